@@ -1,6 +1,7 @@
 #ifndef HTTP_HELPER_COMMON_H
 #define HTTP_HELPER_COMMON_H
 
+#include "../utils/arena.h"
 #include "../utils/vector.h"
 #include "../utils/string.h"
 
@@ -88,6 +89,9 @@ static const char *http_status_messages[] =
 };
 #undef X
 
+/** The number of bytes of a request or response head which are serialized on the stack when sending. Longer heads are serialized on the heap. */
+#define HTTP_HEAD_STACK_CAPACITY 1024
+
 /** Converts an integer HTTP status code to it's status message (i.e. `200 -> OK`). */
 const char *http_status_code_to_message(int status_code);
 
@@ -97,19 +101,9 @@ enum http_request_parsing_states
     /** No parsing state has been assigned yet. */
     REQUEST_PARSING_STATE_NIL = -1,
 
-    // REQUEST LINE
-    /** The method is being parsed. */
-    REQUEST_PARSING_STATE_METHOD,
-    /** The path is being parsed. */
-    REQUEST_PARSING_STATE_PATH,
-    /** The version is being parsed. */
-    REQUEST_PARSING_STATE_VERSION,
-
-    // HEADERS
-    /** The header name is being parsed. */
-    REQUEST_PARSING_STATE_HEADER_NAME,
-    /** The header value is being parsed. */
-    REQUEST_PARSING_STATE_HEADER_VALUE,
+    // REQUEST LINE AND HEADERS
+    /** The request line and headers are being received. */
+    REQUEST_PARSING_STATE_HEAD,
 
     // BODY (CHUNKED)
     /** The chunk size is being parsed. */
@@ -163,6 +157,10 @@ enum parse_request_error_types
     REQUEST_PARSE_ERROR_TOO_MANY_HEADERS = -2,
     /** The request took too long to process. */
     REQUEST_PARSE_ERROR_TIMEOUT = -3,
+    /** The request line or a header was longer than allowed. */
+    REQUEST_PARSE_ERROR_TOO_LONG = -4,
+    /** The request line or a header was not formatted correctly. */
+    REQUEST_PARSE_ERROR_MALFORMED = -5,
 };
 
 /** An enum representing the failure codes for `http_client_parse_response()`. */
@@ -170,6 +168,8 @@ enum parse_response_error_types
 {
     /** The `recv` syscall failed. */
     RESPONSE_PARSE_ERROR_RECV = -1,
+    /** The status line was not formatted correctly. */
+    RESPONSE_PARSE_ERROR_MALFORMED = -2,
 };
 
 /** An enum representing the different connection types. */
@@ -181,6 +181,22 @@ enum connection_types
     CONNECTION_WS
 };
 
+/** The maximum number of values captured from the path of a request by the `:name` segments and `*` of its route. */
+#define HTTP_MAX_ROUTE_PARAMS 8
+
+/** A structure representing a value captured from the path of a request by a `:name` segment or the `*` of its route, which borrows from both. */
+struct http_route_param
+{
+    /** The name of the segment without the `:`, or `*`. Not null terminated. */
+    const char *name;
+    /** The length of the name. */
+    size_t name_length;
+    /** The part of the path the segment matched. Not null terminated. */
+    const char *value;
+    /** The length of the value. */
+    size_t value_length;
+};
+
 /** A structure representing the HTTP request. */
 struct http_request
 {
@@ -203,6 +219,19 @@ struct http_request
 
     /** Whether or not the request wants to upgrade to WS protocol. */
     bool upgrade_websocket;
+
+    /** [SERVER ONLY] The values captured from the path by the route which matched it, in the order of the pattern. */
+    struct http_route_param params[HTTP_MAX_ROUTE_PARAMS];
+    /** [SERVER ONLY] The number of values in `params`. */
+    size_t param_count;
+
+    /** 
+     * [SERVER ONLY] A copy of the request line and headers, only made if the receive buffer had to be refilled before the request was complete.
+     * The method, path, version, query and headers of a parsed request borrow from this (or otherwise from the receive buffer).
+    */
+    char *head_copy;
+    /** [SERVER ONLY] The arena the headers, query, body and head copy of a parsed request are allocated from, or `NULL` if they are allocated on the heap. */
+    struct arena *arena;
 };
 
 /** A structure representing the HTTP response. */
@@ -258,15 +287,17 @@ struct http_server_parsing_state
 
     /** Whether or not parsing the terminating CRLF is done. */
     int parsed_crlf;
-    /** The current HTTP header being populated (if any). */
-    struct http_header header;
-    /** The current chunk length being populated (if any). */
-    char chunk_length[18];
+    /** The number of buffered bytes which have already been searched for the end of the request head, a chunk size or the trailers. */
+    size_t head_scanned;
+    /** The request line and headers, which the strings in the request borrow from. */
+    const char *head;
+    /** The length of the request line and headers, including the terminating CRLF. */
+    size_t head_length;
     /** The current (parsed) chunk size. */
     size_t chunk_size;
     /** The size of the (incomplete) chunk data. */
     size_t incomplete_chunk_data_size;
-    /** The dynamically sized buffer for chunked data. */
+    /** The dynamically sized buffer for chunked data, allocated from the arena of the request. */
     struct vector chunk_data;
 };
 
@@ -306,6 +337,8 @@ const char *http_request_get_path(struct http_request *request);
 const char *http_request_get_version(struct http_request *request);
 /** Gets the value of a request's header, given the name. */
 struct http_header *http_request_get_header(struct http_request *request, const char *name);
+/** Gets the value a `:name` segment (or the `*`) of the route captured from the path, and its length, as it is not null terminated. Returns `NULL` if there is none. */
+const char *http_request_get_param(struct http_request *request, const char *name, size_t *length);
 /** Gets the value of a request's body. */
 char *http_request_get_body(struct http_request *request);
 /** Gets the size of a request's body. */
@@ -352,6 +385,11 @@ void http_header_set_name(struct http_header *header, const char *name);
 /** Sets the value of a header's value. */
 void http_header_set_value(struct http_header *header, const char *value);
 
+/** Gets the number of bytes a vector of headers takes up when serialized. */
+size_t http_headers_serialized_length(struct vector *headers);
+/** Serializes a vector of headers as `Name: Value\r\n` lines. Returns the end of the written bytes. */
+char *http_headers_serialize(struct vector *headers, char *buffer);
+
 /** Gets the value of a query's key. */
 const char *http_query_get_key(struct http_query *query);
 /** Gets the value of a query's value. */
@@ -0,0 +1,85 @@
+#ifndef HTTP_FILE_CACHE_H
+#define HTTP_FILE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+/** The number of files a file cache keeps open by default. */
+#define HTTP_FILE_CACHE_DEFAULT_CAPACITY 64
+/** The number of seconds the metadata of a cached file is trusted before the file is checked for changes again. */
+#define HTTP_FILE_CACHE_REVALIDATE_SECONDS 1
+
+/** A structure representing an open file and its metadata, cached by path. */
+struct http_cached_file
+{
+    /** The path the file was opened with. */
+    char *path;
+    /** The hash of the path. */
+    uint64_t hash;
+
+    /** The open file descriptor. */
+    int fd;
+    /** The size of the file in bytes. */
+    off_t size;
+    /** The time the file was last modified. */
+    time_t modified_at;
+    /** The device of the file, to notice it being replaced. */
+    dev_t device;
+    /** The inode of the file, to notice it being replaced. */
+    ino_t inode;
+    /** The time the metadata was last checked against the file. */
+    time_t validated_at;
+
+    /** The value of the `Last-Modified` header. */
+    char last_modified[32];
+    /** The value of the `ETag` header, quoted. */
+    char etag[48];
+
+    /** The number of responses which are still sending the file. */
+    size_t references;
+    /** Whether or not the file was removed from the cache while it was referenced, in which case it is closed once it is released. */
+    bool evicted;
+
+    /** The more recently used file. */
+    struct http_cached_file *previous;
+    /** The less recently used file. */
+    struct http_cached_file *next;
+    /** The next file in the same bucket. */
+    struct http_cached_file *bucket_next;
+};
+
+/** A structure representing a least recently used cache of open files. */
+struct http_file_cache
+{
+    /** The files, hashed by path. Allocated on the first lookup. */
+    struct http_cached_file **buckets;
+    /** The number of buckets (a power of two). */
+    size_t bucket_count;
+
+    /** The number of cached files. */
+    size_t size;
+    /** The number of files which are kept open. */
+    size_t capacity;
+
+    /** The most recently used file. */
+    struct http_cached_file *head;
+    /** The least recently used file, which is closed first. */
+    struct http_cached_file *tail;
+};
+
+/** Initializes a file cache which keeps up to `capacity` files open (`0` for the default). Memory is only allocated on the first lookup. */
+void http_file_cache_init(struct http_file_cache *cache, size_t capacity);
+/**
+ * Gets an open file and its metadata, opening the file if it is not cached or has changed since it was cached.
+ * The file stays open until it is released. Returns `NULL` and sets `errno` if the path is not a regular file which can be opened.
+*/
+struct http_cached_file *http_file_cache_acquire(struct http_file_cache *cache, const char *path);
+/** Releases a file acquired from a cache. */
+void http_file_cache_release(struct http_cached_file *file);
+/** Frees a file cache. Files which are still referenced are closed once they are released. */
+void http_file_cache_free(struct http_file_cache *cache);
+
+#endif // HTTP_FILE_CACHE_H
@@ -6,10 +6,23 @@ struct web_client;
 
 #include "./common.h"
 
-/** Sends chunked data to the client. Returns 1, otherwise a failure. */
+/** Sends chunked data to the client. An empty chunk ends the response. Returns 1, otherwise a failure. */
 int http_server_send_chunked_data(struct web_server *server, struct web_client *client, const char *data, size_t data_length);
-/** Sends the HTTP response. Returns 1, otherwise a failure. */
+/** 
+ * Sends the HTTP response. Returns 1, otherwise a failure.
+ * If the request or the response has `Connection: close`, the connection is closed once the response (or its last chunk) was sent.
+*/
 int http_server_send_response(struct web_server *server, struct web_client *client, struct http_response *response, const char *data, size_t length);
+/** 
+ * Sends the HTTP response like `http_server_send_response`, but a body of at least `zerocopy_threshold` bytes is sent with `MSG_ZEROCOPY` instead of being copied.
+ * `data` may not be changed or freed until `on_sent` is called. Returns 1, otherwise a failure.
+*/
+int http_server_send_response_zerocopy(struct web_server *server, struct web_client *client, struct http_response *response, const char *data, size_t length, void (*on_sent)(void *data), void *on_sent_data);
+/** 
+ * Sends a file from the disk as the response to a GET or HEAD request, answering conditional (`If-None-Match`) and single `Range` requests.
+ * The file is sent with `sendfile`, and kept open in the file cache of the server. Returns 1, otherwise a failure.
+*/
+int http_server_send_file(struct web_server *server, struct web_client *client, struct http_request *request, const char *path);
 /** Parses the HTTP request. */
 int http_server_parse_request(struct web_server *server, struct web_client *client, struct http_server_parsing_state *current_state);
 
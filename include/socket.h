@@ -4,6 +4,7 @@
 #include "./utils/vector.h"
 #include "./utils/string.h"
 
+#include <stdbool.h>
 #include <sys/types.h>
 #include <sys/fcntl.h>
 
@@ -13,14 +14,66 @@
     typedef int socklen_t;
     typedef SOCKET socket_t;
     typedef SSIZE_T ssize_t;
+
+    /** A buffer for vectored I/O, laid out like the POSIX structure. */
+    struct iovec
+    {
+        /** The start of the buffer. */
+        void *iov_base;
+        /** The length of the buffer. */
+        size_t iov_len;
+    };
 #else
+    #include <sys/uio.h>
+
     typedef int socket_t;
 #endif
 
-/** Dynamically receives from a socket until a certain byte pattern. */
-int socket_recv_until_dynamic(socket_t sockfd, string_t *string, const char *bytes, int remove_delimiter, size_t max_bytes_received);
+/** The number of bytes a socket buffer allocates on its first fill. */
+#define SOCKET_BUFFER_INITIAL_CAPACITY 4096
+
+/** A structure representing bytes received from a socket which have not been consumed yet. */
+struct socket_buffer
+{
+    /** The received bytes. */
+    char *data;
+    /** The number of bytes stored in the buffer. */
+    size_t size;
+    /** The number of bytes the buffer can store before it has to grow. */
+    size_t capacity;
+    /** The number of bytes at the front of the buffer which have already been consumed. */
+    size_t offset;
+    /** Whether or not bytes are appended by the event loop (i.e. io_uring), in which case the buffer never reads the socket itself. */
+    bool filled_externally;
+};
+
+/** Initializes a socket buffer. Memory is only allocated on the first fill. */
+void socket_buffer_init(struct socket_buffer *buffer);
+/** Receives as many bytes as the buffer can hold with one `recv` syscall. Returns the result of the `recv` syscall. */
+ssize_t socket_buffer_fill(socket_t sockfd, struct socket_buffer *buffer);
+/** Gets the number of bytes which have been received but not consumed. */
+size_t socket_buffer_available(struct socket_buffer *buffer);
+/** Receives from a socket through the buffer. Buffered bytes are returned before the socket is read again. Behaves like the `recv` syscall. */
+ssize_t socket_buffer_recv(socket_t sockfd, struct socket_buffer *buffer, void *dest, size_t length, int flags);
+/** Appends bytes to the end of a socket buffer, growing it if needed. Returns `0`, or `-1` if the buffer could not grow. */
+int socket_buffer_append(struct socket_buffer *buffer, const void *data, size_t length);
+/** Receives until at least `length` bytes are buffered. Returns the number of buffered bytes, or the result of the `recv` syscall which stopped it. */
+ssize_t socket_buffer_require(socket_t sockfd, struct socket_buffer *buffer, size_t length);
+/** 
+ * Searches the buffered bytes for a byte pattern, skipping the first `*scanned` bytes which were searched by a previous call.
+ * Returns the number of bytes up to and including the pattern, or `0` if it has not been received yet.
+*/
+size_t socket_buffer_find(struct socket_buffer *buffer, const char *bytes, size_t bytes_length, size_t *scanned);
+/** Frees a socket buffer. */
+void socket_buffer_free(struct socket_buffer *buffer);
+
+/** Dynamically receives from a socket until a certain byte pattern. Returns the number of bytes consumed. */
+int socket_recv_until_dynamic(socket_t sockfd, struct socket_buffer *socket_buffer, string_t *string, const char *bytes, int remove_delimiter, size_t max_bytes_received);
 /** Receives from a socket until a certain byte pattern, or until a fixed length has been surpassed. */
-int socket_recv_until_fixed(socket_t sockfd, char *buffer, size_t buffer_size, const char *bytes, int remove_delimiter);
+int socket_recv_until_fixed(socket_t sockfd, struct socket_buffer *socket_buffer, char *buffer, size_t buffer_size, const char *bytes, int remove_delimiter);
+
+/** Sends several buffers with one `sendmsg` (or `WSASend`) syscall, without copying them together first. Returns the result of the syscall. */
+ssize_t socket_sendv(socket_t sockfd, struct iovec *iov, int iovcnt, int flags);
 
 /** Sets a socket to nonblocking mode. */
 int socket_set_non_blocking(socket_t sockfd);
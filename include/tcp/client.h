@@ -14,6 +14,8 @@ int tcp_client_init(struct tcp_client *client, struct sockaddr *addr, int non_bl
 int tcp_client_connect(struct tcp_client *client);
 /** Sends data to the server. Returns the result of the `send` syscall. */
 int tcp_client_send(struct tcp_client *client, const char *message, size_t msglen, int flags);
+/** Sends several buffers to the server at once. Returns the result of the `sendmsg` syscall. */
+ssize_t tcp_client_sendv(struct tcp_client *client, struct iovec *iov, int iovcnt, int flags);
 /** Receives data from the server. Returns the result of the `recv` syscall. */
 int tcp_client_receive(struct tcp_client *client, const char *message, size_t msglen, int flags);
 
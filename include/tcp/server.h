@@ -2,8 +2,11 @@
 #define TCP_SERVER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "../utils/vector.h"
+#include "../utils/map.h"
+#include "../utils/timer_wheel.h"
 #include "../socket.h"
 
 #ifdef _WIN32
@@ -13,6 +16,77 @@
 #include <arpa/inet.h>
 #endif
 
+struct tcp_server;
+struct tcp_uring;
+
+/** The event loop backends a TCP server can run on. */
+enum tcp_server_backend
+{
+    /** epoll on Linux, kqueue on macOS and WSAPoll on Windows. */
+    TCP_SERVER_BACKEND_POLL,
+    /** 
+     * io_uring on Linux 6.1 and above, with multishot accepts and multishot receives into provided buffers.
+     * Received bytes are appended to the `recv_buffer` of the client before `on_data` is called, so clients have to be read through it.
+     * Falls back to `TCP_SERVER_BACKEND_POLL` if the kernel lacks io_uring.
+    */
+    TCP_SERVER_BACKEND_IO_URING,
+};
+
+/** A range of a file, or of a buffer which is sent without being copied, queued to be sent to a client behind the bytes which were queued in front of it. */
+struct tcp_queued_range
+{
+    /** The number of queued bytes of `send_buffer` which have to be sent before the range (and after the previous queued range). */
+    size_t bytes_before;
+    /** The file descriptor of the file, or `-1` if the range is of `buffer`. */
+    int fd;
+    /** The buffer which is sent with `MSG_ZEROCOPY`, or `NULL` if the range is of a file. */
+    const char *buffer;
+    /** The offset of the next byte to send. */
+    off_t offset;
+    /** The number of bytes left to send. */
+    size_t length;
+    /** Whether or not any bytes of the buffer were sent without being copied, so the kernel still references it. */
+    bool zerocopied;
+    /** The sequence number of the last zerocopy send of the buffer. */
+    uint32_t sequence;
+    /** The callback for when the range has been sent (and the kernel no longer references the buffer), or can no longer be sent. */
+    void (*on_sent)(void *data);
+    /** The data passed to `on_sent`. */
+    void *data;
+};
+
+/** A buffer which was sent without being copied, and is released once the kernel reports that the zerocopy sends up to `sequence` are complete. */
+struct tcp_zerocopy_release
+{
+    /** The sequence number of the last zerocopy send of the buffer. */
+    uint32_t sequence;
+    /** The callback for when the kernel no longer references the buffer. */
+    void (*on_sent)(void *data);
+    /** The data passed to `on_sent`. */
+    void *data;
+};
+
+/** The zerocopy sends of a closed client, which are held until the kernel completes them, as it still sends their buffers after the socket is closed. */
+struct tcp_zerocopy_closed
+{
+    /** A duplicate of the socket of the client, which keeps its error queue readable after the client's socket is closed. */
+    socket_t sockfd;
+    /** The buffers waiting for the kernel to complete their sends. */
+    struct vector releases; // <struct tcp_zerocopy_release>
+    /** The index of the held sends in the `zerocopy_closed` of the server. */
+    size_t index;
+    /** The timer for reaping the completions, as the socket is no longer polled. */
+    struct wheel_timer timer;
+    /** The server which closed the client. */
+    struct tcp_server *server;
+};
+
+/** The number of milliseconds between reaping the completions of the zerocopy sends of closed clients. */
+#define TCP_SERVER_ZEROCOPY_CLOSED_INTERVAL 100
+
+/** The number of bytes a corked client holds back before they are written anyway, as copying more costs more than the syscall it saves. */
+#define TCP_SERVER_CORK_LIMIT 65536
+
 /** A structure representing a TCP client. */
 struct tcp_client
 {
@@ -29,6 +103,35 @@ struct tcp_client
     int pfd;
 #endif 
 
+    /** The bytes received from the socket which have not been parsed yet. */
+    struct socket_buffer recv_buffer;
+    /** [SERVER ONLY] The bytes which have been sent, but could not be written to the socket yet. */
+    struct socket_buffer send_buffer;
+    /** [SERVER ONLY] The files and buffers which are queued to be sent, in order, between the bytes of `send_buffer`. */
+    struct vector send_ranges; // <struct tcp_queued_range>
+    /** [SERVER ONLY] Whether or not `SO_ZEROCOPY` is enabled on the socket. */
+    bool zerocopy_enabled;
+    /** [SERVER ONLY] Whether or not zerocopy sends are not worth it for the socket, as the kernel cannot do them or copied the bytes anyway. */
+    bool zerocopy_unavailable;
+    /** [SERVER ONLY] The sequence number of the next zerocopy send, counted like the kernel counts them. */
+    uint32_t zerocopy_sequence;
+    /** [SERVER ONLY] The number of zerocopy sends the kernel reported complete, which may include the sends of a buffer still being sent. */
+    uint32_t zerocopy_completed;
+    /** [SERVER ONLY] The buffers which were sent without being copied, and are waiting for the kernel to complete the sends. */
+    struct vector zerocopy_releases; // <struct tcp_zerocopy_release>
+    /** [SERVER ONLY] Whether or not more bytes than the high watermark are queued, and have not drained to the low watermark since. */
+    bool backpressured;
+    /** [SERVER ONLY] Whether or not sent bytes are held back until `tcp_server_uncork`, so several sends are written together. */
+    bool corked;
+    /** [SERVER ONLY] The number of bytes of `send_buffer` which are held back by the cork, and are not waiting for writability. */
+    size_t corked_bytes;
+    /** [SERVER ONLY] Whether or not the client is closed once its queued bytes, files and buffers are sent. */
+    bool closing;
+    /** [SERVER ONLY] The server which accepted the client. */
+    struct tcp_server *server;
+    /** [SERVER ONLY] The address of the peer, which `sockaddr` points to. */
+    struct sockaddr_storage peer_address;
+
     /** User defined data to be passed to the event callbacks. */
     void *data;
 
@@ -56,14 +159,56 @@ struct tcp_server
     /** The number of clients connected to the server. */
     size_t client_count;
 
+    /** The clients which were accepted and are not closed yet, indexed by their sockets, so closing a client frees its buffers. */
+    struct map clients; // <socket_t sockfd, struct tcp_client *client>
+    /** The clients which have bytes queued to be sent once their socket is writable, indexed by their sockets so an event finds its client in one load. */
+    struct map pending_clients; // <socket_t sockfd, struct tcp_client *client>
+    /** The number of queued bytes after which a client is backpressured. Defaults to `1048576`. */
+    size_t send_high_watermark;
+    /** The number of queued bytes a client has to drain to before `on_drain` is called. Defaults to `0`. */
+    size_t send_low_watermark;
+    /** 
+     * [LINUX ONLY] The size from which `tcp_server_send_zerocopy` sends a buffer with `MSG_ZEROCOPY` instead of copying it. Defaults to `0`, which never does.
+     * Pinning pages is only cheaper than copying them for large buffers (around 10 KB and above).
+    */
+    size_t zerocopy_threshold;
+    /** The clients which have `SO_ZEROCOPY` enabled, whose error queues report completed zerocopy sends, indexed by their sockets. */
+    struct map zerocopy_clients; // <socket_t sockfd, struct tcp_client *client>
+    /** The zerocopy sends of closed clients which the kernel has not completed yet. */
+    struct vector zerocopy_closed; // <struct tcp_zerocopy_closed *>
+
 #ifdef _WIN32
     /** The events stored by the server. */
     struct vector events; // <struct pollfd>
 #else
     /** The polling file descriptor. */
     int pfd;
+    /** [LINUX ONLY] The eventfd which `tcp_server_wake` writes to, polled alongside the sockets. `-1` for a blocking server, or on other systems. */
+    int wake_fd;
+    /** The events filled in by one poll, allocated when the main loop starts and freed when it stops. */
+    void *poll_events; // <struct epoll_event> or <struct kevent>
+    /** The number of events `poll_events` has room for. */
+    size_t poll_events_capacity;
 #endif 
 
+    /** 
+     * Whether or not client sockets are polled as edge triggered (`EPOLLET`/`EV_CLEAR`). Defaults to `false`, and has to be set before clients connect.
+     * An edge triggered socket is only reported again for new bytes, so `on_data` has to read until the socket would block.
+    */
+    bool edge_triggered;
+    /** The maximum number of connections `on_connect` should accept per wakeup, so connected clients are not starved. Defaults to `64`. */
+    size_t accept_budget;
+    /** The event loop backend the server runs on. */
+    enum tcp_server_backend backend;
+    /** [IO_URING ONLY] The io_uring instance of the server. */
+    struct tcp_uring *uring;
+
+    /** The maximum number of events handled per poll. Defaults to `1024`, and changes take effect when the main loop starts. */
+    size_t max_events;
+
+    /** The timers of the clients, which the main loop waits for alongside the sockets and expires after handling their events. */
+    struct timer_wheel timers;
+
     /** User defined data to be passed to the event callbacks. */
     void *data;
 
@@ -73,6 +218,10 @@ struct tcp_server
     void (*on_data)(struct tcp_server *server, socket_t sockfd);
     /** The callback for when a client socket disconnects. */
     void (*on_disconnect)(struct tcp_server *server, socket_t sockfd, bool is_error);
+    /** The callback for when the bytes queued for a client drain to the low watermark. */
+    void (*on_drain)(struct tcp_server *server, socket_t sockfd);
+    /** The callback for when `tcp_server_wake` is called, on the thread running the main loop. */
+    void (*on_wake)(struct tcp_server *server);
 };
 
 /** The main loop of a nonblocking TCP server. */
@@ -80,21 +229,72 @@ int tcp_server_main_loop(struct tcp_server *server);
 
 /** Initializes a TCP server. */
 int tcp_server_init(struct tcp_server *server, struct sockaddr *address, bool non_blocking);
+/** Initializes a TCP server which runs on a specific backend. `server->backend` tells which backend is used after a fallback. */
+int tcp_server_init_backend(struct tcp_server *server, struct sockaddr *address, bool non_blocking, enum tcp_server_backend backend);
 /** Binds a TCP server to an address. */
 int tcp_server_bind(struct tcp_server *server);
 /** Starts listening for connections on a TCP server. */
 int tcp_server_listen(struct tcp_server *server, int backlog);
-/** Accepts a connection on the TCP server. */
+/** 
+ * Accepts a connection on the TCP server. The peer address is stored inline in the client, so `client->sockaddr` is not to be freed.
+ * The client has to stay valid until it is closed with `tcp_server_close_client` or the server is closed, as closing it frees its buffers.
+ * A nonblocking server returns `EWOULDBLOCK` once no connections are left to accept. A connection which cannot be polled is closed before the error is returned.
+*/
 int tcp_server_accept(struct tcp_server *server, struct tcp_client *client);
 
 /** Sends a message to the client. Returns the result of the `send` syscall. */
 int tcp_server_send(socket_t sockfd, const char *message, size_t msglen, int flags);
+/** Sends several buffers to the client at once. Returns the result of the `sendmsg` syscall. */
+ssize_t tcp_server_sendv(socket_t sockfd, struct iovec *iov, int iovcnt, int flags);
+/** 
+ * Sends several buffers to the client, queueing whatever the socket cannot take yet. Queued bytes are sent in order once the socket is writable.
+ * Returns the number of bytes sent or queued, or `-1` if the `sendmsg` syscall failed.
+*/
+ssize_t tcp_server_send_queued(struct tcp_server *server, struct tcp_client *client, struct iovec *iov, int iovcnt);
+/** 
+ * Sends several buffers followed by `length` bytes of a file from `offset`, with `sendfile` so the file is never copied through memory.
+ * Whatever the socket cannot take yet is queued like `tcp_server_send_queued`, and the file has to stay open until then.
+ * `on_sent` (if not `NULL`) is called once the file has been sent or can no longer be sent, including when this fails.
+ * Returns the number of bytes sent or queued, or `-1` if a syscall failed.
+*/
+ssize_t tcp_server_sendfile_queued(struct tcp_server *server, struct tcp_client *client, struct iovec *head, int head_count, int fd, off_t offset, size_t length, void (*on_sent)(void *data), void *data);
+/** 
+ * Sends several buffers followed by `length` bytes of `buffer`, which is sent with `MSG_ZEROCOPY` if it is at least `zerocopy_threshold` bytes long.
+ * Whatever the socket cannot take yet is queued like `tcp_server_send_queued`, but `buffer` is referenced rather than copied.
+ * `buffer` may not be changed or freed until `on_sent` is called, which happens once the kernel no longer references it, or right away if it was copied.
+ * The kernel still sends the buffer after the client is closed, so `on_sent` may be called after `on_disconnect`. Closing the server releases every buffer right away.
+ * Returns the number of bytes sent or queued, or `-1` if a syscall failed (`on_sent` is still called).
+*/
+ssize_t tcp_server_send_zerocopy(struct tcp_server *server, struct tcp_client *client, struct iovec *head, int head_count, const char *buffer, size_t length, void (*on_sent)(void *data), void *data);
+/** 
+ * Holds back the bytes sent to a client with `tcp_server_send_queued` until `tcp_server_uncork`, so the responses to several requests leave in one syscall.
+ * Up to `TCP_SERVER_CORK_LIMIT` bytes are held, and sends past it are written together with the held bytes right away. Files and buffers are written after the held bytes.
+ * Held bytes are dropped if the client is closed before it is uncorked.
+*/
+void tcp_server_cork(struct tcp_server *server, struct tcp_client *client);
+/** Writes the bytes held back by the cork of a client, queueing whatever the socket cannot take yet. Returns `0`, or `-1` if the `sendmsg` syscall failed. */
+int tcp_server_uncork(struct tcp_server *server, struct tcp_client *client);
+/** Whether or not a client has more bytes queued than the high watermark. Producers should stop sending to it until `on_drain` is called. */
+bool tcp_server_is_backpressured(struct tcp_server *server, struct tcp_client *client);
 /** Receives a message from the client. Returns the result of the `recv` syscall. */
 int tcp_server_receive(socket_t sockfd, const char *message, size_t msglen, int flags);
 
+/** 
+ * Wakes the main loop of a nonblocking server, which calls `on_wake` on its own thread. Several wakeups before the loop handles them call it once.
+ * This is the only function which may be called from another thread while the main loop runs, so the loop can be told to stop and close the server itself.
+ * Returns `0`, or an error code if the wakeup could not be sent.
+*/
+int tcp_server_wake(struct tcp_server *server);
+
 /** Closes the TCP server. */
 int tcp_server_close_self(struct tcp_server *server);
-/** Closes a client connection. */
+/** Closes a client connection, dropping whatever is still queued for it and freeing its receive and send buffers before `on_disconnect` is called. */
 int tcp_server_close_client(struct tcp_server *server, socket_t sockfd, bool is_error);
+/** 
+ * Uncorks a client and closes it once the bytes, files and buffers queued for it are sent, or right away if none are.
+ * `closing` is set on the client while its queue is flushed, and nothing should be sent to it after this.
+ * Returns `0`, or the result of closing it if it could not be uncorked.
+*/
+int tcp_server_close_client_flushed(struct tcp_server *server, struct tcp_client *client);
 
 #endif // TCP_SERVER_H
\ No newline at end of file
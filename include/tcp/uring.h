@@ -0,0 +1,181 @@
+#ifndef TCP_URING_H
+#define TCP_URING_H
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define TCP_URING_SUPPORTED
+#endif
+#endif
+
+#ifdef TCP_URING_SUPPORTED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+#include "../utils/vector.h"
+
+struct tcp_client;
+
+/** The number of submission queue entries of the ring. */
+#define TCP_URING_ENTRIES 256
+/** The number of completion queue entries of the ring. */
+#define TCP_URING_CQ_ENTRIES 4096
+/** The number of buffers the kernel can receive into (a power of two). */
+#define TCP_URING_BUFFER_COUNT 256
+/** The size of each buffer the kernel can receive into. */
+#define TCP_URING_BUFFER_SIZE 8192
+/** The ID of the group of provided buffers. */
+#define TCP_URING_BUFFER_GROUP 0
+
+/** The operations which are submitted to the ring, stored in the user data of their entries. */
+enum tcp_uring_operations
+{
+    /** A multishot accept on the listening socket. */
+    TCP_URING_OP_ACCEPT = 1,
+    /** A multishot receive into the provided buffers. */
+    TCP_URING_OP_RECV,
+    /** A oneshot poll for the writability of a client socket. */
+    TCP_URING_OP_POLL_WRITABLE,
+    /** A cancellation of the operations of a closed client socket. */
+    TCP_URING_OP_CANCEL,
+    /** A oneshot poll for the error queue of a client socket, which reports completed zerocopy sends. */
+    TCP_URING_OP_POLL_ERROR,
+    /** A oneshot poll for the eventfd which `tcp_server_wake` writes to. */
+    TCP_URING_OP_POLL_WAKE,
+};
+
+/** A structure representing the state of a client socket, indexed by its file descriptor. */
+struct tcp_uring_slot
+{
+    /** The client which was accepted with the file descriptor, or `NULL` if it is not open. */
+    struct tcp_client *client;
+    /** Incremented whenever the file descriptor is closed, so completions of a previous client can be told apart. */
+    uint32_t generation;
+    /** Whether or not a poll for writability is submitted. */
+    bool writable_armed;
+    /** Whether or not a poll for the error queue is submitted. */
+    bool error_armed;
+    /** Whether or not the client is in the list of clients to dispatch. */
+    bool ready;
+    /** Whether or not bytes were appended to the receive buffer of the client. */
+    bool readable;
+    /** Whether or not the client has hung up, or its socket failed. */
+    bool hangup;
+    /** Whether or not the socket failed. */
+    bool error;
+    /** Whether or not the socket has become writable. */
+    bool writable;
+    /** Whether or not the error queue of the socket has become readable. */
+    bool error_queued;
+};
+
+/** A structure representing an io_uring instance driving a TCP server. */
+struct tcp_uring
+{
+    /** The io_uring file descriptor. */
+    int fd;
+    /** Whether or not the ring has been enabled by the thread which runs the main loop. */
+    bool enabled;
+
+    /** The mapped submission queue ring. */
+    void *sq_ring;
+    /** The length of the mapped submission queue ring. */
+    size_t sq_ring_length;
+    /** The head of the submission queue, advanced by the kernel. */
+    unsigned *sq_head;
+    /** The tail of the submission queue, advanced by the server. */
+    unsigned *sq_tail;
+    /** The mask for indexing the submission queue. */
+    unsigned sq_mask;
+    /** The number of entries of the submission queue. */
+    unsigned sq_entries;
+    /** The indices of the submitted entries. */
+    unsigned *sq_array;
+    /** The tail of the entries which are filled in but not yet visible to the kernel. */
+    unsigned sq_local_tail;
+    /** The mapped submission queue entries. */
+    struct io_uring_sqe *sqes;
+    /** The length of the mapped submission queue entries. */
+    size_t sqes_length;
+
+    /** The mapped completion queue ring. */
+    void *cq_ring;
+    /** The length of the mapped completion queue ring. */
+    size_t cq_ring_length;
+    /** The head of the completion queue, advanced by the server. */
+    unsigned *cq_head;
+    /** The tail of the completion queue, advanced by the kernel. */
+    unsigned *cq_tail;
+    /** The mask for indexing the completion queue. */
+    unsigned cq_mask;
+    /** The completion queue entries. */
+    struct io_uring_cqe *cqes;
+
+    /** The ring of buffers provided to the kernel for receiving. */
+    struct io_uring_buf_ring *buffer_ring;
+    /** The memory of the provided buffers. */
+    char *buffers;
+    /** The tail of the provided buffer ring. */
+    uint16_t buffer_tail;
+
+    /** The state of every client socket, indexed by file descriptor. */
+    struct tcp_uring_slot *slots;
+    /** The number of slots allocated. */
+    size_t slots_capacity;
+
+    /** The sockets accepted by the kernel, which have not been handed to `tcp_server_accept` yet. */
+    struct vector accepted; // <int>
+    /** The client sockets which have completions to dispatch. */
+    struct vector ready; // <int>
+    /** Whether or not the server was woken, so `on_wake` is called with the dispatch. */
+    bool woken;
+};
+
+/** Builds the user data of a submission, which is handed back in its completions. */
+#define TCP_URING_USER_DATA(operation, fd, generation) (((uint64_t)(operation) << 56) | ((uint64_t)((generation) & 0xFFFFFF) << 32) | (uint32_t)(fd))
+/** Gets the operation from the user data of a completion. */
+#define TCP_URING_OPERATION(user_data) ((int)((user_data) >> 56))
+/** Gets the file descriptor from the user data of a completion. */
+#define TCP_URING_FD(user_data) ((int)(uint32_t)(user_data))
+/** Gets the generation from the user data of a completion. */
+#define TCP_URING_GENERATION(user_data) ((uint32_t)(((user_data) >> 32) & 0xFFFFFF))
+
+/** Sets up a disabled ring and registers the provided buffers. Returns `0`, or `-1` if the kernel lacks the needed io_uring features. */
+int tcp_uring_init(struct tcp_uring *uring);
+/** Enables the ring. The calling thread becomes the only thread which may submit to it. */
+int tcp_uring_enable(struct tcp_uring *uring);
+/** Gets a zeroed submission queue entry, submitting the queued ones first if the queue is full. */
+struct io_uring_sqe *tcp_uring_get_sqe(struct tcp_uring *uring);
+/** Submits the queued entries and waits for at least `wait_nr` completions. Returns the result of the `io_uring_enter` syscall. */
+int tcp_uring_submit(struct tcp_uring *uring, unsigned wait_nr);
+/** Submits the queued entries and waits for a completion, or `timeout` milliseconds (`-1` waits indefinitely). Returns `-1` if the `io_uring_enter` syscall failed. */
+int tcp_uring_wait(struct tcp_uring *uring, int timeout);
+
+/** Queues a multishot accept on a listening socket. */
+int tcp_uring_prep_accept(struct tcp_uring *uring, int sockfd);
+/** Queues a multishot receive into the provided buffers on a client socket. */
+int tcp_uring_prep_recv(struct tcp_uring *uring, int sockfd, uint32_t generation);
+/** Queues a oneshot poll for the writability of a client socket. */
+int tcp_uring_prep_poll_writable(struct tcp_uring *uring, int sockfd, uint32_t generation);
+/** Queues a oneshot poll which completes once the socket has an error, such as a completed zerocopy send. */
+int tcp_uring_prep_poll_error(struct tcp_uring *uring, int sockfd, uint32_t generation);
+/** Queues a oneshot poll for the readability of the eventfd which wakes the server. */
+int tcp_uring_prep_poll_wake(struct tcp_uring *uring, int fd);
+/** Queues the cancellation of every submission with the given user data. */
+int tcp_uring_prep_cancel(struct tcp_uring *uring, uint64_t user_data);
+
+/** Gets a provided buffer by its ID. */
+char *tcp_uring_buffer(struct tcp_uring *uring, uint16_t buffer_id);
+/** Hands a provided buffer back to the kernel once its bytes have been consumed. */
+void tcp_uring_recycle_buffer(struct tcp_uring *uring, uint16_t buffer_id);
+
+/** Gets the slot of a file descriptor, growing the slots if needed. Returns `NULL` if they could not grow. */
+struct tcp_uring_slot *tcp_uring_slot(struct tcp_uring *uring, int sockfd);
+
+/** Frees the ring and the provided buffers. */
+void tcp_uring_free(struct tcp_uring *uring);
+
+#endif // TCP_URING_SUPPORTED
+
+#endif // TCP_URING_H
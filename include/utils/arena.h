@@ -0,0 +1,50 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/** The number of bytes of each page of an arena by default. */
+#define ARENA_DEFAULT_PAGE_SIZE 4096
+
+/** A structure representing a page of an arena, followed by its bytes. */
+struct arena_page
+{
+    /** The next page, which is only used once this one is full. */
+    struct arena_page *next;
+    /** The number of bytes of the page. */
+    size_t capacity;
+};
+
+/** 
+ * A structure representing a bump pointer arena. Allocations are carved out of pages in order and only freed all at once.
+ * A zeroed arena is empty and allocates its first page when it is first used. Pages are kept when the arena is reset, so it only grows for the largest use.
+*/
+struct arena
+{
+    /** The first page. */
+    struct arena_page *pages;
+    /** The page allocations are carved out of. */
+    struct arena_page *current;
+    /** The number of bytes of the current page which are allocated. */
+    size_t used;
+    /** The number of bytes of each page (`0` for the default). Larger allocations get a page of their own size. */
+    size_t page_size;
+};
+
+/** Initializes an empty arena with pages of `page_size` bytes (`0` for the default). */
+void arena_init(struct arena *arena, size_t page_size);
+
+/** Allocates `size` bytes, aligned for any type. Returns `NULL` if a page could not be allocated. */
+void *arena_alloc(struct arena *arena, size_t size);
+/** 
+ * Grows an allocation from `old_size` to `new_size` bytes, keeping its contents. 
+ * The last allocation grows in place if its page has room for it. Otherwise, the bytes are copied into a new allocation.
+*/
+void *arena_realloc(struct arena *arena, void *allocation, size_t old_size, size_t new_size);
+
+/** Frees every allocation at once, keeping the pages to be used again. */
+void arena_reset(struct arena *arena);
+/** Frees the arena, and every page with it. */
+void arena_free(struct arena *arena);
+
+#endif // ARENA_H
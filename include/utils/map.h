@@ -4,41 +4,33 @@
 #include <stddef.h>
 #include <stdbool.h>
 
-/** A struct representing a map with int-only keys. */
+/** 
+ * A struct representing a map with small, non-negative int keys, such as file descriptors.
+ * Every value is stored at the index of its key, so a lookup is one bounds check and one load, and never hashes or probes.
+*/
 struct map
 {
     /** The number of entries in the map. */
     size_t size;
-    /** The capacity of the map. */
+    /** The number of keys the map has room for, one past the largest key it can hold without growing. */
     size_t capacity;
-    /** The entries in the map. */
-    struct map_entry *entries;
+    /** The values in the map, indexed by their keys. A key without a value is `NULL`. */
+    void **values;
 };
 
-/** A struct representing an entry in a map. */
-struct map_entry
-{
-    /** The key of the entry. */
-    int key;
-    /** The value of the entry. */
-    void *value;
-    /** Whether or not the entry has been initialised. */
-    bool initialised;
-};
-
-/** Initializes the map. */
+/** Initializes the map with room for the keys below `capacity`. */
 void map_init(struct map *map, size_t capacity);
-/** Resizes the vector. Returns a `0` if a resize is required, or a `-1` if not. */
-int map_resize(struct map *map);
+/** Grows the map to hold the keys below `capacity`. Returns a `0` if it grew, or a `-1` if it did not have to or could not. */
+int map_resize(struct map *map, size_t capacity);
 
-/** Gets an element. */
+/** Gets an element, or `NULL` if the key has none. */
 void *map_get(struct map *map, int key);
-/** Sets an element. */
-void map_set(struct map *map, int key, void *value);
+/** Sets an element, growing the map if the key does not fit. Returns `0`, or `-1` if the key is negative or the map could not grow. */
+int map_set(struct map *map, int key, void *value);
 /** Removes an element. */
 void map_delete(struct map *map, int key);
 
 /** Frees the map. */
 void map_free(struct map *map, bool free_values);
 
-#endif // MAP_H
\ No newline at end of file
+#endif // MAP_H
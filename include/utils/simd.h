@@ -0,0 +1,35 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** The instruction sets which vectorized routines can be selected from at runtime. */
+enum simd_level
+{
+    /** Plain C, for CPUs (or compilers) without any of the extensions below. */
+    SIMD_LEVEL_SCALAR,
+    /** SSE2 (every x86-64 CPU). */
+    SIMD_LEVEL_SSE2,
+    /** SSE4.2, which adds `pcmpestri` for range searches. */
+    SIMD_LEVEL_SSE42,
+    /** AVX2, which doubles the vector width to 32 bytes. */
+    SIMD_LEVEL_AVX2,
+};
+
+/** Detects the best instruction set supported by the CPU using CPUID. The result is cached after the first call. */
+enum simd_level simd_get_level(void);
+
+/** 
+ * Finds the first byte of `data` which falls in one of the inclusive ranges in `ranges`, given as pairs of low and high bytes (i.e. `"\x00\x1f\x7f\x7f"`).
+ * At most 8 ranges (16 bytes) are supported. Returns the offset of the byte, or `length` if no byte matched.
+*/
+size_t simd_find_ranges(const char *data, size_t length, const char *ranges, size_t ranges_length);
+
+/** 
+ * XORs `length` bytes of `source` with a repeating 4 byte masking key into `destination`, which may be `source` itself to mask in place.
+ * The first byte is XORed with byte `phase % 4` of the key, so a payload received in parts is masked as if it were whole.
+*/
+void simd_mask(uint8_t *destination, const uint8_t *source, size_t length, const uint8_t masking_key[4], size_t phase);
+
+#endif // SIMD_H
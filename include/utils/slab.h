@@ -0,0 +1,35 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+
+/** 
+ * A structure representing a slab of fixed size slots, allocated at once and recycled through a free list.
+ * The free list is kept apart from the slots, so a released slot keeps its contents until it is acquired again.
+*/
+struct slab
+{
+    /** The memory of every slot. */
+    void *slots;
+    /** The size of each slot, rounded up to keep every slot aligned. */
+    size_t slot_size;
+    /** The number of slots. */
+    size_t capacity;
+    /** The indices of the free slots, the most recently released last. */
+    size_t *free_slots;
+    /** The number of free slots. */
+    size_t free_count;
+};
+
+/** Initializes a slab of `capacity` slots of `slot_size` bytes. Every slot is touched, so the memory is resident up front. Returns `-1` if it could not be allocated. */
+int slab_init(struct slab *slab, size_t slot_size, size_t capacity);
+
+/** Acquires a zeroed slot, or returns `NULL` if every slot is in use. */
+void *slab_acquire(struct slab *slab);
+/** Releases a slot to be acquired again. */
+void slab_release(struct slab *slab, void *slot);
+
+/** Frees the slab, and every slot with it. */
+void slab_free(struct slab *slab);
+
+#endif // SLAB_H
@@ -23,6 +23,14 @@ typedef struct sso_string {
 
 /** Initializes a SSO string. */
 void sso_string_init(string_t *string, const char *data);
+/** 
+ * Initializes a SSO string which borrows `length` bytes of `data` instead of copying them.
+ * Strings short enough to be stored inline are copied. Otherwise `data[length]` must be a null terminator,
+ * and `data` must outlive the string.
+ */
+void sso_string_init_view(string_t *string, const char *data, size_t length);
+/** Whether or not the SSO string borrows its data. */
+int sso_string_is_view(string_t *string);
 /** Sets the value of a SSO string. */
 void sso_string_set(string_t *string, const char *data);
 /** Gets the value of a SSO string. */
@@ -32,6 +40,8 @@ const char *sso_string_get(string_t *string);
 void sso_string_concat(string_t *dest, string_t *src);
 /** Concatenates a SSO string and a char *buffer. */
 void sso_string_concat_buffer(string_t *dest, const char *src);
+/** Concatenates a SSO string and `length` bytes of a buffer. */
+void sso_string_concat_bytes(string_t *dest, const char *src, size_t length);
 /** Concatenates a SSO string and a char. */
 void sso_string_concat_char(string_t *dest, const char src);
 /** Goes back `n` chars and inserts a null terminator. */
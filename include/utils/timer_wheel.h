@@ -0,0 +1,76 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** The number of slots of each level of a timer wheel. A level fits in the bits of a `uint64_t`. */
+#define TIMER_WHEEL_SLOTS 64
+/** The number of levels of a timer wheel. Each level spans `TIMER_WHEEL_SLOTS` times the one below it. */
+#define TIMER_WHEEL_LEVELS 4
+/** The number of milliseconds per tick of a timer wheel by default. */
+#define TIMER_WHEEL_DEFAULT_RESOLUTION 100
+
+/** A structure representing a timer which can be armed on a timer wheel, stored in the structure it times out. */
+struct wheel_timer
+{
+    /** The tick the timer expires at. */
+    uint64_t expires_at;
+    /** Whether or not the timer is armed. */
+    bool armed;
+    /** The level the timer is placed in. */
+    uint8_t level;
+    /** The slot of the level the timer is placed in. */
+    uint8_t slot;
+
+    /** The previous timer in the same slot. */
+    struct wheel_timer *previous;
+    /** The next timer in the same slot. */
+    struct wheel_timer *next;
+
+    /** The callback for when the timer expires. The timer is disarmed first, so it may be armed again. */
+    void (*on_expire)(struct wheel_timer *timer);
+    /** User defined data to be passed to `on_expire`. */
+    void *data;
+};
+
+/**
+ * A structure representing a hierarchical timer wheel. Timers are armed and cancelled in constant time.
+ * A timer is placed in the lowest level whose span covers it, and moved down a level whenever the level below wraps around.
+*/
+struct timer_wheel
+{
+    /** The timers of every slot of every level. */
+    struct wheel_timer *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    /** The slots which have timers, one bit per slot of each level. */
+    uint64_t occupied[TIMER_WHEEL_LEVELS];
+
+    /** The number of milliseconds per tick. */
+    uint32_t resolution;
+    /** The tick the wheel has advanced to. */
+    uint64_t current;
+    /** The number of armed timers. */
+    size_t count;
+};
+
+/** Gets the milliseconds of a monotonic clock. */
+uint64_t timer_wheel_now(void);
+
+/** Initializes a timer wheel which ticks every `resolution` milliseconds (`0` for the default). */
+void timer_wheel_init(struct timer_wheel *wheel, uint32_t resolution);
+/** Arms a timer to expire in `timeout` milliseconds, up to one tick late. A timer which is already armed is moved. */
+void timer_wheel_arm(struct timer_wheel *wheel, struct wheel_timer *timer, uint64_t timeout);
+/** Cancels a timer. Nothing happens if the timer is not armed. */
+void timer_wheel_cancel(struct timer_wheel *wheel, struct wheel_timer *timer);
+/**
+ * Gets the number of milliseconds a poll may wait for before the wheel has to advance, or `-1` if no timer is armed.
+ * Timers in the upper levels only need the wheel to advance once the lowest level wraps around, so the wait is bounded by it.
+*/
+int timer_wheel_next_timeout(struct timer_wheel *wheel);
+/** Advances the wheel to the current time, calling `on_expire` for every timer which expired. Timers may be armed and cancelled from the callbacks. */
+void timer_wheel_advance(struct timer_wheel *wheel);
+/** Forgets every armed timer without calling them, as their memory may already be freed. */
+void timer_wheel_clear(struct timer_wheel *wheel);
+
+#endif // TIMER_WHEEL_H
@@ -7,6 +7,28 @@
 #include "../http/client.h"
 #include "../ws/client.h"
 #include "../ws/common.h"
+#include "../ws/deflate.h"
+#include "../utils/arena.h"
+#include "../utils/timer_wheel.h"
+
+struct web_server_route;
+
+/** An enum representing the deadlines a connection to a server can be waiting for. */
+enum web_client_timeouts
+{
+    /** The connection is not timed out. */
+    WEB_CLIENT_TIMEOUT_NONE,
+    /** The request line and headers of a request are being received. */
+    WEB_CLIENT_TIMEOUT_HEADER,
+    /** The body of a request is being received. */
+    WEB_CLIENT_TIMEOUT_BODY,
+    /** The connection is idle between requests. */
+    WEB_CLIENT_TIMEOUT_KEEP_ALIVE,
+    /** The WebSocket connection is waiting for a frame. */
+    WEB_CLIENT_TIMEOUT_WS_IDLE,
+    /** The connection is closing, and waiting for its last bytes to be sent. */
+    WEB_CLIENT_TIMEOUT_CLOSING,
+};
 
 /** A structure representing a client connection over HTTP/WS. */
 struct web_client
@@ -19,8 +41,23 @@ struct web_client
 
     /** [WS SERVER ONLY] The path the client is connected to. */
     const char *path;
+    /** [WS SERVER ONLY] The route the client upgraded on, so its frames are dispatched without matching the path again. `NULL` once the route is removed. */
+    struct web_server_route *route;
+    /** [WS SERVER ONLY] The topics the client is subscribed to. */
+    struct vector subscriptions; // <struct ws_subscription>
     /** [WS CLIENT ONLY] Whether or not the client has already closed. */
     bool is_closed;
+    /** [WS ONLY] The permessage-deflate state of the connection, or `NULL` if it was not negotiated. */
+    struct ws_deflate *deflate;
+    /** [WS ONLY] The buffer payloads are masked or compressed into before they are sent. It only grows, and is freed once the connection closes. */
+    struct vector send_scratch; // <uint8_t>
+
+    /** [SERVER ONLY] The timer which closes the connection once its deadline passes. */
+    struct wheel_timer timeout;
+    /** [SERVER ONLY] The deadline `timeout` is armed for. */
+    enum web_client_timeouts timeout_kind;
+    /** [HTTP SERVER ONLY] The arena the request being parsed is allocated from. It is reset once the request is handled, keeping its pages for the next one. */
+    struct arena request_arena;
 
     /** User defined data to be passed to the event callbacks. */
     void *data;
@@ -74,6 +111,8 @@ struct web_client
          * Do not set to `true` if the server replies to pong frames.
         */
         bool record_latency;
+        /** permessage-deflate (RFC 7692), which is offered to the server when enabled. */
+        struct ws_deflate_config permessage_deflate;
     } ws_client_config;
 
     /** The callback for when the client connects via HTTP. */
@@ -8,11 +8,36 @@
 
 #include "../http/common.h"
 #include "../http/server.h"
+#include "../http/file_cache.h"
 
 #include "../ws/server.h"
 #include "../ws/common.h"
+#include "../ws/topic.h"
 
 #include "../utils/map.h"
+#include "../utils/slab.h"
+
+/** A structure representing the memory of one connection to a web server, with its TCP client stored inline. */
+struct web_server_connection
+{
+    /** The client, first so the connection and its client share an address. */
+    struct web_client client;
+    /** The TCP client which `client.tcp_client` points to. */
+    struct tcp_client tcp_client;
+};
+
+/** The states of the event loop of a web server, which tell `web_server_close` whether it frees the server itself or wakes the loop to. */
+enum web_server_loop_state
+{
+    /** The loop has not started, so the server is freed by the thread which closes it. */
+    WEB_SERVER_LOOP_IDLE,
+    /** The loop is running, and frees the server on its own thread once it stops. */
+    WEB_SERVER_LOOP_RUNNING,
+    /** The loop is being woken to stop, which it waits for before it frees the server. */
+    WEB_SERVER_LOOP_WAKING,
+    /** The loop has been told to stop, or the server has been freed. */
+    WEB_SERVER_LOOP_STOPPED,
+};
 
 /** A structure representing a server connection over HTTP/WS. */
 struct web_server
@@ -20,11 +45,20 @@ struct web_server
     /** The underlying TCP server. */
     struct tcp_server *tcp_server;
 
-    /** A vector storing all the HTTP routes to their callbacks. */
-    struct vector routes; // <server_route>
+    /** A vector storing all the HTTP routes to their callbacks, each allocated once so it keeps its address. */
+    struct vector routes; // <struct web_server_route *>
+    /** The radix tree the patterns of the routes are compiled into, which matches a path in one walk. */
+    struct web_server_route_node *route_tree;
 
-    /** A map storing all the sockfds to their client structs. */
+    /** A map storing all the sockfds to their client structs, indexed by the sockfds. */
     struct map clients; // <socket_t sockfd, struct web_client *client>
+    /** The memory of the clients, one slot per connection with its TCP client inline. Allocated when the event loop starts. */
+    struct slab connections; // <struct web_server_connection>
+    /** 
+     * The maximum number of clients connected at once, whose memory is allocated up front when the event loop starts. Defaults to `1024`.
+     * Every worker has its own slots. Connections past the maximum are closed right after they are accepted.
+    */
+    size_t max_connections;
 
     /** User defined data to be passed to the event callbacks. */
     void *data;
@@ -46,6 +80,14 @@ struct web_server
         size_t max_header_count;
         /** The maximum length of the body. Defaults to `65536`. */
         size_t max_body_len;
+        /** The maximum number of files kept open for static routes. Defaults to `64`. */
+        size_t max_open_files;
+        /** The milliseconds a client has to send the request line and headers in, from connecting or the first byte of the request. Defaults to `10000`. */
+        size_t header_timeout;
+        /** The milliseconds a client has to send the body of a request in, once its headers are received. Defaults to `30000`. */
+        size_t body_timeout;
+        /** The milliseconds a connection may stay idle between requests. Defaults to `60000`. */
+        size_t keep_alive_timeout;
     } http_server_config;
 
     /** [WS ONLY] A structure representing the configuration for a WebSocket server. */
@@ -58,10 +100,34 @@ struct web_server
          * Do not set to `true` if the server replies to pong frames.
         */
         bool record_latency;
+        /** The milliseconds a WebSocket connection may go without sending a frame. Defaults to `0`, which never closes it. */
+        size_t idle_timeout;
+        /** permessage-deflate (RFC 7692), which is accepted when a client offers it if enabled. */
+        struct ws_deflate_config permessage_deflate;
     } ws_server_config;
 
     /** Whether or not the server is closing. */
     bool is_closing;
+    /** The state of the event loop, changed atomically as `web_server_close` may be called from any thread. */
+    int loop_state; // <enum web_server_loop_state>
+
+    /** The files which static routes keep open, with their metadata. Every worker has its own. */
+    struct http_file_cache file_cache;
+    /** [WS ONLY] The topics the clients are subscribed to. Every worker has its own, as it has its own clients. */
+    struct ws_topics topics;
+    /** [WS ONLY] The stream every connection compresses with if `shared_compression` is enabled. Every worker has its own, allocated on the first message. */
+    struct z_stream_s *shared_deflate_stream;
+
+    /** The backlog of the listening socket, reused by the workers. */
+    int backlog;
+    /** The event backend requested for the TCP server, reused by the workers. */
+    enum tcp_server_backend backend;
+    /** The servers run by the other worker threads, which share the routes of this server. */
+    struct web_server *workers;
+    /** The number of other worker threads. */
+    size_t worker_count;
+    /** The server which started this worker, or `NULL` if it is not a worker. */
+    struct web_server *parent;
     
     /** The callback for when a client connects, for both HTTP and WS. */
     void (*on_connect)(struct web_server *server, struct web_client *client);
@@ -71,6 +137,9 @@ struct web_server
 
     /** The callback for when a HTTP client disconnects. */
     void (*on_disconnect)(struct web_server *server, socket_t sockfd, bool is_error);
+
+    /** The callback for when the bytes queued for a client drain to the low watermark of the TCP server. */
+    void (*on_drain)(struct web_server *server, struct web_client *client);
 };
 
 /** A structure representing a route. */
@@ -85,6 +154,12 @@ struct web_server_route
     void (*on_heartbeat)(struct web_server *server, struct web_client *client, struct ws_message *message);
     /** The callback for when a WebSocket client sends a message to the server. */
     void (*on_ws_message)(struct web_server *server, struct web_client *client, struct ws_message *message);
+    /** 
+     * The callback for the payload of text and binary messages as it arrives, which replaces `on_ws_message` for them when set.
+     * The bytes are unmasked in the receive buffer and only valid during the call, so no message is held in memory and `max_payload_len` does not apply.
+     * A compressed message is inflated whole (within `max_payload_len`) and delivered as one final fragment.
+    */
+    void (*on_ws_fragment)(struct web_server *server, struct web_client *client, const uint8_t *data, size_t length, bool is_final);
     /** The callback for when a request is malformed for WS. */
     void (*on_ws_malformed_frame)(struct web_server *server, struct web_client *client, enum ws_frame_parsing_errors error);
     /** The callback for when a WebSocket connection closes. */
@@ -92,21 +167,68 @@ struct web_server_route
 
     /** The path pattern. */
     const char *path;
+    /** 
+     * [HTTP ONLY] The directory to serve files from instead of calling `on_http_message`, or `NULL`.
+     * The part of the path matched by the `*` of the pattern names the file in the directory, and a path ending in `/` is served its `index.html`.
+    */
+    const char *static_directory;
+};
+
+/** 
+ * A structure representing a node of the radix tree which routes paths. Every edge matches the bytes of its `prefix`, a `:name` segment or a `*`.
+ * A path is matched by walking down the tree, preferring bytes over `:name` segments over a `*`.
+*/
+struct web_server_route_node
+{
+    /** The bytes of the path the node matches after its parent. Empty for the root and for `:name` and `*` nodes. */
+    char *prefix;
+    /** The length of the prefix. */
+    size_t prefix_length;
+
+    /** The children which match more bytes, each starting with a different byte. */
+    struct vector children; // <struct web_server_route_node *>
+    /** The child which matches one non-empty segment of the path, up to the next `/`, for a `:name`. */
+    struct web_server_route_node *param;
+    /** The child which matches any run of the path for a `*`. */
+    struct web_server_route_node *wildcard;
+
+    /** The route whose pattern ends at the node, or `NULL`. */
+    struct web_server_route *route;
 };
 
 /** Initializes the web server. */
 int web_server_init(struct web_server *http_server, struct sockaddr *address, int backlog);
-/** Starts a nonblocking event loop for the web server. */
+/** Initializes the web server with the given event backend, falling back to polling if it is unavailable. */
+int web_server_init_backend(struct web_server *http_server, struct sockaddr *address, int backlog, enum tcp_server_backend backend);
+/** 
+ * Starts a nonblocking event loop for the web server. It returns once the server is closed or its loop fails, after freeing the state of the server on its own thread.
+ * Returns `-1` if the server was already started or closed.
+*/
 int web_server_start(struct web_server *server);
-
-/** Creates a route for a path. Note that precedence works by whichever route is created first. */
+/** 
+ * Starts `num_workers` nonblocking event loops, one per thread, each with its own listening socket (SO_REUSEPORT), clients and parsing states.
+ * The calling thread runs one of the loops, and the function returns once every loop has stopped and freed its worker.
+ * Routes are shared by every worker, so they may not be created or removed after this is called.
+ * Callbacks may be called from any of the threads, with the `server` argument being the worker which owns the client.
+ * Topics are per worker as well, so `ws_server_publish` only reaches the subscribers of the worker it is called with, and has to be called by each worker on its own thread to reach all of them.
+*/
+int web_server_start_workers(struct web_server *server, size_t num_workers);
+
+/** 
+ * Creates a route for a path pattern. The route is copied, but its `path` has to outlive it. A `:name` segment matches one segment of a path, and a `*` matches any run of it, including none.
+ * A path is routed by specificity: bytes are matched before `:name` segments, and `:name` segments before a `*`. Of two routes with the same pattern, the one created first is used.
+*/
 void web_server_create_route(struct web_server *server, struct web_server_route *route);
 /** Finds a route given a path. */
 struct web_server_route *web_server_find_route(struct web_server *server, const char *path);
 /** Removes a route for a path. */
 void web_server_remove_route(struct web_server *server, const char *path);
 
-/** Closes the web server. */
+/** 
+ * Closes the web server, and every worker started with `web_server_start_workers`. It may be called from any thread, including from a callback, with the server or any of its workers.
+ * A server whose loop runs is only woken, and its loop frees it on its own thread once it returns to polling. Its clients are not called back after that.
+ * A server whose loop never started is freed right away.
+*/
 int web_server_close(struct web_server *server);
 
 #endif // SERVER_CONNECTION_H
\ No newline at end of file
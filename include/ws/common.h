@@ -31,6 +31,11 @@
 #define WEBSOCKET_HANDSHAKE_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
 #define WEBSOCKET_VERSION "13"
 
+/** The number of frames of a message handed to one send, as a header and a payload each. */
+#define WS_SEND_BATCH 8
+/** The number of bytes the scratch buffer of a connection starts with, once a message is masked or compressed into it. */
+#define WS_SEND_SCRATCH_INITIAL_CAPACITY 4096
+
 #define WS_OPCODE_CONTINUE 0b0000
 #define WS_OPCODE_TEXT     0b0001
 #define WS_OPCODE_BINARY   0b0010
@@ -46,7 +51,9 @@ enum ws_frame_parsing_errors
     /** The payload length for the frame is invalid. */
     WS_FRAME_PARSE_ERROR_INVALID_FRAME_LENGTH = -2,
     /** The payload length is too big. */
-    WS_FRAME_PARSE_ERROR_PAYLOAD_TOO_BIG = -3
+    WS_FRAME_PARSE_ERROR_PAYLOAD_TOO_BIG = -3,
+    /** The payload is compressed without permessage-deflate being negotiated, or could not be decompressed. */
+    WS_FRAME_PARSE_ERROR_INVALID_COMPRESSION = -4
 };
 
 /** The parsing state of a frame. */
@@ -54,14 +61,8 @@ enum ws_frame_parsing_states
 {
     /** The start of parsing. */
     WS_FRAME_NIL = -1,
-    /** The first byte is being parsed. */
-    WS_FRAME_PARSING_STATE_FIRST_BYTE,
-    /** The second byte is being parsed. */
-    WS_FRAME_PARSING_STATE_SECOND_BYTE,
-    /** The payload length is going through further review. */
-    WS_FRAME_PARSING_STATE_PAYLOAD_LENGTH,
-    /** The masking key is being parsed. */
-    WS_FRAME_PARSING_STATE_MASKING_KEY,
+    /** The header (up to the masking key) is being received, and is decoded at once when it is fully buffered. */
+    WS_FRAME_PARSING_STATE_HEADER,
     /** The payload data is being parsed. */
     WS_FRAME_PARSING_STATE_PAYLOAD_DATA
 };
@@ -124,16 +125,38 @@ struct ws_frame_parsing_state
     struct vector payload_data;
     /** Length being received for one frame. */
     size_t received_length;
+    /** Whether or not the message is compressed with permessage-deflate, as told by the first frame. */
+    bool compressed;
+
+    /** [STREAMING] The payload bytes the last call unmasked, which stay in the receive buffer and are only valid until the next call. */
+    const uint8_t *fragment;
+    /** [STREAMING] The number of bytes of `fragment`. */
+    size_t fragment_length;
+    /** [STREAMING] Whether or not `fragment` ends the message. */
+    bool fragment_is_final;
 };
 
 /** Builds a WebSocket masking key. */
 void ws_build_masking_key(uint8_t masking_key[4]);
 /** Builds a WebSocket frame. */
 void ws_build_message(struct ws_message *message, uint8_t opcode, uint64_t payload_length, uint8_t *payload_data);
+/** Builds the header of an unmasked frame carrying a whole message of `payload_length` bytes into `header`. Returns the length of the header. */
+size_t ws_build_frame_header(uint8_t header[10], uint8_t opcode, uint64_t payload_length);
 
-/** Sends a WebSocket message. Returns 1, otherwise a failure. */
+/** 
+ * Sends a WebSocket message, split into `num_frames` frames. Data messages are compressed if the connection negotiated permessage-deflate. Returns 1, otherwise a failure.
+ * The payload is sent from the message itself, unless it is masked or compressed into the scratch buffer of the connection, which is kept between messages.
+*/
 int ws_send_message(struct web_client *client, struct ws_message *message, uint8_t masking_key[4], size_t num_frames);
-/** Parses an incoming websocket frame. */
-int ws_parse_frame(struct web_client *client, struct ws_frame_parsing_state *current_state, size_t MAX_PAYLOAD_LENGTH);
+/** 
+ * Sends a WebSocket message from the server in one unmasked frame, with a payload of at least `zerocopy_threshold` bytes sent with `MSG_ZEROCOPY` instead of being copied.
+ * The payload may not be changed or freed until `on_sent` is called, once per call. It is never compressed, as it is sent as it is. Returns 1, otherwise a failure.
+*/
+int ws_send_message_zerocopy(struct web_client *client, struct ws_message *message, void (*on_sent)(void *data), void *data);
+/** 
+ * Parses an incoming websocket frame. Returns `0` once a message is whole, `1` if more bytes have to arrive first, or a parse error.
+ * If `stream`, the payload of uncompressed text and binary frames is not gathered, and `2` is returned whenever a part of it is unmasked into `fragment` instead.
+*/
+int ws_parse_frame(struct web_client *client, struct ws_frame_parsing_state *current_state, size_t MAX_PAYLOAD_LENGTH, bool stream);
 
 #endif // WS_COMMON_H
\ No newline at end of file
@@ -0,0 +1,92 @@
+#ifndef WS_DEFLATE_H
+#define WS_DEFLATE_H
+
+#include "../utils/vector.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+struct z_stream_s;
+
+/** The largest LZ77 window of permessage-deflate, as a power of two. */
+#define WS_DEFLATE_MAX_WINDOW_BITS 15
+/** The number of bytes from which a payload is compressed by default. Smaller payloads barely shrink, and cost more to compress than they save. */
+#define WS_DEFLATE_DEFAULT_THRESHOLD 64
+
+/** A structure representing the parameters of permessage-deflate (RFC 7692), as offered, accepted or configured. */
+struct ws_deflate_options
+{
+    /** Whether or not the server compresses every message without the context of the previous ones. */
+    bool server_no_context_takeover;
+    /** Whether or not the client compresses every message without the context of the previous ones. */
+    bool client_no_context_takeover;
+    /** The largest window the server compresses with, from `8` to `15`, or `0` if it is not limited. */
+    uint8_t server_max_window_bits;
+    /** The largest window the client compresses with, from `8` to `15`, or `0` if it is not limited. An offer without a value allows `15`. */
+    uint8_t client_max_window_bits;
+};
+
+/** A structure representing how one end of a connection uses permessage-deflate. */
+struct ws_deflate_config
+{
+    /** Whether or not permessage-deflate is offered (by a client) or accepted (by a server). Defaults to `false`. */
+    bool enabled;
+    /** The parameters to ask for. Windows larger than asked for are never used, and `0` means `15`. */
+    struct ws_deflate_options options;
+    /** 
+     * [SERVER ONLY] Whether or not every connection compresses with one stream of the server, so a message published to a topic is compressed once for every subscriber.
+     * The server then compresses without context takeover, trading some ratio for not keeping a compression window per connection.
+    */
+    bool shared_compression;
+    /** The number of bytes from which a payload is compressed. Defaults to `WS_DEFLATE_DEFAULT_THRESHOLD`. */
+    size_t threshold;
+};
+
+/** A structure representing the permessage-deflate state of a connection which negotiated it. */
+struct ws_deflate
+{
+    /** The parameters which were negotiated. */
+    struct ws_deflate_options options;
+    /** Whether or not this end is the server, which decides which parameters apply to which direction. */
+    bool is_server;
+    /** The number of bytes from which a payload is compressed. */
+    size_t threshold;
+
+    /** The stream compressing the messages which are sent. Allocated on the first message. */
+    struct z_stream_s *deflate_stream;
+    /** The stream of the server which every connection compresses with instead (if shared compression is enabled), allocated on the first message. */
+    struct z_stream_s **shared_deflate_stream;
+    /** The stream decompressing the messages which are received. Allocated on the first message. */
+    struct z_stream_s *inflate_stream;
+};
+
+/** Formats the `Sec-WebSocket-Extensions` value a client offers permessage-deflate with. Returns the length of the value. */
+size_t ws_deflate_format_offer(const struct ws_deflate_config *config, char *buffer, size_t size);
+/** 
+ * Picks the first offer of a `Sec-WebSocket-Extensions` value a server can accept, and the parameters to respond with.
+ * Returns `0` if an offer was accepted, or `-1` if none can be.
+*/
+int ws_deflate_accept_offer(const char *extensions, const struct ws_deflate_config *config, struct ws_deflate_options *negotiated);
+/** Formats the `Sec-WebSocket-Extensions` value a server accepts permessage-deflate with. Returns the length of the value. */
+size_t ws_deflate_format_response(const struct ws_deflate_options *negotiated, char *buffer, size_t size);
+/** Parses the `Sec-WebSocket-Extensions` value a server responded with. Returns `0` if it accepted permessage-deflate, or `-1` if it did not. */
+int ws_deflate_accept_response(const char *extensions, struct ws_deflate_options *negotiated);
+
+/** 
+ * Creates the permessage-deflate state of a connection from the negotiated parameters. 
+ * `shared_deflate_stream` (if not `NULL`) points to the stream of a server which is used to compress instead, as the server does not take over context.
+*/
+struct ws_deflate *ws_deflate_create(const struct ws_deflate_options *negotiated, const struct ws_deflate_config *config, bool is_server, struct z_stream_s **shared_deflate_stream);
+
+/** Compresses a message into `output`, which is initialized by the call if it is not allocated yet, and grown otherwise. Returns `0`, or `-1` if zlib failed. */
+int ws_deflate_compress(struct ws_deflate *deflate, const uint8_t *data, size_t length, struct vector *output);
+/** Decompresses a message into `output`, which is initialized by the call. Returns `0`, `-1` if the message is not valid, or `-2` if it inflates past `max_length` bytes. */
+int ws_deflate_decompress(struct ws_deflate *deflate, const uint8_t *data, size_t length, struct vector *output, size_t max_length);
+
+/** Frees the permessage-deflate state of a connection. */
+void ws_deflate_free(struct ws_deflate *deflate);
+/** Frees a stream shared by the connections of a server. */
+void ws_deflate_free_shared(struct z_stream_s **shared_deflate_stream);
+
+#endif // WS_DEFLATE_H
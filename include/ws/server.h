@@ -11,4 +11,15 @@ int ws_server_upgrade_connection(struct web_server *server, struct web_client *c
 /** Closes a WebSocket client. */
 int ws_server_close_client(struct web_server *server, struct web_client *client, uint16_t code, const char *reason);
 
+/** Subscribes a WebSocket client to a topic. Returns `1` if the client was already subscribed, or `-1` if memory could not be allocated. */
+int ws_server_subscribe(struct web_server *server, struct web_client *client, const char *topic);
+/** Unsubscribes a WebSocket client from a topic. Returns `1` if the client was not subscribed. Clients are unsubscribed from every topic when they disconnect. */
+int ws_server_unsubscribe(struct web_server *server, struct web_client *client, const char *topic);
+/** 
+ * Publishes a message to every client subscribed to a topic. The frame is encoded once, and the same bytes are sent to every subscriber.
+ * Only the clients of this server are reached, as every worker has its own topics. Returns the number of subscribers the message was sent to.
+ * With `shared_compression`, the payload is compressed once for every subscriber which negotiated permessage-deflate. Otherwise, it is sent to them uncompressed.
+*/
+size_t ws_server_publish(struct web_server *server, const char *topic, struct ws_message *message);
+
 #endif // WS_SERVER_H
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef WS_TOPIC_H
+#define WS_TOPIC_H
+
+#include "../utils/vector.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct web_client;
+
+/** A structure representing a topic which WebSocket clients subscribe to, and which messages are published to. */
+struct ws_topic
+{
+    /** The name of the topic. */
+    char *name;
+    /** The hash of the name. */
+    uint64_t hash;
+
+    /** The clients subscribed to the topic, packed so a message is published to all of them in one loop. */
+    struct vector subscribers; // <struct ws_subscriber>
+
+    /** The next topic in the same bucket. */
+    struct ws_topic *bucket_next;
+};
+
+/** A structure representing a client subscribed to a topic. */
+struct ws_subscriber
+{
+    /** The client. */
+    struct web_client *client;
+    /** The index of the subscription in the subscriptions of the client, so it follows the client when the client is moved. */
+    size_t subscription_index;
+};
+
+/** A structure representing a topic a client is subscribed to. */
+struct ws_subscription
+{
+    /** The topic. */
+    struct ws_topic *topic;
+    /** The index of the client in the subscribers of the topic, so it is unsubscribed without searching for it. */
+    size_t index;
+};
+
+/** A structure representing the topics of a server, hashed by name. A topic exists while it has subscribers. */
+struct ws_topics
+{
+    /** The topics, hashed by name. Allocated on the first subscription. */
+    struct ws_topic **buckets;
+    /** The number of buckets (a power of two). */
+    size_t bucket_count;
+    /** The number of topics. */
+    size_t size;
+};
+
+/** Initializes an empty set of topics. Memory is only allocated on the first subscription. */
+void ws_topics_init(struct ws_topics *topics);
+
+/** Finds a topic by name, or returns `NULL` if no client is subscribed to it. */
+struct ws_topic *ws_topics_find(struct ws_topics *topics, const char *name);
+
+/** Subscribes a client to a topic, creating the topic if needed. Returns `1` if the client was already subscribed, or `-1` if memory could not be allocated. */
+int ws_topics_subscribe(struct ws_topics *topics, struct web_client *client, const char *name);
+/** Unsubscribes a client from a topic, removing the topic once it has no subscribers. Returns `1` if the client was not subscribed. */
+int ws_topics_unsubscribe(struct ws_topics *topics, struct web_client *client, const char *name);
+/** Unsubscribes a client from every topic, and frees its subscriptions. */
+void ws_topics_unsubscribe_all(struct ws_topics *topics, struct web_client *client);
+
+/** Frees every topic. The subscriptions of the clients are not touched. */
+void ws_topics_free(struct ws_topics *topics);
+
+#endif // WS_TOPIC_H
@@ -3,22 +3,56 @@
 
 #include "tests/tcp/test001.c"
 #include "tests/tcp/test002.c"
+#include "tests/tcp/test003.c"
 
 #include "tests/udp/test001.c"
 #include "tests/udp/test002.c"
 
 #include "tests/http/test001.c"
+#include "tests/http/test002.c"
+#include "tests/http/test003.c"
+#include "tests/http/test004.c"
+#include "tests/http/test005.c"
+#include "tests/http/test006.c"
+#include "tests/http/test007.c"
+#include "tests/http/test008.c"
+#include "tests/http/test009.c"
+#include "tests/http/test010.c"
+#include "tests/http/test011.c"
 #include "tests/ws/test001.c"
+#include "tests/ws/test002.c"
+#include "tests/ws/test003.c"
+#include "tests/ws/test004.c"
+#include "tests/ws/test005.c"
+#include "tests/ws/test006.c"
+#include "tests/ws/test007.c"
 
 #include <time.h>
 
 char *MAPPINGS[] = {
     "[TCP TEST CASE 001]",
     "[TCP TEST CASE 002]",
+    "[TCP TEST CASE 003]",
     "[UDP TEST CASE 001]",
     "[UDP TEST CASE 002]",
     "[HTTP TEST CASE 001]",
+    "[HTTP TEST CASE 002]",
+    "[HTTP TEST CASE 003]",
+    "[HTTP TEST CASE 004]",
+    "[HTTP TEST CASE 005]",
+    "[HTTP TEST CASE 006]",
+    "[HTTP TEST CASE 007]",
+    "[HTTP TEST CASE 008]",
+    "[HTTP TEST CASE 009]",
+    "[HTTP TEST CASE 010]",
+    "[HTTP TEST CASE 011]",
     "[WS TEST CASE 001]",
+    "[WS TEST CASE 002]",
+    "[WS TEST CASE 003]",
+    "[WS TEST CASE 004]",
+    "[WS TEST CASE 005]",
+    "[WS TEST CASE 006]",
+    "[WS TEST CASE 007]",
 };
 
 char *BANNER = "\
@@ -31,20 +65,37 @@ char *BANNER = "\
 
 int main()
 {
-    int testsuite_result[6] = {0};
+    int testsuite_result[23] = {0};
     testsuite_result[0] = tcp_test001();
     testsuite_result[1] = tcp_test002();
-    testsuite_result[2] = udp_test001();
-    testsuite_result[3] = udp_test002();
-    testsuite_result[4] = http_test001();
-    testsuite_result[5] = ws_test001();
+    testsuite_result[2] = tcp_test003();
+    testsuite_result[3] = udp_test001();
+    testsuite_result[4] = udp_test002();
+    testsuite_result[5] = http_test001();
+    testsuite_result[6] = http_test002();
+    testsuite_result[7] = http_test003();
+    testsuite_result[8] = http_test004();
+    testsuite_result[9] = http_test005();
+    testsuite_result[10] = http_test006();
+    testsuite_result[11] = http_test007();
+    testsuite_result[12] = http_test008();
+    testsuite_result[13] = http_test009();
+    testsuite_result[14] = http_test010();
+    testsuite_result[15] = http_test011();
+    testsuite_result[16] = ws_test001();
+    testsuite_result[17] = ws_test002();
+    testsuite_result[18] = ws_test003();
+    testsuite_result[19] = ws_test004();
+    testsuite_result[20] = ws_test005();
+    testsuite_result[21] = ws_test006();
+    testsuite_result[22] = ws_test007();
 
     printf("\n\n\n%s", BANNER);
 
     printf("\n\n\n---RESULTS---\n");
 
     int testsuite_passed = 1;
-    for (int i = 0; i < 6; ++i)
+    for (int i = 0; i < 23; ++i)
     {
         if (testsuite_result[i] == 1)
         {
@@ -7,34 +7,26 @@
 
 int http_client_send_chunked_data(struct web_client *client, const char *data, size_t data_length)
 {
-    char length_str[16] = {0};
-    sprintf(length_str, "%zx\r\n", data_length);
+    char length_str[20] = {0};
+    int length_str_length = sprintf(length_str, "%zx\r\n", data_length);
 
-    int send_result = 0;
-
-    char buffer[data_length + strlen(length_str) + 2];
-    memcpy(buffer, length_str, strlen(length_str));
-    memcpy(buffer + strlen(length_str), data, data_length);
-    memcpy(buffer + strlen(length_str) + data_length, "\r\n", 2);
+    struct iovec iov[3] =
+    {
+        { .iov_base = length_str, .iov_len = length_str_length },
+        { .iov_base = (char *)data, .iov_len = data_length },
+        { .iov_base = "\r\n", .iov_len = 2 },
+    };
 
-    if ((send_result = tcp_client_send(client->tcp_client, buffer, data_length + strlen(length_str) + 2, 0)) <= 0) return send_result;
+    ssize_t send_result = 0;
+    if ((send_result = tcp_client_sendv(client->tcp_client, iov, 3, 0)) <= 0) return send_result;
     return 1;
 };
 
 int http_client_send_request(struct web_client *client, struct http_request *request, const char *data, size_t data_length)
 {
-    string_t request_str = {0};
-    sso_string_init(&request_str, "");
-
     char encoded[request->path.length * 3 + 1];
     http_url_percent_encode((char *)sso_string_get(&request->path), encoded);
-
-    sso_string_concat_buffer(&request_str, sso_string_get(&request->method));
-    sso_string_concat_char(&request_str, ' ');
-    sso_string_concat_buffer(&request_str, encoded);
-    sso_string_concat_char(&request_str, ' ');
-    sso_string_concat_buffer(&request_str, sso_string_get(&request->version));
-    sso_string_concat_buffer(&request_str, "\r\n");
+    size_t encoded_length = strlen(encoded);
 
     int chunked = 0;
 
@@ -48,31 +40,48 @@ int http_client_send_request(struct web_client *client, struct http_request *req
             chunked = 1;
         else if (!chunked && strcasecmp(name, "Content-Length") == 0)
             chunked = -1;
-
-        sso_string_concat_buffer(&request_str, name);
-        sso_string_concat_buffer(&request_str, ": ");
-        sso_string_concat_buffer(&request_str, value);
-        sso_string_concat_buffer(&request_str, "\r\n");
     };
 
+    char content_length[40] = {0};
+    int content_length_length = 0;
     if (chunked == 0 && data_length != 0)
+        content_length_length = sprintf(content_length, "Content-Length: %zu\r\n", data_length);
+
+    /** The head is serialized into one buffer, and the body is sent from the caller's buffer. */
+    size_t head_length = 
+        request->method.length + 1 + encoded_length + 1 + request->version.length + 2
+        + http_headers_serialized_length(&request->headers)
+        + content_length_length + 2;
+
+    char stack_head[HTTP_HEAD_STACK_CAPACITY];
+    char *head = head_length <= sizeof(stack_head) ? stack_head : malloc(head_length);
+    char *cursor = head;
+
+    memcpy(cursor, sso_string_get(&request->method), request->method.length);
+    cursor += request->method.length;
+    *cursor++ = ' ';
+    memcpy(cursor, encoded, encoded_length);
+    cursor += encoded_length;
+    *cursor++ = ' ';
+    memcpy(cursor, sso_string_get(&request->version), request->version.length);
+    cursor += request->version.length;
+    memcpy(cursor, "\r\n", 2);
+    cursor += 2;
+
+    cursor = http_headers_serialize(&request->headers, cursor);
+
+    memcpy(cursor, content_length, content_length_length);
+    cursor += content_length_length;
+    memcpy(cursor, "\r\n", 2);
+
+    struct iovec iov[2] =
     {
-        char length_str[16] = {0};
-        sprintf(length_str, "%zu", data_length);
-
-        sso_string_concat_buffer(&request_str, "Content-Length: ");
-        sso_string_concat_buffer(&request_str, length_str);
-        sso_string_concat_buffer(&request_str, "\r\n");
+        { .iov_base = head, .iov_len = head_length },
+        { .iov_base = (char *)data, .iov_len = data_length },
     };
 
-    sso_string_concat_buffer(&request_str, "\r\n");
-
-    char concatenated_string[request_str.length + data_length + 1];
-    memcpy(concatenated_string, sso_string_get(&request_str), request_str.length);
-    if (data_length > 0) memcpy(concatenated_string + request_str.length, data, data_length);
-    concatenated_string[request_str.length + data_length] = '\0';
-
-    ssize_t send_result = tcp_client_send(client->tcp_client, concatenated_string, request_str.length + data_length, 0);
+    ssize_t send_result = tcp_client_sendv(client->tcp_client, iov, data_length > 0 ? 2 : 1, 0);
+    if (head != stack_head) free(head);
     if (send_result <= 0) return send_result;
 
     return 1;
@@ -81,7 +90,8 @@ int http_client_send_request(struct web_client *client, struct http_request *req
 int http_client_parse_response(struct web_client *client, struct http_client_parsing_state *current_state)
 {
     socket_t sockfd = client->tcp_client->sockfd;
-    vector_init(&current_state->response.headers, 8, sizeof(struct http_header));
+    struct socket_buffer *recv_buffer = &client->tcp_client->recv_buffer;
+    if (current_state->response.headers.elements == NULL) vector_init(&current_state->response.headers, 8, sizeof(struct http_header));
 
 parse_start:
     errno = 0;
@@ -97,7 +107,7 @@ parse_start:
             string_t *version = &current_state->response.version;
             if (version->length == 0) sso_string_init(version, "");
             
-            ssize_t bytes_received = socket_recv_until_dynamic(sockfd, version, " ", 1, 8 + 1);
+            ssize_t bytes_received = socket_recv_until_dynamic(sockfd, recv_buffer, version, " ", 1, 8 + 1);
             if (bytes_received <= 0)
             {
                 if (bytes_received == -2 || errno == EWOULDBLOCK) return 1;
@@ -109,14 +119,24 @@ parse_start:
         };
         case RESPONSE_PARSING_STATE_STATUS_CODE:
         {
-            char buffer[4] = {0};
-            if (recv(sockfd, buffer, sizeof(buffer), MSG_PEEK) <= 0) return RESPONSE_PARSE_ERROR_RECV;
-
-            if (buffer[3] == ' ')
+            /** The status code is three digits followed by a space. */
+            ssize_t bytes_received = socket_buffer_require(sockfd, recv_buffer, 4);
+            if (bytes_received <= 0)
             {
-                buffer[3] = '\0';
-                current_state->response.status_code = atoi(buffer);
-            } else return 1;
+                if (errno == EWOULDBLOCK) return 1;
+                else return RESPONSE_PARSE_ERROR_RECV;
+            };
+
+            const char *status_code = recv_buffer->data + recv_buffer->offset;
+            if (
+                status_code[0] < '0' || status_code[0] > '9'
+                || status_code[1] < '0' || status_code[1] > '9'
+                || status_code[2] < '0' || status_code[2] > '9'
+                || status_code[3] != ' '
+            ) return RESPONSE_PARSE_ERROR_MALFORMED;
+
+            current_state->response.status_code = (status_code[0] - '0') * 100 + (status_code[1] - '0') * 10 + (status_code[2] - '0');
+            recv_buffer->offset += 4;
 
             current_state->parsing_state = RESPONSE_PARSING_STATE_STATUS_MESSAGE;
             goto parse_start;
@@ -126,7 +146,7 @@ parse_start:
             string_t *status_message = &current_state->response.status_message;
             if (status_message->length == 0) sso_string_init(status_message, "");
 
-            ssize_t bytes_received = socket_recv_until_dynamic(sockfd, status_message, "\r\n", 1, 64 + 2);
+            ssize_t bytes_received = socket_recv_until_dynamic(sockfd, recv_buffer, status_message, "\r\n", 1, 64 + 2);
             if (bytes_received <= 0)
             {
                 if (bytes_received == -2 || errno == EWOULDBLOCK) return 1;
@@ -138,14 +158,19 @@ parse_start:
         };
         case RESPONSE_PARSING_STATE_HEADER_NAME:
         {
-            char crlf[2] = {0};
-            recv(sockfd, crlf, sizeof(crlf), MSG_PEEK);
-
-            if (crlf[0] == '\r')
+            /** Every header line is at least two bytes long, so two buffered bytes tell whether the headers have ended. */
+            if (current_state->header.name.length == 0)
             {
-                if (crlf[1] == '\n')
+                ssize_t bytes_received = socket_buffer_require(sockfd, recv_buffer, 2);
+                if (bytes_received <= 0)
                 {
-                    if (recv(sockfd, crlf, sizeof(crlf), 0) <= 0) return REQUEST_PARSE_ERROR_RECV;
+                    if (errno == EWOULDBLOCK) return 1;
+                    else return RESPONSE_PARSE_ERROR_RECV;
+                };
+
+                if (memcmp(recv_buffer->data + recv_buffer->offset, "\r\n", 2) == 0)
+                {
+                    recv_buffer->offset += 2;
 
                     if (current_state->content_length == 0) break;
                     else
@@ -156,13 +181,13 @@ parse_start:
                             RESPONSE_PARSING_STATE_BODY;
                         goto parse_start;
                     };
-                } else return 1;
+                };
             };
 
             struct http_header *header = &current_state->header;
             if (header->name.length == 0) sso_string_init(&header->name, "");
 
-            ssize_t bytes_received = socket_recv_until_dynamic(sockfd, &header->name, ": ", 1, 256 + 2);
+            ssize_t bytes_received = socket_recv_until_dynamic(sockfd, recv_buffer, &header->name, ": ", 1, 256 + 2);
             if (bytes_received <= 0)
             {
                 if (bytes_received == -2 || errno == EWOULDBLOCK) return 1;
@@ -181,7 +206,7 @@ parse_start:
             struct http_header *header = &current_state->header;
             if (header->value.length == 0) sso_string_init(&header->value, "");
 
-            ssize_t bytes_received = socket_recv_until_dynamic(sockfd, &header->value, "\r\n", 1, 4096 + 2);
+            ssize_t bytes_received = socket_recv_until_dynamic(sockfd, recv_buffer, &header->value, "\r\n", 1, 4096 + 2);
             if (bytes_received <= 0)
             {
                 if (bytes_received == -2 || errno == EWOULDBLOCK) return 1;
@@ -204,7 +229,7 @@ parse_start:
         };
         case RESPONSE_PARSING_STATE_CHUNK_SIZE:
         {
-            if (current_state->chunk_data.size == 0)
+            if (current_state->chunk_data.elements == NULL)
             {
                 current_state->chunk_size = -1;
                 vector_init(&current_state->chunk_data, 128, sizeof(char));
@@ -217,7 +242,7 @@ parse_start:
                 size_t length = 16 + 2 - preexisting_chunk_length;
                 char *delimiter = length == 1 ? "\n" : "\r\n";
 
-                int bytes_received = socket_recv_until_fixed(sockfd, current_state->chunk_length + preexisting_chunk_length, length, delimiter, 1);
+                int bytes_received = socket_recv_until_fixed(sockfd, recv_buffer, current_state->chunk_length + preexisting_chunk_length, length, delimiter, 1);
                 if (bytes_received <= 0)
                 {
                     if (errno == EWOULDBLOCK) return 1;
@@ -230,13 +255,25 @@ parse_start:
 
             if (current_state->chunk_size == 0)
             {
-                char crlf[2] = {0};
-                recv(sockfd, crlf, sizeof(crlf), MSG_PEEK);
-                if (crlf[0] == '\r' && crlf[1] == '\n')
+                /** The last chunk is followed by an empty line, or by trailers ending with one. Trailers are not kept. */
+                ssize_t bytes_received = socket_buffer_require(sockfd, recv_buffer, 2);
+                size_t trailers_length = 2;
+                size_t scanned = 0;
+
+                if (bytes_received > 0 && memcmp(recv_buffer->data + recv_buffer->offset, "\r\n", 2) != 0)
                 {
-                    if (recv(sockfd, crlf, sizeof(crlf), 0) <= 0) return RESPONSE_PARSE_ERROR_RECV;
-                    break;
-                } else return 1;
+                    while (bytes_received > 0 && (trailers_length = socket_buffer_find(recv_buffer, "\r\n\r\n", 4, &scanned)) == 0)
+                        bytes_received = socket_buffer_fill(sockfd, recv_buffer);
+                };
+
+                if (bytes_received <= 0)
+                {
+                    if (errno == EWOULDBLOCK) return 1;
+                    else return RESPONSE_PARSE_ERROR_RECV;
+                };
+
+                recv_buffer->offset += trailers_length;
+                break;
             };
 
             current_state->parsing_state = RESPONSE_PARSING_STATE_CHUNK_DATA;
@@ -250,7 +287,7 @@ parse_start:
             vector_resize(&current_state->chunk_data, current_state->chunk_data.size + length);
             char *buffer_ptr = current_state->chunk_data.elements + current_state->chunk_data.size;
 
-            ssize_t bytes_received = recv(sockfd, buffer_ptr, length, 0);
+            ssize_t bytes_received = socket_buffer_recv(sockfd, recv_buffer, buffer_ptr, length, 0);
 
             if (bytes_received <= 0)
             {
@@ -274,22 +311,30 @@ parse_start:
         };
         case RESPONSE_PARSING_STATE_BODY:
         {
-            current_state->response.body = malloc(current_state->content_length + 1);
-            current_state->response.body[current_state->content_length] = '\0';
+            if (current_state->response.body == NULL)
+            {
+                current_state->response.body = malloc(current_state->content_length + 1);
+                current_state->response.body[current_state->content_length] = '\0';
+            };
 
-            ssize_t bytes_received = recv(sockfd, current_state->response.body, current_state->content_length, 0);
+            size_t preexisting_body_data = current_state->response.body_size;
+            size_t length = current_state->content_length - preexisting_body_data;
+
+            ssize_t bytes_received = socket_buffer_recv(sockfd, recv_buffer, current_state->response.body + preexisting_body_data, length, 0);
             if (bytes_received <= 0)
             {
                 if (errno == EWOULDBLOCK) return 1;
                 else return RESPONSE_PARSE_ERROR_RECV;
             };
 
-            if (bytes_received == current_state->content_length) break;
+            current_state->response.body_size += bytes_received;
+
+            if (bytes_received == length) break;
             else return 1;
         };
     };
 
-    if (current_state->response.body_size > 0)
+    if (current_state->chunk_data.elements != NULL)
     {
         vector_push(&current_state->chunk_data, &(char){'\0'});
         current_state->response.body = (char *)current_state->chunk_data.elements;
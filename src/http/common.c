@@ -23,6 +23,9 @@ void http_request_build(struct http_request *request, const char *method, const
     sso_string_init(&request->path, path);
     sso_string_init(&request->version, version);
 
+    request->head_copy = NULL;
+    request->arena = NULL;
+
     vector_init(&request->headers, headers_length, sizeof(struct http_header));
 
     for (size_t i = 0; i < headers_length; ++i)
@@ -40,10 +43,16 @@ void http_request_build(struct http_request *request, const char *method, const
 
 void http_request_free(struct http_request *request)
 {
-    free(request->body);
+    /** The storage of a request parsed by a server is freed all at once by resetting its arena. */
+    if (request->arena == NULL)
+    {
+        free(request->body);
+
+        vector_free(&request->headers);
+        vector_free(&request->query);
 
-    vector_free(&request->headers);
-    vector_free(&request->query);
+        free(request->head_copy);
+    };
 
     sso_string_free(&request->method);
     sso_string_free(&request->path);
@@ -64,6 +73,21 @@ struct http_header *http_request_get_header(struct http_request *request, const
 
     return NULL;
 };
+const char *http_request_get_param(struct http_request *request, const char *name, size_t *length)
+{
+    size_t name_length = strlen(name);
+    for (size_t i = 0; i < request->param_count; ++i)
+    {
+        struct http_route_param *param = &request->params[i];
+        if (param->name_length == name_length && memcmp(param->name, name, name_length) == 0)
+        {
+            if (length != NULL) *length = param->value_length;
+            return param->value;
+        };
+    };
+
+    return NULL;
+};
 char *http_request_get_body(struct http_request *request) { return request->body; };
 size_t http_request_get_body_size(struct http_request *request) { return request->body_size; };
 
@@ -129,12 +153,43 @@ void http_header_free(struct http_header *header)
     sso_string_free(&header->value);
 };
 
-char *http_header_get_name(struct http_header *header) { return sso_string_get(&header->name); };
+const char *http_header_get_name(struct http_header *header) { return sso_string_get(&header->name); };
 char *http_header_get_value(struct http_header *header) { return sso_string_get(&header->value); };
 
 void http_header_set_name(struct http_header *header, const char *name) { sso_string_set(&header->name, name); };
 void http_header_set_value(struct http_header *header, const char *value) { sso_string_set(&header->value, value); };
 
+size_t http_headers_serialized_length(struct vector *headers)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < headers->size; ++i)
+    {
+        struct http_header *header = vector_get(headers, i);
+        length += header->name.length + 2 + header->value.length + 2;
+    };
+
+    return length;
+};
+
+char *http_headers_serialize(struct vector *headers, char *buffer)
+{
+    for (size_t i = 0; i < headers->size; ++i)
+    {
+        struct http_header *header = vector_get(headers, i);
+
+        memcpy(buffer, sso_string_get(&header->name), header->name.length);
+        buffer += header->name.length;
+        memcpy(buffer, ": ", 2);
+        buffer += 2;
+        memcpy(buffer, sso_string_get(&header->value), header->value.length);
+        buffer += header->value.length;
+        memcpy(buffer, "\r\n", 2);
+        buffer += 2;
+    };
+
+    return buffer;
+};
+
 const char *http_query_get_key(struct http_query *query) { return sso_string_get(&query->key); };
 const char *http_query_get_value(struct http_query *query) { return sso_string_get(&query->value); };
 
@@ -0,0 +1,208 @@
+#include "../../include/http/file_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+/** Hashes a path with FNV-1a. */
+static uint64_t _http_file_cache_hash(const char *path)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (; *path; ++path)
+    {
+        hash ^= (unsigned char)*path;
+        hash *= 0x100000001b3ULL;
+    };
+
+    return hash;
+};
+
+/** Unlinks a file from the recency list. */
+static void _http_file_cache_unlink(struct http_file_cache *cache, struct http_cached_file *file)
+{
+    if (file->previous != NULL) file->previous->next = file->next;
+    else cache->head = file->next;
+
+    if (file->next != NULL) file->next->previous = file->previous;
+    else cache->tail = file->previous;
+
+    file->previous = file->next = NULL;
+};
+
+/** Links a file to the front of the recency list. */
+static void _http_file_cache_link_front(struct http_file_cache *cache, struct http_cached_file *file)
+{
+    file->previous = NULL;
+    file->next = cache->head;
+
+    if (cache->head != NULL) cache->head->previous = file;
+    else cache->tail = file;
+
+    cache->head = file;
+};
+
+/** Closes and frees a file. */
+static void _http_file_cache_destroy(struct http_cached_file *file)
+{
+    close(file->fd);
+    free(file->path);
+    free(file);
+};
+
+/** Removes a file from the cache. The file is closed now, or once it is released if it is still referenced. */
+static void _http_file_cache_evict(struct http_file_cache *cache, struct http_cached_file *file)
+{
+    struct http_cached_file **link = &cache->buckets[file->hash & (cache->bucket_count - 1)];
+    while (*link != file) link = &(*link)->bucket_next;
+    *link = file->bucket_next;
+
+    _http_file_cache_unlink(cache, file);
+    --cache->size;
+
+    if (file->references == 0) _http_file_cache_destroy(file);
+    else file->evicted = true;
+};
+
+/** Copies the metadata of a file, and formats its `Last-Modified` and `ETag` values. */
+static void _http_file_cache_set_metadata(struct http_cached_file *file, struct stat *info)
+{
+    file->size = info->st_size;
+    file->modified_at = info->st_mtime;
+    file->device = info->st_dev;
+    file->inode = info->st_ino;
+
+    struct tm time;
+#ifdef _WIN32
+    gmtime_s(&time, &file->modified_at);
+#else
+    gmtime_r(&file->modified_at, &time);
+#endif
+    strftime(file->last_modified, sizeof(file->last_modified), "%a, %d %b %Y %H:%M:%S GMT", &time);
+
+    /** Like most servers, the tag changes whenever the size or the modification time does. */
+    snprintf(file->etag, sizeof(file->etag), "\"%llx-%llx\"", (unsigned long long)file->modified_at, (unsigned long long)file->size);
+};
+
+/** Whether or not the metadata of a cached file still describes the file at its path. */
+static bool _http_file_cache_is_current(struct http_cached_file *file, struct stat *info)
+{
+    return info->st_dev == file->device
+        && info->st_ino == file->inode
+        && info->st_size == file->size
+        && info->st_mtime == file->modified_at;
+};
+
+void http_file_cache_init(struct http_file_cache *cache, size_t capacity)
+{
+    cache->buckets = NULL;
+    cache->bucket_count = 0;
+    cache->size = 0;
+    cache->capacity = capacity == 0 ? HTTP_FILE_CACHE_DEFAULT_CAPACITY : capacity;
+    cache->head = NULL;
+    cache->tail = NULL;
+};
+
+struct http_cached_file *http_file_cache_acquire(struct http_file_cache *cache, const char *path)
+{
+    if (cache->buckets == NULL)
+    {
+        /** The cache never holds more than `capacity` files, so the buckets never have to grow. */
+        size_t bucket_count = 16;
+        while (bucket_count < cache->capacity * 2) bucket_count *= 2;
+
+        cache->buckets = calloc(bucket_count, sizeof(struct http_cached_file *));
+        if (cache->buckets == NULL)
+        {
+            errno = ENOMEM;
+            return NULL;
+        };
+
+        cache->bucket_count = bucket_count;
+    };
+
+    uint64_t hash = _http_file_cache_hash(path);
+    time_t now = time(NULL);
+
+    struct http_cached_file *file = cache->buckets[hash & (cache->bucket_count - 1)];
+    while (file != NULL && (file->hash != hash || strcmp(file->path, path) != 0)) file = file->bucket_next;
+
+    if (file != NULL)
+    {
+        struct stat info;
+        if (now - file->validated_at < HTTP_FILE_CACHE_REVALIDATE_SECONDS || (stat(path, &info) == 0 && _http_file_cache_is_current(file, &info)))
+        {
+            file->validated_at = now;
+            _http_file_cache_unlink(cache, file);
+            _http_file_cache_link_front(cache, file);
+
+            ++file->references;
+            return file;
+        };
+
+        /** The file was changed or removed since it was opened. */
+        _http_file_cache_evict(cache, file);
+    };
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return NULL;
+
+    struct stat info;
+    int error = fstat(fd, &info) == -1 ? errno : S_ISDIR(info.st_mode) ? EISDIR : !S_ISREG(info.st_mode) ? EACCES : 0;
+    if (error != 0)
+    {
+        close(fd);
+        errno = error;
+        return NULL;
+    };
+
+    file = calloc(1, sizeof(struct http_cached_file));
+    char *path_copy = strdup(path);
+    if (file == NULL || path_copy == NULL)
+    {
+        free(file);
+        free(path_copy);
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    };
+
+    file->path = path_copy;
+    file->hash = hash;
+    file->fd = fd;
+    file->validated_at = now;
+    file->references = 1;
+    _http_file_cache_set_metadata(file, &info);
+
+    /** The least recently used file makes room for the new one. */
+    if (cache->size >= cache->capacity) _http_file_cache_evict(cache, cache->tail);
+
+    struct http_cached_file **bucket = &cache->buckets[hash & (cache->bucket_count - 1)];
+    file->bucket_next = *bucket;
+    *bucket = file;
+
+    _http_file_cache_link_front(cache, file);
+    ++cache->size;
+
+    return file;
+};
+
+void http_file_cache_release(struct http_cached_file *file)
+{
+    if (--file->references == 0 && file->evicted) _http_file_cache_destroy(file);
+};
+
+void http_file_cache_free(struct http_file_cache *cache)
+{
+    while (cache->tail != NULL) _http_file_cache_evict(cache, cache->tail);
+
+    free(cache->buckets);
+    http_file_cache_init(cache, cache->capacity);
+};
@@ -1,8 +1,10 @@
 #include "../../include/web/server.h"
 #include "../../include/http/server.h"
+#include "../../include/utils/simd.h"
 
 #include <stdio.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
@@ -16,46 +18,111 @@
 #include <sys/event.h>
 #endif
 
-static int x = 0;
+/** 
+ * The bytes which cannot be in a HTTP token, as ranges for `simd_find_ranges`.
+ * These ranges also contain `*`, `+`, `|` and `~`, which are filtered out with `_http_token_table`.
+*/
+static const char _http_non_token_ranges[] = "\x00\x20" "\"\"" "(," "//" ":@" "[]" "{}" "\x7f\xff";
+/** The bytes which end a request target or HTTP version (control characters and space). */
+static const char _http_target_end_ranges[] = "\x00\x20" "\x7f\x7f";
+/** The bytes which end a header value (control characters besides horizontal tab). */
+static const char _http_value_end_ranges[] = "\x00\x08" "\x0a\x1f" "\x7f\x7f";
+
+/** Whether or not each byte is a HTTP token character (`tchar` in RFC 9110). */
+static const char _http_token_table[256] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 1, 0, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
 
-int http_server_send_chunked_data(struct web_server *server, struct web_client *client, const char *data, size_t data_length)
+/** Returns the length of the HTTP token at the start of `data`. */
+static size_t _http_token_length(const char *data, size_t length)
 {
-    char length_str[16] = {0};
-    sprintf(length_str, "%zx\r\n", data_length);
+    size_t i = 0;
+    while (
+        (i += simd_find_ranges(data + i, length - i, _http_non_token_ranges, sizeof(_http_non_token_ranges) - 1)) < length
+        && _http_token_table[(unsigned char)data[i]]
+    ) ++i;
 
-    socket_t sockfd = client->tcp_client->sockfd;
+    return i;
+};
+
+/** Returns the value of a hexadecimal digit, or `-1` if the byte is not one. */
+static int _http_hex_value(char byte)
+{
+    if (byte >= '0' && byte <= '9') return byte - '0';
+    if (byte >= 'a' && byte <= 'f') return byte - 'a' + 10;
+    if (byte >= 'A' && byte <= 'F') return byte - 'A' + 10;
+    return -1;
+};
+
+/** Whether or not a comma separated header value (such as `Connection: keep-alive, close`) lists a token, compared case insensitively. */
+static bool _http_header_has_token(const char *value, const char *token)
+{
+    size_t token_length = strlen(token);
 
-    int send_result = 0;
+    while (*value != '\0')
+    {
+        while (*value == ',' || *value == ' ' || *value == '\t') ++value;
 
-    // combine them all into one char buffer
-    char buffer[data_length + strlen(length_str) + 2];
-    memcpy(buffer, length_str, strlen(length_str));
-    memcpy(buffer + strlen(length_str), data, data_length);
-    memcpy(buffer + strlen(length_str) + data_length, "\r\n", 2);
+        size_t length = strcspn(value, ",");
+        size_t trimmed = length;
+        while (trimmed > 0 && (value[trimmed - 1] == ' ' || value[trimmed - 1] == '\t')) --trimmed;
 
-    if ((send_result = tcp_server_send(sockfd, buffer, data_length + strlen(length_str) + 2, 0)) <= 0) return send_result;
+        if (trimmed == token_length && strncasecmp(value, token, token_length) == 0) return true;
+        value += length;
+    };
+
+    return false;
+};
+
+/** Closes the connection once a response was sent, if the request or the response asked for it to be closed. Returns `1`. */
+static int _http_server_finish_response(struct web_server *server, struct web_client *client)
+{
+    /** The responses to earlier pipelined requests are held back with this one, and are sent before the connection is closed. */
+    if (client->server_close_flag) tcp_server_close_client_flushed(server->tcp_server, client->tcp_client);
 
     return 1;
 };
 
-int http_server_send_response(struct web_server *server, struct web_client *client, struct http_response *response, const char *data, size_t data_length)
+int http_server_send_chunked_data(struct web_server *server, struct web_client *client, const char *data, size_t data_length)
 {
-    socket_t sockfd = client->tcp_client->sockfd;
+    char length_str[20] = {0};
+    int length_str_length = sprintf(length_str, "%zx\r\n", data_length);
 
-    string_t response_str;
-    sso_string_init(&response_str, "");
+    struct iovec iov[3] =
+    {
+        { .iov_base = length_str, .iov_len = length_str_length },
+        { .iov_base = (char *)data, .iov_len = data_length },
+        { .iov_base = "\r\n", .iov_len = 2 },
+    };
 
-    sso_string_concat_buffer(&response_str, sso_string_get(&response->version));
-    sso_string_concat_char(&response_str, ' ');
+    ssize_t send_result = 0;
+    if ((send_result = tcp_server_send_queued(server->tcp_server, client->tcp_client, iov, 3)) <= 0) return send_result;
 
-    char status_code[4] = {0};
-    sprintf(status_code, "%d", response->status_code);
-    sso_string_concat_buffer(&response_str, status_code);
-    sso_string_concat_char(&response_str, ' ');
+    /** The last chunk ends the response. */
+    if (data_length == 0) return _http_server_finish_response(server, client);
 
-    sso_string_concat_buffer(&response_str, sso_string_get(&response->status_message));
-    sso_string_concat_buffer(&response_str, "\r\n");
+    return 1;
+};
 
+/** Sends the HTTP response, with the body sent by `tcp_server_send_zerocopy` if `zerocopy` is set. */
+static int _http_server_send_response(struct web_server *server, struct web_client *client, struct http_response *response, const char *data, size_t data_length, bool zerocopy, void (*on_sent)(void *data), void *on_sent_data)
+{
     int chunked = 0;
     int has_connection_close = 0;
 
@@ -69,51 +136,333 @@ int http_server_send_response(struct web_server *server, struct web_client *clie
             chunked = 1;
         else if (!chunked && strcasecmp(name, "Content-Length") == 0)
             chunked = -1;
-        else if (strcasecmp(name, "Connection") == 0 && strcasecmp(name, "close") == 0)
+        else if (strcasecmp(name, "Connection") == 0 && _http_header_has_token(value, "close"))
             has_connection_close = 1;
-
-        sso_string_concat_buffer(&response_str, name);
-        sso_string_concat_buffer(&response_str, ": ");
-        sso_string_concat_buffer(&response_str, value);
-        sso_string_concat_buffer(&response_str, "\r\n");
     };
 
+    char status_code[16] = {0};
+    int status_code_length = sprintf(status_code, "%d", response->status_code);
+
+    char content_length[40] = {0};
+    int content_length_length = 0;
     if (chunked == 0 && data_length != 0)
+        content_length_length = sprintf(content_length, "Content-Length: %zu\r\n", data_length);
+
+    const char *connection_close = "Connection: close\r\n";
+    size_t connection_close_length = (has_connection_close == 0 && client->server_close_flag) ? strlen(connection_close) : 0;
+
+    /** The head is serialized into one buffer, and the body is sent from the caller's buffer. */
+    size_t head_length = 
+        response->version.length + 1 + status_code_length + 1 + response->status_message.length + 2
+        + http_headers_serialized_length(&response->headers)
+        + content_length_length + connection_close_length + 2;
+
+    char stack_head[HTTP_HEAD_STACK_CAPACITY];
+    char *head = head_length <= sizeof(stack_head) ? stack_head : malloc(head_length);
+    char *cursor = head;
+
+    memcpy(cursor, sso_string_get(&response->version), response->version.length);
+    cursor += response->version.length;
+    *cursor++ = ' ';
+    memcpy(cursor, status_code, status_code_length);
+    cursor += status_code_length;
+    *cursor++ = ' ';
+    memcpy(cursor, sso_string_get(&response->status_message), response->status_message.length);
+    cursor += response->status_message.length;
+    memcpy(cursor, "\r\n", 2);
+    cursor += 2;
+
+    cursor = http_headers_serialize(&response->headers, cursor);
+
+    memcpy(cursor, content_length, content_length_length);
+    cursor += content_length_length;
+    memcpy(cursor, connection_close, connection_close_length);
+    cursor += connection_close_length;
+    memcpy(cursor, "\r\n", 2);
+
+    struct iovec iov[2] =
     {
-        char length_str[16] = {0};
-        sprintf(length_str, "%zu", data_length);
+        { .iov_base = head, .iov_len = head_length },
+        { .iov_base = (char *)data, .iov_len = data_length },
+    };
+
+    ssize_t total_send = zerocopy
+        ? tcp_server_send_zerocopy(server->tcp_server, client->tcp_client, iov, 1, data, data_length, on_sent, on_sent_data)
+        : tcp_server_send_queued(server->tcp_server, client->tcp_client, iov, data_length > 0 ? 2 : 1);
+    if (head != stack_head) free(head);
+    if (total_send <= 0) return total_send;
+
+    /** A chunked response only ends with its last chunk. */
+    if (has_connection_close) client->server_close_flag = 1;
+    if (chunked == 1) return 1;
+
+    return _http_server_finish_response(server, client);
+};
+
+int http_server_send_response(struct web_server *server, struct web_client *client, struct http_response *response, const char *data, size_t data_length)
+{
+    return _http_server_send_response(server, client, response, data, data_length, false, NULL, NULL);
+};
+
+int http_server_send_response_zerocopy(struct web_server *server, struct web_client *client, struct http_response *response, const char *data, size_t data_length, void (*on_sent)(void *data), void *on_sent_data)
+{
+    return _http_server_send_response(server, client, response, data, data_length, true, on_sent, on_sent_data);
+};
+
+/** The media types of common file extensions. */
+static const char *_http_content_types[][2] =
+{
+    { "html", "text/html; charset=utf-8" },
+    { "htm", "text/html; charset=utf-8" },
+    { "css", "text/css; charset=utf-8" },
+    { "js", "text/javascript; charset=utf-8" },
+    { "mjs", "text/javascript; charset=utf-8" },
+    { "json", "application/json" },
+    { "txt", "text/plain; charset=utf-8" },
+    { "xml", "application/xml" },
+    { "svg", "image/svg+xml" },
+    { "png", "image/png" },
+    { "jpg", "image/jpeg" },
+    { "jpeg", "image/jpeg" },
+    { "gif", "image/gif" },
+    { "webp", "image/webp" },
+    { "ico", "image/x-icon" },
+    { "wasm", "application/wasm" },
+    { "pdf", "application/pdf" },
+    { "mp4", "video/mp4" },
+    { "webm", "video/webm" },
+    { "mp3", "audio/mpeg" },
+    { "woff", "font/woff" },
+    { "woff2", "font/woff2" },
+};
+
+/** Gets the media type of a file from its extension. */
+static const char *_http_content_type(const char *path)
+{
+    const char *extension = strrchr(path, '.');
+    if (extension == NULL || strchr(extension, '/') != NULL) return "application/octet-stream";
+
+    for (size_t i = 0; i < sizeof(_http_content_types) / sizeof(_http_content_types[0]); ++i)
+        if (strcasecmp(extension + 1, _http_content_types[i][0]) == 0) return _http_content_types[i][1];
 
-        sso_string_concat_buffer(&response_str, "Content-Length: ");
-        sso_string_concat_buffer(&response_str, length_str);
-        sso_string_concat_buffer(&response_str, "\r\n");
+    return "application/octet-stream";
+};
+
+/** Parses the digits at the start of a string. Returns the number of digits, or `0` if there are none or the number overflows. */
+static size_t _http_parse_offset(const char *digits, unsigned long long *value)
+{
+    size_t length = 0;
+    *value = 0;
+
+    for (; digits[length] >= '0' && digits[length] <= '9'; ++length)
+    {
+        if (*value > (~0ULL - 9) / 10) return 0;
+        *value = *value * 10 + (digits[length] - '0');
     };
 
-    if (has_connection_close == 0 && client->server_close_flag)
-        sso_string_concat_buffer(&response_str, "Connection: close\r\n");
+    return length;
+};
 
-    sso_string_concat_buffer(&response_str, "\r\n");
+/** 
+ * Parses a `Range` header value into the first and last byte of a file of `size` bytes.
+ * Returns `1` if the range is satisfiable, `0` if the header should be ignored (it is invalid or asks for several ranges), or `-1` if it cannot be satisfied.
+*/
+static int _http_parse_range(const char *value, unsigned long long size, unsigned long long *first, unsigned long long *last)
+{
+    if (strncasecmp(value, "bytes=", 6) != 0 || strchr(value, ',') != NULL) return 0;
+    value += 6;
+
+    unsigned long long start = 0, end = 0;
+    size_t start_length = _http_parse_offset(value, &start);
+    if (value[start_length] != '-') return 0;
 
-    char combined_data[response_str.length + data_length + 1];
+    size_t end_length = _http_parse_offset(value + start_length + 1, &end);
+    if (value[start_length + 1 + end_length] != '\0') return 0;
 
-    memcpy(combined_data, sso_string_get(&response_str), response_str.length);
-    if (data_length > 0)
+    /** A suffix range asks for the last bytes of the file. */
+    if (start_length == 0)
     {
-        memcpy(combined_data + response_str.length, data, data_length);
-    }
-    combined_data[response_str.length + data_length] = '\0';
+        if (end_length == 0) return 0;
+        if (end == 0 || size == 0) return -1;
 
-    ssize_t total_send = tcp_server_send(sockfd, combined_data, response_str.length + data_length, 0);
-    if (total_send <= 0) return total_send;
+        *first = end < size ? size - end : 0;
+        *last = size - 1;
+        return 1;
+    };
 
-    if (has_connection_close)
-        tcp_server_close_client(server->tcp_server, client->tcp_client->sockfd, 0);
+    if (end_length > 0 && end < start) return 0;
+    if (start >= size) return -1;
 
+    *first = start;
+    *last = end_length > 0 && end < size - 1 ? end : size - 1;
     return 1;
 };
 
+/** Sends a response without a file, with the status message as its body. */
+static int _http_server_send_status(struct web_server *server, struct web_client *client, bool is_head, int status_code, const char *headers)
+{
+    const char *status_message = http_status_code_to_message(status_code);
+
+    char response[512];
+    int response_length = snprintf(response, sizeof(response),
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: %zu\r\n"
+        "%s%s"
+        "\r\n"
+        "%s",
+        status_code, status_message, strlen(status_message), headers, client->server_close_flag ? "Connection: close\r\n" : "", is_head ? "" : status_message);
+
+    struct iovec iov = { .iov_base = response, .iov_len = response_length };
+    if (tcp_server_send_queued(server->tcp_server, client->tcp_client, &iov, 1) <= 0) return -1;
+
+    return _http_server_finish_response(server, client);
+};
+
+/** Releases a cached file once a response has sent it. */
+static void _http_server_release_file(void *file)
+{
+    http_file_cache_release(file);
+};
+
+int http_server_send_file(struct web_server *server, struct web_client *client, struct http_request *request, const char *path)
+{
+    const char *method = http_request_get_method(request);
+    bool is_head = strcmp(method, "HEAD") == 0;
+    if (!is_head && strcmp(method, "GET") != 0) return _http_server_send_status(server, client, false, 405, "Allow: GET, HEAD\r\n");
+
+    if (server->file_cache.capacity == 0) http_file_cache_init(&server->file_cache, server->http_server_config.max_open_files);
+
+    struct http_cached_file *file = http_file_cache_acquire(&server->file_cache, path);
+    if (file == NULL) return _http_server_send_status(server, client, is_head, errno == EACCES ? 403 : 404, "");
+
+    /** A client which has the current version of the file does not need it again. */
+    struct http_header *if_none_match = http_request_get_header(request, "If-None-Match");
+    struct http_header *if_modified_since = http_request_get_header(request, "If-Modified-Since");
+    if (
+        (if_none_match != NULL && (strcmp(http_header_get_value(if_none_match), "*") == 0 || strstr(http_header_get_value(if_none_match), file->etag) != NULL))
+        || (if_none_match == NULL && if_modified_since != NULL && strcmp(http_header_get_value(if_modified_since), file->last_modified) == 0)
+    )
+    {
+        char response[256];
+        int response_length = snprintf(response, sizeof(response),
+            "HTTP/1.1 304 Not Modified\r\n"
+            "Last-Modified: %s\r\n"
+            "ETag: %s\r\n"
+            "%s"
+            "\r\n",
+            file->last_modified, file->etag, client->server_close_flag ? "Connection: close\r\n" : "");
+        http_file_cache_release(file);
+
+        struct iovec iov = { .iov_base = response, .iov_len = response_length };
+        if (tcp_server_send_queued(server->tcp_server, client->tcp_client, &iov, 1) <= 0) return -1;
+
+        return _http_server_finish_response(server, client);
+    };
+
+    unsigned long long size = file->size;
+    unsigned long long first = 0, last = size - 1;
+    int status_code = 200;
+    char content_range[96] = {0};
+
+    /** A range is only honored if it is a range of the version of the file the client has (if it says). */
+    struct http_header *range = http_request_get_header(request, "Range");
+    struct http_header *if_range = http_request_get_header(request, "If-Range");
+    if (range != NULL && (if_range == NULL || strcmp(http_header_get_value(if_range), file->etag) == 0 || strcmp(http_header_get_value(if_range), file->last_modified) == 0))
+    {
+        int range_result = _http_parse_range(http_header_get_value(range), size, &first, &last);
+        if (range_result == -1)
+        {
+            snprintf(content_range, sizeof(content_range), "Content-Range: bytes */%llu\r\n", size);
+            http_file_cache_release(file);
+            return _http_server_send_status(server, client, is_head, 416, content_range);
+        };
+
+        if (range_result == 1)
+        {
+            status_code = 206;
+            snprintf(content_range, sizeof(content_range), "Content-Range: bytes %llu-%llu/%llu\r\n", first, last, size);
+        };
+    };
+
+    unsigned long long length = size == 0 ? 0 : last - first + 1;
+
+    char head[512];
+    int head_length = snprintf(head, sizeof(head),
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %llu\r\n"
+        "Accept-Ranges: bytes\r\n"
+        "Last-Modified: %s\r\n"
+        "ETag: %s\r\n"
+        "%s%s"
+        "\r\n",
+        status_code, http_status_code_to_message(status_code), _http_content_type(path), length, file->last_modified, file->etag,
+        content_range, client->server_close_flag ? "Connection: close\r\n" : "");
+
+    struct iovec iov = { .iov_base = head, .iov_len = head_length };
+
+    /** The file is sent straight from the page cache, and stays open until the socket has taken all of it. */
+    ssize_t send_result = tcp_server_sendfile_queued(server->tcp_server, client->tcp_client, &iov, 1, file->fd, first, is_head ? 0 : length, _http_server_release_file, file);
+    if (send_result <= 0) return send_result;
+
+    return _http_server_finish_response(server, client);
+};
+
+/** Receives until `bytes` is buffered. Returns the number of bytes up to and including it, `0` if more bytes have to arrive first, or a parse error. */
+static ssize_t _http_server_buffer_until(socket_t sockfd, struct socket_buffer *recv_buffer, const char *bytes, size_t bytes_length, size_t *scanned, size_t max_length)
+{
+    size_t length = 0;
+    while ((length = socket_buffer_find(recv_buffer, bytes, bytes_length, scanned)) == 0)
+    {
+        if (socket_buffer_available(recv_buffer) > max_length) return REQUEST_PARSE_ERROR_TOO_LONG;
+
+        ssize_t bytes_received = socket_buffer_fill(sockfd, recv_buffer);
+        if (bytes_received <= 0)
+        {
+            if (errno == EWOULDBLOCK) return 0;
+            else return REQUEST_PARSE_ERROR_RECV;
+        };
+    };
+
+    *scanned = 0;
+    return length;
+};
+
+/** Points a string borrowing from `from` at the same bytes in `to`. */
+static void _http_server_rebase_string(string_t *string, const char *from, const char *to)
+{
+    if (sso_string_is_view(string))
+        sso_string_init_view(string, to + (sso_string_get(string) - from), string->length);
+};
+
+/** Copies the request head out of the receive buffer, so the buffer can be refilled before the request is dispatched. */
+static void _http_server_detach_head(struct http_server_parsing_state *current_state)
+{
+    struct http_request *request = &current_state->request;
+
+    char *head = arena_alloc(request->arena, current_state->head_length);
+    memcpy(head, current_state->head, current_state->head_length);
+
+    _http_server_rebase_string(&request->method, current_state->head, head);
+    _http_server_rebase_string(&request->path, current_state->head, head);
+    _http_server_rebase_string(&request->version, current_state->head, head);
+
+    for (size_t i = 0; i < request->headers.size; ++i)
+    {
+        struct http_header *header = vector_get(&request->headers, i);
+        _http_server_rebase_string(&header->name, current_state->head, head);
+        _http_server_rebase_string(&header->value, current_state->head, head);
+    };
+
+    request->head_copy = head;
+    current_state->head = head;
+};
+
 int http_server_parse_request(struct web_server *server, struct web_client *client, struct http_server_parsing_state *current_state)
 {
     socket_t sockfd = client->tcp_client->sockfd;
+    struct socket_buffer *recv_buffer = &client->tcp_client->recv_buffer;
 
     size_t MAX_HTTP_METHOD_LEN = (server->http_server_config.max_method_len ? server->http_server_config.max_method_len : 7);
     size_t MAX_HTTP_PATH_LEN = (server->http_server_config.max_path_len ? server->http_server_config.max_path_len : 2000);
@@ -122,8 +471,8 @@ int http_server_parse_request(struct web_server *server, struct web_client *clie
     size_t MAX_HTTP_HEADER_VALUE_LEN = (server->http_server_config.max_header_value_len ? server->http_server_config.max_header_value_len : 4096);
     size_t MAX_HTTP_HEADER_COUNT = server->http_server_config.max_header_count ? server->http_server_config.max_header_count : 24;
     size_t MAX_HTTP_BODY_LEN = (server->http_server_config.max_body_len ? server->http_server_config.max_body_len : 65536);
-
-    vector_init(&current_state->request.headers, 8, sizeof(struct http_header));
+    /** The request line and every header with their delimiters, plus the empty line. */
+    size_t MAX_HTTP_HEAD_LEN = MAX_HTTP_METHOD_LEN + MAX_HTTP_PATH_LEN + MAX_HTTP_VERSION_LEN + 4 + MAX_HTTP_HEADER_COUNT * (MAX_HTTP_HEADER_NAME_LEN + MAX_HTTP_HEADER_VALUE_LEN + 4) + 2;
 
 parse_start:
     errno = 0;
@@ -131,189 +480,165 @@ parse_start:
     {
         case REQUEST_PARSING_STATE_NIL:
         {
-            current_state->parsing_state = REQUEST_PARSING_STATE_METHOD;
+            current_state->parsing_state = REQUEST_PARSING_STATE_HEAD;
             goto parse_start;
         };
-        case REQUEST_PARSING_STATE_METHOD:
+        case REQUEST_PARSING_STATE_HEAD:
         {
-            string_t *method = &current_state->request.method;
-            
-            if (method->length == 0) sso_string_init(method, "");
-            if (method->length < MAX_HTTP_METHOD_LEN)
+            /** The head is only parsed once it is fully buffered, so the request can borrow its strings from the buffer. */
+            ssize_t head_length = _http_server_buffer_until(sockfd, recv_buffer, "\r\n\r\n", 4, &current_state->head_scanned, MAX_HTTP_HEAD_LEN);
+            if (head_length <= 0) return head_length == 0 ? 1 : head_length;
+
+            struct http_request *request = &current_state->request;
+            char *head = recv_buffer->data + recv_buffer->offset;
+            /** Points to the CRLF of the empty line ending the head. */
+            char *head_end = head + head_length - 2;
+
+            /** Each token is null terminated in place by overwriting the delimiter after it. */
+            char *method_end = head + _http_token_length(head, head_end - head);
+            if (method_end == head || *method_end != ' ') return REQUEST_PARSE_ERROR_MALFORMED;
+
+            char *path_end = method_end + 1 + simd_find_ranges(method_end + 1, head_end - method_end - 1, _http_target_end_ranges, sizeof(_http_target_end_ranges) - 1);
+            if (path_end == method_end + 1 || *path_end != ' ') return REQUEST_PARSE_ERROR_MALFORMED;
+
+            char *line_end = path_end + 1 + simd_find_ranges(path_end + 1, head_end - path_end - 1, _http_target_end_ranges, sizeof(_http_target_end_ranges) - 1);
+            if (line_end[0] != '\r' || line_end[1] != '\n') return REQUEST_PARSE_ERROR_MALFORMED;
+
+            if (
+                method_end - head > MAX_HTTP_METHOD_LEN 
+                || path_end - method_end - 1 > MAX_HTTP_PATH_LEN 
+                || line_end - path_end - 1 > MAX_HTTP_VERSION_LEN
+            ) return REQUEST_PARSE_ERROR_TOO_LONG;
+
+            *method_end = *path_end = *line_end = '\0';
+            sso_string_init_view(&request->method, head, method_end - head);
+            sso_string_init_view(&request->path, method_end + 1, path_end - method_end - 1);
+            sso_string_init_view(&request->version, path_end + 1, line_end - path_end - 1);
+
+            /** The headers are the only allocation while the head is parsed, so they grow in place in the arena. */
+            request->arena = &client->request_arena;
+            request->headers = (struct vector){ .capacity = 8, .element_size = sizeof(struct http_header) };
+            request->headers.elements = arena_alloc(request->arena, request->headers.capacity * sizeof(struct http_header));
+
+            for (char *line = line_end + 2; line != head_end; line = line_end + 2)
             {
-                ssize_t bytes_received = socket_recv_until_dynamic(sockfd, method, " ", 1, MAX_HTTP_METHOD_LEN - method->length + 1);
-                if (bytes_received <= 0)
-                {
-                    if (errno == EWOULDBLOCK) return 1;
-                    else return REQUEST_PARSE_ERROR_RECV;
-                };
-            };
+                if (request->headers.size >= MAX_HTTP_HEADER_COUNT) return REQUEST_PARSE_ERROR_TOO_MANY_HEADERS;
 
-            current_state->parsing_state = REQUEST_PARSING_STATE_PATH;
-            goto parse_start;
-        };
-        case REQUEST_PARSING_STATE_PATH:
-        {
-            string_t *path = &current_state->request.path;
-            
-            if (path->length == 0) sso_string_init(path, "");
-            if (path->length < MAX_HTTP_PATH_LEN)
-            {
-                ssize_t bytes_received = socket_recv_until_dynamic(sockfd, path, " ", 1, MAX_HTTP_PATH_LEN - path->length + 1);
-                if (bytes_received <= 0)
-                {
-                    if (errno == EWOULDBLOCK) return 1;
-                    else return REQUEST_PARSE_ERROR_RECV;
-                };
-            };
+                char *name_end = line + _http_token_length(line, head_end - line);
+                if (name_end == line || *name_end != ':') return REQUEST_PARSE_ERROR_MALFORMED;
 
-            current_state->parsing_state = REQUEST_PARSING_STATE_VERSION;
-            goto parse_start;
-        };
-        case REQUEST_PARSING_STATE_VERSION:
-        {
-            string_t *version = &current_state->request.version;
-            
-            if (version->length == 0) sso_string_init(version, "");
-            if (version->length < MAX_HTTP_VERSION_LEN)
-            {
-                ssize_t bytes_received = socket_recv_until_dynamic(sockfd, version, "\r\n", 1, MAX_HTTP_VERSION_LEN - version->length + 2);
-                if (bytes_received <= 0)
-                {
-                    if (errno == EWOULDBLOCK) return 1;
-                    else return REQUEST_PARSE_ERROR_RECV;
-                };
-            };
+                line_end = name_end + 1 + simd_find_ranges(name_end + 1, head_end - name_end - 1, _http_value_end_ranges, sizeof(_http_value_end_ranges) - 1);
+                if (line_end[0] != '\r' || line_end[1] != '\n') return REQUEST_PARSE_ERROR_MALFORMED;
 
-            current_state->parsing_state = REQUEST_PARSING_STATE_HEADER_NAME;
-            goto parse_start;
-        };
-        case REQUEST_PARSING_STATE_HEADER_NAME:
-        {
-            /** Test for CRLF. */
-            char crlf[2] = {0};
-            recv(sockfd, crlf, sizeof(crlf), MSG_PEEK);
+                /** Optional whitespace around the value is not part of it. */
+                char *value = name_end + 1;
+                char *value_end = line_end;
+                while (value < value_end && (*value == ' ' || *value == '\t')) ++value;
+                while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) --value_end;
 
-            if (crlf[0] == '\r')
-            {
-                if (crlf[1] == '\n')
-                {
-                    if (recv(sockfd, crlf, sizeof(crlf), 0) <= 0) return REQUEST_PARSE_ERROR_RECV;
-                
-                    if (current_state->content_length == 0) break;
-
-                    current_state->parsing_state = 
-                        current_state->content_length == -1 ?
-                        REQUEST_PARSING_STATE_CHUNK_SIZE : 
-                        REQUEST_PARSING_STATE_BODY;
-                    goto parse_start;
-                } else return 1;
-            };
+                if (name_end - line > MAX_HTTP_HEADER_NAME_LEN || value_end - value > MAX_HTTP_HEADER_VALUE_LEN) return REQUEST_PARSE_ERROR_TOO_LONG;
 
-            struct vector *headers = &current_state->request.headers;
-            struct http_header *header = &current_state->header;
+                *name_end = *value_end = '\0';
 
-            if (headers->size >= MAX_HTTP_HEADER_COUNT) return REQUEST_PARSE_ERROR_TOO_MANY_HEADERS;
-            if (header->name.length == 0) sso_string_init(&header->name, "");
-            
-            if (header->name.length < MAX_HTTP_HEADER_NAME_LEN)
-            {
-                size_t length = MAX_HTTP_HEADER_NAME_LEN - header->name.length + 2 /** crlf */;
-                char *delimiter = length == 1 ? " " : ": ";
+                struct http_header header = {0};
+                sso_string_init_view(&header.name, line, name_end - line);
+                sso_string_init_view(&header.value, value, value_end - value);
 
-                ssize_t bytes_received = socket_recv_until_dynamic(sockfd, &header->name, delimiter, 1, length + 2);
-                if (bytes_received <= 0)
+                if (strcasecmp(line, "Content-Length") == 0)
                 {
-                    if (errno == EWOULDBLOCK) return 1;
-                    else return REQUEST_PARSE_ERROR_RECV;
-                };
-            };
+                    current_state->content_length = atoi(value);
+                    if (current_state->content_length > MAX_HTTP_BODY_LEN) return REQUEST_PARSE_ERROR_BODY_TOO_BIG;
+                }
+                else if (strcasecmp(line, "Transfer-Encoding") == 0 && strcasecmp(value, "chunked") == 0)
+                    current_state->content_length = -1;
 
-            current_state->parsing_state = REQUEST_PARSING_STATE_HEADER_VALUE;
-            goto parse_start;
-        };
-        case REQUEST_PARSING_STATE_HEADER_VALUE:
-        {
-            struct vector *headers = &current_state->request.headers;
-            struct http_header *header = &current_state->header;
+                if (strcasecmp(line, "Connection") == 0 && _http_header_has_token(value, "close"))
+                    client->server_close_flag = 1;
 
-            if (header->value.length == 0) sso_string_init(&header->value, "");
-            if (header->value.length < MAX_HTTP_HEADER_VALUE_LEN)
-            {
-                size_t length = MAX_HTTP_HEADER_VALUE_LEN - current_state->header.value.length + 2 /** crlf */;
-                char *delimiter = length == 1 ? "\n" : "\r\n";
-                
-                ssize_t bytes_received = socket_recv_until_dynamic(sockfd, &header->value, delimiter, 1, length);
-                if (bytes_received <= 0)
+                if (strcasecmp(line, "Upgrade") == 0 && strcasecmp(value, "websocket") == 0)
+                    request->upgrade_websocket = true;
+
+                if (request->headers.size == request->headers.capacity)
                 {
-                    if (errno == EWOULDBLOCK) return 1;
-                    else return REQUEST_PARSE_ERROR_RECV;
+                    request->headers.elements = arena_realloc(request->arena, request->headers.elements, request->headers.capacity * sizeof(struct http_header), request->headers.capacity * 2 * sizeof(struct http_header));
+                    request->headers.capacity *= 2;
                 };
+
+                vector_push(&request->headers, &header);
             };
 
-            if (strcasecmp(sso_string_get(&header->name), "Content-Length") == 0)
-            {
-                current_state->content_length = atoi(sso_string_get(&header->value));
-                if (current_state->content_length > MAX_HTTP_BODY_LEN) return REQUEST_PARSE_ERROR_BODY_TOO_BIG;
-            }
-            else if (strcasecmp(sso_string_get(&header->name), "Transfer-Encoding") == 0 && strcasecmp(sso_string_get(&header->value), "chunked") == 0)
-                current_state->content_length = -1;
-            
-            if (strcasecmp(sso_string_get(&header->name), "Connection") == 0 && strcasecmp(sso_string_get(&header->value), "close") == 0)
-                client->server_close_flag = 1;
+            current_state->head = head;
+            current_state->head_length = head_length;
+            recv_buffer->offset += head_length;
 
-            if (strcasecmp(sso_string_get(&header->name), "Upgrade") == 0 && strcasecmp(sso_string_get(&header->value), "websocket") == 0)
-                current_state->request.upgrade_websocket = true;                
+            if (current_state->content_length == 0) break;
 
-            vector_push(headers, header);
-            memset(header, 0, sizeof(struct http_header));
+            /** The head would be overwritten if the buffer is refilled while receiving the body. */
+            if (current_state->content_length < 0 || socket_buffer_available(recv_buffer) < current_state->content_length)
+                _http_server_detach_head(current_state);
 
-            current_state->parsing_state = REQUEST_PARSING_STATE_HEADER_NAME;
+            current_state->parsing_state = 
+                current_state->content_length == -1 ?
+                REQUEST_PARSING_STATE_CHUNK_SIZE : 
+                REQUEST_PARSING_STATE_BODY;
             goto parse_start;
         };
         case REQUEST_PARSING_STATE_CHUNK_SIZE:
         {
-            if (current_state->chunk_data.size == 0)
+            if (current_state->chunk_data.elements == NULL)
             {
                 current_state->chunk_size = -1;
-                vector_init(&current_state->chunk_data, 8, sizeof(char));
+                current_state->chunk_data = (struct vector){ .capacity = 64, .element_size = sizeof(char) };
+                current_state->chunk_data.elements = arena_alloc(current_state->request.arena, current_state->chunk_data.capacity);
             };
 
             if (current_state->chunk_size == -1)
             {
-                size_t preexisting_chunk_length = strlen(current_state->chunk_length);
-                size_t length = 16 + 2 - preexisting_chunk_length;
-                char *delimiter = length == 1 ? "\n" : "\r\n";
+                /** The chunk size line is parsed once it is fully buffered. */
+                ssize_t line_length = _http_server_buffer_until(sockfd, recv_buffer, "\r\n", 2, &current_state->head_scanned, MAX_HTTP_HEADER_VALUE_LEN);
+                if (line_length <= 0) return line_length == 0 ? 1 : line_length;
+
+                char *line = recv_buffer->data + recv_buffer->offset;
+                size_t chunk_size = 0;
+                size_t digits = 0;
 
-                int bytes_received_chunk_length = socket_recv_until_fixed(sockfd, current_state->chunk_length + preexisting_chunk_length, length, delimiter, 1);
-                if (bytes_received_chunk_length <= 0)
+                for (int value = 0; (value = _http_hex_value(line[digits])) != -1; ++digits)
                 {
-                    if (errno == EWOULDBLOCK) return 1;
-                    else return REQUEST_PARSE_ERROR_RECV;
+                    /** A size which does not fit in a `size_t` could never fit in the body either. */
+                    if (chunk_size > SIZE_MAX >> 4) return REQUEST_PARSE_ERROR_BODY_TOO_BIG;
+                    chunk_size = chunk_size << 4 | value;
                 };
 
-                current_state->chunk_size = strtoul(current_state->chunk_length, NULL, 16);
-                memset(&current_state->chunk_length, 0, sizeof(current_state->chunk_length));
+                /** Chunk extensions (`;name=value`) are ignored. */
+                if (digits == 0 || (line[digits] != '\r' && line[digits] != ';')) return REQUEST_PARSE_ERROR_MALFORMED;
+
+                /** Compared against the room left so the sum cannot wrap around. The body never exceeds the limit, so the room cannot either. */
+                if (chunk_size > MAX_HTTP_BODY_LEN - current_state->request.body_size) return REQUEST_PARSE_ERROR_BODY_TOO_BIG;
+
+                recv_buffer->offset += line_length;
+                current_state->chunk_size = chunk_size;
             };
 
             if (current_state->chunk_size == 0)
             {
-                /** Test for CRLF. */
-                char crlf[2] = {0};
-                recv(sockfd, crlf, sizeof(crlf), MSG_PEEK);
-
-                if (crlf[0] == '\r' && crlf[1] == '\n')
+                /** The last chunk is followed by an empty line, or by trailers ending with one. Trailers are not kept. */
+                ssize_t bytes_received = socket_buffer_require(sockfd, recv_buffer, 2);
+                if (bytes_received <= 0)
                 {
-                    if (recv(sockfd, crlf, sizeof(crlf), 0) <= 0) return REQUEST_PARSE_ERROR_RECV;
-                    break;
-                }
-                else if (++x == 2)
+                    if (errno == EWOULDBLOCK) return 1;
+                    else return REQUEST_PARSE_ERROR_RECV;
+                };
+
+                ssize_t trailers_length = 2;
+                if (memcmp(recv_buffer->data + recv_buffer->offset, "\r\n", 2) != 0)
                 {
-                    exit(0);
-                }
-            };
+                    trailers_length = _http_server_buffer_until(sockfd, recv_buffer, "\r\n\r\n", 4, &current_state->head_scanned, MAX_HTTP_HEAD_LEN);
+                    if (trailers_length <= 0) return trailers_length == 0 ? 1 : trailers_length;
+                };
 
-            if (current_state->request.body_size + current_state->chunk_size > MAX_HTTP_BODY_LEN) return REQUEST_PARSE_ERROR_BODY_TOO_BIG;
+                recv_buffer->offset += trailers_length;
+                break;
+            };
 
             current_state->parsing_state = REQUEST_PARSING_STATE_CHUNK_DATA;
             goto parse_start;
@@ -323,10 +648,19 @@ parse_start:
             size_t preexisting_chunk_data = current_state->chunk_data.size - current_state->request.body_size;
             size_t length = current_state->chunk_size + 2 - preexisting_chunk_data;
 
-            vector_resize(&current_state->chunk_data, current_state->chunk_data.size + length);
+            /** Room is kept for the CRLF after the chunk, which is later replaced by the null terminator. */
+            if (current_state->chunk_data.size + length > current_state->chunk_data.capacity)
+            {
+                size_t capacity = current_state->chunk_data.capacity * 2;
+                if (capacity < current_state->chunk_data.size + length) capacity = current_state->chunk_data.size + length;
+
+                current_state->chunk_data.elements = arena_realloc(current_state->request.arena, current_state->chunk_data.elements, current_state->chunk_data.capacity, capacity);
+                current_state->chunk_data.capacity = capacity;
+            };
+
             char *buffer_ptr = current_state->chunk_data.elements + current_state->chunk_data.size;
 
-            ssize_t bytes_received = recv(sockfd, buffer_ptr, length, 0);
+            ssize_t bytes_received = socket_buffer_recv(sockfd, recv_buffer, buffer_ptr, length, 0);
 
             if (bytes_received <= 0)
             {
@@ -339,6 +673,9 @@ parse_start:
             if (current_state->chunk_data.size >= current_state->request.body_size + current_state->chunk_size + 2)
             {
                 current_state->chunk_data.size -= 2;
+
+                /** The chunk data must be followed by exactly a CRLF. */
+                if (memcmp((char *)current_state->chunk_data.elements + current_state->chunk_data.size, "\r\n", 2) != 0) return REQUEST_PARSE_ERROR_MALFORMED;
             } else return 1;
 
             current_state->request.body_size += current_state->chunk_size;
@@ -351,14 +688,14 @@ parse_start:
         {
             if (current_state->request.body == NULL)
             {
-                current_state->request.body = malloc(current_state->content_length + 1);
+                current_state->request.body = arena_alloc(current_state->request.arena, current_state->content_length + 1);
                 current_state->request.body[current_state->content_length] = '\0';
             };
 
             size_t preexisting_body_data = current_state->request.body_size;
             size_t length = current_state->content_length - preexisting_body_data;
 
-            ssize_t bytes_received_body = recv(sockfd, current_state->request.body + preexisting_body_data, length, 0);
+            ssize_t bytes_received_body = socket_buffer_recv(sockfd, recv_buffer, current_state->request.body + preexisting_body_data, length, 0);
             
             if (bytes_received_body == -1)
             {
@@ -371,9 +708,9 @@ parse_start:
         };
     };
 
-    if (current_state->chunk_data.size > 0)
+    if (current_state->chunk_data.elements != NULL)
     {
-        vector_push(&current_state->chunk_data, &(char){'\0'});
+        ((char *)current_state->chunk_data.elements)[current_state->chunk_data.size] = '\0';
         current_state->request.body = (char *)current_state->chunk_data.elements;
     };
 
@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
 
@@ -13,47 +14,234 @@
 #include <sys/socket.h>
 #endif
 
-int socket_recv_until_dynamic(socket_t sockfd, string_t *string, const char *bytes, int remove_delimiter, size_t max_bytes_received)
+void socket_buffer_init(struct socket_buffer *buffer)
 {
-    size_t bytes_len = bytes == NULL ? 0 : strlen(bytes);
-    ssize_t bytes_received = 0;
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->capacity = 0;
+    buffer->offset = 0;
+    buffer->filled_externally = false;
+};
 
-    int has_pattern = 0;
+ssize_t socket_buffer_fill(socket_t sockfd, struct socket_buffer *buffer)
+{
+    if (buffer->filled_externally)
+    {
+        errno = EWOULDBLOCK;
+        return -1;
+    };
 
-    while (bytes_received < max_bytes_received)
+    if (buffer->offset == buffer->size) buffer->offset = buffer->size = 0;
+
+    /** Reclaim consumed bytes before growing, so the buffer only grows when it is full of unconsumed bytes. */
+    if (buffer->offset > 0 && buffer->capacity - buffer->size < buffer->capacity / 4)
+    {
+        memmove(buffer->data, buffer->data + buffer->offset, buffer->size - buffer->offset);
+        buffer->size -= buffer->offset;
+        buffer->offset = 0;
+    };
+
+    if (buffer->size == buffer->capacity)
     {
-        char c;
-        ssize_t recv_result = recv(sockfd, &c, sizeof(c), 0);
-        if (recv_result <= 0)
+        size_t capacity = buffer->capacity == 0 ? SOCKET_BUFFER_INITIAL_CAPACITY : buffer->capacity * 2;
+
+        char *data = realloc(buffer->data, capacity);
+        if (data == NULL)
         {
-            if (recv_result == -1 && errno != EWOULDBLOCK) 
-                netc_error(BADRECV);
+            errno = ENOMEM;
+            return -1;
+        };
+
+        buffer->data = data;
+        buffer->capacity = capacity;
+    };
+
+    ssize_t recv_result = recv(sockfd, buffer->data + buffer->size, buffer->capacity - buffer->size, 0);
+    if (recv_result > 0) buffer->size += recv_result;
+
+    return recv_result;
+};
+
+size_t socket_buffer_available(struct socket_buffer *buffer)
+{
+    return buffer->size - buffer->offset;
+};
+
+ssize_t socket_buffer_recv(socket_t sockfd, struct socket_buffer *buffer, void *dest, size_t length, int flags)
+{
+    size_t available = socket_buffer_available(buffer);
+
+    /** Large reads go straight to the destination when nothing is buffered, avoiding a copy. */
+    if (available == 0 && !(flags & MSG_PEEK) && length >= SOCKET_BUFFER_INITIAL_CAPACITY && !buffer->filled_externally)
+        return recv(sockfd, dest, length, flags);
+
+    if (available == 0 || (available < length && flags & MSG_PEEK))
+    {
+        ssize_t recv_result = socket_buffer_fill(sockfd, buffer);
+        if (recv_result <= 0 && available == 0) return recv_result;
+
+        available = socket_buffer_available(buffer);
+    };
+
+    if (length > available) length = available;
+
+    memcpy(dest, buffer->data + buffer->offset, length);
+    if (!(flags & MSG_PEEK)) buffer->offset += length;
+
+    return length;
+};
+
+int socket_buffer_append(struct socket_buffer *buffer, const void *data, size_t length)
+{
+    if (buffer->offset == buffer->size) buffer->offset = buffer->size = 0;
 
-            return recv_result;
+    if (buffer->capacity - buffer->size < length && buffer->offset > 0)
+    {
+        memmove(buffer->data, buffer->data + buffer->offset, buffer->size - buffer->offset);
+        buffer->size -= buffer->offset;
+        buffer->offset = 0;
+    };
+
+    if (buffer->capacity - buffer->size < length)
+    {
+        size_t capacity = buffer->capacity == 0 ? SOCKET_BUFFER_INITIAL_CAPACITY : buffer->capacity;
+        while (capacity - buffer->size < length) capacity *= 2;
+
+        char *new_data = realloc(buffer->data, capacity);
+        if (new_data == NULL)
+        {
+            errno = ENOMEM;
+            return -1;
         };
 
-        bytes_received++;
-        sso_string_concat_char(string, c);
+        buffer->data = new_data;
+        buffer->capacity = capacity;
+    };
+
+    memcpy(buffer->data + buffer->size, data, length);
+    buffer->size += length;
+
+    return 0;
+};
+
+ssize_t socket_buffer_require(socket_t sockfd, struct socket_buffer *buffer, size_t length)
+{
+    while (socket_buffer_available(buffer) < length)
+    {
+        ssize_t recv_result = socket_buffer_fill(sockfd, buffer);
+        if (recv_result <= 0) return recv_result;
+    };
+
+    return socket_buffer_available(buffer);
+};
+
+size_t socket_buffer_find(struct socket_buffer *buffer, const char *bytes, size_t bytes_length, size_t *scanned)
+{
+    size_t length = socket_buffer_available(buffer);
+    if (length == 0) return 0;
+
+    /** The last byte of the pattern is searched for, so a match ending in the new bytes is found even if it starts in the scanned ones. */
+    const char *data = buffer->data + buffer->offset;
+    const char *cursor = data + (*scanned < length ? *scanned : length);
+    char last_byte = bytes[bytes_length - 1];
 
-        if (bytes != NULL && bytes_received >= bytes_len && strcmp(sso_string_get(string) + string->length - bytes_len, bytes) == 0)
+    while ((cursor = memchr(cursor, last_byte, data + length - cursor)) != NULL)
+    {
+        size_t end = cursor - data + 1;
+        if (end >= bytes_length && memcmp(cursor + 1 - bytes_length, bytes, bytes_length) == 0) return end;
+
+        ++cursor;
+    };
+
+    *scanned = length;
+    return 0;
+};
+
+void socket_buffer_free(struct socket_buffer *buffer)
+{
+    free(buffer->data);
+    socket_buffer_init(buffer);
+};
+
+/** Finds where a delimiter ends in `data`, taking the delimiter bytes already stored at the end of `string` into account. */
+static size_t _socket_find_delimiter(string_t *string, const char *data, size_t length, const char *bytes, size_t bytes_len, size_t *bytes_in_string)
+{
+    const char *end = data + length;
+    const char *cursor = data;
+
+    while ((cursor = memchr(cursor, bytes[bytes_len - 1], end - cursor)) != NULL)
+    {
+        size_t taken = cursor - data + 1;
+        size_t in_data = taken - 1 < bytes_len - 1 ? taken - 1 : bytes_len - 1;
+        size_t in_string = bytes_len - 1 - in_data;
+
+        if (
+            in_string <= string->length
+            && memcmp(cursor - in_data, bytes + in_string, in_data) == 0
+            && memcmp(sso_string_get(string) + string->length - in_string, bytes, in_string) == 0
+        )
         {
-            has_pattern = 1;
+            *bytes_in_string = in_string;
+            return taken;
+        };
 
-            if (remove_delimiter)
+        ++cursor;
+    };
+
+    return 0;
+};
+
+int socket_recv_until_dynamic(socket_t sockfd, struct socket_buffer *socket_buffer, string_t *string, const char *bytes, int remove_delimiter, size_t max_bytes_received)
+{
+    size_t bytes_len = bytes == NULL ? 0 : strlen(bytes);
+    size_t bytes_received = 0;
+
+    while (bytes_received < max_bytes_received)
+    {
+        if (socket_buffer_available(socket_buffer) == 0)
+        {
+            ssize_t recv_result = socket_buffer_fill(sockfd, socket_buffer);
+            if (recv_result <= 0)
             {
-                sso_string_backspace(string, bytes_len);
-                bytes_received -= bytes_len;
+                if (recv_result == -1 && errno != EWOULDBLOCK) 
+                    netc_error(BADRECV);
+
+                return recv_result;
             };
+        };
 
-            break;
+        const char *data = socket_buffer->data + socket_buffer->offset;
+        size_t length = socket_buffer_available(socket_buffer);
+        if (length > max_bytes_received - bytes_received) length = max_bytes_received - bytes_received;
+
+        size_t bytes_in_string = 0;
+        size_t taken = bytes == NULL ? 0 : _socket_find_delimiter(string, data, length, bytes, bytes_len, &bytes_in_string);
+
+        if (taken == 0)
+        {
+            sso_string_concat_bytes(string, data, length);
+            socket_buffer->offset += length;
+            bytes_received += length;
+
+            continue;
         };
+
+        if (remove_delimiter)
+        {
+            sso_string_backspace(string, bytes_in_string);
+            sso_string_concat_bytes(string, data, taken - (bytes_len - bytes_in_string));
+        }
+        else sso_string_concat_bytes(string, data, taken);
+
+        socket_buffer->offset += taken;
+        return bytes_received + taken;
     };
 
-    if (bytes != NULL && has_pattern == 0) return -2;
+    if (bytes != NULL) return -2;
     return bytes_received;
 };
 
-int socket_recv_until_fixed(socket_t sockfd, char *buffer, size_t buffer_size, const char *bytes, int remove_delimiter)
+int socket_recv_until_fixed(socket_t sockfd, struct socket_buffer *socket_buffer, char *buffer, size_t buffer_size, const char *bytes, int remove_delimiter)
 {
     size_t bytes_len = bytes == NULL ? 0 : strlen(bytes);
     size_t bytes_received = 0;
@@ -62,19 +250,22 @@ int socket_recv_until_fixed(socket_t sockfd, char *buffer, size_t buffer_size, c
     
     while ((bytes_received + bytes_len) < buffer_size)
     {
-        ssize_t recv_result = recv(sockfd, buffer + bytes_received, 1, 0);
-        if (recv_result <= 0) 
+        if (socket_buffer_available(socket_buffer) == 0)
         {
-            if (recv_result == -1) 
+            ssize_t recv_result = socket_buffer_fill(sockfd, socket_buffer);
+            if (recv_result <= 0) 
             {
-                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
-                netc_error(BADRECV);
-            };
+                if (recv_result == -1) 
+                {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                    netc_error(BADRECV);
+                };
 
-            return recv_result;
+                return recv_result;
+            };
         };
 
-        bytes_received += recv_result;
+        buffer[bytes_received++] = socket_buffer->data[socket_buffer->offset++];
 
         if (bytes != NULL && bytes_received >= bytes_len && strncmp(buffer + bytes_received - bytes_len, bytes, bytes_len) == 0)
         {
@@ -94,6 +285,29 @@ int socket_recv_until_fixed(socket_t sockfd, char *buffer, size_t buffer_size, c
     return bytes_received;
 };
 
+ssize_t socket_sendv(socket_t sockfd, struct iovec *iov, int iovcnt, int flags)
+{
+#ifdef _WIN32
+    WSABUF buffers[iovcnt];
+    for (int i = 0; i < iovcnt; ++i)
+    {
+        buffers[i].buf = iov[i].iov_base;
+        buffers[i].len = (ULONG)iov[i].iov_len;
+    };
+
+    DWORD bytes_sent = 0;
+    if (WSASend(sockfd, buffers, iovcnt, &bytes_sent, flags, NULL, NULL) == SOCKET_ERROR) return -1;
+
+    return bytes_sent;
+#else
+    struct msghdr message = {0};
+    message.msg_iov = iov;
+    message.msg_iovlen = iovcnt;
+
+    return sendmsg(sockfd, &message, flags);
+#endif
+};
+
 int socket_set_non_blocking(socket_t sockfd)
 {
 #ifdef _WIN32
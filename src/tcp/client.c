@@ -134,6 +134,9 @@ int tcp_client_init(struct tcp_client *client, struct sockaddr *addr, int non_bl
     if (client->sockfd == -1) return netc_error(SOCKET_C);
 
     client->listening = 0;
+    client->server = NULL;
+    socket_buffer_init(&client->recv_buffer);
+    socket_buffer_init(&client->send_buffer);
 
     if (non_blocking == 0) return 0; 
     if (socket_set_non_blocking(client->sockfd) != 0) return netc_error(FD_CTL);
@@ -187,6 +190,14 @@ int tcp_client_send(struct tcp_client *client, const char *message, size_t msgle
     return result;
 };
 
+ssize_t tcp_client_sendv(struct tcp_client *client, struct iovec *iov, int iovcnt, int flags)
+{
+    ssize_t result = socket_sendv(client->sockfd, iov, iovcnt, flags);
+    if (result == -1) netc_error(BADSEND);
+
+    return result;
+};
+
 int tcp_client_receive(struct tcp_client *client, const char *message, size_t msglen, int flags)
 {
     socket_t sockfd = client->sockfd;
@@ -203,6 +214,7 @@ int tcp_client_close(struct tcp_client *client, bool is_error)
 
     socket_t sockfd = client->sockfd;
     client->listening = 0;
+    socket_buffer_free(&client->recv_buffer);
     
 #ifdef _WIN32
     int result = closesocket(sockfd);
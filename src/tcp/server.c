@@ -1,4 +1,9 @@
+#ifdef __linux__
+#define _GNU_SOURCE /** accept4 */
+#endif
+
 #include "../../include/tcp/server.h"
+#include "../../include/tcp/uring.h"
 #include "../../include/utils/error.h"
 
 #include <stdlib.h>
@@ -9,6 +14,8 @@
 
 #ifdef __linux__
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
 #elif _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <winsock2.h>
@@ -16,34 +23,712 @@
 #include <sys/event.h>
 #endif
 
-#ifndef _WIN32
-#include <sys/socket.h>
-#include <errno.h>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <errno.h>
+#endif
+
+#if defined(__linux__) && defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY)
+#define TCP_ZEROCOPY_SUPPORTED
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#endif
+
+#ifdef __linux__
+#define POLL_EVENT_SIZE sizeof(struct epoll_event)
+#elif __APPLE__
+#define POLL_EVENT_SIZE sizeof(struct kevent)
+#endif
+
+/** Starts or stops watching a client's socket for writability. */
+static int _tcp_server_watch_writable(struct tcp_server *server, struct tcp_client *client, bool writable)
+{
+#ifdef TCP_URING_SUPPORTED
+    /** A poll of io_uring only reports writability once, so there is nothing to stop. */
+    if (server->uring != NULL)
+    {
+        struct tcp_uring_slot *slot = tcp_uring_slot(server->uring, client->sockfd);
+        if (!writable || slot == NULL || slot->writable_armed) return 0;
+
+        if (tcp_uring_prep_poll_writable(server->uring, client->sockfd, slot->generation) != 0) return netc_error(POLL_FD);
+        slot->writable_armed = true;
+
+        return 0;
+    };
+#endif
+
+#ifdef __linux__
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP | (writable ? EPOLLOUT : 0) | (server->edge_triggered ? EPOLLET : 0);
+    ev.data.fd = client->sockfd;
+    if (epoll_ctl(server->pfd, EPOLL_CTL_MOD, client->sockfd, &ev) == -1) return netc_error(POLL_FD);
+#elif _WIN32
+    for (size_t i = 0; i < server->events.size; ++i)
+    {
+        WSAPOLLFD *event = vector_get(&server->events, i);
+        if (event->fd == client->sockfd)
+        {
+            event->events = POLLIN | POLLERR | POLLHUP | (writable ? POLLOUT : 0);
+            break;
+        };
+    };
+#elif __APPLE__
+    struct kevent ev;
+    EV_SET(&ev, client->sockfd, EVFILT_WRITE, writable ? EV_ADD | (server->edge_triggered ? EV_CLEAR : 0) : EV_DELETE, 0, 0, NULL);
+    if (kevent(server->pfd, &ev, 1, NULL, 0, NULL) == -1) return netc_error(POLL_FD);
+#endif
+
+    return 0;
+};
+
+/** Adds a client to the pending clients, and watches its socket for writability. Returns `0`, or `-1` if it could not be added. */
+static int _tcp_server_add_pending(struct tcp_server *server, struct tcp_client *client)
+{
+    if (map_set(&server->pending_clients, client->sockfd, client) != 0)
+    {
+        netc_error(BADSEND);
+        return -1;
+    };
+
+    return _tcp_server_watch_writable(server, client, true);
+};
+
+/** Whether or not a client has bytes, files or buffers queued, which new bytes have to be sent behind. */
+static bool _tcp_server_is_queued(struct tcp_client *client)
+{
+    return socket_buffer_available(&client->send_buffer) > 0 || client->send_ranges.size > 0;
+};
+
+#ifdef TCP_ZEROCOPY_SUPPORTED
+/** Watches the error queue of a client socket for completed zerocopy sends. Sockets are always polled for errors, besides with io_uring. */
+static void _tcp_server_watch_errors(struct tcp_server *server, struct tcp_client *client)
+{
+#ifdef TCP_URING_SUPPORTED
+    if (server->uring == NULL) return;
+
+    struct tcp_uring_slot *slot = tcp_uring_slot(server->uring, client->sockfd);
+    if (slot == NULL || slot->error_armed) return;
+
+    if (tcp_uring_prep_poll_error(server->uring, client->sockfd, slot->generation) == 0) slot->error_armed = true;
+#endif
+};
+
+/** Enables zerocopy sends on a client socket. Returns whether or not they are enabled. */
+static bool _tcp_server_enable_zerocopy(struct tcp_server *server, struct tcp_client *client)
+{
+    if (client->zerocopy_enabled) return true;
+    if (client->zerocopy_unavailable) return false;
+
+    if (setsockopt(client->sockfd, SOL_SOCKET, SO_ZEROCOPY, &(int){1}, sizeof(int)) == -1)
+    {
+        client->zerocopy_unavailable = true;
+        return false;
+    };
+
+    /** A client whose completions could not be found from its socket would never release its buffers. */
+    if (map_set(&server->zerocopy_clients, client->sockfd, client) != 0)
+    {
+        client->zerocopy_unavailable = true;
+        return false;
+    };
+
+    client->zerocopy_enabled = true;
+
+    return true;
+};
+
+/** 
+ * Reads the completions of zerocopy sends from the error queue of a socket, and releases the buffers which the kernel no longer references.
+ * Counts the completed sends in `completed` unless it is `NULL`. Returns whether or not the kernel reported copying the bytes anyway.
+*/
+static bool _tcp_server_reap_releases(socket_t sockfd, struct vector *releases, uint32_t *completed)
+{
+    char control[128];
+    bool copied = false;
+
+    while (true)
+    {
+        struct msghdr msg = { .msg_control = control, .msg_controllen = sizeof(control) };
+        if (recvmsg(sockfd, &msg, MSG_ERRQUEUE) == -1) break;
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) && !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) continue;
+
+            struct sock_extended_err *error = (struct sock_extended_err *)CMSG_DATA(cmsg);
+            if (error->ee_origin != SO_EE_ORIGIN_ZEROCOPY || error->ee_errno != 0) continue;
+
+            if (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) copied = true;
+            if (completed != NULL && (int32_t)(error->ee_data + 1 - *completed) > 0) *completed = error->ee_data + 1;
+
+            /** TCP completes its sends in order, so every send up to the last one of the range is complete. */
+            while (releases->size > 0)
+            {
+                struct tcp_zerocopy_release release = *(struct tcp_zerocopy_release *)vector_get(releases, 0);
+                if ((int32_t)(release.sequence - error->ee_data) > 0) break;
+
+                vector_delete(releases, 0);
+                if (release.on_sent != NULL) release.on_sent(release.data);
+            };
+        };
+    };
+
+    return copied;
+};
+
+/** Reaps the completions of the zerocopy sends of a client, and keeps watching for the ones which are left. */
+static void _tcp_server_reap_zerocopy(struct tcp_server *server, struct tcp_client *client)
+{
+    /** The kernel had to copy the bytes anyway (i.e. over loopback), so pinning pages only costs more for this socket. */
+    if (_tcp_server_reap_releases(client->sockfd, &client->zerocopy_releases, &client->zerocopy_completed)) client->zerocopy_unavailable = true;
+
+    if (client->zerocopy_releases.size > 0) _tcp_server_watch_errors(server, client);
+};
+
+/** Releases every buffer of the zerocopy sends of a closed client, closes its duplicate socket and frees them. */
+static void _tcp_server_free_zerocopy_closed(struct tcp_server *server, struct tcp_zerocopy_closed *closed)
+{
+    /** The last held sends take the place of the freed ones, so removing them does not shift the others. */
+    struct tcp_zerocopy_closed *last = *(struct tcp_zerocopy_closed **)vector_get(&server->zerocopy_closed, server->zerocopy_closed.size - 1);
+    vector_set_index(&server->zerocopy_closed, &last, closed->index);
+    last->index = closed->index;
+    --server->zerocopy_closed.size;
+
+    for (size_t i = 0; i < closed->releases.size; ++i)
+    {
+        struct tcp_zerocopy_release *release = vector_get(&closed->releases, i);
+        if (release->on_sent != NULL) release->on_sent(release->data);
+    };
+
+    close(closed->sockfd);
+    vector_free(&closed->releases);
+    free(closed);
+};
+
+/** Reaps the completions of the zerocopy sends of a closed client, until the kernel has completed all of them. */
+static void _tcp_server_on_zerocopy_closed(struct wheel_timer *timer)
+{
+    struct tcp_zerocopy_closed *closed = timer->data;
+
+    _tcp_server_reap_releases(closed->sockfd, &closed->releases, NULL);
+    if (closed->releases.size > 0) timer_wheel_arm(&closed->server->timers, &closed->timer, TCP_SERVER_ZEROCOPY_CLOSED_INTERVAL);
+    else _tcp_server_free_zerocopy_closed(closed->server, closed);
+};
+
+/** 
+ * Holds the zerocopy sends of a client which is being closed until the kernel completes them, as it still sends their buffers after the socket is closed.
+ * The socket is duplicated so its error queue stays readable, and shut down so the peer still sees the connection close.
+*/
+static void _tcp_server_hold_zerocopy(struct tcp_server *server, struct tcp_client *client)
+{
+    _tcp_server_reap_releases(client->sockfd, &client->zerocopy_releases, &client->zerocopy_completed);
+
+    struct tcp_zerocopy_closed *closed = client->zerocopy_releases.size > 0 ? calloc(1, sizeof(struct tcp_zerocopy_closed)) : NULL;
+    socket_t sockfd = closed != NULL ? dup(client->sockfd) : -1;
+
+    if (sockfd == -1)
+    {
+        /** Without a socket to read the completions from, the buffers can only be released right away. */
+        for (size_t i = 0; i < client->zerocopy_releases.size; ++i)
+        {
+            struct tcp_zerocopy_release *release = vector_get(&client->zerocopy_releases, i);
+            if (release->on_sent != NULL) release->on_sent(release->data);
+        };
+
+        free(closed);
+        vector_free(&client->zerocopy_releases);
+        return;
+    };
+
+    /** epoll watches the socket until every descriptor of it is closed, so the duplicate would keep reporting it. */
+    if (server->pfd != -1) epoll_ctl(server->pfd, EPOLL_CTL_DEL, client->sockfd, NULL);
+    shutdown(sockfd, SHUT_RDWR);
+
+    closed->sockfd = sockfd;
+    closed->releases = client->zerocopy_releases;
+    closed->index = server->zerocopy_closed.size;
+    closed->server = server;
+    closed->timer.on_expire = _tcp_server_on_zerocopy_closed;
+    closed->timer.data = closed;
+    memset(&client->zerocopy_releases, 0, sizeof(client->zerocopy_releases));
+
+    vector_push(&server->zerocopy_closed, &closed);
+    timer_wheel_arm(&server->timers, &closed->timer, TCP_SERVER_ZEROCOPY_CLOSED_INTERVAL);
+};
+
+/** Reaps the error queue of a client socket if it has zerocopy enabled. Returns `0` if the socket has no other error. */
+static int _tcp_server_reap_errors(struct tcp_server *server, socket_t sockfd)
+{
+    struct tcp_client *client = map_get(&server->zerocopy_clients, sockfd);
+    if (client == NULL) return -1;
+
+    _tcp_server_reap_zerocopy(server, client);
+
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &length) == -1 || error != 0) return -1;
+
+    return 0;
+};
+#endif
+
+/** Calls the callback of a range which was sent or dropped. A buffer which the kernel may still reference is released once its zerocopy sends complete. */
+static void _tcp_server_release_range(struct tcp_server *server, struct tcp_client *client, struct tcp_queued_range *range)
+{
+#ifdef TCP_ZEROCOPY_SUPPORTED
+    /** Once the kernel reported copying the first sends of a buffer, the rest of it is copied, so the completion of its last zerocopy send may have been read already. */
+    if (range->zerocopied && (int32_t)(range->sequence - client->zerocopy_completed) >= 0)
+    {
+        struct tcp_zerocopy_release release = { .sequence = range->sequence, .on_sent = range->on_sent, .data = range->data };
+
+        if (client->zerocopy_releases.elements == NULL) vector_init(&client->zerocopy_releases, 4, sizeof(struct tcp_zerocopy_release));
+        vector_push(&client->zerocopy_releases, &release);
+
+        return;
+    };
+#endif
+
+    if (range->on_sent != NULL) range->on_sent(range->data);
+};
+
+/** Removes the first queued range of a client and releases it. */
+static void _tcp_server_shift_range(struct tcp_server *server, struct tcp_client *client)
+{
+    struct tcp_queued_range range = *(struct tcp_queued_range *)vector_get(&client->send_ranges, 0);
+    vector_delete(&client->send_ranges, 0);
+    if (client->send_ranges.size == 0) vector_free(&client->send_ranges);
+
+    _tcp_server_release_range(server, client, &range);
+};
+
+/** Sends part of a queued range with one syscall, advancing it past the bytes which were sent. Returns the number of bytes sent, or `-1`. */
+static ssize_t _tcp_server_send_range(struct tcp_server *server, struct tcp_client *client, struct tcp_queued_range *range)
+{
+    socket_t sockfd = client->sockfd;
+
+    if (range->buffer != NULL)
+    {
+#ifdef TCP_ZEROCOPY_SUPPORTED
+        int flags = client->zerocopy_unavailable ? 0 : MSG_ZEROCOPY;
+        ssize_t result = send(sockfd, range->buffer + range->offset, range->length, flags);
+        if (result > 0 && flags == MSG_ZEROCOPY)
+        {
+            range->zerocopied = true;
+            range->sequence = client->zerocopy_sequence++;
+            _tcp_server_watch_errors(server, client);
+        }
+        /** The kernel refuses to pin more pages than the option memory of the socket allows, in which case the bytes are copied. */
+        else if (result == -1 && errno == ENOBUFS && flags == MSG_ZEROCOPY) result = send(sockfd, range->buffer + range->offset, range->length, 0);
+#else
+        ssize_t result = send(sockfd, range->buffer + range->offset, range->length, 0);
+#endif
+        if (result > 0)
+        {
+            range->offset += result;
+            range->length -= result;
+        };
+
+        return result;
+    };
+
+#ifdef __linux__
+    ssize_t result = sendfile(sockfd, range->fd, &range->offset, range->length);
+    if (result > 0) range->length -= result;
+
+    return result;
+#elif __APPLE__
+    off_t sent = range->length;
+    if (sendfile(range->fd, sockfd, range->offset, &sent, NULL, 0) == -1 && (errno != EAGAIN || sent == 0)) return -1;
+
+    range->offset += sent;
+    range->length -= sent;
+
+    return sent;
+#else
+    /** Without `sendfile`, the file is read into a buffer first. Bytes the socket does not take are read again next time. */
+    char buffer[16384];
+    size_t length = range->length < sizeof(buffer) ? range->length : sizeof(buffer);
+
+    if (lseek(range->fd, range->offset, SEEK_SET) == -1) return -1;
+    ssize_t read_result = read(range->fd, buffer, length);
+    if (read_result <= 0) return read_result;
+
+    ssize_t result = send(sockfd, buffer, read_result, 0);
+    if (result > 0)
+    {
+        range->offset += result;
+        range->length -= result;
+    };
+
+    return result;
+#endif
+};
+
+/** Releases a range which could not be sent. Returns `-1`. */
+static ssize_t _tcp_server_drop_range(struct tcp_server *server, struct tcp_client *client, struct tcp_queued_range *range)
+{
+    _tcp_server_release_range(server, client, range);
+
+    netc_error(BADSEND);
+    return -1;
+};
+
+/** Appends the bytes of several buffers to the send buffer of a client, skipping the first `sent` bytes. Returns `0`, or `-1` if the buffer could not grow. */
+static int _tcp_server_queue_iov(struct tcp_client *client, struct iovec *iov, int iovcnt, size_t sent)
+{
+    for (int i = 0; i < iovcnt; ++i)
+    {
+        if (sent >= iov[i].iov_len)
+        {
+            sent -= iov[i].iov_len;
+            continue;
+        };
+
+        if (socket_buffer_append(&client->send_buffer, (char *)iov[i].iov_base + sent, iov[i].iov_len - sent) != 0) return -1;
+
+        sent = 0;
+    };
+
+    return 0;
+};
+
+/** 
+ * Writes the bytes held back by the cork of a client followed by several buffers in one syscall, and queues whatever the socket does not take.
+ * Returns `0`, or `-1` if the `sendmsg` syscall failed.
+*/
+static int _tcp_server_send_corked(struct tcp_server *server, struct tcp_client *client, struct iovec *iov, int iovcnt)
+{
+    struct socket_buffer *send_buffer = &client->send_buffer;
+    size_t held = client->corked_bytes;
+    client->corked_bytes = 0;
+
+    struct iovec vectors[iovcnt + 1];
+    vectors[0] = (struct iovec){ .iov_base = send_buffer->data + send_buffer->offset, .iov_len = held };
+    if (iovcnt > 0) memcpy(vectors + 1, iov, iovcnt * sizeof(struct iovec));
+
+    size_t length = held;
+    for (int i = 0; i < iovcnt; ++i) length += iov[i].iov_len;
+
+    size_t sent = 0;
+    ssize_t result = socket_sendv(client->sockfd, vectors, iovcnt + 1, 0);
+    if (result == -1)
+    {
+        if (errno != EWOULDBLOCK && errno != EAGAIN)
+        {
+            netc_error(BADSEND);
+            return -1;
+        };
+    }
+    else sent = result;
+
+    size_t held_sent = sent < held ? sent : held;
+    send_buffer->offset += held_sent;
+
+    if (sent == length) return 0;
+
+    if (_tcp_server_queue_iov(client, iov, iovcnt, sent - held_sent) != 0)
+    {
+        netc_error(BADSEND);
+        return -1;
+    };
+
+    if (_tcp_server_add_pending(server, client) != 0) return -1;
+
+    if (socket_buffer_available(send_buffer) > server->send_high_watermark) client->backpressured = true;
+
+    return 0;
+};
+
+/** Writes as many queued bytes, files and buffers of a client as its socket takes. */
+static int _tcp_server_flush(struct tcp_server *server, socket_t sockfd)
+{
+    struct tcp_client *client = map_get(&server->pending_clients, sockfd);
+    if (client == NULL) return 0;
+
+    struct socket_buffer *send_buffer = &client->send_buffer;
+    size_t queued = socket_buffer_available(send_buffer);
+    size_t remaining = queued;
+
+    /** An edge triggered socket is only reported again once it was written until it is full. Otherwise, writing stops once the socket took less than offered. */
+    while (remaining > 0 || client->send_ranges.size > 0)
+    {
+        struct tcp_queued_range *range = client->send_ranges.size > 0 ? vector_get(&client->send_ranges, 0) : NULL;
+        size_t length = range != NULL ? range->bytes_before : remaining;
+        ssize_t result = 0;
+
+        if (length > 0)
+        {
+            result = send(sockfd, send_buffer->data + send_buffer->offset, length, 0);
+            if (result > 0)
+            {
+                send_buffer->offset += result;
+                remaining -= result;
+                if (range != NULL) range->bytes_before -= result;
+            };
+        }
+        else
+        {
+            length = range->length;
+            result = _tcp_server_send_range(server, client, range);
+
+            /** The file is shorter than the length which was promised to the peer. */
+            if (result == 0) return tcp_server_close_client(server, sockfd, true);
+            if (result > 0 && range->length == 0) _tcp_server_shift_range(server, client);
+        };
+
+        if (result == -1)
+        {
+            if (errno != EWOULDBLOCK && errno != EAGAIN) return tcp_server_close_client(server, sockfd, true);
+            break;
+        };
+
+        if (!server->edge_triggered && (size_t)result < length) break;
+    };
+
+#ifdef TCP_URING_SUPPORTED
+    if (server->uring != NULL && _tcp_server_is_queued(client) && _tcp_server_watch_writable(server, client, true) != 0) return -1;
+#endif
+
+    if (!_tcp_server_is_queued(client))
+    {
+        map_delete(&server->pending_clients, sockfd);
+
+        /** A client which is closed once its queue is sent has nothing left to drain for. */
+        if (client->closing) return tcp_server_close_client(server, sockfd, false);
+        if (_tcp_server_watch_writable(server, client, false) != 0) return -1;
+    };
+
+    if (queued > server->send_low_watermark && remaining <= server->send_low_watermark)
+    {
+        client->backpressured = false;
+        if (server->on_drain != NULL) server->on_drain(server, sockfd);
+    };
+
+    return 0;
+};
+
+/** Resets the wakeup of the server and calls `on_wake`, on the thread running the main loop. */
+static void _tcp_server_woken(struct tcp_server *server)
+{
+#ifdef __linux__
+    /** Reading the counter resets it, so the eventfd is not reported again until the next wakeup. */
+    uint64_t count;
+    while (read(server->wake_fd, &count, sizeof(count)) == -1 && errno == EINTR);
+#endif
+
+    if (server->on_wake != NULL) server->on_wake(server);
+};
+
+#ifdef TCP_URING_SUPPORTED
+/** Gets the slot of an open client socket, or `NULL` if the socket was closed since the generation was read. */
+static struct tcp_uring_slot *_tcp_server_uring_open_slot(struct tcp_uring *uring, int sockfd, uint32_t generation)
+{
+    if (sockfd < 0 || (size_t)sockfd >= uring->slots_capacity) return NULL;
+
+    struct tcp_uring_slot *slot = &uring->slots[sockfd];
+    if (slot->client == NULL || (slot->generation & 0xFFFFFF) != (generation & 0xFFFFFF)) return NULL;
+
+    return slot;
+};
+
+/** Adds a client socket to the clients which have completions to dispatch. */
+static void _tcp_server_uring_mark_ready(struct tcp_uring *uring, struct tcp_uring_slot *slot, int sockfd)
+{
+    if (slot->ready) return;
+
+    slot->ready = true;
+    vector_push(&uring->ready, &sockfd);
+};
+
+/** Handles one completion. Received bytes are appended to the receive buffer of the client, and callbacks are deferred to the dispatch. */
+static void _tcp_server_uring_complete(struct tcp_server *server, struct io_uring_cqe *cqe)
+{
+    struct tcp_uring *uring = server->uring;
+    int sockfd = TCP_URING_FD(cqe->user_data);
+    uint32_t generation = TCP_URING_GENERATION(cqe->user_data);
+    bool more = cqe->flags & IORING_CQE_F_MORE;
+
+    switch (TCP_URING_OPERATION(cqe->user_data))
+    {
+        case TCP_URING_OP_ACCEPT:
+        {
+            if (cqe->res >= 0) vector_push(&uring->accepted, &cqe->res);
+            if (!more && server->listening) tcp_uring_prep_accept(uring, server->sockfd);
+
+            break;
+        };
+        case TCP_URING_OP_RECV:
+        {
+            struct tcp_uring_slot *slot = _tcp_server_uring_open_slot(uring, sockfd, generation);
+
+            if (cqe->flags & IORING_CQE_F_BUFFER)
+            {
+                uint16_t buffer_id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                if (slot != NULL && cqe->res > 0)
+                {
+                    if (socket_buffer_append(&slot->client->recv_buffer, tcp_uring_buffer(uring, buffer_id), cqe->res) == 0) slot->readable = true;
+                    else slot->hangup = slot->error = true;
+                };
+
+                tcp_uring_recycle_buffer(uring, buffer_id);
+            };
+
+            if (slot == NULL) break;
+
+            if (cqe->res == 0) slot->hangup = true;
+            /** Running out of provided buffers only stops the receive, which is submitted again. */
+            else if (cqe->res < 0 && cqe->res != -ENOBUFS) slot->hangup = slot->error = true;
+            else if (!more) tcp_uring_prep_recv(uring, sockfd, slot->generation);
+
+            _tcp_server_uring_mark_ready(uring, slot, sockfd);
+            break;
+        };
+        case TCP_URING_OP_POLL_WRITABLE:
+        {
+            struct tcp_uring_slot *slot = _tcp_server_uring_open_slot(uring, sockfd, generation);
+            if (slot == NULL) break;
+
+            slot->writable_armed = false;
+            slot->writable = true;
+            _tcp_server_uring_mark_ready(uring, slot, sockfd);
+
+            break;
+        };
+        case TCP_URING_OP_POLL_ERROR:
+        {
+            struct tcp_uring_slot *slot = _tcp_server_uring_open_slot(uring, sockfd, generation);
+            if (slot == NULL) break;
+
+            slot->error_armed = false;
+            slot->error_queued = true;
+            _tcp_server_uring_mark_ready(uring, slot, sockfd);
+
+            break;
+        };
+        case TCP_URING_OP_POLL_WAKE:
+        {
+            uring->woken = true;
+            break;
+        };
+    };
+};
+
+/** Calls the callbacks of every client socket which had completions. */
+static void _tcp_server_uring_dispatch(struct tcp_server *server)
+{
+    struct tcp_uring *uring = server->uring;
+
+    /** A wakeup is handled first, as it may stop the server before any client is. The poll is oneshot, so it is armed again. */
+    if (uring->woken)
+    {
+        uring->woken = false;
+        _tcp_server_woken(server);
+        if (server->listening) tcp_uring_prep_poll_wake(uring, server->wake_fd);
+    };
+
+    for (size_t i = 0; i < uring->ready.size && server->listening; ++i)
+    {
+        int sockfd = *(int *)vector_get(&uring->ready, i);
+        struct tcp_uring_slot *slot = &uring->slots[sockfd];
+        if (!slot->ready) continue;
+
+        uint32_t generation = slot->generation;
+        bool readable = slot->readable, writable = slot->writable, hangup = slot->hangup, error = slot->error, error_queued = slot->error_queued;
+        slot->ready = slot->readable = slot->writable = slot->hangup = slot->error = slot->error_queued = false;
+
+        /** Bytes received before a hangup are still handled. Callbacks may close the client, or the server. */
+        if (readable && server->on_data != NULL) server->on_data(server, sockfd);
+        if (server->listening == 0 || _tcp_server_uring_open_slot(uring, sockfd, generation) == NULL) continue;
+
+#ifdef TCP_ZEROCOPY_SUPPORTED
+        if (error_queued && _tcp_server_reap_errors(server, sockfd) != 0) hangup = error = true;
+#endif
+
+        if (hangup)
+        {
+            tcp_server_close_client(server, sockfd, error);
+            continue;
+        };
+
+        if (writable) _tcp_server_flush(server, sockfd);
+    };
+
+    uring->ready.size = 0;
+
+    /** `on_connect` is called until it stops accepting, as one wakeup may have accepted several connections. */
+    while (uring->accepted.size > 0 && server->listening && server->on_connect != NULL)
+    {
+        size_t accepted = uring->accepted.size;
+        server->on_connect(server);
+
+        if (server->listening == 0 || uring->accepted.size == accepted) break;
+    };
+};
+
+/** The main loop of a TCP server running on io_uring. */
+static int _tcp_server_uring_main_loop(struct tcp_server *server)
+{
+    struct tcp_uring *uring = server->uring;
+    int result = 0;
+
+    if (tcp_uring_enable(uring) != 0) return netc_error(EVCREATE);
+    if (tcp_uring_prep_accept(uring, server->sockfd) != 0) return netc_error(POLL_FD);
+    if (tcp_uring_prep_poll_wake(uring, server->wake_fd) != 0) return netc_error(POLL_FD);
+
+    while (server->listening)
+    {
+        if (tcp_uring_wait(uring, timer_wheel_next_timeout(&server->timers)) == -1)
+        {
+            result = netc_error(POLL_FD);
+            break;
+        };
+
+        if (server->listening == 0) break;
+
+        /** Every completion is handled before any callback, so bytes are appended to the receive buffers in the order they were received. */
+        unsigned head = *uring->cq_head;
+        unsigned tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) _tcp_server_uring_complete(server, &uring->cqes[head & uring->cq_mask]);
+        __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+
+        _tcp_server_uring_dispatch(server);
+        if (server->listening) timer_wheel_advance(&server->timers);
+    };
+
+    /** The loop owns the ring, as a callback may close the server while the loop still uses it. */
+    for (size_t i = 0; i < uring->accepted.size; ++i) close(*(int *)vector_get(&uring->accepted, i));
+    tcp_uring_free(uring);
+    free(uring);
+    server->uring = NULL;
+
+    return result;
+};
 #endif
 
-int tcp_server_main_loop(struct tcp_server *server)
+/** Polls the sockets and handles their events until the server stops listening. */
+static int _tcp_server_poll_main_loop(struct tcp_server *server)
 {
-    /** The server socket should be nonblocking when listening for events. */
-    socket_set_non_blocking(server->sockfd);
-    server->listening = 1;
-
     while (server->listening)
     {
+        /** The poll wakes up for the next timer, or waits indefinitely if none is armed. */
+        int timeout = timer_wheel_next_timeout(&server->timers);
+
 #ifdef __linux__
         int pfd = server->pfd;
-        struct epoll_event events[server->client_count + 1];
-        int nev = epoll_wait(pfd, events, server->client_count + 1, -1);
+        struct epoll_event *events = server->poll_events;
+        int nev = epoll_wait(pfd, events, server->poll_events_capacity, timeout);
         if (nev == -1) return netc_error(POLL_FD);
 #elif _WIN32
         WSAPOLLFD events[server->client_count + 1];
         events[0].fd = server->sockfd;
         events[0].events = POLLIN | POLLERR | POLLHUP;
-        int nev = WSAPoll(events, sizeof(events), -1);
+        int nev = WSAPoll(events, sizeof(events), timeout);
         if (nev == -1) return netc_error(POLL_FD);
 #elif __APPLE__
         int pfd = server->pfd;
-        struct kevent events[server->client_count + 1];
-        int nev = kevent(pfd, NULL, 0, events, server->client_count + 1, NULL);
+        struct kevent *events = server->poll_events;
+        struct timespec wait = { .tv_sec = timeout / 1000, .tv_nsec = (timeout % 1000) * 1000000 };
+        int nev = kevent(pfd, NULL, 0, events, server->poll_events_capacity, timeout < 0 ? NULL : &wait);
         if (nev == -1) return netc_error(POLL_FD);
 #endif
 
@@ -51,11 +736,18 @@ int tcp_server_main_loop(struct tcp_server *server)
 
         for (int i = 0; i < nev; ++i)
         {
+            /** The clients are gone once the server closes itself from a callback. */
+            if (server->listening == 0) break;
+
 #ifdef __linux__
             struct epoll_event ev = events[i];
             socket_t sockfd = ev.data.fd;
 
-            if (sockfd == server->sockfd)
+            if (sockfd == server->wake_fd)
+            {
+                _tcp_server_woken(server);
+            }
+            else if (sockfd == server->sockfd)
             {
                 if (ev.events & EPOLLERR || ev.events & EPOLLHUP || ev.events & EPOLLRDHUP) // server socket closed
                     return netc_error(HANGUP);
@@ -64,14 +756,20 @@ int tcp_server_main_loop(struct tcp_server *server)
             }
             else
             {
+#ifdef TCP_ZEROCOPY_SUPPORTED
+                /** Completed zerocopy sends are reported as errors, which do not close the socket. */
+                if (ev.events & EPOLLERR && _tcp_server_reap_errors(server, sockfd) == 0) ev.events &= ~EPOLLERR;
+#endif
+
                 if (ev.events & EPOLLERR || ev.events & EPOLLHUP || ev.events & EPOLLRDHUP) // client socket closed
                 {
                     if (tcp_server_close_client(server, sockfd, ev.events & EPOLLERR) != 0)
                         return netc_error(CLOSE);
                 }
-                else if (ev.events & EPOLLIN && server->on_data != NULL) 
+                else
                 {
-                    server->on_data(server, sockfd);
+                    if (ev.events & EPOLLIN && server->on_data != NULL) server->on_data(server, sockfd);
+                    if (ev.events & EPOLLOUT) _tcp_server_flush(server, sockfd);
                 }
             }
 #elif _WIN32
@@ -83,16 +781,25 @@ int tcp_server_main_loop(struct tcp_server *server)
                 if (i == 0) return netc_error(HANGUP);
                 else if (tcp_server_close_client(server, sockfd, 1) != 0) return netc_error(CLOSE);
             }
-            else if (event.revents & POLLIN)
+            else
             {
-                if (i == 0 && server->on_connect != NULL) server->on_connect(server);
-                else if (server->on_data != NULL) server->on_data(server, sockfd);
+                if (event.revents & POLLIN)
+                {
+                    if (i == 0 && server->on_connect != NULL) server->on_connect(server);
+                    else if (server->on_data != NULL) server->on_data(server, sockfd);
+                };
+
+                if (event.revents & POLLOUT) _tcp_server_flush(server, sockfd);
             };
 #elif __APPLE__
             struct kevent ev = events[i];
             socket_t sockfd = ev.ident;
 
-            if (sockfd == server->sockfd)
+            if (ev.filter == EVFILT_USER)
+            {
+                _tcp_server_woken(server);
+            }
+            else if (sockfd == server->sockfd)
             {
                 if (ev.flags & EV_EOF || ev.flags & EV_ERROR) // server socket closed
                     return netc_error(HANGUP); 
@@ -106,6 +813,10 @@ int tcp_server_main_loop(struct tcp_server *server)
                     if (tcp_server_close_client(server, sockfd, ev.flags & EV_ERROR) != 0)
                         return netc_error(CLOSE);
                 }
+                else if (ev.filter == EVFILT_WRITE)
+                {
+                    _tcp_server_flush(server, sockfd);
+                }
                 else if (ev.flags & EVFILT_READ && server->on_data != NULL)
                 {
                      server->on_data(server, sockfd);
@@ -113,12 +824,54 @@ int tcp_server_main_loop(struct tcp_server *server)
             }
 #endif
         }
+
+        /** Timers expire after the events, so a client is not closed right before the bytes it sent in time are handled. */
+        if (server->listening) timer_wheel_advance(&server->timers);
     }
 
     return 0;
 };
 
+int tcp_server_main_loop(struct tcp_server *server)
+{
+    /** The server socket should be nonblocking when listening for events. */
+    socket_set_non_blocking(server->sockfd);
+    server->listening = 1;
+
+#ifdef TCP_URING_SUPPORTED
+    if (server->uring != NULL) return _tcp_server_uring_main_loop(server);
+#endif
+
+#ifndef _WIN32
+    if (server->max_events == 0) server->max_events = 1;
+    if (server->max_events != server->poll_events_capacity)
+    {
+        void *poll_events = realloc(server->poll_events, server->max_events * POLL_EVENT_SIZE);
+        if (poll_events == NULL) return -1;
+
+        server->poll_events = poll_events;
+        server->poll_events_capacity = server->max_events;
+    };
+#endif
+
+    int result = _tcp_server_poll_main_loop(server);
+
+#ifndef _WIN32
+    /** The events are freed by the loop rather than by `tcp_server_close_self`, which may be called from another thread while the loop waits to fill them. */
+    free(server->poll_events);
+    server->poll_events = NULL;
+    server->poll_events_capacity = 0;
+#endif
+
+    return result;
+};
+
 int tcp_server_init(struct tcp_server *server, struct sockaddr *address, bool non_blocking)
+{
+    return tcp_server_init_backend(server, address, non_blocking, TCP_SERVER_BACKEND_POLL);
+};
+
+int tcp_server_init_backend(struct tcp_server *server, struct sockaddr *address, bool non_blocking, enum tcp_server_backend backend)
 {
     if (server == NULL) return -1;
 
@@ -132,11 +885,56 @@ int tcp_server_init(struct tcp_server *server, struct sockaddr *address, bool no
     server->client_count = 0;
     server->listening = 0;
 
+    map_init(&server->clients, 8);
+    map_init(&server->pending_clients, 8);
+    server->send_high_watermark = 1048576;
+    server->send_low_watermark = 0;
+    server->max_events = 1024;
+    timer_wheel_init(&server->timers, 0);
+    server->edge_triggered = false;
+    server->accept_budget = 64;
+    server->zerocopy_threshold = 0;
+    map_init(&server->zerocopy_clients, 8);
+    vector_init(&server->zerocopy_closed, 8, sizeof(struct tcp_zerocopy_closed *));
+    server->backend = TCP_SERVER_BACKEND_POLL;
+    server->uring = NULL;
+
+#ifndef _WIN32
+    server->pfd = -1;
+    server->wake_fd = -1;
+    server->poll_events = NULL;
+    server->poll_events_capacity = 0;
+#endif
+
     if (server->non_blocking == 0) return 0;
     if (socket_set_non_blocking(server->sockfd) != 0) return netc_error(FD_CTL);
 
     if (signal(SIGPIPE, SIG_IGN) == SIG_ERR) return netc_error(SIGPIPE);
 
+#ifdef __linux__
+    /** Both backends poll the eventfd, so another thread can wake the loop with `tcp_server_wake`. */
+    server->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (server->wake_fd == -1) return netc_error(EVCREATE);
+#endif
+
+#ifdef TCP_URING_SUPPORTED
+    if (backend == TCP_SERVER_BACKEND_IO_URING)
+    {
+        struct tcp_uring *uring = malloc(sizeof(struct tcp_uring));
+        if (uring != NULL && tcp_uring_init(uring) == 0)
+        {
+            server->backend = TCP_SERVER_BACKEND_IO_URING;
+            server->uring = uring;
+            server->pfd = -1;
+
+            return 0;
+        };
+
+        /** The kernel lacks io_uring, or one of the features used, so the server falls back to epoll. */
+        free(uring);
+    };
+#endif
+
     /** Register event for the server socket. */
 #ifdef __linux__
     server->pfd = epoll_create1(0);
@@ -146,6 +944,10 @@ int tcp_server_init(struct tcp_server *server, struct sockaddr *address, bool no
     ev.events = EPOLLIN | EPOLLRDHUP;
     ev.data.fd = server->sockfd;
     if (epoll_ctl(server->pfd, EPOLL_CTL_ADD, server->sockfd, &ev) == -1) return netc_error(POLL_FD);
+
+    ev.events = EPOLLIN;
+    ev.data.fd = server->wake_fd;
+    if (epoll_ctl(server->pfd, EPOLL_CTL_ADD, server->wake_fd, &ev) == -1) return netc_error(POLL_FD);
 #elif _WIN32
     vector_init(&server->events, 8, sizeof(WSAPOLLFD));
     WSAPOLLFD event = { .fd = server->sockfd, .events = POLLIN | POLLERR | POLLHUP };
@@ -157,6 +959,10 @@ int tcp_server_init(struct tcp_server *server, struct sockaddr *address, bool no
     struct kevent ev;
     EV_SET(&ev, server->sockfd, EVFILT_READ, EV_ADD, 0, 0, NULL);
     if (kevent(server->pfd, &ev, 1, NULL, 0, NULL) == -1) return netc_error(POLL_FD);
+
+    /** The user event is reset once it is reported, so `tcp_server_wake` can trigger it again. */
+    EV_SET(&ev, server->sockfd, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, NULL);
+    if (kevent(server->pfd, &ev, 1, NULL, 0, NULL) == -1) return netc_error(POLL_FD);
 #endif 
 
     return 0;
@@ -184,33 +990,159 @@ int tcp_server_listen(struct tcp_server *server, int backlog)
     return 0;
 };
 
+/** Undoes the accept of a client which could not be polled, so its socket is not leaked and the server does not count it. Keeps `errno`. */
+static void _tcp_server_discard_accepted(struct tcp_server *server, struct tcp_client *client)
+{
+    int error = errno;
+
+    map_delete(&server->clients, client->sockfd);
+#ifdef _WIN32
+    closesocket(client->sockfd);
+#else
+    close(client->sockfd);
+#endif
+    --server->client_count;
+
+    errno = error;
+};
+
 int tcp_server_accept(struct tcp_server *server, struct tcp_client *client)
 {
     socket_t sockfd = server->sockfd;
-    client->sockaddr = malloc(sizeof(struct sockaddr));
-    socklen_t addrlen = sizeof(struct sockaddr);
+    client->sockaddr = (struct sockaddr *)&client->peer_address;
+    socklen_t addrlen = sizeof(client->peer_address);
+
+#ifdef TCP_URING_SUPPORTED
+    /** The kernel has already accepted the connection, so it is taken from the accepted sockets. */
+    if (server->uring != NULL)
+    {
+        struct tcp_uring *uring = server->uring;
+        if (uring->accepted.size == 0)
+        {
+            errno = EWOULDBLOCK;
+            return netc_error(ACCEPT);
+        };
+
+        int result = *(int *)vector_get(&uring->accepted, 0);
+        vector_delete(&uring->accepted, 0);
+
+        /** A socket without a slot would never be received from, so it is closed instead of becoming a client. */
+        struct tcp_uring_slot *slot = tcp_uring_slot(uring, result);
+        if (slot == NULL)
+        {
+            int error = errno;
+            close(result);
+            errno = error;
+
+            return netc_error(ACCEPT);
+        };
+
+        if (map_set(&server->clients, result, client) != 0)
+        {
+            close(result);
+            errno = ENOMEM;
+
+            return netc_error(ACCEPT);
+        };
+
+        if (tcp_uring_prep_recv(uring, result, slot->generation) != 0)
+        {
+            int error = errno;
+            map_delete(&server->clients, result);
+            close(result);
+            errno = error;
+
+            return netc_error(POLL_FD);
+        };
+
+        /** A multishot accept shares one address buffer between every connection, so the address is queried instead. */
+        if (getpeername(result, client->sockaddr, &addrlen) == -1) memset(&client->peer_address, 0, sizeof(client->peer_address));
+
+        client->sockfd = result;
+        client->server = server;
+        client->backpressured = false;
+        socket_buffer_init(&client->recv_buffer);
+        socket_buffer_init(&client->send_buffer);
+        memset(&client->send_ranges, 0, sizeof(client->send_ranges));
+        client->zerocopy_enabled = client->zerocopy_unavailable = false;
+        client->zerocopy_sequence = client->zerocopy_completed = 0;
+        client->corked = false;
+        client->corked_bytes = 0;
+        client->closing = false;
+        memset(&client->zerocopy_releases, 0, sizeof(client->zerocopy_releases));
+        client->recv_buffer.filled_externally = true;
+        slot->client = client;
+        ++server->client_count;
+
+        return 0;
+    };
+#endif
 
+#ifdef __linux__
+    /** The socket is made nonblocking by the same syscall, instead of two more `fcntl` calls. */
+    int result = accept4(sockfd, client->sockaddr, &addrlen, SOCK_CLOEXEC | (server->non_blocking ? SOCK_NONBLOCK : 0));
+#else
     int result = accept(sockfd, client->sockaddr, &addrlen);
+#endif
     if (result == -1) return netc_error(ACCEPT);
 
+    /** A client the server cannot find again would never have its buffers freed, so it is not accepted. */
+    if (map_set(&server->clients, result, client) != 0)
+    {
+        close(result);
+        errno = ENOMEM;
+
+        return netc_error(ACCEPT);
+    };
+
     client->sockfd = result;
+    client->server = server;
+    client->backpressured = false;
+    socket_buffer_init(&client->recv_buffer);
+    socket_buffer_init(&client->send_buffer);
+    memset(&client->send_ranges, 0, sizeof(client->send_ranges));
+    client->zerocopy_enabled = client->zerocopy_unavailable = false;
+    client->zerocopy_sequence = client->zerocopy_completed = 0;
+    client->corked = false;
+    client->corked_bytes = 0;
+    client->closing = false;
+    memset(&client->zerocopy_releases, 0, sizeof(client->zerocopy_releases));
     ++server->client_count;
 
     if (server->non_blocking == 0) return 0;
-    if (socket_set_non_blocking(client->sockfd) != 0) return netc_error(FD_CTL);
 
 #ifdef __linux__
     struct epoll_event ev;
-    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.events = EPOLLIN | EPOLLRDHUP | (server->edge_triggered ? EPOLLET : 0);
     ev.data.fd = client->sockfd;
-    if (epoll_ctl(server->pfd, EPOLL_CTL_ADD, client->sockfd, &ev) == -1) return netc_error(POLL_FD);
+    if (epoll_ctl(server->pfd, EPOLL_CTL_ADD, client->sockfd, &ev) == -1)
+    {
+        _tcp_server_discard_accepted(server, client);
+        return netc_error(POLL_FD);
+    };
 #elif _WIN32
+    if (socket_set_non_blocking(client->sockfd) != 0)
+    {
+        _tcp_server_discard_accepted(server, client);
+        return netc_error(FD_CTL);
+    };
+
     WSAPOLLFD event = { .fd = server->sockfd, .events = POLLIN | POLLERR | POLLHUP };
     vector_push(&server->events, &event);
 #elif __APPLE__
+    if (socket_set_non_blocking(client->sockfd) != 0)
+    {
+        _tcp_server_discard_accepted(server, client);
+        return netc_error(FD_CTL);
+    };
+
     struct kevent ev;
-    EV_SET(&ev, client->sockfd, EVFILT_READ, EV_ADD, 0, 0, NULL);
-    if (kevent(server->pfd, &ev, 1, NULL, 0, NULL) == -1) return netc_error(POLL_FD);
+    EV_SET(&ev, client->sockfd, EVFILT_READ, EV_ADD | (server->edge_triggered ? EV_CLEAR : 0), 0, 0, NULL);
+    if (kevent(server->pfd, &ev, 1, NULL, 0, NULL) == -1)
+    {
+        _tcp_server_discard_accepted(server, client);
+        return netc_error(POLL_FD);
+    };
 #endif
 
     return 0;
@@ -224,6 +1156,234 @@ int tcp_server_send(socket_t sockfd, const char *message, size_t msglen, int fla
     return result;
 };
 
+ssize_t tcp_server_sendv(socket_t sockfd, struct iovec *iov, int iovcnt, int flags)
+{
+    ssize_t result = socket_sendv(sockfd, iov, iovcnt, flags);
+    if (result == -1) netc_error(BADSEND);
+
+    return result;
+};
+
+ssize_t tcp_server_send_queued(struct tcp_server *server, struct tcp_client *client, struct iovec *iov, int iovcnt)
+{
+    size_t length = 0;
+    for (int i = 0; i < iovcnt; ++i) length += iov[i].iov_len;
+
+    struct socket_buffer *send_buffer = &client->send_buffer;
+
+    /** Bytes behind other queued bytes are written once the socket is writable anyway, so only a client with nothing queued holds them back. */
+    if (client->corked_bytes > 0 || (client->corked && !_tcp_server_is_queued(client)))
+    {
+        if (client->corked_bytes + length > TCP_SERVER_CORK_LIMIT) return _tcp_server_send_corked(server, client, iov, iovcnt) == 0 ? (ssize_t)length : -1;
+
+        if (_tcp_server_queue_iov(client, iov, iovcnt, 0) != 0)
+        {
+            netc_error(BADSEND);
+            return -1;
+        };
+
+        client->corked_bytes += length;
+        return length;
+    };
+
+    bool was_queued = _tcp_server_is_queued(client);
+    size_t sent = 0;
+
+    /** Bytes can only be sent right away if nothing is queued in front of them. */
+    if (!was_queued)
+    {
+        ssize_t result = socket_sendv(client->sockfd, iov, iovcnt, 0);
+        if (result == -1)
+        {
+            if (errno != EWOULDBLOCK && errno != EAGAIN)
+            {
+                netc_error(BADSEND);
+                return -1;
+            };
+        }
+        else sent = result;
+    };
+
+    if (sent == length) return length;
+
+    if (_tcp_server_queue_iov(client, iov, iovcnt, sent) != 0)
+    {
+        netc_error(BADSEND);
+        return -1;
+    };
+
+    if (!was_queued && _tcp_server_add_pending(server, client) != 0) return -1;
+
+    if (socket_buffer_available(send_buffer) > server->send_high_watermark) client->backpressured = true;
+
+    return length;
+};
+
+ssize_t tcp_server_sendfile_queued(struct tcp_server *server, struct tcp_client *client, struct iovec *head, int head_count, int fd, off_t offset, size_t length, void (*on_sent)(void *data), void *data)
+{
+    size_t head_length = 0;
+    for (int i = 0; i < head_count; ++i) head_length += head[i].iov_len;
+
+    struct tcp_queued_range file = { .bytes_before = 0, .fd = fd, .buffer = NULL, .offset = offset, .length = length, .zerocopied = false, .on_sent = on_sent, .data = data };
+    struct socket_buffer *send_buffer = &client->send_buffer;
+
+    /** The file follows the bytes held back by the cork, which are written first. */
+    if (client->corked_bytes > 0 && _tcp_server_send_corked(server, client, NULL, 0) != 0) return _tcp_server_drop_range(server, client, &file);
+
+    bool was_queued = _tcp_server_is_queued(client);
+    size_t sent = 0;
+
+    /** Bytes can only be sent right away if nothing is queued in front of them. */
+    if (!was_queued)
+    {
+        ssize_t result = 0;
+#ifdef MSG_MORE
+        /** The head is held back until the file follows it, so a small response leaves in one packet. */
+        if (head_length > 0) result = socket_sendv(client->sockfd, head, head_count, length > 0 ? MSG_MORE : 0);
+#else
+        if (head_length > 0) result = socket_sendv(client->sockfd, head, head_count, 0);
+#endif
+        if (result == -1 && errno != EWOULDBLOCK && errno != EAGAIN) return _tcp_server_drop_range(server, client, &file);
+        if (result > 0) sent = result;
+
+        while (sent == head_length && file.length > 0)
+        {
+            size_t offered = file.length;
+            result = _tcp_server_send_range(server, client, &file);
+
+            if (result == -1 && (errno == EWOULDBLOCK || errno == EAGAIN)) break;
+            if (result <= 0) return _tcp_server_drop_range(server, client, &file);
+            if ((size_t)result < offered) break;
+        };
+
+        if (sent == head_length && file.length == 0)
+        {
+            if (on_sent != NULL) on_sent(data);
+            return head_length + length;
+        };
+    };
+
+    if (_tcp_server_queue_iov(client, head, head_count, sent) != 0) return _tcp_server_drop_range(server, client, &file);
+
+    if (file.length > 0)
+    {
+        /** The file is sent after the bytes which are queued but not in front of another queued file. */
+        file.bytes_before = socket_buffer_available(send_buffer);
+        for (size_t i = 0; i < client->send_ranges.size; ++i)
+            file.bytes_before -= ((struct tcp_queued_range *)vector_get(&client->send_ranges, i))->bytes_before;
+
+        if (client->send_ranges.elements == NULL) vector_init(&client->send_ranges, 4, sizeof(struct tcp_queued_range));
+        vector_push(&client->send_ranges, &file);
+    }
+    else if (on_sent != NULL) on_sent(data);
+
+    if (!was_queued && _tcp_server_add_pending(server, client) != 0) return -1;
+
+    if (socket_buffer_available(send_buffer) > server->send_high_watermark) client->backpressured = true;
+
+    return head_length + length;
+};
+
+ssize_t tcp_server_send_zerocopy(struct tcp_server *server, struct tcp_client *client, struct iovec *head, int head_count, const char *buffer, size_t length, void (*on_sent)(void *data), void *data)
+{
+#ifdef TCP_ZEROCOPY_SUPPORTED
+    /** Pinning pages and reaping their completions costs more than copying small buffers. */
+    if (server->zerocopy_threshold == 0 || length < server->zerocopy_threshold || !_tcp_server_enable_zerocopy(server, client))
+#endif
+    {
+        struct iovec iov[head_count + 1];
+        memcpy(iov, head, head_count * sizeof(struct iovec));
+        iov[head_count] = (struct iovec){ .iov_base = (void *)buffer, .iov_len = length };
+
+        ssize_t result = tcp_server_send_queued(server, client, iov, head_count + 1);
+        if (on_sent != NULL) on_sent(data);
+
+        return result;
+    };
+
+#ifdef TCP_ZEROCOPY_SUPPORTED
+    size_t head_length = 0;
+    for (int i = 0; i < head_count; ++i) head_length += head[i].iov_len;
+
+    struct tcp_queued_range range = { .bytes_before = 0, .fd = -1, .buffer = buffer, .offset = 0, .length = length, .zerocopied = false, .on_sent = on_sent, .data = data };
+    struct socket_buffer *send_buffer = &client->send_buffer;
+
+    /** The buffer follows the bytes held back by the cork, which are written first. */
+    if (client->corked_bytes > 0 && _tcp_server_send_corked(server, client, NULL, 0) != 0) return _tcp_server_drop_range(server, client, &range);
+
+    bool was_queued = _tcp_server_is_queued(client);
+    size_t sent = 0;
+
+    /** Bytes can only be sent right away if nothing is queued in front of them. */
+    if (!was_queued)
+    {
+        /** The head is small and may not outlive this call, so it is copied, and held back until the buffer follows it. */
+        ssize_t result = head_length > 0 ? socket_sendv(client->sockfd, head, head_count, MSG_MORE) : 0;
+        if (result == -1 && errno != EWOULDBLOCK && errno != EAGAIN) return _tcp_server_drop_range(server, client, &range);
+        if (result > 0) sent = result;
+
+        while (sent == head_length && range.length > 0)
+        {
+            size_t offered = range.length;
+            result = _tcp_server_send_range(server, client, &range);
+
+            if (result == -1 && (errno == EWOULDBLOCK || errno == EAGAIN)) break;
+            if (result <= 0) return _tcp_server_drop_range(server, client, &range);
+            if ((size_t)result < offered) break;
+        };
+
+        if (sent == head_length && range.length == 0)
+        {
+            _tcp_server_release_range(server, client, &range);
+            return head_length + length;
+        };
+    };
+
+    if (_tcp_server_queue_iov(client, head, head_count, sent) != 0) return _tcp_server_drop_range(server, client, &range);
+
+    /** The buffer is sent after the bytes which are queued but not in front of another queued range. */
+    range.bytes_before = socket_buffer_available(send_buffer);
+    for (size_t i = 0; i < client->send_ranges.size; ++i)
+        range.bytes_before -= ((struct tcp_queued_range *)vector_get(&client->send_ranges, i))->bytes_before;
+
+    if (client->send_ranges.elements == NULL) vector_init(&client->send_ranges, 4, sizeof(struct tcp_queued_range));
+    vector_push(&client->send_ranges, &range);
+
+    if (!was_queued && _tcp_server_add_pending(server, client) != 0) return -1;
+
+    if (socket_buffer_available(send_buffer) > server->send_high_watermark) client->backpressured = true;
+
+    return head_length + length;
+#endif
+};
+
+void tcp_server_cork(struct tcp_server *server, struct tcp_client *client)
+{
+    client->corked = true;
+};
+
+int tcp_server_uncork(struct tcp_server *server, struct tcp_client *client)
+{
+    client->corked = false;
+    if (client->corked_bytes == 0) return 0;
+
+    return _tcp_server_send_corked(server, client, NULL, 0);
+};
+
+int tcp_server_close_client_flushed(struct tcp_server *server, struct tcp_client *client)
+{
+    if (tcp_server_uncork(server, client) != 0) return tcp_server_close_client(server, client->sockfd, true);
+    if (!_tcp_server_is_queued(client)) return tcp_server_close_client(server, client->sockfd, false);
+
+    client->closing = true;
+    return 0;
+};
+
+bool tcp_server_is_backpressured(struct tcp_server *server, struct tcp_client *client)
+{
+    return client->backpressured;
+};
+
 int tcp_server_receive(socket_t sockfd, const char *message, size_t msglen, int flags)
 {
     int result = recv(sockfd, message, msglen, flags);
@@ -232,6 +1392,24 @@ int tcp_server_receive(socket_t sockfd, const char *message, size_t msglen, int
     return result;
 };
 
+int tcp_server_wake(struct tcp_server *server)
+{
+#ifdef __linux__
+    /** A full counter already has a wakeup pending. */
+    uint64_t count = 1;
+    if (write(server->wake_fd, &count, sizeof(count)) == -1 && errno != EAGAIN) return netc_error(BADSEND);
+#elif __APPLE__
+    struct kevent ev;
+    EV_SET(&ev, server->sockfd, EVFILT_USER, 0, NOTE_TRIGGER, 0, NULL);
+    if (kevent(server->pfd, &ev, 1, NULL, 0, NULL) == -1) return netc_error(POLL_FD);
+#else
+    /** The poll of this system cannot be woken, so the loop only notices once a socket has an event. */
+    return -1;
+#endif
+
+    return 0;
+};
+
 int tcp_server_close_self(struct tcp_server *server)
 {
     server->listening = 0;
@@ -244,6 +1422,32 @@ int tcp_server_close_self(struct tcp_server *server)
 #endif
     if (result == -1) return netc_error(CLOSE);
 
+#ifdef TCP_URING_SUPPORTED
+    /** The main loop frees the ring it runs on, so only a ring which was never enabled is freed here. */
+    if (server->uring != NULL && !server->uring->enabled)
+    {
+        tcp_uring_free(server->uring);
+        free(server->uring);
+        server->uring = NULL;
+    };
+#endif
+
+#ifndef _WIN32
+    if (server->wake_fd != -1) close(server->wake_fd);
+    if (server->pfd != -1) close(server->pfd);
+    server->wake_fd = server->pfd = -1;
+#endif
+
+    map_free(&server->clients, false);
+    map_free(&server->pending_clients, false);
+    map_free(&server->zerocopy_clients, false);
+#ifdef TCP_ZEROCOPY_SUPPORTED
+    /** The completions can no longer be reaped without the main loop, so the buffers of closed clients are released right away. */
+    while (server->zerocopy_closed.size > 0) _tcp_server_free_zerocopy_closed(server, *(struct tcp_zerocopy_closed **)vector_get(&server->zerocopy_closed, 0));
+#endif
+    vector_free(&server->zerocopy_closed);
+    timer_wheel_clear(&server->timers);
+
     if (server->on_disconnect != NULL) 
         server->on_disconnect(server, sockfd, 0);
         
@@ -252,6 +1456,25 @@ int tcp_server_close_self(struct tcp_server *server)
 
 int tcp_server_close_client(struct tcp_server *server, socket_t sockfd, bool is_error)
 {
+    /** Bytes and files which are still queued can no longer be sent. */
+    struct tcp_client *pending_client = map_get(&server->pending_clients, sockfd);
+    if (pending_client != NULL)
+    {
+        map_delete(&server->pending_clients, sockfd);
+
+        while (pending_client->send_ranges.size > 0) _tcp_server_shift_range(server, pending_client);
+    };
+
+#ifdef TCP_ZEROCOPY_SUPPORTED
+    /** Buffers which were sent without being copied are held until the kernel completes them, so this happens before the socket is closed. */
+    struct tcp_client *zerocopy_client = map_get(&server->zerocopy_clients, sockfd);
+    if (zerocopy_client != NULL)
+    {
+        map_delete(&server->zerocopy_clients, sockfd);
+        _tcp_server_hold_zerocopy(server, zerocopy_client);
+    };
+#endif
+
 #ifdef _WIN32
     int result = closesocket(sockfd);
     for (size_t i = 0; i < server->events.size; ++i)
@@ -267,6 +1490,33 @@ int tcp_server_close_client(struct tcp_server *server, socket_t sockfd, bool is_
     int result = close(sockfd);
 #endif
 
+#ifdef TCP_URING_SUPPORTED
+    /** The submissions of the socket hold it open until they are cancelled. Their completions are told apart by the generation. */
+    struct tcp_uring_slot *slot = server->uring != NULL && sockfd >= 0 && (size_t)sockfd < server->uring->slots_capacity ? &server->uring->slots[sockfd] : NULL;
+    if (slot != NULL && slot->client != NULL)
+    {
+        tcp_uring_prep_cancel(server->uring, TCP_URING_USER_DATA(TCP_URING_OP_RECV, sockfd, slot->generation));
+        if (slot->writable_armed) tcp_uring_prep_cancel(server->uring, TCP_URING_USER_DATA(TCP_URING_OP_POLL_WRITABLE, sockfd, slot->generation));
+        if (slot->error_armed) tcp_uring_prep_cancel(server->uring, TCP_URING_USER_DATA(TCP_URING_OP_POLL_ERROR, sockfd, slot->generation));
+
+        uint32_t generation = slot->generation + 1;
+        memset(slot, 0, sizeof(struct tcp_uring_slot));
+        slot->generation = generation;
+    };
+#endif
+
+    /** The buffers are freed before `on_disconnect`, which may release the memory of the client. */
+    struct tcp_client *client = map_get(&server->clients, sockfd);
+    if (client != NULL)
+    {
+        map_delete(&server->clients, sockfd);
+
+        socket_buffer_free(&client->recv_buffer);
+        socket_buffer_free(&client->send_buffer);
+        vector_free(&client->send_ranges);
+        client->corked_bytes = 0;
+    };
+
     if (result == -1) return netc_error(CLOSE);
     if (server->on_disconnect != NULL) server->on_disconnect(server, sockfd, is_error);
 
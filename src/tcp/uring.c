@@ -0,0 +1,337 @@
+#include "../../include/tcp/uring.h"
+
+#ifdef TCP_URING_SUPPORTED
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+static int _tcp_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return syscall(__NR_io_uring_setup, entries, params);
+};
+
+static int _tcp_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t arg_size)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size);
+};
+
+static int _tcp_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+};
+
+/** Adds a buffer to the tail of the provided buffer ring. The kernel only sees it once the tail is published. */
+static void _tcp_uring_add_buffer(struct tcp_uring *uring, uint16_t buffer_id)
+{
+    struct io_uring_buf *buffer = &uring->buffer_ring->bufs[uring->buffer_tail & (TCP_URING_BUFFER_COUNT - 1)];
+    buffer->addr = (uint64_t)(uintptr_t)(uring->buffers + (size_t)buffer_id * TCP_URING_BUFFER_SIZE);
+    buffer->len = TCP_URING_BUFFER_SIZE;
+    buffer->bid = buffer_id;
+
+    ++uring->buffer_tail;
+};
+
+int tcp_uring_init(struct tcp_uring *uring)
+{
+    memset(uring, 0, sizeof(struct tcp_uring));
+    uring->fd = -1;
+
+    vector_init(&uring->accepted, 8, sizeof(int));
+    vector_init(&uring->ready, 8, sizeof(int));
+    uring->woken = false;
+
+    /**
+     * Completions are only processed when the server waits for them (DEFER_TASKRUN), which needs a single submitting thread.
+     * The ring starts disabled, so that thread is the one which runs the main loop rather than the one which initialized the server.
+     * Kernels which lack these flags (before 6.1) also lack multishot receives, so they fall back to epoll.
+    */
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_R_DISABLED | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    params.cq_entries = TCP_URING_CQ_ENTRIES;
+
+    uring->fd = _tcp_uring_setup(TCP_URING_ENTRIES, &params);
+    if (uring->fd == -1) goto fail;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) goto fail;
+
+    uring->sq_ring_length = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    uring->cq_ring_length = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (uring->cq_ring_length > uring->sq_ring_length) uring->sq_ring_length = uring->cq_ring_length;
+    uring->cq_ring_length = uring->sq_ring_length;
+
+    /** Both rings share one mapping. */
+    uring->sq_ring = mmap(NULL, uring->sq_ring_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQ_RING);
+    if (uring->sq_ring == MAP_FAILED)
+    {
+        uring->sq_ring = NULL;
+        goto fail;
+    };
+
+    uring->cq_ring = uring->sq_ring;
+
+    uring->sqes_length = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring->sqes = mmap(NULL, uring->sqes_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQES);
+    if (uring->sqes == MAP_FAILED)
+    {
+        uring->sqes = NULL;
+        goto fail;
+    };
+
+    char *sq_ring = uring->sq_ring;
+    uring->sq_head = (unsigned *)(sq_ring + params.sq_off.head);
+    uring->sq_tail = (unsigned *)(sq_ring + params.sq_off.tail);
+    uring->sq_mask = *(unsigned *)(sq_ring + params.sq_off.ring_mask);
+    uring->sq_entries = params.sq_entries;
+    uring->sq_array = (unsigned *)(sq_ring + params.sq_off.array);
+    uring->sq_local_tail = *uring->sq_tail;
+
+    /** Every slot of the submission queue always refers to the entry with the same index. */
+    for (unsigned i = 0; i < uring->sq_entries; ++i) uring->sq_array[i] = i;
+
+    char *cq_ring = uring->cq_ring;
+    uring->cq_head = (unsigned *)(cq_ring + params.cq_off.head);
+    uring->cq_tail = (unsigned *)(cq_ring + params.cq_off.tail);
+    uring->cq_mask = *(unsigned *)(cq_ring + params.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+
+    uring->buffer_ring = mmap(NULL, TCP_URING_BUFFER_COUNT * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (uring->buffer_ring == MAP_FAILED)
+    {
+        uring->buffer_ring = NULL;
+        goto fail;
+    };
+
+    uring->buffers = malloc((size_t)TCP_URING_BUFFER_COUNT * TCP_URING_BUFFER_SIZE);
+    if (uring->buffers == NULL) goto fail;
+
+    struct io_uring_buf_reg buffer_registration;
+    memset(&buffer_registration, 0, sizeof(buffer_registration));
+    buffer_registration.ring_addr = (uint64_t)(uintptr_t)uring->buffer_ring;
+    buffer_registration.ring_entries = TCP_URING_BUFFER_COUNT;
+    buffer_registration.bgid = TCP_URING_BUFFER_GROUP;
+
+    if (_tcp_uring_register(uring->fd, IORING_REGISTER_PBUF_RING, &buffer_registration, 1) == -1) goto fail;
+
+    for (uint16_t i = 0; i < TCP_URING_BUFFER_COUNT; ++i) _tcp_uring_add_buffer(uring, i);
+    __atomic_store_n(&uring->buffer_ring->tail, uring->buffer_tail, __ATOMIC_RELEASE);
+
+    return 0;
+
+fail:
+    tcp_uring_free(uring);
+    return -1;
+};
+
+int tcp_uring_enable(struct tcp_uring *uring)
+{
+    if (uring->enabled) return 0;
+    if (_tcp_uring_register(uring->fd, IORING_REGISTER_ENABLE_RINGS, NULL, 0) == -1) return -1;
+
+    uring->enabled = true;
+    return 0;
+};
+
+struct io_uring_sqe *tcp_uring_get_sqe(struct tcp_uring *uring)
+{
+    unsigned head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+    if (uring->sq_local_tail - head >= uring->sq_entries)
+    {
+        if (tcp_uring_submit(uring, 0) == -1) return NULL;
+
+        head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+        if (uring->sq_local_tail - head >= uring->sq_entries) return NULL;
+    };
+
+    struct io_uring_sqe *sqe = &uring->sqes[uring->sq_local_tail & uring->sq_mask];
+    ++uring->sq_local_tail;
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    return sqe;
+};
+
+int tcp_uring_submit(struct tcp_uring *uring, unsigned wait_nr)
+{
+    __atomic_store_n(uring->sq_tail, uring->sq_local_tail, __ATOMIC_RELEASE);
+
+    int result = 0;
+    do
+    {
+        unsigned to_submit = uring->sq_local_tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+        result = _tcp_uring_enter(uring->fd, to_submit, wait_nr, wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (result == -1 && errno == EINTR);
+
+    return result;
+};
+
+int tcp_uring_wait(struct tcp_uring *uring, int timeout)
+{
+    if (timeout < 0) return tcp_uring_submit(uring, 1);
+
+    __atomic_store_n(uring->sq_tail, uring->sq_local_tail, __ATOMIC_RELEASE);
+
+    /** The timeout is passed to the syscall itself, so waiting for it does not take a submission. */
+    struct __kernel_timespec wait = { .tv_sec = timeout / 1000, .tv_nsec = (long long)(timeout % 1000) * 1000000 };
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = (uint64_t)(uintptr_t)&wait;
+
+    int result = 0;
+    do
+    {
+        unsigned to_submit = uring->sq_local_tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+        result = _tcp_uring_enter(uring->fd, to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    } while (result == -1 && errno == EINTR);
+
+    if (result == -1 && errno == ETIME) return 0;
+    return result;
+};
+
+int tcp_uring_prep_accept(struct tcp_uring *uring, int sockfd)
+{
+    struct io_uring_sqe *sqe = tcp_uring_get_sqe(uring);
+    if (sqe == NULL) return -1;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = sockfd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = TCP_URING_USER_DATA(TCP_URING_OP_ACCEPT, sockfd, 0);
+
+    return 0;
+};
+
+int tcp_uring_prep_recv(struct tcp_uring *uring, int sockfd, uint32_t generation)
+{
+    struct io_uring_sqe *sqe = tcp_uring_get_sqe(uring);
+    if (sqe == NULL) return -1;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = sockfd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = TCP_URING_BUFFER_GROUP;
+    sqe->user_data = TCP_URING_USER_DATA(TCP_URING_OP_RECV, sockfd, generation);
+
+    return 0;
+};
+
+int tcp_uring_prep_poll_writable(struct tcp_uring *uring, int sockfd, uint32_t generation)
+{
+    struct io_uring_sqe *sqe = tcp_uring_get_sqe(uring);
+    if (sqe == NULL) return -1;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = sockfd;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    sqe->poll32_events = (uint32_t)POLLOUT << 16 | (uint32_t)POLLOUT >> 16;
+#else
+    sqe->poll32_events = POLLOUT;
+#endif
+    sqe->user_data = TCP_URING_USER_DATA(TCP_URING_OP_POLL_WRITABLE, sockfd, generation);
+
+    return 0;
+};
+
+int tcp_uring_prep_poll_error(struct tcp_uring *uring, int sockfd, uint32_t generation)
+{
+    struct io_uring_sqe *sqe = tcp_uring_get_sqe(uring);
+    if (sqe == NULL) return -1;
+
+    /** Errors and hangups are always reported, so no other events are asked for. */
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = sockfd;
+    sqe->poll32_events = 0;
+    sqe->user_data = TCP_URING_USER_DATA(TCP_URING_OP_POLL_ERROR, sockfd, generation);
+
+    return 0;
+};
+
+int tcp_uring_prep_poll_wake(struct tcp_uring *uring, int fd)
+{
+    struct io_uring_sqe *sqe = tcp_uring_get_sqe(uring);
+    if (sqe == NULL) return -1;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    sqe->poll32_events = (uint32_t)POLLIN << 16 | (uint32_t)POLLIN >> 16;
+#else
+    sqe->poll32_events = POLLIN;
+#endif
+    sqe->user_data = TCP_URING_USER_DATA(TCP_URING_OP_POLL_WAKE, fd, 0);
+
+    return 0;
+};
+
+int tcp_uring_prep_cancel(struct tcp_uring *uring, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = tcp_uring_get_sqe(uring);
+    if (sqe == NULL) return -1;
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = TCP_URING_USER_DATA(TCP_URING_OP_CANCEL, 0, 0);
+
+    return 0;
+};
+
+char *tcp_uring_buffer(struct tcp_uring *uring, uint16_t buffer_id)
+{
+    return uring->buffers + (size_t)buffer_id * TCP_URING_BUFFER_SIZE;
+};
+
+void tcp_uring_recycle_buffer(struct tcp_uring *uring, uint16_t buffer_id)
+{
+    _tcp_uring_add_buffer(uring, buffer_id);
+    __atomic_store_n(&uring->buffer_ring->tail, uring->buffer_tail, __ATOMIC_RELEASE);
+};
+
+struct tcp_uring_slot *tcp_uring_slot(struct tcp_uring *uring, int sockfd)
+{
+    if (sockfd < 0) return NULL;
+
+    if ((size_t)sockfd >= uring->slots_capacity)
+    {
+        size_t capacity = uring->slots_capacity == 0 ? 64 : uring->slots_capacity;
+        while (capacity <= (size_t)sockfd) capacity *= 2;
+
+        struct tcp_uring_slot *slots = realloc(uring->slots, capacity * sizeof(struct tcp_uring_slot));
+        if (slots == NULL) return NULL;
+
+        memset(slots + uring->slots_capacity, 0, (capacity - uring->slots_capacity) * sizeof(struct tcp_uring_slot));
+        uring->slots = slots;
+        uring->slots_capacity = capacity;
+    };
+
+    return &uring->slots[sockfd];
+};
+
+void tcp_uring_free(struct tcp_uring *uring)
+{
+    if (uring->sqes != NULL) munmap(uring->sqes, uring->sqes_length);
+    if (uring->sq_ring != NULL) munmap(uring->sq_ring, uring->sq_ring_length);
+    if (uring->fd != -1) close(uring->fd);
+
+    /** The buffers can only be released once the ring, which the kernel receives through, is closed. */
+    if (uring->buffer_ring != NULL) munmap(uring->buffer_ring, TCP_URING_BUFFER_COUNT * sizeof(struct io_uring_buf));
+    free(uring->buffers);
+    free(uring->slots);
+
+    vector_free(&uring->accepted);
+    vector_free(&uring->ready);
+
+    memset(uring, 0, sizeof(struct tcp_uring));
+    uring->fd = -1;
+};
+
+#endif // TCP_URING_SUPPORTED
@@ -0,0 +1,106 @@
+#include "../../include/utils/arena.h"
+
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** The alignment of every allocation, and of the bytes after the header of a page. */
+#define ARENA_ALIGNMENT alignof(max_align_t)
+/** The size of the header of a page, rounded up so its bytes stay aligned. */
+#define ARENA_PAGE_HEADER_SIZE ((sizeof(struct arena_page) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+/** Gets the bytes of a page. */
+static char *_arena_page_data(struct arena_page *page)
+{
+    return (char *)page + ARENA_PAGE_HEADER_SIZE;
+};
+
+/** Moves to the next page with room for `size` bytes, allocating one if no kept page has room. */
+static struct arena_page *_arena_next_page(struct arena *arena, size_t size)
+{
+    struct arena_page **link = arena->current != NULL ? &arena->current->next : &arena->pages;
+
+    /** Kept pages too small for the allocation are skipped, and stay kept for the next reset. */
+    while (*link != NULL && (*link)->capacity < size) link = &(*link)->next;
+
+    if (*link == NULL)
+    {
+        size_t page_size = arena->page_size != 0 ? arena->page_size : ARENA_DEFAULT_PAGE_SIZE;
+        size_t capacity = size > page_size ? size : page_size;
+
+        struct arena_page *page = malloc(ARENA_PAGE_HEADER_SIZE + capacity);
+        if (page == NULL) return NULL;
+
+        page->next = NULL;
+        page->capacity = capacity;
+        *link = page;
+    };
+
+    arena->current = *link;
+    arena->used = 0;
+
+    return arena->current;
+};
+
+void arena_init(struct arena *arena, size_t page_size)
+{
+    memset(arena, 0, sizeof(struct arena));
+    arena->page_size = page_size;
+};
+
+void *arena_alloc(struct arena *arena, size_t size)
+{
+    size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+    if (arena->current == NULL || arena->current->capacity - arena->used < size)
+    {
+        if (_arena_next_page(arena, size) == NULL) return NULL;
+    };
+
+    void *allocation = _arena_page_data(arena->current) + arena->used;
+    arena->used += size;
+
+    return allocation;
+};
+
+void *arena_realloc(struct arena *arena, void *allocation, size_t old_size, size_t new_size)
+{
+    if (allocation == NULL) return arena_alloc(arena, new_size);
+    if (new_size <= old_size) return allocation;
+
+    old_size = (old_size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    new_size = (new_size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+    /** The last allocation of the current page is followed by its free bytes. */
+    char *end = _arena_page_data(arena->current) + arena->used;
+    if ((char *)allocation + old_size == end && arena->current->capacity - arena->used >= new_size - old_size)
+    {
+        arena->used += new_size - old_size;
+        return allocation;
+    };
+
+    void *grown = arena_alloc(arena, new_size);
+    if (grown != NULL) memcpy(grown, allocation, old_size);
+
+    return grown;
+};
+
+void arena_reset(struct arena *arena)
+{
+    arena->current = arena->pages;
+    arena->used = 0;
+};
+
+void arena_free(struct arena *arena)
+{
+    struct arena_page *page = arena->pages;
+    while (page != NULL)
+    {
+        struct arena_page *next = page->next;
+        free(page);
+        page = next;
+    };
+
+    arena->pages = arena->current = NULL;
+    arena->used = 0;
+};
@@ -7,86 +7,69 @@
 
 void map_init(struct map *map, size_t capacity)
 {
-    map->entries = calloc(capacity, sizeof(struct map_entry));
+    map->values = calloc(capacity, sizeof(void *));
 
     map->size = 0;
     map->capacity = capacity;
 };
 
-int map_resize(struct map *map)
+int map_resize(struct map *map, size_t capacity)
 {
-    if (map->size < map->capacity) return -1;
+    if (capacity <= map->capacity) return -1;
 
-    map->capacity *= 2;
-    map->entries = realloc(map->entries, map->capacity * sizeof(struct map_entry));
+    /** Doubling keeps the number of resizes logarithmic while file descriptors climb one at a time. */
+    size_t new_capacity = map->capacity == 0 ? 8 : map->capacity;
+    while (new_capacity < capacity) new_capacity *= 2;
+
+    void **values = realloc(map->values, new_capacity * sizeof(void *));
+    if (values == NULL) return -1;
+
+    memset(values + map->capacity, 0, (new_capacity - map->capacity) * sizeof(void *));
+
+    map->values = values;
+    map->capacity = new_capacity;
 
     return 0;
 };
 
 void *map_get(struct map *map, int key)
 {
-    int index = key % map->capacity;
-    size_t start = index;
-
-    while (1)
-    {
-        if (key == map->entries[index].key) break;
+    if (key < 0 || (size_t)key >= map->capacity) return NULL;
 
-        index = (index + 1) % map->capacity;
-        if (index == start) return NULL;
-    };
-
-    return map->entries[index].value;
+    return map->values[key];
 };
 
-void map_set(struct map *map, int key, void *value)
+int map_set(struct map *map, int key, void *value)
 {
-    map_resize(map);
+    if (key < 0) return -1;
+    if ((size_t)key >= map->capacity && map_resize(map, (size_t)key + 1) != 0) return -1;
 
-    int index = key % map->capacity;
-    size_t start = index;
+    if (map->values[key] == NULL && value != NULL) ++map->size;
+    else if (map->values[key] != NULL && value == NULL) --map->size;
 
-    while (map->entries[index].initialised == true)
-    {
-        if (key == map->entries[index].key) break;
+    map->values[key] = value;
 
-        index = (index + 1) % map->capacity;
-        if (index == start) return;
-    };
-
-    if (map->entries[index].initialised == false) ++map->size;
-
-    map->entries[index].key = key;
-    map->entries[index].value = value;
+    return 0;
 };
 
 void map_delete(struct map *map, int key)
 {
-    int index = key % map->capacity;
-    size_t start = index;
-
-    while (1)
-    {
-        if (key == map->entries[index].key) break;
-
-        index = (index + 1) % map->capacity;
-        if (index == start) return;
-    };
+    /** A key past the capacity has no value, so there is nothing to grow for. */
+    if (key < 0 || (size_t)key >= map->capacity) return;
 
-    memset(&map->entries[index], 0, sizeof(struct map_entry));
-    --map->size;
+    map_set(map, key, NULL);
 };
 
 void map_free(struct map *map, bool free_values)
 {
     for (size_t i = 0; i < map->capacity; ++i)
     {
-        if (map->entries[i].value != NULL && free_values) free(map->entries[i].value);
+        if (map->values[i] != NULL && free_values) free(map->values[i]);
     };
 
-    free(map->entries);
+    free(map->values);
     
-    map->entries = NULL;
+    map->values = NULL;
     map->size = 0;
     map->capacity = 0;
-};
\ No newline at end of file
+};
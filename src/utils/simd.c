@@ -0,0 +1,203 @@
+#include "../../include/utils/simd.h"
+
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+static size_t _simd_find_ranges_scalar(const char *data, size_t length, const char *ranges, size_t ranges_length)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        unsigned char byte = (unsigned char)data[i];
+        for (size_t j = 0; j + 1 < ranges_length; j += 2)
+        {
+            if (byte >= (unsigned char)ranges[j] && byte <= (unsigned char)ranges[j + 1])
+                return i;
+        };
+    };
+
+    return length;
+};
+
+#ifdef SIMD_X86
+__attribute__((target("sse4.2")))
+static size_t _simd_find_ranges_sse42(const char *data, size_t length, const char *ranges, size_t ranges_length)
+{
+    /** `pcmpestri` always loads 16 bytes of ranges, and only looks at the first `ranges_length`. */
+    char padded_ranges[16] = {0};
+    memcpy(padded_ranges, ranges, ranges_length);
+    __m128i ranges_vector = _mm_loadu_si128((const __m128i *)padded_ranges);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+        int index = _mm_cmpestri(ranges_vector, (int)ranges_length, block, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if (index != 16) return i + index;
+    };
+
+    return i + _simd_find_ranges_scalar(data + i, length - i, ranges, ranges_length);
+};
+
+__attribute__((target("avx2")))
+static size_t _simd_find_ranges_avx2(const char *data, size_t length, const char *ranges, size_t ranges_length)
+{
+    __m256i lows[8], highs[8];
+    size_t range_count = ranges_length / 2;
+
+    for (size_t j = 0; j < range_count; ++j)
+    {
+        lows[j] = _mm256_set1_epi8(ranges[j * 2]);
+        highs[j] = _mm256_set1_epi8(ranges[j * 2 + 1]);
+    };
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i matches = _mm256_setzero_si256();
+
+        /** There is no unsigned byte comparison, so `low <= byte <= high` is tested as `max(byte, low) == byte && min(byte, high) == byte`. */
+        for (size_t j = 0; j < range_count; ++j)
+        {
+            __m256i above_low = _mm256_cmpeq_epi8(_mm256_max_epu8(block, lows[j]), block);
+            __m256i below_high = _mm256_cmpeq_epi8(_mm256_min_epu8(block, highs[j]), block);
+            matches = _mm256_or_si256(matches, _mm256_and_si256(above_low, below_high));
+        };
+
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(matches);
+        if (mask != 0) return i + __builtin_ctz(mask);
+    };
+
+    return i + _simd_find_ranges_scalar(data + i, length - i, ranges, ranges_length);
+};
+#endif
+
+/** Masks a word at a time. The key repeats every 4 bytes, so it tiles a word of any width the same way. */
+static void _simd_mask_scalar(uint8_t *destination, const uint8_t *source, size_t length, const uint8_t masking_key[4], size_t phase)
+{
+    uint8_t rotated_key[sizeof(uintptr_t)];
+    for (size_t i = 0; i < sizeof(uintptr_t); ++i) rotated_key[i] = masking_key[(phase + i) % 4];
+
+    uintptr_t key_word;
+    memcpy(&key_word, rotated_key, sizeof(uintptr_t));
+
+    size_t i = 0;
+    for (; i + sizeof(uintptr_t) <= length; i += sizeof(uintptr_t))
+    {
+        uintptr_t word;
+        memcpy(&word, source + i, sizeof(uintptr_t));
+        word ^= key_word;
+        memcpy(destination + i, &word, sizeof(uintptr_t));
+    };
+
+    for (; i < length; ++i) destination[i] = source[i] ^ rotated_key[i % sizeof(uintptr_t)];
+};
+
+#ifdef SIMD_X86
+__attribute__((target("sse2")))
+static void _simd_mask_sse2(uint8_t *destination, const uint8_t *source, size_t length, const uint8_t masking_key[4], size_t phase)
+{
+    uint8_t rotated_key[16];
+    for (size_t i = 0; i < 16; ++i) rotated_key[i] = masking_key[(phase + i) % 4];
+    __m128i key_vector = _mm_loadu_si128((const __m128i *)rotated_key);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(source + i));
+        _mm_storeu_si128((__m128i *)(destination + i), _mm_xor_si128(block, key_vector));
+    };
+
+    /** Every block is a multiple of 4 bytes long, so the rest starts at the same phase. */
+    _simd_mask_scalar(destination + i, source + i, length - i, masking_key, phase);
+};
+
+__attribute__((target("avx2")))
+static void _simd_mask_avx2(uint8_t *destination, const uint8_t *source, size_t length, const uint8_t masking_key[4], size_t phase)
+{
+    uint8_t rotated_key[32];
+    for (size_t i = 0; i < 32; ++i) rotated_key[i] = masking_key[(phase + i) % 4];
+    __m256i key_vector = _mm256_loadu_si256((const __m256i *)rotated_key);
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(source + i));
+        _mm256_storeu_si256((__m256i *)(destination + i), _mm256_xor_si256(block, key_vector));
+    };
+
+    _simd_mask_scalar(destination + i, source + i, length - i, masking_key, phase);
+};
+#endif
+
+enum simd_level simd_get_level(void)
+{
+    static int level = -1;
+    if (level != -1) return level;
+
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) level = SIMD_LEVEL_AVX2;
+    else if (__builtin_cpu_supports("sse4.2")) level = SIMD_LEVEL_SSE42;
+    else if (__builtin_cpu_supports("sse2")) level = SIMD_LEVEL_SSE2;
+    else level = SIMD_LEVEL_SCALAR;
+#else
+    level = SIMD_LEVEL_SCALAR;
+#endif
+
+    return level;
+};
+
+static size_t _simd_find_ranges_resolve(const char *data, size_t length, const char *ranges, size_t ranges_length);
+
+/** The implementation of `simd_find_ranges` for this CPU, which is resolved on the first call. */
+static size_t (*_simd_find_ranges)(const char *data, size_t length, const char *ranges, size_t ranges_length) = _simd_find_ranges_resolve;
+
+static size_t _simd_find_ranges_resolve(const char *data, size_t length, const char *ranges, size_t ranges_length)
+{
+    switch (simd_get_level())
+    {
+#ifdef SIMD_X86
+        case SIMD_LEVEL_AVX2: _simd_find_ranges = _simd_find_ranges_avx2; break;
+        case SIMD_LEVEL_SSE42: _simd_find_ranges = _simd_find_ranges_sse42; break;
+#endif
+        default: _simd_find_ranges = _simd_find_ranges_scalar; break;
+    };
+
+    return _simd_find_ranges(data, length, ranges, ranges_length);
+};
+
+size_t simd_find_ranges(const char *data, size_t length, const char *ranges, size_t ranges_length)
+{
+    return _simd_find_ranges(data, length, ranges, ranges_length);
+};
+
+static void _simd_mask_resolve(uint8_t *destination, const uint8_t *source, size_t length, const uint8_t masking_key[4], size_t phase);
+
+/** The implementation of `simd_mask` for this CPU, which is resolved on the first call. */
+static void (*_simd_mask)(uint8_t *destination, const uint8_t *source, size_t length, const uint8_t masking_key[4], size_t phase) = _simd_mask_resolve;
+
+static void _simd_mask_resolve(uint8_t *destination, const uint8_t *source, size_t length, const uint8_t masking_key[4], size_t phase)
+{
+    switch (simd_get_level())
+    {
+#ifdef SIMD_X86
+        case SIMD_LEVEL_AVX2: _simd_mask = _simd_mask_avx2; break;
+        case SIMD_LEVEL_SSE42:
+        case SIMD_LEVEL_SSE2: _simd_mask = _simd_mask_sse2; break;
+#endif
+        default: _simd_mask = _simd_mask_scalar; break;
+    };
+
+    _simd_mask(destination, source, length, masking_key, phase);
+};
+
+void simd_mask(uint8_t *destination, const uint8_t *source, size_t length, const uint8_t masking_key[4], size_t phase)
+{
+    _simd_mask(destination, source, length, masking_key, phase);
+};
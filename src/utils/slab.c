@@ -0,0 +1,53 @@
+#include "../../include/utils/slab.h"
+
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+int slab_init(struct slab *slab, size_t slot_size, size_t capacity)
+{
+    size_t alignment = alignof(max_align_t);
+    slab->slot_size = (slot_size + alignment - 1) & ~(alignment - 1);
+    slab->capacity = capacity;
+    slab->free_count = 0;
+
+    slab->slots = malloc(slab->slot_size * capacity);
+    slab->free_slots = malloc(sizeof(size_t) * capacity);
+    if (slab->slots == NULL || slab->free_slots == NULL)
+    {
+        slab_free(slab);
+        return -1;
+    };
+
+    memset(slab->slots, 0, slab->slot_size * capacity);
+
+    /** The lowest slots are acquired first, so the slots in use stay close together. */
+    for (size_t i = capacity; i > 0; --i) slab->free_slots[slab->free_count++] = i - 1;
+
+    return 0;
+};
+
+void *slab_acquire(struct slab *slab)
+{
+    if (slab->free_count == 0) return NULL;
+
+    void *slot = (char *)slab->slots + slab->free_slots[--slab->free_count] * slab->slot_size;
+    memset(slot, 0, slab->slot_size);
+
+    return slot;
+};
+
+void slab_release(struct slab *slab, void *slot)
+{
+    slab->free_slots[slab->free_count++] = ((char *)slot - (char *)slab->slots) / slab->slot_size;
+};
+
+void slab_free(struct slab *slab)
+{
+    free(slab->slots);
+    free(slab->free_slots);
+
+    slab->slots = NULL;
+    slab->free_slots = NULL;
+    slab->capacity = slab->free_count = 0;
+};
@@ -19,6 +19,29 @@ void sso_string_init(string_t *string, const char *data)
     sso_string_ensure_null_terminated(string);
 };
 
+void sso_string_init_view(string_t *string, const char *data, size_t length)
+{
+    string->length = length;
+
+    if (length > SSO_STRING_MAX_LENGTH)
+    {
+        /** A capacity of `0` marks a long string as borrowed. */
+        string->capacity = 0;
+        string->long_string = (char *)data;
+    }
+    else
+    {
+        string->capacity = SSO_STRING_MAX_LENGTH;
+        memmove(string->short_string, data, length);
+        string->short_string[length] = '\0';
+    };
+};
+
+int sso_string_is_view(string_t *string)
+{
+    return string->length > SSO_STRING_MAX_LENGTH && string->capacity == 0;
+};
+
 void sso_string_set(string_t *string, const char *data)
 {
     sso_string_free(string);
@@ -36,7 +59,7 @@ void sso_string_concat(string_t *dest, string_t *src)
 
     if (total_length > SSO_STRING_MAX_LENGTH)
     {
-        if (dest->length > SSO_STRING_MAX_LENGTH)
+        if (dest->length > SSO_STRING_MAX_LENGTH && !sso_string_is_view(dest))
         {
             char *new_long_string = (char *)realloc(dest->long_string, total_length + 1);
             dest->long_string = new_long_string;
@@ -44,7 +67,7 @@ void sso_string_concat(string_t *dest, string_t *src)
         else
         {
             char *new_long_string = (char *)malloc(total_length + 1);
-            memcpy(new_long_string, dest->short_string, dest->length);
+            memcpy(new_long_string, sso_string_get(dest), dest->length);
             dest->long_string = new_long_string;
         }
 
@@ -59,12 +82,16 @@ void sso_string_concat(string_t *dest, string_t *src)
 
 void sso_string_concat_buffer(string_t *dest, const  char *src)
 {
-    size_t src_length = strlen(src);
-    size_t total_length = dest->length + src_length;
+    sso_string_concat_bytes(dest, src, strlen(src));
+};
+
+void sso_string_concat_bytes(string_t *dest, const char *src, size_t length)
+{
+    size_t total_length = dest->length + length;
 
     if (total_length > SSO_STRING_MAX_LENGTH)
     {
-        if (dest->length > SSO_STRING_MAX_LENGTH)
+        if (dest->length > SSO_STRING_MAX_LENGTH && !sso_string_is_view(dest))
         {
             char *new_long_string = (char *)realloc(dest->long_string, total_length + 1);
             dest->long_string = new_long_string;
@@ -72,13 +99,13 @@ void sso_string_concat_buffer(string_t *dest, const  char *src)
         else
         {
             char *new_long_string = (char *)malloc(total_length + 1);
-            memcpy(new_long_string, dest->short_string, dest->length);
+            memcpy(new_long_string, sso_string_get(dest), dest->length);
             dest->long_string = new_long_string;
         }
 
-        memcpy(dest->long_string + dest->length, src, src_length + 1);
+        memcpy(dest->long_string + dest->length, src, length);
     }
-    else memcpy(dest->short_string + dest->length, src, src_length + 1);
+    else memcpy(dest->short_string + dest->length, src, length);
 
     dest->length = total_length;
     dest->capacity = total_length;
@@ -148,7 +175,7 @@ void sso_string_copy(string_t *dest, string_t *src)
     else memcpy(dest->short_string, sso_string_get(src), src->length);
     
     dest->length = src->length;
-    dest->capacity = src->capacity;
+    dest->capacity = src->length > SSO_STRING_MAX_LENGTH ? src->length : SSO_STRING_MAX_LENGTH;
 
     sso_string_ensure_null_terminated(dest);
 };
@@ -178,7 +205,7 @@ void sso_string_ensure_null_terminated(string_t *string)
 
 void sso_string_free(string_t *string)
 {
-    if (string->length > SSO_STRING_MAX_LENGTH && string->long_string != NULL)
+    if (string->length > SSO_STRING_MAX_LENGTH && string->long_string != NULL && !sso_string_is_view(string))
     {
         free(string->long_string);
     };
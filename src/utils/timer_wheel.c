@@ -0,0 +1,182 @@
+#include "../../include/utils/timer_wheel.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/** The number of bits of a tick which index one level. */
+#define TIMER_WHEEL_SLOT_BITS 6
+
+uint64_t timer_wheel_now(void)
+{
+#ifdef _WIN32
+    return GetTickCount64();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#endif
+};
+
+/** Places a timer in the lowest level whose span covers the ticks until it expires. */
+static void _timer_wheel_insert(struct timer_wheel *wheel, struct wheel_timer *timer)
+{
+    uint64_t delta = timer->expires_at > wheel->current ? timer->expires_at - wheel->current : 0;
+
+    /** Timers past the span of the highest level are clamped to it. */
+    uint64_t span = (uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS);
+    if (delta >= span)
+    {
+        delta = span - 1;
+        timer->expires_at = wheel->current + delta;
+    };
+
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * (level + 1))) ++level;
+
+    uint8_t slot = (timer->expires_at >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+
+    timer->level = level;
+    timer->slot = slot;
+    timer->previous = NULL;
+    timer->next = wheel->slots[level][slot];
+    if (timer->next != NULL) timer->next->previous = timer;
+
+    wheel->slots[level][slot] = timer;
+    wheel->occupied[level] |= (uint64_t)1 << slot;
+};
+
+/** Removes a timer from its slot. */
+static void _timer_wheel_unlink(struct timer_wheel *wheel, struct wheel_timer *timer)
+{
+    if (timer->previous != NULL) timer->previous->next = timer->next;
+    else wheel->slots[timer->level][timer->slot] = timer->next;
+
+    if (timer->next != NULL) timer->next->previous = timer->previous;
+
+    if (wheel->slots[timer->level][timer->slot] == NULL) wheel->occupied[timer->level] &= ~((uint64_t)1 << timer->slot);
+
+    timer->previous = timer->next = NULL;
+};
+
+/** Moves the timers of the slot of an upper level which the current tick has reached down to the lower levels. */
+static void _timer_wheel_cascade(struct timer_wheel *wheel, int level)
+{
+    uint8_t slot = (wheel->current >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+
+    struct wheel_timer *timer = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied[level] &= ~((uint64_t)1 << slot);
+
+    while (timer != NULL)
+    {
+        struct wheel_timer *next = timer->next;
+        _timer_wheel_insert(wheel, timer);
+        timer = next;
+    };
+};
+
+void timer_wheel_init(struct timer_wheel *wheel, uint32_t resolution)
+{
+    memset(wheel, 0, sizeof(struct timer_wheel));
+
+    wheel->resolution = resolution == 0 ? TIMER_WHEEL_DEFAULT_RESOLUTION : resolution;
+    wheel->current = timer_wheel_now() / wheel->resolution;
+};
+
+void timer_wheel_arm(struct timer_wheel *wheel, struct wheel_timer *timer, uint64_t timeout)
+{
+    if (timer->armed) timer_wheel_cancel(wheel, timer);
+
+    uint64_t now = timer_wheel_now();
+
+    /** An empty wheel has nothing to expire on the way, so it skips ahead instead of stepping through the ticks it slept for. */
+    if (wheel->count == 0 && now / wheel->resolution > wheel->current) wheel->current = now / wheel->resolution;
+
+    /** The deadline is rounded up to a tick, so a timer never expires early. */
+    timer->expires_at = (now + timeout + wheel->resolution - 1) / wheel->resolution;
+    if (timer->expires_at <= wheel->current) timer->expires_at = wheel->current + 1;
+    timer->armed = true;
+
+    _timer_wheel_insert(wheel, timer);
+    ++wheel->count;
+};
+
+void timer_wheel_cancel(struct timer_wheel *wheel, struct wheel_timer *timer)
+{
+    if (!timer->armed) return;
+
+    _timer_wheel_unlink(wheel, timer);
+    timer->armed = false;
+    --wheel->count;
+};
+
+int timer_wheel_next_timeout(struct timer_wheel *wheel)
+{
+    if (wheel->count == 0) return -1;
+
+    uint64_t position = wheel->current & (TIMER_WHEEL_SLOTS - 1);
+    uint64_t ticks = TIMER_WHEEL_SLOTS - position;
+
+    /** The next occupied slot of the lowest level, found by rotating the slot after the current one to the lowest bit. */
+    uint64_t occupied = wheel->occupied[0];
+    if (occupied != 0)
+    {
+        uint64_t shift = (position + 1) & (TIMER_WHEEL_SLOTS - 1);
+        uint64_t rotated = shift == 0 ? occupied : (occupied >> shift) | (occupied << (TIMER_WHEEL_SLOTS - shift));
+        uint64_t distance = __builtin_ctzll(rotated) + 1;
+
+        if (distance < ticks) ticks = distance;
+    };
+
+    uint64_t now = timer_wheel_now();
+    uint64_t deadline = (wheel->current + ticks) * wheel->resolution;
+    if (deadline <= now) return 0;
+
+    uint64_t timeout = deadline - now;
+    return timeout > INT32_MAX ? INT32_MAX : (int)timeout;
+};
+
+void timer_wheel_advance(struct timer_wheel *wheel)
+{
+    uint64_t now = timer_wheel_now() / wheel->resolution;
+
+    while (wheel->current < now)
+    {
+        if (wheel->count == 0)
+        {
+            wheel->current = now;
+            break;
+        };
+
+        ++wheel->current;
+
+        /** The upper levels move down whenever every level below them wraps around, from the highest one down. */
+        for (int level = TIMER_WHEEL_LEVELS - 1; level > 0; --level)
+        {
+            if ((wheel->current & (((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * level)) - 1)) == 0) _timer_wheel_cascade(wheel, level);
+        };
+
+        /** A callback may cancel the other timers of the slot, so they are taken one at a time. */
+        uint8_t slot = wheel->current & (TIMER_WHEEL_SLOTS - 1);
+        struct wheel_timer *timer = NULL;
+        while ((timer = wheel->slots[0][slot]) != NULL)
+        {
+            timer_wheel_cancel(wheel, timer);
+            if (timer->on_expire != NULL) timer->on_expire(timer);
+        };
+    };
+};
+
+void timer_wheel_clear(struct timer_wheel *wheel)
+{
+    memset(wheel->slots, 0, sizeof(wheel->slots));
+    memset(wheel->occupied, 0, sizeof(wheel->occupied));
+    wheel->count = 0;
+};
@@ -66,10 +66,8 @@ void vector_delete(struct vector *vec, size_t index)
 
 void vector_clear(struct vector *vec)
 {
-    while (vec->size > 0)
-    {
-        vector_delete(vec, 0);
-    };
+    /** The elements are plain bytes, so they are dropped at once rather than shifted out one by one. */
+    vec->size = 0;
 };
 
 void vector_reset(struct vector *vec)
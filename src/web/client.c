@@ -12,7 +12,8 @@ static void _tcp_on_connect(struct tcp_client *client)
         http_client->on_http_connect(http_client);
 };
 
-static void _tcp_on_data(struct tcp_client *client)
+/** Parses and dispatches one message from the server. Returns `0` if a message was dispatched. */
+static int _tcp_on_message(struct tcp_client *client)
 {
     struct web_client *web_client = client->data;
     switch (web_client->connection_type)
@@ -22,7 +23,7 @@ static void _tcp_on_data(struct tcp_client *client)
             struct ws_frame_parsing_state *ws_parsing_state = &web_client->ws_parsing_state;
             
             enum ws_frame_parsing_errors result = 0;
-            if ((result = ws_parse_frame(web_client, ws_parsing_state, -1 /** overflows to SIZE_MAX*/)))
+            if ((result = ws_parse_frame(web_client, ws_parsing_state, -1 /** overflows to SIZE_MAX*/, false)))
             {
                 if (result < 0)
                 {
@@ -30,7 +31,7 @@ static void _tcp_on_data(struct tcp_client *client)
                         web_client->on_ws_malformed_frame(web_client, result);
                 };
 
-                return;
+                return 1;
             };
 
             if (ws_parsing_state->message.opcode == WS_OPCODE_PING || ws_parsing_state->message.opcode == WS_OPCODE_PONG)
@@ -93,15 +94,21 @@ static void _tcp_on_data(struct tcp_client *client)
                     memset(http_client_parsing_state, 0, sizeof(struct http_client_parsing_state));
 
                     http_client_parsing_state->parsing_state = -1;
-                    return;
+                    return 1;
                 };
 
-                return;
+                return 1;
             };
 
             if (http_client_parsing_state->response.accept_websocket == true)
             {
                 web_client->connection_type = CONNECTION_WS;
+
+                /** The server names the parameters of permessage-deflate it accepted, if it did. */
+                struct ws_deflate_options deflate_options;
+                if (web_client->ws_client_config.permessage_deflate.enabled && ws_deflate_accept_response(http_response_get_header(&http_client_parsing_state->response, "Sec-WebSocket-Extensions"), &deflate_options) == 0)
+                    web_client->deflate = ws_deflate_create(&deflate_options, &web_client->ws_client_config.permessage_deflate, false, NULL);
+
                 if (web_client->on_ws_connect != NULL)
                 {
                     web_client->on_ws_connect(web_client);
@@ -129,6 +136,18 @@ static void _tcp_on_data(struct tcp_client *client)
             break;
         };
     };
+
+    return 0;
+};
+
+static void _tcp_on_data(struct tcp_client *client)
+{
+    /** The socket will not become readable again for bytes which are already buffered, so every buffered message is handled now. */
+    while (
+        _tcp_on_message(client) == 0
+        && client->listening
+        && socket_buffer_available(&client->recv_buffer) > 0
+    );
 };
 
 static void _tcp_on_disconnect(struct tcp_client *client, bool is_error)
@@ -142,6 +161,10 @@ static void _tcp_on_disconnect(struct tcp_client *client, bool is_error)
         web_client->on_ws_disconnect(web_client, 0, NULL);
         web_client->is_closed = true;
     };
+
+    ws_deflate_free(web_client->deflate);
+    web_client->deflate = NULL;
+    vector_free(&web_client->send_scratch);
 };
 
 int web_client_init(struct web_client *client, struct sockaddr *address)
@@ -167,6 +190,8 @@ int web_client_init(struct web_client *client, struct sockaddr *address)
     client->tcp_client = tcp_client;
     client->client_close_flag = 0;
     client->connection_type = CONNECTION_HTTP /** default */;
+    client->deflate = NULL;
+    memset(&client->send_scratch, 0, sizeof(client->send_scratch));
 
     return 0;
 };
@@ -5,6 +5,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #ifdef __linux__
 #include <sys/epoll.h>
@@ -15,76 +21,488 @@
 #include <sys/event.h>
 #endif
 
-int _path_matches(const char *path, const char *pattern) 
+/** Creates a node of the route tree which matches the bytes of a prefix. */
+static struct web_server_route_node *_web_server_route_node_create(const char *prefix, size_t prefix_length)
+{
+    struct web_server_route_node *node = calloc(1, sizeof(struct web_server_route_node));
+    vector_init(&node->children, 2, sizeof(struct web_server_route_node *));
+
+    if (prefix_length > 0)
+    {
+        node->prefix = malloc(prefix_length);
+        memcpy(node->prefix, prefix, prefix_length);
+    };
+
+    node->prefix_length = prefix_length;
+
+    return node;
+};
+
+/** Frees a node of the route tree and every node below it. */
+static void _web_server_route_node_free(struct web_server_route_node *node)
 {
-    if (strcmp(path, pattern) == 0) return 1;
+    if (node == NULL) return;
 
-    while (*pattern) 
+    for (size_t i = 0; i < node->children.size; ++i)
+        _web_server_route_node_free(*(struct web_server_route_node **)vector_get(&node->children, i));
+
+    _web_server_route_node_free(node->param);
+    _web_server_route_node_free(node->wildcard);
+
+    vector_free(&node->children);
+    free(node->prefix);
+    free(node);
+};
+
+/** Whether or not a `:` of a pattern starts a `:name` segment, which it only does at the start of a segment. */
+static bool _web_server_is_param(const char *pattern, const char *cursor)
+{
+    return *cursor == ':' && (cursor == pattern || cursor[-1] == '/');
+};
+
+/** Compiles the pattern of a route into the route tree. */
+static void _web_server_route_tree_insert(struct web_server_route_node *node, struct web_server_route *route)
+{
+    const char *pattern = route->path;
+    const char *cursor = pattern;
+
+    while (*cursor != '\0')
     {
-        if (*pattern == '*') 
+        if (_web_server_is_param(pattern, cursor))
         {
-            /** Check for end of path. */
-            if (*(pattern + 1) == '\0') return 1;
+            /** The name only labels the value, so patterns which only differ in it share the node. */
+            cursor += strcspn(cursor, "/");
 
-            /** Recursively try all positions for the wildcard match. */
-            while (*path)
-            {
-                if (_path_matches(path, pattern + 1)) return 1;
-                else ++path;
-            }
-            
-            return 0;
-        } 
-        else
+            if (node->param == NULL) node->param = _web_server_route_node_create(NULL, 0);
+            node = node->param;
+            continue;
+        };
+
+        if (*cursor == '*')
+        {
+            ++cursor;
+
+            if (node->wildcard == NULL) node->wildcard = _web_server_route_node_create(NULL, 0);
+            node = node->wildcard;
+            continue;
+        };
+
+        /** The bytes run until the next `:name` segment or `*`. */
+        const char *end = cursor;
+        while (*end != '\0' && *end != '*' && !_web_server_is_param(pattern, end)) ++end;
+        size_t length = end - cursor;
+
+        struct web_server_route_node **child = NULL;
+        for (size_t i = 0; i < node->children.size && child == NULL; ++i)
+        {
+            struct web_server_route_node **candidate = vector_get(&node->children, i);
+            if ((*candidate)->prefix[0] == *cursor) child = candidate;
+        };
+
+        if (child == NULL)
+        {
+            struct web_server_route_node *created = _web_server_route_node_create(cursor, length);
+            vector_push(&node->children, &created);
+
+            node = created;
+            cursor = end;
+            continue;
+        };
+
+        size_t common = 0;
+        while (common < length && common < (*child)->prefix_length && (*child)->prefix[common] == cursor[common]) ++common;
+
+        /** The child is split where the bytes differ, so both patterns share the bytes before it. */
+        if (common < (*child)->prefix_length)
+        {
+            struct web_server_route_node *split = _web_server_route_node_create(cursor, common);
+            struct web_server_route_node *rest = *child;
+
+            memmove(rest->prefix, rest->prefix + common, rest->prefix_length - common);
+            rest->prefix_length -= common;
+
+            vector_push(&split->children, &rest);
+            *child = split;
+        };
+
+        node = *child;
+        cursor += common;
+    };
+
+    /** Of two routes with the same pattern, the one created first keeps the node. */
+    if (node->route == NULL) node->route = route;
+};
+
+/** Captures a value from the path into the request (if any), unless it has no room left for it. */
+static void _web_server_capture_param(struct http_request *request, const char *value, size_t length)
+{
+    if (request == NULL || request->param_count >= HTTP_MAX_ROUTE_PARAMS) return;
+
+    request->params[request->param_count++] = (struct http_route_param){ .value = value, .value_length = length };
+};
+
+/** Finds the first byte of a path from which a child of a node could match, or the end of the path if none does. */
+static const char *_web_server_route_tree_next_start(struct web_server_route_node *node, const char *path, const char *end)
+{
+    if (node->children.size == 1)
+    {
+        const char *start = memchr(path, (*(struct web_server_route_node **)vector_get(&node->children, 0))->prefix[0], end - path);
+        return start != NULL ? start : end;
+    };
+
+    /** The children start with different bytes, so there are at most as many as there are bytes. */
+    char starts[257];
+    size_t count = 0;
+    for (; count < node->children.size; ++count) starts[count] = (*(struct web_server_route_node **)vector_get(&node->children, count))->prefix[0];
+    starts[count] = '\0';
+
+    return path + strcspn(path, starts);
+};
+
+/** Matches the rest of a path below a node of the route tree, preferring bytes over `:name` segments over a `*`. Returns the route which matched, or `NULL`. */
+static struct web_server_route *_web_server_route_tree_match(struct web_server_route_node *node, const char *path, struct http_request *request)
+{
+    if (*path == '\0' && node->route != NULL) return node->route;
+
+    struct web_server_route *route = NULL;
+    size_t captured = request != NULL ? request->param_count : 0;
+
+    /** The children start with different bytes, so at most one of them can match. */
+    for (size_t i = 0; i < node->children.size && *path != '\0'; ++i)
+    {
+        struct web_server_route_node *child = *(struct web_server_route_node **)vector_get(&node->children, i);
+        if (child->prefix[0] != *path) continue;
+
+        if (strncmp(path, child->prefix, child->prefix_length) == 0 && (route = _web_server_route_tree_match(child, path + child->prefix_length, request)) != NULL) return route;
+        break;
+    };
+
+    if (node->param != NULL)
+    {
+        size_t length = strcspn(path, "/");
+        if (length > 0)
+        {
+            _web_server_capture_param(request, path, length);
+            if ((route = _web_server_route_tree_match(node->param, path + length, request)) != NULL) return route;
+            if (request != NULL) request->param_count = captured;
+        };
+    };
+
+    if (node->wildcard != NULL)
+    {
+        struct web_server_route_node *wildcard = node->wildcard;
+        size_t remaining = strlen(path);
+
+        /** A `*` which ends the pattern takes the rest of the path. Otherwise, it takes the shortest run after which the rest of the pattern matches. */
+        if (wildcard->children.size == 0 && wildcard->param == NULL && wildcard->wildcard == NULL)
         {
-            if (*path != *pattern) return 0;
-            
-            ++path;
-            ++pattern;
+            _web_server_capture_param(request, path, remaining);
+            return wildcard->route;
+        };
+
+        /** 
+         * The run can only stop where a child of the `*` starts or where the path ends, so it skips straight to the next such byte.
+         * Trying every length instead would match the rest of the pattern from every byte of the path.
+        */
+        const char *end = path + remaining;
+        for (const char *cursor = path; cursor <= end; ++cursor)
+        {
+            if (wildcard->wildcard == NULL) cursor = _web_server_route_tree_next_start(wildcard, cursor, end);
+
+            _web_server_capture_param(request, path, cursor - path);
+            if ((route = _web_server_route_tree_match(wildcard, cursor, request)) != NULL) return route;
+            if (request != NULL) request->param_count = captured;
+        };
+    };
+
+    return NULL;
+};
+
+/** Finds the route of a path, capturing the values of its `:name` segments and `*` into the request (if not `NULL`), named after the pattern. */
+static struct web_server_route *_web_server_match_route(struct web_server *server, const char *path, struct http_request *request)
+{
+    if (path == NULL || server->route_tree == NULL) return NULL;
+    if (request != NULL) request->param_count = 0;
+
+    struct web_server_route *route = _web_server_route_tree_match(server->route_tree, path, request);
+    if (route == NULL || request == NULL) return route;
+
+    /** The values were captured in the order of the pattern, so the names are read from it in the same order. */
+    const char *pattern = route->path;
+    size_t index = 0;
+    for (const char *cursor = pattern; *cursor != '\0' && index < request->param_count; ++cursor)
+    {
+        struct http_route_param *param = &request->params[index];
+
+        if (*cursor == '*')
+        {
+            param->name = cursor;
+            param->name_length = 1;
+            ++index;
         }
-    }
+        else if (_web_server_is_param(pattern, cursor))
+        {
+            param->name = cursor + 1;
+            param->name_length = strcspn(cursor + 1, "/");
+            cursor += param->name_length;
+            ++index;
+        };
+    };
+
+    return route;
+};
+
+/** Sends a canned response with a plain text body, and closes the connection once it was sent if it is closing. */
+static void _web_server_send_canned(struct web_server *server, struct web_client *client, int status_code, const char *body)
+{
+    char response[256];
+    int response_length = snprintf(response, sizeof(response),
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: %zu\r\n"
+        "%s"
+        "\r\n"
+        "%s",
+        status_code, http_status_code_to_message(status_code), strlen(body), client->server_close_flag ? "Connection: close\r\n" : "", body);
+
+    /** The response is queued behind the responses to earlier pipelined requests, which are sent before the connection is closed. */
+    struct iovec iov = { .iov_base = response, .iov_len = response_length };
+    if (tcp_server_send_queued(server->tcp_server, client->tcp_client, &iov, 1) == -1) tcp_server_close_client(server->tcp_server, client->tcp_client->sockfd, true);
+    else if (client->server_close_flag) tcp_server_close_client_flushed(server->tcp_server, client->tcp_client);
+};
+
+/** Serves the file which a path names in the directory of a static route. */
+static void _web_server_serve_static(struct web_server *server, struct web_client *client, struct web_server_route *route, struct http_request *request)
+{
+    /** The part of the path matched by the wildcard is looked up in the directory. */
+    size_t name_length = 0;
+    const char *name = http_request_get_param(request, "*", &name_length);
+    if (name == NULL) name = "";
+    size_t directory_length = strlen(route->static_directory);
+
+    /** Room for the separator, the name, a trailing `index.html` and the null terminator. */
+    char *file_path = malloc(directory_length + 1 + name_length + sizeof("index.html"));
+    memcpy(file_path, route->static_directory, directory_length);
+    file_path[directory_length] = '/';
+
+    char *cursor = file_path + directory_length + 1;
+    char *segment = cursor;
+    bool malformed = false;
+
+    for (size_t i = 0; i < name_length && !malformed; ++i)
+    {
+        char byte = name[i];
+        if (byte == '%')
+        {
+            if (i + 2 >= name_length || !isxdigit((unsigned char)name[i + 1]) || !isxdigit((unsigned char)name[i + 2]))
+            {
+                malformed = true;
+                break;
+            };
+
+            char hex[3] = {name[i + 1], name[i + 2], '\0'};
+            byte = (char)strtol(hex, NULL, 16);
+            i += 2;
+        };
+
+        /** A decoded name may not end early, or leave the directory through a `..` segment. */
+        malformed = byte == '\0' || byte == '\\' || (byte == '/' && cursor - segment == 2 && memcmp(segment, "..", 2) == 0);
+
+        *cursor++ = byte;
+        if (byte == '/') segment = cursor;
+    };
+
+    if (malformed || (cursor - segment == 2 && memcmp(segment, "..", 2) == 0))
+    {
+        free(file_path);
+
+        _web_server_send_canned(server, client, 400, "Bad Request");
+        return;
+    };
 
-    return (*path == '\0');
+    /** A directory is served by its index. */
+    if (cursor == segment) memcpy(cursor, "index.html", sizeof("index.html"));
+    else *cursor = '\0';
+
+    http_server_send_file(server, client, request, file_path);
+    free(file_path);
+};
+
+/** Arms the timer of a client for a deadline, or cancels it if the deadline is disabled. */
+static void _web_server_set_timeout(struct web_server *server, struct web_client *client, enum web_client_timeouts kind)
+{
+    size_t timeout = 0;
+
+    if (kind == WEB_CLIENT_TIMEOUT_HEADER) timeout = server->http_server_config.header_timeout ? server->http_server_config.header_timeout : 10000;
+    else if (kind == WEB_CLIENT_TIMEOUT_BODY) timeout = server->http_server_config.body_timeout ? server->http_server_config.body_timeout : 30000;
+    /** A connection which is closing gets as long to receive its last bytes as it would to stay idle. */
+    else if (kind == WEB_CLIENT_TIMEOUT_KEEP_ALIVE || kind == WEB_CLIENT_TIMEOUT_CLOSING) timeout = server->http_server_config.keep_alive_timeout ? server->http_server_config.keep_alive_timeout : 60000;
+    else if (kind == WEB_CLIENT_TIMEOUT_WS_IDLE) timeout = server->ws_server_config.idle_timeout;
+
+    client->timeout_kind = kind;
+
+    if (timeout == 0) timer_wheel_cancel(&server->tcp_server->timers, &client->timeout);
+    else timer_wheel_arm(&server->tcp_server->timers, &client->timeout, timeout);
+};
+
+/** 
+ * Moves the timer of a client to the deadline its connection is waiting for, after its bytes were handled.
+ * The deadline of a request is only armed when it starts, so a request which trickles in is not given more time with every byte.
+*/
+static void _web_server_update_timeout(struct web_server *server, struct web_client *client)
+{
+    if (client->tcp_client->closing)
+    {
+        if (client->timeout_kind != WEB_CLIENT_TIMEOUT_CLOSING) _web_server_set_timeout(server, client, WEB_CLIENT_TIMEOUT_CLOSING);
+        return;
+    };
+
+    if (client->connection_type == CONNECTION_WS)
+    {
+        _web_server_set_timeout(server, client, WEB_CLIENT_TIMEOUT_WS_IDLE);
+        return;
+    };
+
+    enum http_request_parsing_states state = client->http_server_parsing_state.parsing_state;
+    enum web_client_timeouts kind = state == REQUEST_PARSING_STATE_NIL ? WEB_CLIENT_TIMEOUT_KEEP_ALIVE : state == REQUEST_PARSING_STATE_HEAD ? WEB_CLIENT_TIMEOUT_HEADER : WEB_CLIENT_TIMEOUT_BODY;
+
+    if (kind != client->timeout_kind || kind == WEB_CLIENT_TIMEOUT_KEEP_ALIVE) _web_server_set_timeout(server, client, kind);
+};
+
+/** Closes a connection whose deadline passed. A request which was not received in time is reported as a timeout. */
+static void _web_server_on_timeout(struct wheel_timer *timer)
+{
+    struct web_client *client = timer->data;
+    struct tcp_client *tcp_client = client->tcp_client;
+    struct web_server *server = tcp_client->server->data;
+    socket_t sockfd = tcp_client->sockfd;
+    if (server->is_closing) return;
+
+    switch (client->timeout_kind)
+    {
+        case WEB_CLIENT_TIMEOUT_HEADER:
+        case WEB_CLIENT_TIMEOUT_BODY:
+        {
+            char *timeout_message = "HTTP/1.1 408 Request Timeout\r\n"
+                "Content-Type: text/plain\r\n"
+                "Content-Length: 15\r\n"
+                "Connection: close\r\n"
+                "\r\n"
+                "Request Timeout";
+
+            /** The response is queued behind whatever the connection is still receiving, and the connection is closed once it was sent. */
+            struct iovec iov = { .iov_base = timeout_message, .iov_len = strlen(timeout_message) };
+            ssize_t result = tcp_server_send_queued(server->tcp_server, tcp_client, &iov, 1);
+            if (server->on_http_malformed_request != NULL) server->on_http_malformed_request(server, client, REQUEST_PARSE_ERROR_TIMEOUT);
+
+            if (map_get(&server->clients, sockfd) != client) return;
+
+            if (result == -1) tcp_server_close_client(server->tcp_server, sockfd, true);
+            else if (tcp_server_close_client_flushed(server->tcp_server, tcp_client) == 0 && map_get(&server->clients, sockfd) == client) _web_server_update_timeout(server, client);
+
+            return;
+        };
+        case WEB_CLIENT_TIMEOUT_KEEP_ALIVE:
+        {
+            /** The connection is not idle while it is still receiving a response. */
+            if (socket_buffer_available(&tcp_client->send_buffer) > 0 || tcp_client->send_ranges.size > 0)
+            {
+                _web_server_set_timeout(server, client, WEB_CLIENT_TIMEOUT_KEEP_ALIVE);
+                return;
+            };
+
+            break;
+        };
+        case WEB_CLIENT_TIMEOUT_WS_IDLE:
+        {
+            ws_server_close_client(server, client, 1001, "Idle timeout.");
+            return;
+        };
+        /** A connection which does not receive its last bytes in time is closed without them. */
+        case WEB_CLIENT_TIMEOUT_CLOSING: break;
+        default: return;
+    };
+
+    if (map_get(&server->clients, sockfd) == client) tcp_server_close_client(server->tcp_server, sockfd, false);
 };
 
 static void _tcp_on_connect(struct tcp_server *server)
 {
     struct web_server *http_server = server->data;
 
-    struct web_client *client = calloc(1, sizeof(struct web_client));
-    client->tcp_client = malloc(sizeof(struct tcp_client));
-    client->server_close_flag = 0;
-    client->connection_type = CONNECTION_HTTP /** default */;
+    /** The backlog is drained up to the budget, as the listening socket is reported once for several connections. */
+    for (size_t i = 0; i < server->accept_budget && http_server->is_closing == 0; ++i)
+    {
+        struct web_server_connection *connection = slab_acquire(&http_server->connections);
+        if (connection == NULL)
+        {
+            /** Every slot is in use, so the connection is refused. It is still accepted, as the listening socket would keep being reported for it. */
+            struct tcp_client refused;
+            if (tcp_server_accept(server, &refused) != 0) return;
+
+            tcp_server_close_client(server, refused.sockfd, false);
+            continue;
+        };
 
-    tcp_server_accept(server, client->tcp_client);
+        struct web_client *client = &connection->client;
+        client->tcp_client = &connection->tcp_client;
+        client->server_close_flag = 0;
+        client->connection_type = CONNECTION_HTTP /** default */;
 
-    socket_t sockfd = client->tcp_client->sockfd;
+        if (tcp_server_accept(server, client->tcp_client) != 0)
+        {
+            slab_release(&http_server->connections, connection);
+            return;
+        };
+
+        socket_t sockfd = client->tcp_client->sockfd;
+
+        /** A client which cannot be looked up by its socket would never have its events handled, so it is refused. */
+        if (map_set(&http_server->clients, sockfd, client) != 0)
+        {
+            tcp_server_close_client(server, sockfd, true);
+            slab_release(&http_server->connections, connection);
+            continue;
+        };
 
-    map_set(&http_server->clients, sockfd, client);
+        /** A connection which never sends a request is closed like one which sends it too slowly. */
+        client->timeout.on_expire = _web_server_on_timeout;
+        client->timeout.data = client;
+        _web_server_set_timeout(http_server, client, WEB_CLIENT_TIMEOUT_HEADER);
 
-    if (http_server->on_connect != NULL)
-        http_server->on_connect(http_server, client);
+        if (http_server->on_connect != NULL)
+            http_server->on_connect(http_server, client);
+    };
 };
 
-static void _tcp_on_data(struct tcp_server *server, socket_t sockfd)
+/** Parses and dispatches one message from a client. Returns `0` if a message was dispatched. */
+static int _tcp_on_message(struct tcp_server *server, struct web_client *client)
 {
     struct web_server *web_server = server->data;
-    struct web_client *client = map_get(&web_server->clients, sockfd);
-    if (client == NULL) return;
 
     switch (client->connection_type)
     {
         case CONNECTION_WS:
         {
             struct ws_frame_parsing_state *ws_parsing_state = &client->ws_parsing_state;
-            struct web_server_route *route = web_server_find_route(web_server, client->path);
+            struct web_server_route *route = client->route;
 
-            if (route == NULL) return;
+            if (route == NULL) return 1;
 
             int result = 0;
 
-            if ((result = ws_parse_frame(client, ws_parsing_state, web_server->ws_server_config.max_payload_len ? web_server->ws_server_config.max_payload_len : 65536)) != 0)
+            if ((result = ws_parse_frame(client, ws_parsing_state, web_server->ws_server_config.max_payload_len ? web_server->ws_server_config.max_payload_len : 65536, route->on_ws_fragment != NULL)) != 0)
             {
+                /** A part of a streamed message was unmasked, and is handed out before the receive buffer moves on. */
+                if (result == 2)
+                {
+                    bool is_final = ws_parsing_state->fragment_is_final;
+                    route->on_ws_fragment(web_server, client, ws_parsing_state->fragment, ws_parsing_state->fragment_length, is_final);
+
+                    if (is_final) memset(ws_parsing_state, 0, sizeof(struct ws_frame_parsing_state));
+                    return 0;
+                };
+
                 if (result < 0)
                 {
                     /** TODO(Altanis): Fix one WS request partitioned into two causing two event calls. */
@@ -94,7 +512,7 @@ static void _tcp_on_data(struct tcp_server *server, socket_t sockfd)
                     ws_server_close_client(web_server, client, 1002, "Malformed frame.");
                 };
 
-                return;
+                return 1;
             };
 
             if (ws_parsing_state->message.opcode == WS_OPCODE_PING || ws_parsing_state->message.opcode == WS_OPCODE_PONG)
@@ -134,7 +552,14 @@ static void _tcp_on_data(struct tcp_server *server, socket_t sockfd)
                 
                 tcp_server_close_client(server, client->tcp_client->sockfd, false);
                 route->on_ws_close(web_server, client, close_code, message);
-            } else if (route->on_ws_message != NULL) route->on_ws_message(web_server, client, &ws_parsing_state->message);
+            }
+            else if (route->on_ws_fragment != NULL && (ws_parsing_state->message.opcode == WS_OPCODE_TEXT || ws_parsing_state->message.opcode == WS_OPCODE_BINARY))
+            {
+                /** A compressed message is only streamed once it is inflated, as one fragment without the terminator of text. */
+                size_t length = ws_parsing_state->message.payload_length - (ws_parsing_state->message.opcode == WS_OPCODE_TEXT ? 1 : 0);
+                route->on_ws_fragment(web_server, client, ws_parsing_state->message.buffer, length, true);
+            }
+            else if (route->on_ws_message != NULL) route->on_ws_message(web_server, client, &ws_parsing_state->message);
 
             free(ws_parsing_state->message.buffer);
             memset(ws_parsing_state, 0, sizeof(struct ws_frame_parsing_state));
@@ -154,94 +579,158 @@ static void _tcp_on_data(struct tcp_server *server, socket_t sockfd)
                     {
                         /** TODO(Altanis): Fix one HTTP request partitioned into two causing two event calls. */
                         web_server->on_http_malformed_request(web_server, client, result);
+                        tcp_server_uncork(server, client->tcp_client);
                         tcp_server_close_client(server, client->tcp_client->sockfd, true);
                     }
                 }
 
                 // > 0 means the http request is incomplete and waiting for incoming data
-                return;
+                return 1;
             };
 
-            char *path = strdup(sso_string_get(&client->http_server_parsing_state.request.path));
-            /** Check for query strings to parse. */
+            struct http_request *request = &client->http_server_parsing_state.request;
+            char *path = (char *)sso_string_get(&request->path);
+
+            /** Check for query strings to parse. The path and query are split in place, and the query borrows from the path. */
             char *query_string = strchr(path, '?');
             if (query_string != NULL)
             {
-                path[query_string - path] = '\0';
+                *query_string = '\0';
+
+                /** Every `&` starts another pair, so the query is allocated once with room for all of them. */
+                size_t query_capacity = 1;
+                for (const char *ampersand = query_string + 1; (ampersand = strchr(ampersand, '&')) != NULL; ++ampersand) ++query_capacity;
 
-                vector_init(&client->http_server_parsing_state.request.query, 8, sizeof(struct http_query));
+                request->query = (struct vector){ .capacity = query_capacity, .element_size = sizeof(struct http_query) };
+                request->query.elements = arena_alloc(request->arena, query_capacity * sizeof(struct http_query));
 
-                char *token = strtok(query_string + 1, "&");
-                while (token != NULL)
+                char *token = query_string + 1;
+                while (token != NULL && *token != '\0')
                 {
-                    struct http_query query = {0};
-                    sso_string_init(&query.key, "");
-                    sso_string_init(&query.value, "");
+                    char *next_token = strchr(token, '&');
+                    if (next_token != NULL) *next_token++ = '\0';
 
                     char *value = strchr(token, '=');
-                    if (value == NULL) break;
+                    if (value != NULL)
+                    {
+                        *value++ = '\0';
 
-                    *value = '\0';
+                        struct http_query query = {0};
+                        sso_string_init_view(&query.key, token, value - token - 1);
+                        sso_string_init_view(&query.value, value, strlen(value));
 
-                    sso_string_set(&query.key, token);
-                    sso_string_set(&query.value, value + 1);
+                        vector_push(&request->query, &query);
+                    };
 
-                    vector_push(&client->http_server_parsing_state.request.query, &query);
+                    token = next_token;
                 };
+
+                sso_string_init_view(&request->path, path, query_string - path);
+                path = (char *)sso_string_get(&request->path);
             };
 
-            struct web_server_route *route = web_server_find_route(web_server, path);
+            struct web_server_route *route = _web_server_match_route(web_server, path, request);
             if (route == NULL)
             {
-                // That comedian...
-                char *notfound_message = "HTTP/1.1 404 Not Found\r\n"
-                    "Content-Type: text/plain\r\n"
-                    "Content-Length: 9\r\n"
-                    "\r\n"
-                    "Not Found";
-
-                tcp_server_send(sockfd, (char *)notfound_message, strlen(notfound_message), 0);
-                
-                free(path);
-                http_request_free(&client->http_server_parsing_state.request);
-                memset(&client->http_server_parsing_state.request, 0, sizeof(client->http_server_parsing_state.request));
+                /** The request is freed first, as the client is freed if the connection is closed right away. */
+                http_request_free(request);
+                arena_reset(&client->request_arena);
+                memset(&client->http_server_parsing_state, 0, sizeof(client->http_server_parsing_state));
                 client->http_server_parsing_state.parsing_state = -1;
 
-                return;        
+                // That comedian...
+                _web_server_send_canned(web_server, client, 404, "Not Found");
+
+                return 0;
             };
 
-            if (client->http_server_parsing_state.request.upgrade_websocket == true)
+            if (request->upgrade_websocket == true)
             {
                 void (*handshake_request_cb)(struct web_server *server, struct web_client *client, struct http_request *request) = route->on_ws_handshake_request;
                 if (handshake_request_cb == NULL)
                 {
+                    /** A client which asked to upgrade expects no HTTP responses after this one. */
+                    client->server_close_flag = 1;
+
                     // That comedian...
-                    char *badrequest_message = "HTTP/1.1 400 Bad Request\r\n"
-                        "Content-Type: text/plain\r\n"
-                        "Content-Length: 38\r\n"
-                        "Connection: close\r\n"
-                        "\r\n"
-                        "Upgrade to WebSocket is not supported.";
-                    
-                    tcp_server_send(sockfd, (char *)badrequest_message, strlen(badrequest_message), 0);
-                };
+                    _web_server_send_canned(web_server, client, 400, "Upgrade to WebSocket is not supported.");
+                }
+                else handshake_request_cb(web_server, client, request);
 
-                handshake_request_cb(web_server, client, &client->http_server_parsing_state.request);
+                /** The route is kept for the frames after the upgrade, so they are not matched again. */
+                if (client->connection_type == CONNECTION_WS) client->route = route;
             }
+            else if (route->static_directory != NULL) _web_server_serve_static(web_server, client, route, request);
             else
             {
                 void (*callback)(struct web_server *server, struct web_client *client, struct http_request *request) = route->on_http_message;
-                if (callback != NULL) callback(web_server, client, &client->http_server_parsing_state.request);
+                if (callback != NULL) callback(web_server, client, request);
             };
 
-            free(path);
-            http_request_free(&client->http_server_parsing_state.request);
+            http_request_free(request);
+            arena_reset(&client->request_arena);
             memset(&client->http_server_parsing_state, 0, sizeof(client->http_server_parsing_state));
             client->http_server_parsing_state.parsing_state = -1;
 
             break;
         };
     };
+
+    return 0;
+};
+
+static void _tcp_on_data(struct tcp_server *server, socket_t sockfd)
+{
+    struct web_server *web_server = server->data;
+    if (web_server->is_closing) return;
+
+    struct web_client *client = map_get(&web_server->clients, sockfd);
+    if (client == NULL) return;
+
+    struct tcp_client *tcp_client = client->tcp_client;
+    struct socket_buffer *recv_buffer = &tcp_client->recv_buffer;
+
+    /** A connection which is closing does not handle anything it receives, which is read anyway so the socket is not reported again for it. */
+    if (tcp_client->closing)
+    {
+        do recv_buffer->offset = recv_buffer->size;
+        while (socket_buffer_fill(sockfd, recv_buffer) > 0);
+
+        return;
+    };
+
+    /** The responses to pipelined requests are held back while the requests are handled, and written together once they are. */
+    if (client->connection_type == CONNECTION_HTTP) tcp_server_cork(server, tcp_client);
+
+    /** 
+     * The socket will not become readable again for bytes which are already buffered, so every buffered message is handled now.
+     * An edge triggered socket will not become readable again for bytes which are not read yet either, so it is read until it would block.
+    */
+    do
+    {
+        while (
+            _tcp_on_message(server, client) == 0
+            && web_server->is_closing == 0
+            && map_get(&web_server->clients, sockfd) == client
+            && !tcp_client->closing
+            && socket_buffer_available(recv_buffer) > 0
+        )
+        {
+            /** Frames after an upgrade are not pipelined requests, so the handshake is written before they are handled. */
+            if (client->connection_type != CONNECTION_HTTP && tcp_client->corked) tcp_server_uncork(server, tcp_client);
+        };
+    } while (
+        server->edge_triggered
+        && web_server->is_closing == 0
+        && map_get(&web_server->clients, sockfd) == client
+        && !tcp_client->closing
+        && socket_buffer_fill(sockfd, recv_buffer) > 0
+    );
+
+    if (web_server->is_closing != 0 || map_get(&web_server->clients, sockfd) != client) return;
+
+    tcp_server_uncork(server, tcp_client);
+    _web_server_update_timeout(web_server, client);
 };
 
 static void _tcp_on_disconnect(struct tcp_server *server, socket_t sockfd, bool is_error)
@@ -252,11 +741,16 @@ static void _tcp_on_disconnect(struct tcp_server *server, socket_t sockfd, bool
     if (sockfd == server->sockfd && web_server->on_disconnect != NULL)
         return web_server->on_disconnect(web_server, sockfd, is_error);
 
-    if (web_server->clients.entries == NULL) return;
+    if (web_server->clients.values == NULL) return;
 
     struct web_client *web_client = map_get(&web_server->clients, sockfd);
     if (web_client == NULL) return;
 
+    timer_wheel_cancel(&server->timers, &web_client->timeout);
+
+    /** The socket is already closed, so nothing published from the callbacks below may be sent to it. */
+    ws_topics_unsubscribe_all(&web_server->topics, web_client);
+
     if (web_client->connection_type == CONNECTION_HTTP)
     {
         if (web_server->on_disconnect != NULL)
@@ -264,7 +758,7 @@ static void _tcp_on_disconnect(struct tcp_server *server, socket_t sockfd, bool
     }
     else if (web_client->connection_type == CONNECTION_WS && web_client->path != NULL)
     {
-        struct web_server_route *route = web_server_find_route(web_server, web_client->path);
+        struct web_server_route *route = web_client->route;
         if (route != NULL && route->on_ws_close != NULL)
             route->on_ws_close(web_server, web_client, 0, NULL);
 
@@ -276,27 +770,95 @@ static void _tcp_on_disconnect(struct tcp_server *server, socket_t sockfd, bool
 
     if (web_server->is_closing == 1) return;
     
-    free(web_client->tcp_client->sockaddr);
-    free(web_client->tcp_client);
+    arena_free(&web_client->request_arena);
+    ws_deflate_free(web_client->deflate);
+    web_client->deflate = NULL;
+    vector_free(&web_client->send_scratch);
     map_delete(&web_server->clients, sockfd);
+
+    /** The slot keeps its contents until another connection is accepted, so the client can still be compared against after it is closed. */
+    slab_release(&web_server->connections, web_client);
 };
 
-int web_server_init(struct web_server *http_server, struct sockaddr *address, int backlog)
+static void _tcp_on_drain(struct tcp_server *server, socket_t sockfd)
 {
-    vector_init(&http_server->routes, 8, sizeof(struct web_server_route));
-    map_init(&http_server->clients, 8);
+    struct web_server *web_server = server->data;
+    if (web_server->on_drain == NULL) return;
+
+    struct web_client *client = map_get(&web_server->clients, sockfd);
+    if (client != NULL) web_server->on_drain(web_server, client);
+};
+
+/** Stops the loop of a server which is closing, so it frees the server once it returns. */
+static void _tcp_on_wake(struct tcp_server *server)
+{
+    struct web_server *web_server = server->data;
+    if (__atomic_load_n(&web_server->is_closing, __ATOMIC_ACQUIRE)) server->listening = 0;
+};
 
-    struct tcp_server *tcp_server = malloc(sizeof(struct tcp_server));
-    tcp_server->data = http_server;
+/** Creates, binds and starts listening on the TCP server of a web server. */
+static int _web_server_listen(struct web_server *server, struct sockaddr *address, int backlog)
+{
+    struct tcp_server *tcp_server = calloc(1, sizeof(struct tcp_server));
+    if (tcp_server == NULL) return -1;
+    tcp_server->data = server;
     
-    int init_result = tcp_server_init(tcp_server, address, 1);
-    if (init_result != 0) return init_result;
+    int init_result = tcp_server_init_backend(tcp_server, address, 1, server->backend);
+    if (init_result != 0)
+    {
+        /** The state of the TCP server is only allocated once it has a socket. */
+        if (tcp_server->sockfd != -1) tcp_server_close_self(tcp_server);
+        free(tcp_server);
+        return init_result;
+    };
 
     if (setsockopt(tcp_server->sockfd, SOL_SOCKET, SO_REUSEADDR, &(char){1}, sizeof(int)) < 0)
     {
         /** Not essential. Do not return -1. */
     };
 
+#ifdef SO_REUSEPORT
+    /** Lets every worker listen on its own socket for the same address. */
+    if (setsockopt(tcp_server->sockfd, SOL_SOCKET, SO_REUSEPORT, &(int){1}, sizeof(int)) < 0)
+    {
+        /** Not essential. Do not return -1. */
+    };
+#endif
+
+    /** A socket which could not listen is closed, so the caller is left with nothing to free. */
+    int result = tcp_server_bind(tcp_server);
+    if (result == 0) result = tcp_server_listen(tcp_server, backlog);
+    if (result != 0)
+    {
+        tcp_server_close_self(tcp_server);
+        free(tcp_server);
+        return result;
+    };
+
+    tcp_server->on_connect = _tcp_on_connect;
+    tcp_server->on_data = _tcp_on_data;
+    tcp_server->on_disconnect = _tcp_on_disconnect;
+    tcp_server->on_drain = _tcp_on_drain;
+    tcp_server->on_wake = _tcp_on_wake;
+
+    server->tcp_server = tcp_server;
+
+    return 0;
+};
+
+int web_server_init(struct web_server *http_server, struct sockaddr *address, int backlog)
+{
+    return web_server_init_backend(http_server, address, backlog, TCP_SERVER_BACKEND_POLL);
+};
+
+int web_server_init_backend(struct web_server *http_server, struct sockaddr *address, int backlog, enum tcp_server_backend backend)
+{
+    vector_init(&http_server->routes, 8, sizeof(struct web_server_route *));
+    http_server->route_tree = NULL;
+    map_init(&http_server->clients, 8);
+    memset(&http_server->connections, 0, sizeof(http_server->connections));
+    http_server->max_connections = 0;
+
     /** TODO(Altanis): These may overwrite config changes from before web_server_init() was called. */
     http_server->ws_server_config.record_latency = false;
     http_server->http_server_config.max_body_len = 0;
@@ -306,73 +868,203 @@ int web_server_init(struct web_server *http_server, struct sockaddr *address, in
     http_server->http_server_config.max_method_len = 0;
     http_server->http_server_config.max_path_len = 0;
     http_server->http_server_config.max_version_len = 0;
+    http_server->http_server_config.max_open_files = 0;
+    http_server->http_server_config.header_timeout = 0;
+    http_server->http_server_config.body_timeout = 0;
+    http_server->http_server_config.keep_alive_timeout = 0;
     http_server->ws_server_config.max_payload_len = 0;
+    http_server->ws_server_config.idle_timeout = 0;
+    memset(&http_server->ws_server_config.permessage_deflate, 0, sizeof(http_server->ws_server_config.permessage_deflate));
     http_server->is_closing = 0;
+    http_server->loop_state = WEB_SERVER_LOOP_IDLE;
+    memset(&http_server->file_cache, 0, sizeof(http_server->file_cache));
+    ws_topics_init(&http_server->topics);
+    http_server->shared_deflate_stream = NULL;
+
+    http_server->backlog = backlog;
+    http_server->backend = backend;
+    http_server->workers = NULL;
+    http_server->worker_count = 0;
+    http_server->parent = NULL;
+
+    return _web_server_listen(http_server, address, backlog);
+};
 
-    int bind_result = tcp_server_bind(tcp_server);
-    if (bind_result != 0) return bind_result;
+static int _web_server_free(struct web_server *server);
+static int _web_server_close(struct web_server *server);
 
-    int listen_result = tcp_server_listen(tcp_server, backlog);
-    if (listen_result != 0) return listen_result;
+int web_server_start(struct web_server *server)
+{
+    int state = WEB_SERVER_LOOP_IDLE;
+    if (!__atomic_compare_exchange_n(&server->loop_state, &state, WEB_SERVER_LOOP_RUNNING, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return -1;
 
-    tcp_server->on_connect = _tcp_on_connect;
-    tcp_server->on_data = _tcp_on_data;
-    tcp_server->on_disconnect = _tcp_on_disconnect;
+    /** The slots are allocated by the thread which runs the loop, so a worker's clients live in memory local to it. */
+    int result = -1;
+    if (server->connections.slots != NULL || slab_init(&server->connections, sizeof(struct web_server_connection), server->max_connections ? server->max_connections : 1024) == 0)
+        result = tcp_server_main_loop(server->tcp_server);
 
-    http_server->tcp_server = tcp_server;
+    /** A thread which is still waking the loop uses the TCP server, so it is waited for before the server is freed. */
+    state = WEB_SERVER_LOOP_RUNNING;
+    if (!__atomic_compare_exchange_n(&server->loop_state, &state, WEB_SERVER_LOOP_STOPPED, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        while (__atomic_load_n(&server->loop_state, __ATOMIC_ACQUIRE) == WEB_SERVER_LOOP_WAKING) sched_yield();
+    };
 
-    return 0;
+    _web_server_free(server);
+    return result;
 };
 
-int web_server_start(struct web_server *server)
+#ifdef SO_REUSEPORT
+static void *_web_server_worker_main(void *arg)
 {
-    return tcp_server_main_loop(server->tcp_server);
+    web_server_start(arg);
+    return NULL;
 };
+#endif
 
-void web_server_create_route(struct web_server *server, struct web_server_route *route)
+int web_server_start_workers(struct web_server *server, size_t num_workers)
 {
-    vector_push(&server->routes, route);
-};
+#ifdef SO_REUSEPORT
+    if (num_workers <= 1) return web_server_start(server);
 
-struct web_server_route *web_server_find_route(struct web_server *server, const char *path)
-{
-    if (path == NULL) return NULL;
+    server->worker_count = num_workers - 1;
+    server->workers = calloc(server->worker_count, sizeof(struct web_server));
+    if (server->workers == NULL) return -1;
 
-    for (size_t i = 0; i < server->routes.size; ++i)
+    /** Every worker copies the callbacks, configuration and routes of the server, but has its own socket, event loop and clients. */
+    for (size_t i = 0; i < server->worker_count; ++i)
     {
-        struct web_server_route *route = vector_get(&server->routes, i);
-        if (_path_matches(path, route->path))
-            return route;
+        struct web_server *worker = &server->workers[i];
+        *worker = *server;
+        worker->workers = NULL;
+        worker->worker_count = 0;
+        worker->parent = server;
+        map_init(&worker->clients, 8);
+        memset(&worker->connections, 0, sizeof(worker->connections));
+        memset(&worker->file_cache, 0, sizeof(worker->file_cache));
+        ws_topics_init(&worker->topics);
+        worker->shared_deflate_stream = NULL;
+
+        int listen_result = _web_server_listen(worker, server->tcp_server->address, server->backlog);
+        if (listen_result != 0)
+        {
+            /** The workers which are listening never started, so closing them frees them. The server itself is left to the caller. */
+            for (size_t j = 0; j < i; ++j)
+                _web_server_close(&server->workers[j]);
+
+            map_free(&worker->clients, false);
+            ws_topics_free(&worker->topics);
+            free(server->workers);
+            server->workers = NULL;
+            server->worker_count = 0;
+
+            return listen_result;
+        };
+
+        worker->tcp_server->send_high_watermark = server->tcp_server->send_high_watermark;
+        worker->tcp_server->send_low_watermark = server->tcp_server->send_low_watermark;
+        worker->tcp_server->max_events = server->tcp_server->max_events;
+        worker->tcp_server->edge_triggered = server->tcp_server->edge_triggered;
+        worker->tcp_server->accept_budget = server->tcp_server->accept_budget;
+        worker->tcp_server->zerocopy_threshold = server->tcp_server->zerocopy_threshold;
     };
 
-    return NULL;
+    pthread_t threads[server->worker_count];
+    for (size_t i = 0; i < server->worker_count; ++i)
+    {
+        if (pthread_create(&threads[i], NULL, _web_server_worker_main, &server->workers[i]) != 0)
+        {
+            /** Sockets without a thread would still be handed connections, so they are closed. */
+            for (size_t j = i; j < server->worker_count; ++j)
+                _web_server_close(&server->workers[j]);
+
+            server->worker_count = i;
+            break;
+        };
+    };
+
+    int result = web_server_start(server);
+
+    /** The loop of this server may have stopped without being closed, so the workers are closed too. Each of them frees itself on its own thread. */
+    size_t worker_count = server->worker_count;
+    struct web_server *workers = server->workers;
+    server->workers = NULL;
+    server->worker_count = 0;
+
+    for (size_t i = 0; i < worker_count; ++i)
+        _web_server_close(&workers[i]);
+
+    for (size_t i = 0; i < worker_count; ++i)
+        pthread_join(threads[i], NULL);
+
+    free(workers);
+
+    return result;
+#else
+    /** Without SO_REUSEPORT, the kernel cannot spread connections between several listening sockets. */
+    return web_server_start(server);
+#endif
+};
+
+void web_server_create_route(struct web_server *server, struct web_server_route *route)
+{
+    struct web_server_route *copy = malloc(sizeof(struct web_server_route));
+    *copy = *route;
+    vector_push(&server->routes, &copy);
+
+    if (server->route_tree == NULL) server->route_tree = _web_server_route_node_create(NULL, 0);
+    _web_server_route_tree_insert(server->route_tree, copy);
+};
+
+struct web_server_route *web_server_find_route(struct web_server *server, const char *path)
+{
+    return _web_server_match_route(server, path, NULL);
 };
 
 void web_server_remove_route(struct web_server *server, const char *path)
 {
     for (size_t i = 0; i < server->routes.size; ++i)
     {
-        struct web_server_route *route = vector_get(&server->routes, i);
-        if (strcmp(route->path, path) == 0)
+        struct web_server_route *route = *(struct web_server_route **)vector_get(&server->routes, i);
+        if (strcmp(route->path, path) != 0) continue;
+
+        /** Clients which upgraded on the route are no longer dispatched to it. */
+        for (size_t j = 0; j < server->clients.capacity; ++j)
         {
-            vector_delete(&server->routes, i);
-            break;
+            struct web_client *client = server->clients.values[j];
+            if (client != NULL && client->route == route) client->route = NULL;
+        };
+
+        vector_delete(&server->routes, i);
+        free(route);
+
+        /** The tree is compiled again from the remaining routes, as nodes may be shared by several of them. */
+        _web_server_route_node_free(server->route_tree);
+        server->route_tree = NULL;
+
+        for (size_t j = 0; j < server->routes.size; ++j)
+        {
+            if (server->route_tree == NULL) server->route_tree = _web_server_route_node_create(NULL, 0);
+            _web_server_route_tree_insert(server->route_tree, *(struct web_server_route **)vector_get(&server->routes, j));
         };
+
+        break;
     };
 };
 
-int web_server_close(struct web_server *server)
+/** Closes the clients and the socket of a server and frees its state, on the thread which ran its loop. The routes are left, as the workers share them. */
+static int _web_server_free(struct web_server *server)
 {
     server->is_closing = 1;
     server->on_disconnect = NULL;
 
     for (size_t i = 0; i < server->clients.capacity; ++i)
     {
-        struct map_entry entry = server->clients.entries[i];
-        if (entry.value == NULL) continue;
-        struct web_client *client = entry.value;
+        struct web_client *client = server->clients.values[i];
+        if (client == NULL) continue;
 
-        if (client == NULL) continue;        
+        /** A response which was held back while the server was closed from a callback is still written, if the socket takes it. */
+        if (client->tcp_client->corked) tcp_server_uncork(server->tcp_server, client->tcp_client);
 
         if (client->connection_type == CONNECTION_WS)
         {
@@ -395,12 +1087,69 @@ int web_server_close(struct web_server *server)
 #endif
         };
 
+        /** Files and buffers which are still queued are released, so the file cache can close them and their owners can free them. */
+        for (size_t j = 0; j < client->tcp_client->send_ranges.size; ++j)
+        {
+            struct tcp_queued_range *range = vector_get(&client->tcp_client->send_ranges, j);
+            if (range->on_sent != NULL) range->on_sent(range->data);
+        };
+
+        for (size_t j = 0; j < client->tcp_client->zerocopy_releases.size; ++j)
+        {
+            struct tcp_zerocopy_release *release = vector_get(&client->tcp_client->zerocopy_releases, j);
+            if (release->on_sent != NULL) release->on_sent(release->data);
+        };
+
         free(client->path);
-        free(client->tcp_client->sockaddr);
-        free(client->tcp_client);
-        free(client);
+        socket_buffer_free(&client->tcp_client->recv_buffer);
+        socket_buffer_free(&client->tcp_client->send_buffer);
+        vector_free(&client->tcp_client->send_ranges);
+        vector_free(&client->tcp_client->zerocopy_releases);
+        arena_free(&client->request_arena);
+        vector_free(&client->subscriptions);
+        ws_deflate_free(client->deflate);
+        client->deflate = NULL;
+        vector_free(&client->send_scratch);
     };
 
     map_free(&server->clients, false);
-    return tcp_server_close_self(server->tcp_server);
+    slab_free(&server->connections);
+    http_file_cache_free(&server->file_cache);
+    ws_topics_free(&server->topics);
+    ws_deflate_free_shared(&server->shared_deflate_stream);
+
+    int result = tcp_server_close_self(server->tcp_server);
+    free(server->tcp_server);
+    server->tcp_server = NULL;
+
+    return result;
+};
+
+/** Closes a server and the workers it started, without closing the server a worker was started from. */
+static int _web_server_close(struct web_server *server)
+{
+    __atomic_store_n(&server->is_closing, 1, __ATOMIC_RELEASE);
+
+    /** Only one thread wins the loop state, so the server is freed or woken once however many threads close it. */
+    int state = WEB_SERVER_LOOP_IDLE;
+    bool idle = __atomic_compare_exchange_n(&server->loop_state, &state, WEB_SERVER_LOOP_STOPPED, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    if (!idle && (state != WEB_SERVER_LOOP_RUNNING || !__atomic_compare_exchange_n(&server->loop_state, &state, WEB_SERVER_LOOP_WAKING, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))) return 0;
+
+    /** The workers are only woken, as each of them frees itself on its own thread before the loop of this server joins it. */
+    for (size_t i = 0; i < server->worker_count; ++i)
+        _web_server_close(&server->workers[i]);
+
+    if (idle) return _web_server_free(server);
+
+    /** The loop frees the server once it sees the wakeup, which it may already be handling, so the server is not touched after this. */
+    int result = tcp_server_wake(server->tcp_server);
+    __atomic_store_n(&server->loop_state, WEB_SERVER_LOOP_STOPPED, __ATOMIC_RELEASE);
+
+    return result;
+};
+
+int web_server_close(struct web_server *server)
+{
+    /** A callback is handed the worker which owns the client, but closing it closes every worker. */
+    return _web_server_close(server->parent != NULL ? server->parent : server);
 };
\ No newline at end of file
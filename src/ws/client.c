@@ -21,17 +21,21 @@ int ws_client_connect(struct web_client *client, const char *hostname, const cha
     char websocket_key[((4 * sizeof(rand_bytes) / 3) + 3) & ~3];
     http_base64_encode(rand_bytes, sizeof(rand_bytes), websocket_key);
 
-    char *headers[5][2] =
+    char extensions[128];
+    if (client->ws_client_config.permessage_deflate.enabled) ws_deflate_format_offer(&client->ws_client_config.permessage_deflate, extensions, sizeof(extensions));
+
+    char *headers[6][2] =
     {
         {"Host", hostname},
         {"Connection", "Upgrade"},
         {"Upgrade", "websocket"},
         {"Sec-WebSocket-Version", "13"},
-        {"Sec-WebSocket-Key", websocket_key}
+        {"Sec-WebSocket-Key", websocket_key},
+        {"Sec-WebSocket-Extensions", extensions}
     };
 
     struct http_request request;
-    http_request_build(&request, "GET", path, "HTTP/1.1", headers, 5);
+    http_request_build(&request, "GET", path, "HTTP/1.1", headers, client->ws_client_config.permessage_deflate.enabled ? 6 : 5);
 
     int result = 0;
     if ((result = http_client_send_request(client, &request, NULL, 0)) < 1) return result;
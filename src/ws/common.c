@@ -6,15 +6,11 @@
 #include <time.h>
 #include <openssl/sha.h>
 
-#if __has_include(<endian.h>)
-    #include <endian.h>
-#elif __has_include(<machine/endian.h>)
-    #include <machine/endian.h>
-#endif
-
 #include "../../include/web/server.h"
 #include "../../include/ws/server.h"
 #include "../../include/tcp/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/simd.h"
 
 static __thread int seed = 0;
 
@@ -33,312 +29,316 @@ void ws_build_message(struct ws_message *message, uint8_t opcode, uint64_t paylo
     message->buffer = payload_data;
 };
 
-int ws_send_message(struct web_client *client, struct ws_message *message, uint8_t masking_key[4], size_t num_frames)
+size_t ws_build_frame_header(uint8_t header[10], uint8_t opcode, uint64_t payload_length)
 {
-    socket_t sockfd = client->tcp_client->sockfd;
+    header[0] = 0x80 | opcode;
 
-    bool mask = masking_key != NULL;
+    if (payload_length <= 125)
+    {
+        header[1] = payload_length;
+        return 2;
+    }
+    else if (payload_length <= 0xFFFF)
+    {
+        header[1] = 126;
+        header[2] = (payload_length >> 8) & 0xFF;
+        header[3] = payload_length & 0xFF;
+        return 4;
+    };
 
-    uint64_t frame_sizes[num_frames];
-    uint64_t remainder = message->payload_length % num_frames;
-    uint64_t split_payload_len = message->payload_length / num_frames;
+    header[1] = 127;
+    for (int i = 0; i < 8; ++i) header[2 + i] = (payload_length >> (8 * (7 - i))) & 0xFF;
+    return 10;
+};
 
-    for (size_t i = 0; i < num_frames; ++i)
+/** Grows a scratch buffer of a connection to hold at least `length` bytes. Its memory is kept for the next message. Returns `-1` if it could not grow. */
+static int _ws_reserve_scratch(struct vector *scratch, size_t length)
+{
+    if (scratch->elements == NULL)
     {
-        frame_sizes[i] = i == num_frames - 1 ? split_payload_len + remainder : split_payload_len;
+        vector_init(scratch, length < WS_SEND_SCRATCH_INITIAL_CAPACITY ? WS_SEND_SCRATCH_INITIAL_CAPACITY : length, sizeof(uint8_t));
+        return scratch->elements == NULL ? -1 : 0;
     };
 
-    size_t num_bytes_passed = 0;
+    if (scratch->capacity < length) vector_resize(scratch, length);
+    return scratch->capacity < length ? -1 : 0;
+};
 
-    for (size_t i = 0; i < num_frames; ++i)
+int ws_send_message(struct web_client *client, struct ws_message *message, uint8_t masking_key[4], size_t num_frames)
+{
+    if (num_frames == 0) num_frames = 1;
+
+    struct vector *scratch = &client->send_scratch;
+    const uint8_t *payload = message->buffer;
+    uint64_t payload_length = message->payload_length;
+
+    /** A data message is compressed as a whole, and only its first frame tells so. Control frames are never compressed. */
+    bool is_compressed = false;
+    if (client->deflate != NULL && (message->opcode == WS_OPCODE_TEXT || message->opcode == WS_OPCODE_BINARY) && payload_length >= client->deflate->threshold)
     {
-        uint8_t header = 0;
-        header |= (((i + 1 == num_frames) ? 1 : 0) << 7);
-        header |= (0 << 6);
-        header |= (0 << 5);
-        header |= (0 << 4);
-        header |= i == 0 ? message->opcode : WS_OPCODE_CONTINUE;
-
-        uint64_t frame_payload_length = frame_sizes[i];
-        uint8_t payload_encoded = (frame_payload_length <= 125 ? frame_payload_length : (frame_payload_length <= 0xFFFF ? 126 : 127));
-
-        uint8_t payload_length = 0;
-        payload_length |= (mask << 7);
-        payload_length |= payload_encoded;
-
-        // TODO(Altanis): Ensure endianness.
-        uint8_t payload_length_encoded[8] = {0};
-        if (payload_encoded == 126)
-        {
-            payload_length_encoded[0] = (frame_payload_length >> 8) & 0xFF;
-            payload_length_encoded[1] = frame_payload_length & 0xFF;
-        } 
-        else if (payload_encoded == 127)
+        if (ws_deflate_compress(client->deflate, payload, payload_length, scratch) != 0) return -1;
+
+        payload = scratch->elements;
+        payload_length = scratch->size;
+        is_compressed = true;
+    };
+
+    uint64_t split_payload_len = payload_length / num_frames;
+    uint64_t remainder = payload_length % num_frames;
+
+    /** Every frame is masked from the start of the key, into the scratch of the connection so the message is left as it is. A compressed payload already is in it, and is masked in place. */
+    if (masking_key != NULL && payload_length != 0)
+    {
+        if (!is_compressed && _ws_reserve_scratch(scratch, payload_length) != 0) return -1;
+
+        uint8_t *masked = scratch->elements;
+        for (size_t i = 0; i < num_frames; ++i)
         {
-            for (int i = 0; i < 8; ++i)
-            {
-                payload_length_encoded[i] = (frame_payload_length >> (8 * (7 - i))) & 0xFF;
-            };
+            uint64_t offset = i * split_payload_len;
+            simd_mask(masked + offset, payload + offset, i + 1 == num_frames ? split_payload_len + remainder : split_payload_len, masking_key, 0);
         };
 
-        uint8_t *payload_masking_key = NULL;
-        char *payload_data_encoded = NULL;
+        payload = masked;
+    };
 
-        if (message->payload_length != 0)
-        {
-            payload_masking_key = mask ? (uint8_t *)masking_key : NULL;
-            payload_data_encoded = (char *)message->buffer;
-            
-            if (payload_masking_key != NULL)
-            {
-                if (message->opcode == WS_OPCODE_TEXT)
-                {
-                    payload_data_encoded = strdup((char *)message->buffer);
-                }
-                else
-                {
-                    payload_data_encoded = malloc(payload_length);
-                    memcpy((void *)payload_data_encoded, message->buffer, frame_payload_length);
-                }
+    /** The headers are written into a small array, and sent with the payload (straight from where it is) a batch of frames at a time. */
+    struct iovec iov[WS_SEND_BATCH * 2];
+    uint8_t headers[WS_SEND_BATCH][14];
+    int iovcnt = 0;
+    size_t batched = 0;
+    uint64_t offset = 0;
 
-                for (size_t i = 0; i < frame_payload_length; ++i)
-                {
-                    ((uint8_t *)payload_data_encoded)[i] ^= payload_masking_key[i % 4];
-                };
-            };
+    for (size_t i = 0; i < num_frames; ++i)
+    {
+        uint64_t frame_payload_length = i + 1 == num_frames ? split_payload_len + remainder : split_payload_len;
+
+        uint8_t *header = headers[batched++];
+        size_t header_length = ws_build_frame_header(header, i == 0 ? message->opcode : WS_OPCODE_CONTINUE, frame_payload_length);
+        if (i + 1 != num_frames) header[0] &= ~0x80; // FIN
+        if (i == 0 && is_compressed) header[0] |= 0x40; // RSV1
+
+        if (masking_key != NULL)
+        {
+            header[1] |= 0x80;
+            memcpy(header + header_length, masking_key, 4);
+            header_length += 4;
         };
 
+        iov[iovcnt++] = (struct iovec){ .iov_base = header, .iov_len = header_length };
+        if (frame_payload_length != 0) iov[iovcnt++] = (struct iovec){ .iov_base = (void *)(payload + offset), .iov_len = frame_payload_length };
+        offset += frame_payload_length;
+
+        if (batched < WS_SEND_BATCH && i + 1 != num_frames) continue;
+
         ssize_t result = 0;
-        char frame_data[sizeof(header) + sizeof(payload_length) + (payload_encoded == 126 ? 2 : (payload_encoded == 127 ? 8 : 0)) + (payload_masking_key != NULL ? 4 : 0) + frame_payload_length];
+        if (client->tcp_client->server != NULL) result = tcp_server_send_queued(client->tcp_client->server, client->tcp_client, iov, iovcnt);
+        else result = tcp_client_sendv(client->tcp_client, iov, iovcnt, 0);
 
-        memcpy(frame_data, &header, sizeof(header));
-        memcpy(frame_data + sizeof(header), &payload_length, sizeof(payload_length));
+        if (result <= 0) return result;
 
-        if (payload_encoded == 126) memcpy(frame_data + sizeof(header) + sizeof(payload_length), payload_length_encoded, 2);
-        else if (payload_encoded == 127) memcpy(frame_data + sizeof(header) + sizeof(payload_length), payload_length_encoded, 8);
-        if (payload_masking_key != NULL) memcpy(frame_data + sizeof(header) + sizeof(payload_length) + (payload_encoded == 126 ? 2 : (payload_encoded == 127 ? 8 : 0)), payload_masking_key, 4);
-        
-        if (payload_data_encoded != NULL)
-        {
-            memcpy(frame_data + sizeof(header) + sizeof(payload_length) + (payload_encoded == 126 ? 2 : (payload_encoded == 127 ? 8 : 0)) + (payload_masking_key != NULL ? 4 : 0), payload_data_encoded + num_bytes_passed, frame_payload_length);
-            num_bytes_passed += frame_payload_length;
-        };
+        iovcnt = 0;
+        batched = 0;
+    };
+
+    return 1;
+};
+
+int ws_send_message_zerocopy(struct web_client *client, struct ws_message *message, void (*on_sent)(void *data), void *data)
+{
+    /** Clients mask their payloads, which needs a copy anyway. */
+    if (client->tcp_client->server == NULL)
+    {
+        int result = ws_send_message(client, message, NULL, 1);
+        if (on_sent != NULL) on_sent(data);
 
-        if (payload_masking_key != NULL) free((void *)payload_data_encoded);
-        if ((result = tcp_server_send(sockfd, frame_data, sizeof(frame_data), 0)) <= 0) return result;
+        return result;
     };
 
+    uint64_t payload_length = message->payload_length;
+    uint8_t header[10];
+    size_t header_length = ws_build_frame_header(header, message->opcode, payload_length);
+
+    struct iovec iov = { .iov_base = header, .iov_len = header_length };
+    if (tcp_server_send_zerocopy(client->tcp_client->server, client->tcp_client, &iov, 1, (const char *)message->buffer, payload_length, on_sent, data) <= 0) return -1;
+
     return 1;
 };
 
-int ws_parse_frame(struct web_client *client, struct ws_frame_parsing_state *current_state, size_t MAX_PAYLOAD_LENGTH)
+/** Receives until `length` bytes are buffered. Returns `0` once they are, `1` if more bytes have to arrive first, or a parse error. */
+static int _ws_require(socket_t sockfd, struct socket_buffer *recv_buffer, size_t length)
+{
+    if (socket_buffer_require(sockfd, recv_buffer, length) > 0) return 0;
+
+    if (errno == EWOULDBLOCK) return 1;
+    else return WS_FRAME_PARSE_ERROR_RECV;
+};
+
+int ws_parse_frame(struct web_client *client, struct ws_frame_parsing_state *current_state, size_t MAX_PAYLOAD_LENGTH, bool stream)
 {
     socket_t sockfd = client->tcp_client->sockfd;
+    struct socket_buffer *recv_buffer = &client->tcp_client->recv_buffer;
 
 parse_start:
     switch (current_state->parsing_state)
     {
         case WS_FRAME_NIL:
         {
-            current_state->parsing_state = WS_FRAME_PARSING_STATE_FIRST_BYTE;
+            current_state->parsing_state = WS_FRAME_PARSING_STATE_HEADER;
             goto parse_start;
         };
-        case WS_FRAME_PARSING_STATE_FIRST_BYTE:
+        case WS_FRAME_PARSING_STATE_HEADER:
         {
-            uint8_t byte;
-            ssize_t byte_received = recv(sockfd, &byte, 1, 0);
-
-            if (byte_received <= 0)
+            /** The second byte tells how long the rest of the header is, which is then decoded straight from the buffer. */
+            int result = _ws_require(sockfd, recv_buffer, 2);
+            if (result != 0) return result;
+
+            uint8_t second_byte = (uint8_t)recv_buffer->data[recv_buffer->offset + 1];
+            uint8_t payload_length_code = second_byte & 0b01111111;
+            bool mask = second_byte >> 7;
+            size_t header_length = 2 + (payload_length_code == 126 ? 2 : (payload_length_code == 127 ? 8 : 0)) + (mask ? 4 : 0);
+
+            if ((result = _ws_require(sockfd, recv_buffer, header_length)) != 0) return result;
+
+            const uint8_t *header = (const uint8_t *)recv_buffer->data + recv_buffer->offset;
+            recv_buffer->offset += header_length;
+
+            current_state->frame.header.fin = (header[0] & 0b10000000) >> 7;
+            current_state->frame.header.rsv1 = (header[0] & 0b01000000) >> 6;
+            current_state->frame.header.rsv2 = (header[0] & 0b00100000) >> 5;
+            current_state->frame.header.rsv3 = (header[0] & 0b00010000) >> 4;
+            current_state->frame.header.opcode = header[0] & 0b00001111;
+            current_state->frame.mask = mask;
+            current_state->frame.payload_length = payload_length_code;
+
+            /** The extended payload length is in network byte order. */
+            const uint8_t *cursor = header + 2;
+            uint64_t payload_length = payload_length_code;
+            if (payload_length_code >= 126)
             {
-                if (errno == EWOULDBLOCK) return 1;
-                else return WS_FRAME_PARSE_ERROR_RECV;
+                size_t length_bytes = payload_length_code == 126 ? 2 : 8;
+                payload_length = 0;
+
+                for (size_t i = 0; i < length_bytes; ++i) payload_length = payload_length << 8 | cursor[i];
+                cursor += length_bytes;
             };
 
-            current_state->frame.header.fin = (byte & 0b10000000) >> 7;
-            current_state->frame.header.rsv1 = (byte & 0b01000000) >> 6;
-            current_state->frame.header.rsv2 = (byte & 0b00100000) >> 5;
-            current_state->frame.header.rsv3 = (byte & 0b00010000) >> 4;
-            current_state->frame.header.opcode = byte & 0b00001111;
+            if (mask) memcpy(current_state->frame.masking_key, cursor, 4);
+
+            /** Only the first frame of a data message may be compressed, and only with permessage-deflate negotiated. */
+            if (current_state->frame.header.rsv1 && (client->deflate == NULL || current_state->frame.header.opcode == WS_OPCODE_CONTINUE || current_state->frame.header.opcode >= WS_OPCODE_CLOSE))
+                return WS_FRAME_PARSE_ERROR_INVALID_COMPRESSION;
 
             if (current_state->frame.header.opcode != WS_OPCODE_CONTINUE)
+            {
                 current_state->message.opcode = current_state->frame.header.opcode;
+                if (current_state->frame.header.opcode < WS_OPCODE_CLOSE) current_state->compressed = current_state->frame.header.rsv1;
+            };
 
-            current_state->parsing_state = WS_FRAME_PARSING_STATE_SECOND_BYTE;
-            goto parse_start;
-        };
-        case WS_FRAME_PARSING_STATE_SECOND_BYTE:
-        {
-            uint8_t byte;
-            ssize_t byte_received = recv(sockfd, &byte, 1, 0);
+            current_state->real_payload_length = payload_length;
+            current_state->received_length = 0;
+            current_state->parsing_state = WS_FRAME_PARSING_STATE_PAYLOAD_DATA;
 
-            if (byte_received <= 0)
-            {
-                if (errno == EWOULDBLOCK) return 1;
-                else return WS_FRAME_PARSE_ERROR_RECV;
-            };
+            /** A streamed frame is handed out as it arrives, so nothing is gathered and nothing needs a limit. Control frames are always gathered. */
+            if (stream && !current_state->compressed && current_state->frame.header.opcode < WS_OPCODE_CLOSE)
+                goto parse_start;
 
-            current_state->frame.mask = (byte & 0b10000000) >> 7;
-            current_state->frame.payload_length = byte & 0b01111111;
+            if (payload_length > MAX_PAYLOAD_LENGTH - current_state->payload_data.size)
+                return WS_FRAME_PARSE_ERROR_PAYLOAD_TOO_BIG;
 
-            current_state->real_payload_length = 0;
-            current_state->parsing_state = WS_FRAME_PARSING_STATE_PAYLOAD_LENGTH;
+            if (current_state->payload_data.elements == NULL)
+                vector_init(&current_state->payload_data, payload_length + (current_state->message.opcode == WS_OPCODE_TEXT ? 1 : 0), sizeof(uint8_t));
 
+            current_state->message.payload_length = payload_length;
             goto parse_start;
         };
-        case WS_FRAME_PARSING_STATE_PAYLOAD_LENGTH:
+        case WS_FRAME_PARSING_STATE_PAYLOAD_DATA:
         {
-            void *ptr_to_null = memchr((void *)&current_state->real_payload_length, 0x00, sizeof(uint64_t));
+            uint64_t received_length = current_state->received_length;
+            uint64_t remaining_length = current_state->real_payload_length - received_length;
 
-            if (ptr_to_null == NULL)
+            if (stream && !current_state->compressed && current_state->frame.header.opcode < WS_OPCODE_CLOSE)
             {
-                if (current_state->frame.mask == 1)
+                /** The bytes are unmasked where they were received, and handed out as they are. */
+                size_t available = socket_buffer_available(recv_buffer);
+                if (available == 0 && remaining_length != 0)
                 {
-                    memset(current_state->frame.masking_key, 0, sizeof(current_state->frame.masking_key));
-                    current_state->parsing_state = WS_FRAME_PARSING_STATE_MASKING_KEY;
-                } else current_state->parsing_state = WS_FRAME_PARSING_STATE_PAYLOAD_DATA;
-
-                goto parse_start;
-            };
+                    int result = _ws_require(sockfd, recv_buffer, 1);
+                    if (result != 0) return result;
 
-            size_t length = (uint8_t *)ptr_to_null - (uint8_t *)&current_state->real_payload_length;
-            size_t num_bytes_recv = 0;
+                    available = socket_buffer_available(recv_buffer);
+                };
 
-            if (current_state->frame.payload_length <= 125) 
-            {
-                current_state->real_payload_length = current_state->frame.payload_length;
+                size_t length = available < remaining_length ? available : remaining_length;
+                uint8_t *fragment = (uint8_t *)recv_buffer->data + recv_buffer->offset;
+                recv_buffer->offset += length;
 
-                if (current_state->real_payload_length + current_state->payload_data.size > MAX_PAYLOAD_LENGTH)
-                    return WS_FRAME_PARSE_ERROR_PAYLOAD_TOO_BIG;
-                
-                if (current_state->payload_data.size == 0) 
-                    vector_init(&current_state->payload_data, current_state->real_payload_length + (current_state->message.opcode == WS_OPCODE_TEXT ? 1 : 0), sizeof(uint8_t));
+                if (current_state->frame.mask == 1) simd_mask(fragment, fragment, length, current_state->frame.masking_key, received_length);
 
-                current_state->message.payload_length = current_state->real_payload_length;
+                current_state->received_length += length;
+                current_state->fragment = fragment;
+                current_state->fragment_length = length;
+                current_state->fragment_is_final = current_state->frame.header.fin && current_state->received_length == current_state->real_payload_length;
 
-                if (current_state->frame.mask == 1)
+                /** The frame is done once its last byte is handed out, and the next one is parsed on the next call. */
+                if (current_state->received_length == current_state->real_payload_length)
                 {
-                    memset(current_state->frame.masking_key, 0, sizeof(current_state->frame.masking_key));
-                    current_state->parsing_state = WS_FRAME_PARSING_STATE_MASKING_KEY;
-                } else current_state->parsing_state = WS_FRAME_PARSING_STATE_PAYLOAD_DATA;
-
-                goto parse_start;
-            }
-            else if (current_state->frame.payload_length == 126) num_bytes_recv = 2;
-            else if (current_state->frame.payload_length == 127) num_bytes_recv = 8;
-            else return WS_FRAME_PARSE_ERROR_INVALID_FRAME_LENGTH;
-
-            if (num_bytes_recv - length <= 0)
-            {
-                current_state->parsing_state = WS_FRAME_PARSING_STATE_MASKING_KEY;
-                goto parse_start;
-            };
+                    current_state->parsing_state = WS_FRAME_NIL;
+                    current_state->real_payload_length = 0;
+                    current_state->received_length = 0;
+                    memset(&current_state->frame, 0, sizeof(current_state->frame));
 
-            uint64_t value = 0;
-            ssize_t bytes_received = recv(sockfd, &value, num_bytes_recv - length, 0);
-
-            if (bytes_received <= 0)
-            {
-                if (errno == EWOULDBLOCK) return 1;
-                else return WS_FRAME_PARSE_ERROR_RECV;
-            };
+                    /** An empty frame which does not end the message has nothing to hand out. */
+                    if (length == 0 && !current_state->fragment_is_final) goto parse_start;
+                };
 
-#if __BYTE_ORDER__ == __BIG_ENDIAN
-            for (ssize_t i = 0; i < bytes_received; ++i)
-            {
-                current_state->real_payload_length <<= 8;
-                current_state->real_payload_length |= (value >> (8 * i)) & 0xFF;
-            };
-#else
-            for (ssize_t i = bytes_received - 1; i >= 0; --i)
-            {
-                current_state->real_payload_length |= ((uint64_t)(value & 0xFF) << (8 * i));
-                value >>= 8;
+                return 2;
             };
-#endif
 
-            if (bytes_received == num_bytes_recv - length)
-            {
-                if (current_state->real_payload_length + current_state->payload_data.size > MAX_PAYLOAD_LENGTH)
-                    return WS_FRAME_PARSE_ERROR_PAYLOAD_TOO_BIG;
-
-                if (current_state->payload_data.size == 0) 
-                    vector_init(&current_state->payload_data, current_state->real_payload_length + (current_state->message.opcode == WS_OPCODE_TEXT ? 1 : 0), sizeof(uint8_t));
+            if (remaining_length == 0) break;
 
-                current_state->message.payload_length = current_state->real_payload_length;
-
-                if (current_state->frame.mask == 1)
-                {
-                    memset(current_state->frame.masking_key, 0, sizeof(current_state->frame.masking_key));
-                    current_state->parsing_state = WS_FRAME_PARSING_STATE_MASKING_KEY;
-                } else current_state->parsing_state = WS_FRAME_PARSING_STATE_PAYLOAD_DATA;
-
-                goto parse_start;
-            } else return 1;
-        };
-        case WS_FRAME_PARSING_STATE_MASKING_KEY:
-        {
-            uint8_t *masking_key = current_state->frame.masking_key;
-            ssize_t length = masking_key[0] == 0 ? 0 : (masking_key[1] == 0 ? 1 : (masking_key[2] == 0 ? 2 : (masking_key[3] == 0 ? 3 : 4)));
+            vector_resize(&current_state->payload_data, current_state->payload_data.size + remaining_length);
+            char *buffer_ptr = current_state->payload_data.elements + current_state->payload_data.size;
 
-            ssize_t bytes_received = recv(sockfd, masking_key, 4 - length, 0);
+            /** Buffered bytes are copied out first. A large payload with nothing buffered is received straight into the message. */
+            ssize_t bytes_received = socket_buffer_recv(sockfd, recv_buffer, buffer_ptr, remaining_length, 0);
             if (bytes_received <= 0)
             {
                 if (errno == EWOULDBLOCK) return 1;
                 else return WS_FRAME_PARSE_ERROR_RECV;
             };
 
-            if (length + bytes_received == 4)
-            {
-                current_state->parsing_state = WS_FRAME_PARSING_STATE_PAYLOAD_DATA;
-            }
-
-            goto parse_start;
-        };
-        case WS_FRAME_PARSING_STATE_PAYLOAD_DATA:
-        {
-            if (current_state->message.payload_length == 0) break;
-
-            uint64_t received_length = current_state->received_length;
-
-            vector_resize(&current_state->payload_data, current_state->payload_data.size + current_state->real_payload_length - received_length);
-            char *buffer_ptr = current_state->payload_data.elements + current_state->payload_data.size;
-
-            ssize_t bytes_received = recv(sockfd, buffer_ptr, current_state->real_payload_length - received_length, 0);
-            
             current_state->payload_data.size += bytes_received;
             current_state->received_length += bytes_received;
 
-            if (bytes_received <= 0)
-            {
-                if (errno == EWOULDBLOCK) return 1;
-                else return WS_FRAME_PARSE_ERROR_RECV;
-            };
-
+            /** The payload may arrive in parts, so each part continues the key where the previous one ended. */
             if (current_state->frame.mask == 1)
-            {
-                for (size_t i = 0; i < bytes_received; ++i)
-                {
-                    buffer_ptr[i] ^= current_state->frame.masking_key[(received_length + i) % 4];
-                };
-            };
+                simd_mask((uint8_t *)buffer_ptr, (uint8_t *)buffer_ptr, bytes_received, current_state->frame.masking_key, received_length);
 
-            if (bytes_received == current_state->real_payload_length - received_length)
-            {
-                break;
-            }
+            if ((uint64_t)bytes_received == remaining_length) break;
             else return 1;
         };
     };
 
     uint8_t old_fin = current_state->frame.header.fin;
 
-    current_state->parsing_state = -1;
+    current_state->parsing_state = WS_FRAME_NIL;
     current_state->real_payload_length = 0;
     current_state->received_length = 0;
     memset(&current_state->frame, 0, sizeof(current_state->frame));
 
     if (old_fin == 1)
     {
+        /** The message is inflated once it is whole, and is held to the same limit inflated. */
+        if (current_state->compressed)
+        {
+            struct vector decompressed;
+            int result = ws_deflate_decompress(client->deflate, current_state->payload_data.elements, current_state->payload_data.size, &decompressed, MAX_PAYLOAD_LENGTH);
+            if (result != 0) return result == -2 ? WS_FRAME_PARSE_ERROR_PAYLOAD_TOO_BIG : WS_FRAME_PARSE_ERROR_INVALID_COMPRESSION;
+
+            vector_free(&current_state->payload_data);
+            current_state->payload_data = decompressed;
+        };
+
         if (current_state->message.opcode == WS_OPCODE_TEXT) vector_push(&current_state->payload_data, &(char){'\0'});
         current_state->message.payload_length = current_state->payload_data.size;
         current_state->message.buffer = current_state->payload_data.elements;
@@ -0,0 +1,446 @@
+#include "../../include/ws/deflate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <zlib.h>
+
+/** The empty stored block which ends a flushed deflate stream. It is stripped from every message, and given back to inflate. */
+static const uint8_t WS_DEFLATE_TRAILER[4] = { 0x00, 0x00, 0xff, 0xff };
+
+/** The number of bytes the buffers of compression and decompression grow by at least. */
+#define WS_DEFLATE_CHUNK 4096
+
+/** Skips linear whitespace. */
+static const char *_ws_deflate_skip_space(const char *cursor, const char *end)
+{
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t')) ++cursor;
+    return cursor;
+};
+
+/** Checks if a token (which may be quoted) is `name`. */
+static bool _ws_deflate_token_equals(const char *token, size_t length, const char *name)
+{
+    return strlen(name) == length && strncasecmp(token, name, length) == 0;
+};
+
+/** Parses the window bits of a parameter, which may be quoted. Returns `-1` if they are not from `8` to `15`. */
+static int _ws_deflate_parse_window_bits(const char *value, size_t length)
+{
+    if (length >= 2 && value[0] == '"' && value[length - 1] == '"')
+    {
+        ++value;
+        length -= 2;
+    };
+
+    if (length == 0 || length > 2) return -1;
+
+    int bits = 0;
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (!isdigit((unsigned char)value[i])) return -1;
+        bits = bits * 10 + (value[i] - '0');
+    };
+
+    return bits >= 8 && bits <= WS_DEFLATE_MAX_WINDOW_BITS ? bits : -1;
+};
+
+/** 
+ * Parses the parameters of one extension, from `start` up to `end` (a comma or the end of the value). 
+ * Returns `0` if it is permessage-deflate with valid parameters, `1` if it is another extension, or `-1` if its parameters are invalid.
+*/
+static int _ws_deflate_parse_extension(const char *start, const char *end, struct ws_deflate_options *options)
+{
+    memset(options, 0, sizeof(struct ws_deflate_options));
+
+    const char *cursor = _ws_deflate_skip_space(start, end);
+    const char *name = cursor;
+    while (cursor < end && *cursor != ';' && *cursor != ' ' && *cursor != '\t') ++cursor;
+
+    if (!_ws_deflate_token_equals(name, cursor - name, "permessage-deflate")) return 1;
+
+    bool seen[4] = {0};
+
+    while (cursor < end)
+    {
+        cursor = _ws_deflate_skip_space(cursor, end);
+        if (cursor == end) break;
+        if (*cursor != ';') return -1;
+
+        cursor = _ws_deflate_skip_space(cursor + 1, end);
+
+        const char *parameter = cursor;
+        while (cursor < end && *cursor != ';' && *cursor != '=' && *cursor != ' ' && *cursor != '\t') ++cursor;
+        size_t parameter_length = cursor - parameter;
+
+        const char *value = NULL;
+        size_t value_length = 0;
+
+        cursor = _ws_deflate_skip_space(cursor, end);
+        if (cursor < end && *cursor == '=')
+        {
+            cursor = _ws_deflate_skip_space(cursor + 1, end);
+            value = cursor;
+            while (cursor < end && *cursor != ';' && *cursor != ' ' && *cursor != '\t') ++cursor;
+            value_length = cursor - value;
+        };
+
+        int index = -1;
+        if (_ws_deflate_token_equals(parameter, parameter_length, "server_no_context_takeover")) index = 0;
+        else if (_ws_deflate_token_equals(parameter, parameter_length, "client_no_context_takeover")) index = 1;
+        else if (_ws_deflate_token_equals(parameter, parameter_length, "server_max_window_bits")) index = 2;
+        else if (_ws_deflate_token_equals(parameter, parameter_length, "client_max_window_bits")) index = 3;
+
+        /** Unknown and repeated parameters make the whole extension invalid. */
+        if (index == -1 || seen[index]) return -1;
+        seen[index] = true;
+
+        switch (index)
+        {
+            case 0:
+            case 1:
+            {
+                if (value != NULL) return -1;
+
+                if (index == 0) options->server_no_context_takeover = true;
+                else options->client_no_context_takeover = true;
+
+                break;
+            };
+            case 2:
+            {
+                int bits = value != NULL ? _ws_deflate_parse_window_bits(value, value_length) : -1;
+                if (bits == -1) return -1;
+
+                options->server_max_window_bits = bits;
+                break;
+            };
+            case 3:
+            {
+                /** Without a value, the client only tells it can limit its window. */
+                int bits = value != NULL ? _ws_deflate_parse_window_bits(value, value_length) : WS_DEFLATE_MAX_WINDOW_BITS;
+                if (bits == -1) return -1;
+
+                options->client_max_window_bits = bits;
+                break;
+            };
+        };
+    };
+
+    return 0;
+};
+
+/** Formats the parameters of permessage-deflate, with `client_max_window_bits` written without a value if `bare_client_window`. */
+static size_t _ws_deflate_format(const struct ws_deflate_options *options, bool bare_client_window, char *buffer, size_t size)
+{
+    int length = snprintf(buffer, size, "permessage-deflate%s%s",
+        options->server_no_context_takeover ? "; server_no_context_takeover" : "",
+        options->client_no_context_takeover ? "; client_no_context_takeover" : "");
+
+    if (length >= 0 && (size_t)length < size && options->server_max_window_bits != 0)
+        length += snprintf(buffer + length, size - length, "; server_max_window_bits=%d", options->server_max_window_bits);
+
+    if (length >= 0 && (size_t)length < size && options->client_max_window_bits != 0)
+    {
+        if (bare_client_window) length += snprintf(buffer + length, size - length, "; client_max_window_bits");
+        else length += snprintf(buffer + length, size - length, "; client_max_window_bits=%d", options->client_max_window_bits);
+    };
+
+    return length < 0 ? 0 : ((size_t)length >= size ? size - 1 : (size_t)length);
+};
+
+size_t ws_deflate_format_offer(const struct ws_deflate_config *config, char *buffer, size_t size)
+{
+    struct ws_deflate_options offer = config->options;
+
+    /** The client always tells it can limit its window, so the server may ask it to. */
+    bool bare_client_window = offer.client_max_window_bits == 0 || offer.client_max_window_bits == WS_DEFLATE_MAX_WINDOW_BITS;
+    if (bare_client_window) offer.client_max_window_bits = WS_DEFLATE_MAX_WINDOW_BITS;
+    if (offer.server_max_window_bits == WS_DEFLATE_MAX_WINDOW_BITS) offer.server_max_window_bits = 0;
+
+    return _ws_deflate_format(&offer, bare_client_window, buffer, size);
+};
+
+int ws_deflate_accept_offer(const char *extensions, const struct ws_deflate_config *config, struct ws_deflate_options *negotiated)
+{
+    if (extensions == NULL) return -1;
+
+    uint8_t server_window = config->options.server_max_window_bits != 0 ? config->options.server_max_window_bits : WS_DEFLATE_MAX_WINDOW_BITS;
+    uint8_t client_window = config->options.client_max_window_bits != 0 ? config->options.client_max_window_bits : WS_DEFLATE_MAX_WINDOW_BITS;
+
+    const char *start = extensions;
+    const char *value_end = extensions + strlen(extensions);
+
+    while (start < value_end)
+    {
+        const char *end = memchr(start, ',', value_end - start);
+        if (end == NULL) end = value_end;
+
+        struct ws_deflate_options offer;
+        if (_ws_deflate_parse_extension(start, end, &offer) == 0)
+        {
+            /** 
+             * zlib cannot compress with a window of 256 bytes, so a server window of 8 bits cannot be honoured.
+             * A shared stream compresses with the configured window, which every connection has to be able to inflate.
+            */
+            bool acceptable = offer.server_max_window_bits != 8;
+            if (config->shared_compression && offer.server_max_window_bits != 0 && offer.server_max_window_bits < server_window) acceptable = false;
+
+            if (acceptable)
+            {
+                memset(negotiated, 0, sizeof(struct ws_deflate_options));
+
+                negotiated->server_no_context_takeover = offer.server_no_context_takeover || config->options.server_no_context_takeover || config->shared_compression;
+                negotiated->client_no_context_takeover = offer.client_no_context_takeover || config->options.client_no_context_takeover;
+
+                /** The server window is only named in the response if the client asked for it. */
+                if (offer.server_max_window_bits != 0)
+                    negotiated->server_max_window_bits = offer.server_max_window_bits < server_window ? offer.server_max_window_bits : server_window;
+
+                /** The client window can only be limited if the client can do so. */
+                if (offer.client_max_window_bits != 0 && (client_window < WS_DEFLATE_MAX_WINDOW_BITS || offer.client_max_window_bits < WS_DEFLATE_MAX_WINDOW_BITS))
+                    negotiated->client_max_window_bits = offer.client_max_window_bits < client_window ? offer.client_max_window_bits : client_window;
+
+                return 0;
+            };
+        };
+
+        start = end + 1;
+    };
+
+    return -1;
+};
+
+size_t ws_deflate_format_response(const struct ws_deflate_options *negotiated, char *buffer, size_t size)
+{
+    return _ws_deflate_format(negotiated, false, buffer, size);
+};
+
+int ws_deflate_accept_response(const char *extensions, struct ws_deflate_options *negotiated)
+{
+    if (extensions == NULL) return -1;
+
+    /** A server accepts at most one offer, so the response names one extension. */
+    const char *end = strchr(extensions, ',');
+    if (end == NULL) end = extensions + strlen(extensions);
+
+    return _ws_deflate_parse_extension(extensions, end, negotiated) == 0 ? 0 : -1;
+};
+
+struct ws_deflate *ws_deflate_create(const struct ws_deflate_options *negotiated, const struct ws_deflate_config *config, bool is_server, struct z_stream_s **shared_deflate_stream)
+{
+    struct ws_deflate *deflate = calloc(1, sizeof(struct ws_deflate));
+    if (deflate == NULL) return NULL;
+
+    deflate->options = *negotiated;
+    deflate->is_server = is_server;
+    deflate->threshold = config->threshold != 0 ? config->threshold : WS_DEFLATE_DEFAULT_THRESHOLD;
+    deflate->shared_deflate_stream = is_server && config->shared_compression ? shared_deflate_stream : NULL;
+
+    /** The configured window applies even when it was not negotiated, as compressing with a smaller window is always valid. */
+    uint8_t configured_window = config->options.server_max_window_bits;
+    if (!is_server) configured_window = config->options.client_max_window_bits;
+
+    uint8_t *sent_window = is_server ? &deflate->options.server_max_window_bits : &deflate->options.client_max_window_bits;
+    if (*sent_window == 0 || (configured_window != 0 && configured_window < *sent_window)) *sent_window = configured_window;
+
+    return deflate;
+};
+
+/** Gets the window bits a stream is created with, from the negotiated bits (`0` for the largest). zlib only compresses with windows of at least 9 bits. */
+static int _ws_deflate_window_bits(uint8_t bits)
+{
+    if (bits == 0) return WS_DEFLATE_MAX_WINDOW_BITS;
+    return bits < 9 ? 9 : bits;
+};
+
+/** Allocates a raw deflate stream. Returns `NULL` on failure. */
+static z_stream *_ws_deflate_stream_create(uint8_t window_bits)
+{
+    z_stream *stream = calloc(1, sizeof(z_stream));
+    if (stream == NULL) return NULL;
+
+    /** A negative window gives a raw stream, without the zlib header and checksum. */
+    if (deflateInit2(stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -_ws_deflate_window_bits(window_bits), 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        free(stream);
+        return NULL;
+    };
+
+    return stream;
+};
+
+/** Compresses a message with a stream, flushing it to a byte boundary and stripping the trailer. */
+static int _ws_deflate_compress_stream(z_stream *stream, const uint8_t *data, size_t length, struct vector *output)
+{
+    /** A buffer which is already allocated is reused, and only grows. */
+    size_t bound = deflateBound(stream, length) + 16;
+    if (output->elements == NULL) vector_init(output, bound, sizeof(uint8_t));
+    else vector_resize(output, bound);
+
+    if (output->elements == NULL || output->capacity < bound) return -1;
+    output->size = 0;
+
+    stream->next_in = (Bytef *)data;
+    stream->avail_in = length;
+
+    do
+    {
+        if (output->size == output->capacity && vector_resize(output, output->capacity + WS_DEFLATE_CHUNK) != 0) return -1;
+
+        stream->next_out = (Bytef *)output->elements + output->size;
+        stream->avail_out = output->capacity - output->size;
+
+        int result = deflate(stream, Z_SYNC_FLUSH);
+        if (result != Z_OK && result != Z_BUF_ERROR) return -1;
+
+        output->size = output->capacity - stream->avail_out;
+    } while (stream->avail_in != 0 || stream->avail_out == 0);
+
+    if (output->size >= sizeof(WS_DEFLATE_TRAILER) && memcmp((uint8_t *)output->elements + output->size - sizeof(WS_DEFLATE_TRAILER), WS_DEFLATE_TRAILER, sizeof(WS_DEFLATE_TRAILER)) == 0)
+        output->size -= sizeof(WS_DEFLATE_TRAILER);
+
+    return 0;
+};
+
+int ws_deflate_compress(struct ws_deflate *deflate, const uint8_t *data, size_t length, struct vector *output)
+{
+    uint8_t window_bits = deflate->is_server ? deflate->options.server_max_window_bits : deflate->options.client_max_window_bits;
+    bool no_context_takeover = deflate->is_server ? deflate->options.server_no_context_takeover : deflate->options.client_no_context_takeover;
+
+    z_stream **stream = deflate->shared_deflate_stream != NULL ? deflate->shared_deflate_stream : &deflate->deflate_stream;
+
+    if (*stream == NULL && (*stream = _ws_deflate_stream_create(window_bits)) == NULL) return -1;
+
+    /** A shared stream is reset before each message, as the previous one may have been sent to another connection. */
+    if (deflate->shared_deflate_stream != NULL) deflateReset(*stream);
+
+    int result = _ws_deflate_compress_stream(*stream, data, length, output);
+
+    if (result != 0 || (no_context_takeover && deflate->shared_deflate_stream == NULL)) deflateReset(*stream);
+
+    return result;
+};
+
+int ws_deflate_decompress(struct ws_deflate *deflate, const uint8_t *data, size_t length, struct vector *output, size_t max_length)
+{
+    uint8_t window_bits = deflate->is_server ? deflate->options.client_max_window_bits : deflate->options.server_max_window_bits;
+    bool no_context_takeover = deflate->is_server ? deflate->options.client_no_context_takeover : deflate->options.server_no_context_takeover;
+
+    output->elements = NULL;
+
+    if (deflate->inflate_stream == NULL)
+    {
+        z_stream *stream = calloc(1, sizeof(z_stream));
+        if (stream == NULL) return -1;
+
+        if (inflateInit2(stream, -_ws_deflate_window_bits(window_bits)) != Z_OK)
+        {
+            free(stream);
+            return -1;
+        };
+
+        deflate->inflate_stream = stream;
+    };
+
+    z_stream *stream = deflate->inflate_stream;
+
+    /** One byte past the limit is room to tell a message which inflates to exactly the limit from one which is bigger. */
+    size_t limit = max_length == SIZE_MAX ? SIZE_MAX : max_length + 1;
+    size_t capacity = length < limit / 4 ? length * 4 : limit;
+    vector_init(output, capacity < WS_DEFLATE_CHUNK ? (limit < WS_DEFLATE_CHUNK ? limit : WS_DEFLATE_CHUNK) : capacity, sizeof(uint8_t));
+    if (output->elements == NULL) return -1;
+
+    int result = 0;
+
+    /** The message is inflated, and then the trailer stripped from it. */
+    for (int pass = 0; pass < 2 && result == 0; ++pass)
+    {
+        stream->next_in = pass == 0 ? (Bytef *)data : (Bytef *)WS_DEFLATE_TRAILER;
+        stream->avail_in = pass == 0 ? length : sizeof(WS_DEFLATE_TRAILER);
+
+        while (true)
+        {
+            if (output->size == output->capacity)
+            {
+                if (output->capacity == limit)
+                {
+                    result = -2;
+                    break;
+                };
+
+                size_t new_capacity = output->capacity < limit / 2 ? output->capacity * 2 : limit;
+                if (vector_resize(output, new_capacity) != 0)
+                {
+                    result = -1;
+                    break;
+                };
+            };
+
+            stream->next_out = (Bytef *)output->elements + output->size;
+            stream->avail_out = output->capacity - output->size;
+
+            int status = inflate(stream, Z_SYNC_FLUSH);
+            output->size = output->capacity - stream->avail_out;
+
+            /** A final block ends the stream early, which only happens without context takeover. */
+            if (status == Z_STREAM_END)
+            {
+                inflateReset(stream);
+                break;
+            };
+
+            /** Nothing is left to inflate until more input is given. */
+            if (status == Z_BUF_ERROR) break;
+
+            if (status != Z_OK)
+            {
+                result = -1;
+                break;
+            };
+
+            if (stream->avail_in == 0 && stream->avail_out != 0) break;
+        };
+    };
+
+    if (result == 0 && output->size > max_length) result = -2;
+
+    if (result != 0 || no_context_takeover) inflateReset(stream);
+
+    if (result != 0)
+    {
+        vector_free(output);
+        output->elements = NULL;
+    };
+
+    return result;
+};
+
+void ws_deflate_free(struct ws_deflate *deflate)
+{
+    if (deflate == NULL) return;
+
+    if (deflate->deflate_stream != NULL)
+    {
+        deflateEnd(deflate->deflate_stream);
+        free(deflate->deflate_stream);
+    };
+
+    if (deflate->inflate_stream != NULL)
+    {
+        inflateEnd(deflate->inflate_stream);
+        free(deflate->inflate_stream);
+    };
+
+    free(deflate);
+};
+
+void ws_deflate_free_shared(struct z_stream_s **shared_deflate_stream)
+{
+    if (*shared_deflate_stream == NULL) return;
+
+    deflateEnd(*shared_deflate_stream);
+    free(*shared_deflate_stream);
+    *shared_deflate_stream = NULL;
+};
@@ -28,6 +28,7 @@ int ws_server_upgrade_connection(struct web_server *server, struct web_client *c
             "\r\n"
             "Invalid Sec-WebSocket-Key header.";
 
+        tcp_server_uncork(server->tcp_server, client->tcp_client);
         tcp_server_send(sockfd, (char *)badrequest_message, strlen(badrequest_message), 0);
         tcp_server_close_client(server->tcp_server, sockfd, 0);
 
@@ -45,6 +46,7 @@ int ws_server_upgrade_connection(struct web_server *server, struct web_client *c
             "\r\n"
             "Unsupported Sec-WebSocket-Version header.";
 
+        tcp_server_uncork(server->tcp_server, client->tcp_client);
         tcp_server_send(sockfd, (char *)badrequest_message, strlen(badrequest_message), 0);
         tcp_server_close_client(server->tcp_server, sockfd, 0);
 
@@ -88,11 +90,33 @@ int ws_server_upgrade_connection(struct web_server *server, struct web_client *c
         vector_push(&response.headers, &protocol);
     };
 
+    /** The first offer of permessage-deflate the configuration allows is accepted. */
+    struct ws_deflate_config *deflate_config = &server->ws_server_config.permessage_deflate;
+    struct ws_deflate_options deflate_options;
+    bool deflate = false;
+
+    if (deflate_config->enabled)
+    {
+        struct http_header *sec_websocket_extensions = http_request_get_header(request, "Sec-WebSocket-Extensions");
+        if (sec_websocket_extensions != NULL && ws_deflate_accept_offer(sso_string_get(&sec_websocket_extensions->value), deflate_config, &deflate_options) == 0)
+        {
+            char extensions[128];
+            ws_deflate_format_response(&deflate_options, extensions, sizeof(extensions));
+
+            struct http_header extension;
+            http_header_init(&extension, "Sec-WebSocket-Extensions", extensions);
+            vector_push(&response.headers, &extension);
+
+            deflate = true;
+        };
+    };
+
     int result = http_server_send_response(server, client, &response, NULL, 0);
     if (result > 0)
     {
         client->path = strdup(sso_string_get(&request->path));
         client->connection_type = CONNECTION_WS;
+        if (deflate) client->deflate = ws_deflate_create(&deflate_options, deflate_config, true, &server->shared_deflate_stream);
         
         if (server->ws_server_config.record_latency == true)
         {
@@ -121,5 +145,122 @@ int ws_server_close_client(struct web_server *server, struct web_client *client,
     ws_build_message(&message, WS_OPCODE_CLOSE, 2 + reason_len, (uint8_t *)payload_data);
 
     ws_send_message(client, &message, NULL, 1);
+    tcp_server_uncork(server->tcp_server, client->tcp_client);
     return tcp_server_close_client(server->tcp_server, client->tcp_client->sockfd, false);
-};
\ No newline at end of file
+};
+/** A frame published to a topic whose payload may still be referenced by the kernel after it is sent, freed once every send has released it. */
+struct ws_shared_payload
+{
+    /** The number of sends (and the publish itself) which still reference the payload. */
+    size_t references;
+    /** The payload. */
+    uint8_t data[];
+};
+
+/** Releases a reference to a shared payload. */
+static void _ws_server_release_payload(void *data)
+{
+    struct ws_shared_payload *payload = data;
+    if (--payload->references == 0) free(payload);
+};
+
+int ws_server_subscribe(struct web_server *server, struct web_client *client, const char *topic)
+{
+    return ws_topics_subscribe(&server->topics, client, topic);
+};
+
+int ws_server_unsubscribe(struct web_server *server, struct web_client *client, const char *topic)
+{
+    return ws_topics_unsubscribe(&server->topics, client, topic);
+};
+
+/** A frame published to a topic, encoded once for every subscriber it is sent to. */
+struct ws_published_frame
+{
+    /** The header of the frame. */
+    uint8_t header[10];
+    /** The header, as it is sent. */
+    struct iovec iov;
+    /** The payload of the frame. */
+    const char *buffer;
+    /** The length of the payload. */
+    size_t length;
+    /** The copy of the payload shared by every send, if it is sent without being copied. */
+    struct ws_shared_payload *payload;
+    /** Whether or not the frame is encoded. */
+    bool is_prepared;
+};
+
+/** Encodes the header of a published frame. Returns `-1` if its payload could not be copied. */
+static int _ws_server_prepare_frame(struct web_server *server, struct ws_published_frame *frame, uint8_t opcode, bool compressed, const uint8_t *data, size_t length)
+{
+    frame->iov.iov_base = frame->header;
+    frame->iov.iov_len = ws_build_frame_header(frame->header, opcode, length);
+    if (compressed) frame->header[0] |= 0x40; // RSV1
+    
+    frame->buffer = (const char *)data;
+    frame->length = length;
+    frame->payload = NULL;
+    frame->is_prepared = true;
+
+    /** A payload sent without being copied outlives this call, so it is copied once and shared by every send. Otherwise, every send copies what it cannot write right away. */
+    size_t zerocopy_threshold = server->tcp_server->zerocopy_threshold;
+    if (zerocopy_threshold != 0 && length >= zerocopy_threshold)
+    {
+        frame->payload = malloc(sizeof(struct ws_shared_payload) + length);
+        if (frame->payload == NULL) return -1;
+
+        frame->payload->references = 1;
+        memcpy(frame->payload->data, data, length);
+        frame->buffer = (const char *)frame->payload->data;
+    };
+
+    return 0;
+};
+
+size_t ws_server_publish(struct web_server *server, const char *topic, struct ws_message *message)
+{
+    struct ws_topic *found = ws_topics_find(&server->topics, topic);
+    if (found == NULL) return 0;
+
+    struct ws_subscriber *subscribers = found->subscribers.elements;
+    size_t subscriber_count = found->subscribers.size;
+
+    /** The plain frame, and the frame compressed once by the stream the connections share. */
+    struct ws_published_frame frames[2] = {0};
+    struct vector compressed = {0};
+
+    /** Only subscribers which share the stream of the server can be sent its output, so the others are sent the plain frame. */
+    struct ws_deflate *deflate = NULL;
+    if (message->opcode != WS_OPCODE_CLOSE && message->opcode != WS_OPCODE_PING && message->opcode != WS_OPCODE_PONG)
+    {
+        for (size_t i = 0; i < subscriber_count && deflate == NULL; ++i)
+        {
+            struct ws_deflate *subscriber_deflate = subscribers[i].client->deflate;
+            if (subscriber_deflate != NULL && subscriber_deflate->shared_deflate_stream != NULL && message->payload_length >= subscriber_deflate->threshold) deflate = subscriber_deflate;
+        };
+    };
+
+    if (deflate != NULL && (ws_deflate_compress(deflate, message->buffer, message->payload_length, &compressed) != 0 || _ws_server_prepare_frame(server, &frames[1], message->opcode, true, compressed.elements, compressed.size) != 0))
+        deflate = NULL;
+
+    size_t sent = 0;
+    for (size_t i = 0; i < subscriber_count; ++i)
+    {
+        bool is_compressed = deflate != NULL && subscribers[i].client->deflate != NULL && subscribers[i].client->deflate->shared_deflate_stream != NULL;
+        struct ws_published_frame *frame = &frames[is_compressed];
+
+        if (!frame->is_prepared && _ws_server_prepare_frame(server, frame, message->opcode, false, message->buffer, message->payload_length) != 0) break;
+
+        if (frame->payload != NULL) ++frame->payload->references;
+        tcp_server_send_zerocopy(server->tcp_server, subscribers[i].client->tcp_client, &frame->iov, 1, frame->buffer, frame->length, frame->payload != NULL ? _ws_server_release_payload : NULL, frame->payload);
+        ++sent;
+    };
+
+    for (size_t i = 0; i < 2; ++i)
+        if (frames[i].payload != NULL) _ws_server_release_payload(frames[i].payload);
+
+    if (compressed.elements != NULL) vector_free(&compressed);
+
+    return sent;
+};
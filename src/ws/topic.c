@@ -0,0 +1,231 @@
+#include "../../include/ws/topic.h"
+#include "../../include/web/client.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Hashes a name with FNV-1a. */
+static uint64_t _ws_topics_hash(const char *name)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (; *name; ++name)
+    {
+        hash ^= (unsigned char)*name;
+        hash *= 0x100000001b3ULL;
+    };
+
+    return hash;
+};
+
+/** Doubles the number of buckets, so there is at most one topic per bucket on average. */
+static int _ws_topics_grow(struct ws_topics *topics)
+{
+    size_t bucket_count = topics->bucket_count == 0 ? 16 : topics->bucket_count * 2;
+
+    struct ws_topic **buckets = calloc(bucket_count, sizeof(struct ws_topic *));
+    if (buckets == NULL) return -1;
+
+    for (size_t i = 0; i < topics->bucket_count; ++i)
+    {
+        struct ws_topic *topic = topics->buckets[i];
+        while (topic != NULL)
+        {
+            struct ws_topic *next = topic->bucket_next;
+            struct ws_topic **bucket = &buckets[topic->hash & (bucket_count - 1)];
+
+            topic->bucket_next = *bucket;
+            *bucket = topic;
+            topic = next;
+        };
+    };
+
+    free(topics->buckets);
+    topics->buckets = buckets;
+    topics->bucket_count = bucket_count;
+
+    return 0;
+};
+
+/** Removes a topic without subscribers and frees it. */
+static void _ws_topics_remove(struct ws_topics *topics, struct ws_topic *topic)
+{
+    struct ws_topic **link = &topics->buckets[topic->hash & (topics->bucket_count - 1)];
+    while (*link != topic) link = &(*link)->bucket_next;
+    *link = topic->bucket_next;
+
+    --topics->size;
+
+    vector_free(&topic->subscribers);
+    free(topic->name);
+    free(topic);
+};
+
+/** Pushes an element to a vector, growing it first. Returns `-1` if the vector could not grow, leaving it as it was. */
+static int _ws_topics_push(struct vector *vec, void *element)
+{
+    if (vec->elements == NULL || (vec->size == vec->capacity && vector_resize(vec, vec->capacity * 2) != 0)) return -1;
+
+    vector_push(vec, element);
+    return 0;
+};
+
+/** Removes the subscription of a client at an index of its subscriptions. The last subscriber of the topic and the last subscription of the client take their places. */
+static void _ws_topics_remove_subscription(struct ws_topics *topics, struct web_client *client, size_t subscription_index)
+{
+    struct ws_subscription *subscription = vector_get(&client->subscriptions, subscription_index);
+    struct ws_topic *topic = subscription->topic;
+    size_t index = subscription->index;
+    size_t last = topic->subscribers.size - 1;
+
+    if (index != last)
+    {
+        struct ws_subscriber *moved = vector_get(&topic->subscribers, last);
+        vector_set_index(&topic->subscribers, moved, index);
+
+        /** The subscription of the client which moved has to follow it. */
+        struct ws_subscription *moved_subscription = vector_get(&moved->client->subscriptions, moved->subscription_index);
+        moved_subscription->index = index;
+    };
+
+    --topic->subscribers.size;
+
+    last = client->subscriptions.size - 1;
+    if (subscription_index != last)
+    {
+        struct ws_subscription *moved = vector_get(&client->subscriptions, last);
+        vector_set_index(&client->subscriptions, moved, subscription_index);
+
+        /** The subscriber entry of the subscription which moved has to follow it too. */
+        struct ws_subscriber *moved_subscriber = vector_get(&moved->topic->subscribers, moved->index);
+        moved_subscriber->subscription_index = subscription_index;
+    };
+
+    --client->subscriptions.size;
+
+    if (topic->subscribers.size == 0) _ws_topics_remove(topics, topic);
+};
+
+/** Finds the index of the subscription of a client to a topic, or returns `-1`. */
+static ssize_t _ws_topics_find_subscription(struct web_client *client, const char *name)
+{
+    for (size_t i = 0; i < client->subscriptions.size; ++i)
+    {
+        struct ws_subscription *subscription = vector_get(&client->subscriptions, i);
+        if (strcmp(subscription->topic->name, name) == 0) return i;
+    };
+
+    return -1;
+};
+
+void ws_topics_init(struct ws_topics *topics)
+{
+    topics->buckets = NULL;
+    topics->bucket_count = 0;
+    topics->size = 0;
+};
+
+struct ws_topic *ws_topics_find(struct ws_topics *topics, const char *name)
+{
+    if (topics->buckets == NULL) return NULL;
+
+    uint64_t hash = _ws_topics_hash(name);
+    for (struct ws_topic *topic = topics->buckets[hash & (topics->bucket_count - 1)]; topic != NULL; topic = topic->bucket_next)
+    {
+        if (topic->hash == hash && strcmp(topic->name, name) == 0) return topic;
+    };
+
+    return NULL;
+};
+
+int ws_topics_subscribe(struct ws_topics *topics, struct web_client *client, const char *name)
+{
+    if (_ws_topics_find_subscription(client, name) != -1) return 1;
+
+    struct ws_topic *topic = ws_topics_find(topics, name);
+    if (topic == NULL)
+    {
+        if (topics->size >= topics->bucket_count && _ws_topics_grow(topics) != 0) return -1;
+
+        topic = calloc(1, sizeof(struct ws_topic));
+        if (topic == NULL) return -1;
+
+        topic->name = strdup(name);
+        if (topic->name == NULL)
+        {
+            free(topic);
+            return -1;
+        };
+
+        topic->hash = _ws_topics_hash(name);
+        vector_init(&topic->subscribers, 8, sizeof(struct ws_subscriber));
+        if (topic->subscribers.elements == NULL)
+        {
+            free(topic->name);
+            free(topic);
+            return -1;
+        };
+
+        struct ws_topic **bucket = &topics->buckets[topic->hash & (topics->bucket_count - 1)];
+        topic->bucket_next = *bucket;
+        *bucket = topic;
+        ++topics->size;
+    };
+
+    if (client->subscriptions.elements == NULL) vector_init(&client->subscriptions, 4, sizeof(struct ws_subscription));
+
+    struct ws_subscriber subscriber = { .client = client, .subscription_index = client->subscriptions.size };
+    struct ws_subscription subscription = { .topic = topic, .index = topic->subscribers.size };
+
+    if (_ws_topics_push(&topic->subscribers, &subscriber) != 0)
+    {
+        if (topic->subscribers.size == 0) _ws_topics_remove(topics, topic);
+        return -1;
+    };
+
+    /** The client is taken out of the topic again, so no subscriber is left without its subscription. */
+    if (_ws_topics_push(&client->subscriptions, &subscription) != 0)
+    {
+        --topic->subscribers.size;
+        if (topic->subscribers.size == 0) _ws_topics_remove(topics, topic);
+        return -1;
+    };
+
+    return 0;
+};
+
+int ws_topics_unsubscribe(struct ws_topics *topics, struct web_client *client, const char *name)
+{
+    ssize_t subscription_index = _ws_topics_find_subscription(client, name);
+    if (subscription_index == -1) return 1;
+
+    _ws_topics_remove_subscription(topics, client, subscription_index);
+    return 0;
+};
+
+void ws_topics_unsubscribe_all(struct ws_topics *topics, struct web_client *client)
+{
+    while (client->subscriptions.size > 0) _ws_topics_remove_subscription(topics, client, client->subscriptions.size - 1);
+
+    vector_free(&client->subscriptions);
+};
+
+void ws_topics_free(struct ws_topics *topics)
+{
+    for (size_t i = 0; i < topics->bucket_count; ++i)
+    {
+        struct ws_topic *topic = topics->buckets[i];
+        while (topic != NULL)
+        {
+            struct ws_topic *next = topic->bucket_next;
+
+            vector_free(&topic->subscribers);
+            free(topic->name);
+            free(topic);
+
+            topic = next;
+        };
+    };
+
+    free(topics->buckets);
+    ws_topics_init(topics);
+};
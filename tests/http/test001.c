@@ -3,12 +3,14 @@
 
 #include "../../include/web/server.h"
 #include "../../include/web/client.h"
+#include "../../include/tcp/client.h"
 #include "../../include/utils/error.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <pthread.h>
+#include <unistd.h>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -373,8 +375,6 @@ static void http_test001_client_on_data(struct web_client *client, struct http_r
         fclose(file);
 
         printf("Wrote image to ./tests/http/tests/client_recv.png\n");
-
-        web_server_close(&server);
     };
 };
 
@@ -447,7 +447,20 @@ static int http_test001()
     pthread_t clit;
     pthread_create(&clit, NULL, (void *)web_client_start, &client);
 
+    /** The last request has `Connection: close`, so the server closes the connection once it responded, which stops the client. */
     pthread_join(clit, NULL);
+
+    /** Another connection wakes the server up once it is closed, so the server sees it stopped listening. */
+    struct tcp_client wake = {0};
+    if (tcp_client_init(&wake, (struct sockaddr *)&cliaddr, 0) != 0 || tcp_client_connect(&wake) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 001] client failed to connect to wake the server\n" ANSI_RESET);
+        return 1;
+    };
+
+    usleep(100000);
+    web_server_close(&server);
+    tcp_client_close(&wake, false);
     pthread_join(servt, NULL);
 
     if (http_test001_server_connect == 1) {
@@ -0,0 +1,195 @@
+#ifndef HTTP_TEST_002
+#define HTTP_TEST_002
+
+/**
+ * TEST CASE 2: chunked request bodies, including chunk sizes which overflow or exceed the body limit
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8082
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+static struct web_server http_test002_server = {0};
+
+/** The body of the last request the route received, and the last parse error reported. */
+static char http_test002_body[64] = {0};
+static size_t http_test002_body_size = 0;
+static int http_test002_error = 0;
+
+static void http_test002_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request);
+static void http_test002_server_on_http_malformed_request(struct web_server *server, struct web_client *client, enum parse_request_error_types error);
+static int http_test002_exchange(struct tcp_client *client, const char *request, char *response, size_t capacity);
+static int http_test002();
+
+static void http_test002_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    http_test002_body_size = request->body_size < sizeof(http_test002_body) - 1 ? request->body_size : sizeof(http_test002_body) - 1;
+    memcpy(http_test002_body, request->body, http_test002_body_size);
+    http_test002_body[http_test002_body_size] = '\0';
+
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "text/plain"} }, 1);
+    http_server_send_response(server, client, &response, "ok", 2);
+};
+
+static void http_test002_server_on_http_malformed_request(struct web_server *server, struct web_client *client, enum parse_request_error_types error)
+{
+    http_test002_error = error;
+};
+
+/**
+ * Connects a blocking client, sends a raw request, and receives until the server closes the connection or a response with a 2 byte body arrived.
+ * Returns the number of bytes received, or `-1` if the client could not connect or send.
+*/
+static int http_test002_exchange(struct tcp_client *client, const char *request, char *response, size_t capacity)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    memset(client, 0, sizeof(struct tcp_client));
+    if (tcp_client_init(client, (struct sockaddr *)&addr, 0) != 0 || tcp_client_connect(client) != 0) return -1;
+    if (tcp_client_send(client, request, strlen(request), 0) != strlen(request)) return -1;
+
+    size_t received = 0;
+    while (received < capacity - 1)
+    {
+        int result = tcp_client_receive(client, response + received, capacity - 1 - received, 0);
+        if (result <= 0) break;
+
+        received += result;
+        response[received] = '\0';
+
+        char *body = strstr(response, "\r\n\r\n");
+        if (body != NULL && strlen(body + 4) >= 2) break;
+    };
+
+    response[received] = '\0';
+    return received;
+};
+
+static int http_test002()
+{
+    http_test002_server.on_http_malformed_request = http_test002_server_on_http_malformed_request;
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&http_test002_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 002] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    http_test002_server.http_server_config.max_body_len = 32;
+
+    struct web_server_route route = { .path = "/*", .on_http_message = http_test002_server_on_data };
+    web_server_create_route(&http_test002_server, &route);
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &http_test002_server);
+
+    int passed = 1;
+    char response[512];
+    struct tcp_client client;
+
+    /** Chunks with extensions and trailers. */
+    http_test002_exchange(&client, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n6;name=value\r\n world\r\n0\r\nTrailer: x\r\n\r\n", response, sizeof(response));
+    tcp_client_close(&client, false);
+    if (strstr(response, "200 OK") == NULL || http_test002_body_size != 11 || strcmp(http_test002_body, "hello world") != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 002] chunked body was parsed incorrectly: %s\n" ANSI_RESET, http_test002_body);
+        passed = 0;
+    };
+
+    /** A chunk size which does not fit in 64 bits. */
+    http_test002_error = 0;
+    http_test002_exchange(&client, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n10000000000000005\r\nhello\r\n0\r\n\r\n", response, sizeof(response));
+    tcp_client_close(&client, false);
+    if (http_test002_error != REQUEST_PARSE_ERROR_BODY_TOO_BIG)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 002] overflowing chunk size was not rejected: %d\n" ANSI_RESET, http_test002_error);
+        passed = 0;
+    };
+
+    /** A chunk size which wraps the body size around to 0 when added to it. */
+    http_test002_error = 0;
+    http_test002_exchange(&client, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\nfffffffffffffffb\r\nhello\r\n0\r\n\r\n", response, sizeof(response));
+    tcp_client_close(&client, false);
+    if (http_test002_error != REQUEST_PARSE_ERROR_BODY_TOO_BIG)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 002] wrapping chunk size was not rejected: %d\n" ANSI_RESET, http_test002_error);
+        passed = 0;
+    };
+
+    /** Chunks which are larger than the body may be together. */
+    http_test002_error = 0;
+    http_test002_exchange(&client, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n10\r\n0123456789abcdef\r\n11\r\n0123456789abcdefg\r\n0\r\n\r\n", response, sizeof(response));
+    tcp_client_close(&client, false);
+    if (http_test002_error != REQUEST_PARSE_ERROR_BODY_TOO_BIG)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 002] body over the limit was not rejected: %d\n" ANSI_RESET, http_test002_error);
+        passed = 0;
+    };
+
+    /** Chunk data which is not followed by a CRLF. */
+    http_test002_error = 0;
+    http_test002_exchange(&client, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhelloXY0\r\n\r\n", response, sizeof(response));
+    tcp_client_close(&client, false);
+    if (http_test002_error != REQUEST_PARSE_ERROR_MALFORMED)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 002] chunk without CRLF was not rejected: %d\n" ANSI_RESET, http_test002_error);
+        passed = 0;
+    };
+
+    /** The connection of the last request wakes the server up once it is closed, so the server sees it stopped listening. */
+    http_test002_exchange(&client, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nok\r\n0\r\n\r\n", response, sizeof(response));
+    if (strcmp(http_test002_body, "ok") != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 002] server did not recover after malformed requests\n" ANSI_RESET);
+        passed = 0;
+    };
+
+    usleep(100000);
+    web_server_close(&http_test002_server);
+    tcp_client_close(&client, false);
+    pthread_join(servt, NULL);
+
+    if (passed) printf(ANSI_GREEN "[HTTP TEST CASE 002] chunked bodies were parsed correctly\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // HTTP_TEST_002
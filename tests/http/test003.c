@@ -0,0 +1,209 @@
+#ifndef HTTP_TEST_003
+#define HTTP_TEST_003
+
+/**
+ * TEST CASE 3: pipelined requests, and closing the connection once the responses asked to be closed after were sent
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8083
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+static struct web_server http_test003_server = {0};
+
+/** The number of requests the routes handled. */
+static int http_test003_handled = 0;
+
+static void http_test003_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request);
+static void http_test003_server_on_close(struct web_server *server, struct web_client *client, struct http_request *request);
+static int http_test003_connect(struct tcp_client *client);
+static int http_test003_receive_until_closed(struct tcp_client *client, char *response, size_t capacity);
+static int http_test003_count(const char *response, const char *bytes);
+static int http_test003();
+
+/** Responds with the path of the request. */
+static void http_test003_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    ++http_test003_handled;
+
+    const char *path = http_request_get_path(request);
+
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "text/plain"} }, 1);
+    http_server_send_response(server, client, &response, path, strlen(path));
+};
+
+/** Responds with a `Connection: close` header of its own. */
+static void http_test003_server_on_close(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    ++http_test003_handled;
+
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "text/plain"}, {"Connection", "Close"} }, 2);
+    http_server_send_response(server, client, &response, "bye", 3);
+};
+
+/** Connects a blocking client, which stops waiting for bytes after a second. Returns `0`, or `-1` if it could not connect. */
+static int http_test003_connect(struct tcp_client *client)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    memset(client, 0, sizeof(struct tcp_client));
+    if (tcp_client_init(client, (struct sockaddr *)&addr, 0) != 0 || tcp_client_connect(client) != 0) return -1;
+
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client->sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    return 0;
+};
+
+/** Receives until the server closes the connection. Returns the number of bytes received, or `-1` if the server did not close it in time. */
+static int http_test003_receive_until_closed(struct tcp_client *client, char *response, size_t capacity)
+{
+    size_t received = 0;
+    int result = 0;
+    while (received < capacity - 1 && (result = tcp_client_receive(client, response + received, capacity - 1 - received, 0)) > 0) received += result;
+
+    response[received] = '\0';
+    return result == 0 ? (int)received : -1;
+};
+
+/** Counts the occurrences of some bytes in a response. */
+static int http_test003_count(const char *response, const char *bytes)
+{
+    int count = 0;
+    for (const char *cursor = response; (cursor = strstr(cursor, bytes)) != NULL; cursor += strlen(bytes)) ++count;
+
+    return count;
+};
+
+static int http_test003()
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&http_test003_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 003] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    struct web_server_route close_route = { .path = "/close", .on_http_message = http_test003_server_on_close };
+    struct web_server_route route = { .path = "/*", .on_http_message = http_test003_server_on_data };
+    web_server_create_route(&http_test003_server, &close_route);
+    web_server_create_route(&http_test003_server, &route);
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &http_test003_server);
+
+    int passed = 1;
+    char response[2048];
+    struct tcp_client client;
+
+    /** Three requests in one write, the last of which asks to close the connection among other tokens. The request after it is never handled. */
+    const char *requests = "GET /a HTTP/1.1\r\n\r\n"
+        "GET /b HTTP/1.1\r\nContent-Length: 2\r\n\r\nhi"
+        "GET /c HTTP/1.1\r\nConnection: keep-alive, close\r\n\r\n"
+        "GET /d HTTP/1.1\r\n\r\n";
+
+    if (http_test003_connect(&client) != 0 || tcp_client_send(&client, requests, strlen(requests), 0) != strlen(requests))
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 003] client failed to connect or send\n" ANSI_RESET);
+        passed = 0;
+    }
+    else
+    {
+        int received = http_test003_receive_until_closed(&client, response, sizeof(response));
+        char *a = strstr(response, "\r\n\r\n/a");
+        char *b = strstr(response, "\r\n\r\n/b");
+        char *c = strstr(response, "\r\n\r\n/c");
+
+        if (received == -1 || http_test003_count(response, "HTTP/1.1 200 OK") != 3 || a == NULL || b == NULL || c == NULL || !(a < b && b < c) || strstr(response, "/d") != NULL)
+        {
+            printf(ANSI_RED "[HTTP TEST CASE 003] pipelined responses were not sent in order before closing: %s\n" ANSI_RESET, response);
+            passed = 0;
+        };
+
+        if (http_test003_count(response, "Connection: close") != 1)
+        {
+            printf(ANSI_RED "[HTTP TEST CASE 003] response to the closing request did not say it closes\n" ANSI_RESET);
+            passed = 0;
+        };
+    };
+
+    tcp_client_close(&client, false);
+
+    /** A response with its own `Connection` header closes the connection too. */
+    const char *request = "GET /close HTTP/1.1\r\n\r\n";
+    if (http_test003_connect(&client) != 0 || tcp_client_send(&client, request, strlen(request), 0) != strlen(request))
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 003] client failed to connect or send\n" ANSI_RESET);
+        passed = 0;
+    }
+    else if (http_test003_receive_until_closed(&client, response, sizeof(response)) == -1 || strstr(response, "\r\n\r\nbye") == NULL)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 003] connection was not closed after the response asked for it: %s\n" ANSI_RESET, response);
+        passed = 0;
+    };
+
+    tcp_client_close(&client, false);
+
+    if (http_test003_handled != 4)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 003] %d requests were handled instead of 4\n" ANSI_RESET, http_test003_handled);
+        passed = 0;
+    };
+
+    /** Another connection wakes the server up once it is closed, so the server sees it stopped listening. */
+    if (http_test003_connect(&client) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 003] client failed to connect to wake the server\n" ANSI_RESET);
+        return 1;
+    };
+
+    usleep(100000);
+    web_server_close(&http_test003_server);
+    tcp_client_close(&client, false);
+    pthread_join(servt, NULL);
+
+    if (passed) printf(ANSI_GREEN "[HTTP TEST CASE 003] pipelined responses were sent before the connection was closed\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // HTTP_TEST_003
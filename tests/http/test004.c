@@ -0,0 +1,226 @@
+#ifndef HTTP_TEST_004
+#define HTTP_TEST_004
+
+/**
+ * TEST CASE 4: static files with ranges (206 and 416) and conditional requests (304)
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8084
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The file which is served, and the path it is requested at. */
+#define HTTP_TEST004_FILE "./tests/http/image.png"
+#define HTTP_TEST004_PATH "/static/image.png"
+
+static struct web_server http_test004_server = {0};
+
+/** The contents of the served file. */
+static char *http_test004_file = NULL;
+static size_t http_test004_file_size = 0;
+
+static int http_test004_exchange(const char *request, char *response, size_t capacity);
+static int http_test004_starts_with(const char *response, const char *status_line);
+static const char *http_test004_body(const char *response, int received);
+static int http_test004_expect(const char *name, int condition, const char *response);
+static int http_test004();
+
+/** Sends a request on a new connection, and receives until the server closes it. Returns the number of bytes received, or `-1`. */
+static int http_test004_exchange(const char *request, char *response, size_t capacity)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    struct tcp_client client = {0};
+    if (tcp_client_init(&client, (struct sockaddr *)&addr, 0) != 0 || tcp_client_connect(&client) != 0) return -1;
+
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client.sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    size_t received = 0;
+    int result = tcp_client_send(&client, request, strlen(request), 0) == strlen(request) ? 1 : -1;
+    while (result > 0 && received < capacity - 1 && (result = tcp_client_receive(&client, response + received, capacity - 1 - received, 0)) > 0) received += result;
+
+    response[received] = '\0';
+    tcp_client_close(&client, false);
+
+    return result == 0 ? (int)received : -1;
+};
+
+/** Whether or not a response starts with a status line. */
+static int http_test004_starts_with(const char *response, const char *status_line)
+{
+    return strncmp(response, status_line, strlen(status_line)) == 0;
+};
+
+/** Gets the body of a response, which starts after its head. */
+static const char *http_test004_body(const char *response, int received)
+{
+    const char *end = strstr(response, "\r\n\r\n");
+    return end == NULL ? response + (received > 0 ? received : 0) : end + 4;
+};
+
+/** Prints a failed expectation. Returns whether or not it held. */
+static int http_test004_expect(const char *name, int condition, const char *response)
+{
+    if (!condition) printf(ANSI_RED "[HTTP TEST CASE 004] %s failed:\n%.*s\n" ANSI_RESET, name, 256, response);
+    return condition;
+};
+
+static int http_test004()
+{
+    FILE *file = fopen(HTTP_TEST004_FILE, "rb");
+    if (file == NULL)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 004] could not open " HTTP_TEST004_FILE "\n" ANSI_RESET);
+        return 1;
+    };
+
+    fseek(file, 0, SEEK_END);
+    http_test004_file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    http_test004_file = malloc(http_test004_file_size);
+    http_test004_file_size = fread(http_test004_file, 1, http_test004_file_size, file);
+    fclose(file);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&http_test004_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 004] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    struct web_server_route route = { .path = "/static/*", .static_directory = "./tests/http" };
+    web_server_create_route(&http_test004_server, &route);
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &http_test004_server);
+
+    int passed = 1;
+    size_t capacity = http_test004_file_size + 1024;
+    char *response = malloc(capacity);
+    char request[512];
+    char expected[128];
+    int received = 0;
+
+    /** The whole file, whose validator the conditional requests below send back. */
+    received = http_test004_exchange("GET " HTTP_TEST004_PATH " HTTP/1.1\r\nConnection: close\r\n\r\n", response, capacity);
+    snprintf(expected, sizeof(expected), "Content-Length: %zu\r\n", http_test004_file_size);
+    passed &= http_test004_expect("full response",
+        received != -1 && http_test004_starts_with(response, "HTTP/1.1 200 OK\r\n") && strstr(response, expected) != NULL && strstr(response, "Accept-Ranges: bytes\r\n") != NULL
+        && received - (http_test004_body(response, received) - response) == (int)http_test004_file_size && memcmp(http_test004_body(response, received), http_test004_file, http_test004_file_size) == 0,
+        response);
+
+    char etag[64] = {0};
+    char *etag_header = strstr(response, "ETag: ");
+    if (etag_header != NULL) sscanf(etag_header + 6, "%63[^\r]", etag);
+
+    /** The first bytes. */
+    received = http_test004_exchange("GET " HTTP_TEST004_PATH " HTTP/1.1\r\nRange: bytes=0-9\r\nConnection: close\r\n\r\n", response, capacity);
+    snprintf(expected, sizeof(expected), "Content-Range: bytes 0-9/%zu\r\n", http_test004_file_size);
+    passed &= http_test004_expect("first bytes",
+        received != -1 && http_test004_starts_with(response, "HTTP/1.1 206 Partial Content\r\n") && strstr(response, expected) != NULL && strstr(response, "Content-Length: 10\r\n") != NULL
+        && received - (http_test004_body(response, received) - response) == 10 && memcmp(http_test004_body(response, received), http_test004_file, 10) == 0,
+        response);
+
+    /** The last bytes, with a suffix range. */
+    received = http_test004_exchange("GET " HTTP_TEST004_PATH " HTTP/1.1\r\nRange: bytes=-5\r\nConnection: close\r\n\r\n", response, capacity);
+    snprintf(expected, sizeof(expected), "Content-Range: bytes %zu-%zu/%zu\r\n", http_test004_file_size - 5, http_test004_file_size - 1, http_test004_file_size);
+    passed &= http_test004_expect("suffix range",
+        received != -1 && http_test004_starts_with(response, "HTTP/1.1 206 Partial Content\r\n") && strstr(response, expected) != NULL
+        && received - (http_test004_body(response, received) - response) == 5 && memcmp(http_test004_body(response, received), http_test004_file + http_test004_file_size - 5, 5) == 0,
+        response);
+
+    /** A range which starts past the end of the file. */
+    snprintf(request, sizeof(request), "GET " HTTP_TEST004_PATH " HTTP/1.1\r\nRange: bytes=%zu-\r\nConnection: close\r\n\r\n", http_test004_file_size);
+    received = http_test004_exchange(request, response, capacity);
+    snprintf(expected, sizeof(expected), "Content-Range: bytes */%zu\r\n", http_test004_file_size);
+    passed &= http_test004_expect("unsatisfiable range",
+        received != -1 && http_test004_starts_with(response, "HTTP/1.1 416 ") && strstr(response, expected) != NULL,
+        response);
+
+    /** A range of another version of the file is ignored. */
+    received = http_test004_exchange("GET " HTTP_TEST004_PATH " HTTP/1.1\r\nRange: bytes=0-9\r\nIf-Range: \"other\"\r\nConnection: close\r\n\r\n", response, capacity);
+    passed &= http_test004_expect("range of another version",
+        received != -1 && http_test004_starts_with(response, "HTTP/1.1 200 OK\r\n") && received - (http_test004_body(response, received) - response) == (int)http_test004_file_size,
+        response);
+
+    /** The client already has the current version. */
+    snprintf(request, sizeof(request), "GET " HTTP_TEST004_PATH " HTTP/1.1\r\nIf-None-Match: %s\r\nConnection: close\r\n\r\n", etag);
+    received = http_test004_exchange(request, response, capacity);
+    passed &= http_test004_expect("not modified",
+        etag[0] != '\0' && received != -1 && http_test004_starts_with(response, "HTTP/1.1 304 Not Modified\r\n") && strstr(response, etag) != NULL && *http_test004_body(response, received) == '\0',
+        response);
+
+    /** A HEAD request gets the head of the response without the file. */
+    received = http_test004_exchange("HEAD " HTTP_TEST004_PATH " HTTP/1.1\r\nConnection: close\r\n\r\n", response, capacity);
+    snprintf(expected, sizeof(expected), "Content-Length: %zu\r\n", http_test004_file_size);
+    passed &= http_test004_expect("head",
+        received != -1 && http_test004_starts_with(response, "HTTP/1.1 200 OK\r\n") && strstr(response, expected) != NULL && *http_test004_body(response, received) == '\0',
+        response);
+
+    /** Another connection wakes the server up once it is closed, so the server sees it stopped listening. */
+    struct sockaddr_in wake_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(wake_addr.sin_addr));
+
+    struct tcp_client wake = {0};
+    if (tcp_client_init(&wake, (struct sockaddr *)&wake_addr, 0) != 0 || tcp_client_connect(&wake) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 004] client failed to connect to wake the server\n" ANSI_RESET);
+        return 1;
+    };
+
+    usleep(100000);
+    web_server_close(&http_test004_server);
+    tcp_client_close(&wake, false);
+    pthread_join(servt, NULL);
+
+    free(response);
+    free(http_test004_file);
+
+    if (passed) printf(ANSI_GREEN "[HTTP TEST CASE 004] ranges and conditional requests were answered correctly\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // HTTP_TEST_004
@@ -0,0 +1,220 @@
+#ifndef HTTP_TEST_005
+#define HTTP_TEST_005
+
+/**
+ * TEST CASE 5: routing paths to `:name` segments and `*`, and reading the values they matched
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8085
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+static struct web_server http_test005_server = {0};
+
+static void http_test005_respond(struct web_server *server, struct web_client *client, struct http_request *request, const char *route, const char *names[], size_t count);
+static void http_test005_on_me(struct web_server *server, struct web_client *client, struct http_request *request);
+static void http_test005_on_user(struct web_server *server, struct web_client *client, struct http_request *request);
+static void http_test005_on_post(struct web_server *server, struct web_client *client, struct http_request *request);
+static void http_test005_on_file(struct web_server *server, struct web_client *client, struct http_request *request);
+static void http_test005_on_raw(struct web_server *server, struct web_client *client, struct http_request *request);
+static int http_test005_exchange(const char *request, char *response, size_t capacity);
+static int http_test005_expect(const char *request, const char *body);
+static int http_test005();
+
+/** Responds with the name of the route, followed by the values of the parameters, each after a `;`. A missing parameter is written as `?`. */
+static void http_test005_respond(struct web_server *server, struct web_client *client, struct http_request *request, const char *route, const char *names[], size_t count)
+{
+    char body[256];
+    int length = snprintf(body, sizeof(body), "%s", route);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t value_length = 0;
+        const char *value = http_request_get_param(request, names[i], &value_length);
+        if (value == NULL) length += snprintf(body + length, sizeof(body) - length, ";?");
+        else length += snprintf(body + length, sizeof(body) - length, ";%.*s", (int)value_length, value);
+    };
+
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "text/plain"} }, 1);
+    http_server_send_response(server, client, &response, body, length);
+};
+
+static void http_test005_on_me(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    http_test005_respond(server, client, request, "me", (const char *[]){ "id" }, 1);
+};
+
+static void http_test005_on_user(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    http_test005_respond(server, client, request, "user", (const char *[]){ "id" }, 1);
+};
+
+static void http_test005_on_post(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    http_test005_respond(server, client, request, "post", (const char *[]){ "id", "post" }, 2);
+};
+
+static void http_test005_on_file(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    http_test005_respond(server, client, request, "file", (const char *[]){ "*" }, 1);
+};
+
+static void http_test005_on_raw(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    http_test005_respond(server, client, request, "raw", (const char *[]){ "*", "name" }, 2);
+};
+
+/** Sends requests on a new connection, and receives until the server closes it. Returns the number of bytes received, or `-1`. */
+static int http_test005_exchange(const char *request, char *response, size_t capacity)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    struct tcp_client client = {0};
+    if (tcp_client_init(&client, (struct sockaddr *)&addr, 0) != 0 || tcp_client_connect(&client) != 0) return -1;
+
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client.sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    size_t received = 0;
+    int result = tcp_client_send(&client, request, strlen(request), 0) == strlen(request) ? 1 : -1;
+    while (result > 0 && received < capacity - 1 && (result = tcp_client_receive(&client, response + received, capacity - 1 - received, 0)) > 0) received += result;
+
+    response[received] = '\0';
+    tcp_client_close(&client, false);
+
+    return result == 0 ? (int)received : -1;
+};
+
+/** Requests a path, and checks the body of the response. Returns whether or not it was the expected one. */
+static int http_test005_expect(const char *path, const char *body)
+{
+    char request[256];
+    char response[1024];
+    snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nConnection: close\r\n\r\n", path);
+
+    int received = http_test005_exchange(request, response, sizeof(response));
+    const char *end = strstr(response, "\r\n\r\n");
+
+    if (received == -1 || strncmp(response, "HTTP/1.1 200 OK\r\n", 17) != 0 || end == NULL || strcmp(end + 4, body) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 005] %s did not respond with \"%s\":\n%s\n" ANSI_RESET, path, body, response);
+        return 0;
+    };
+
+    return 1;
+};
+
+static int http_test005()
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&http_test005_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 005] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    /** The parameter routes are created first, so the bytes of `/users/me` win over `:id` by being more specific, not by order. */
+    struct web_server_route user_route = { .path = "/users/:id", .on_http_message = http_test005_on_user };
+    struct web_server_route post_route = { .path = "/users/:id/posts/:post", .on_http_message = http_test005_on_post };
+    struct web_server_route me_route = { .path = "/users/me", .on_http_message = http_test005_on_me };
+    struct web_server_route file_route = { .path = "/files/*", .on_http_message = http_test005_on_file };
+    struct web_server_route raw_route = { .path = "/raw/*/:name", .on_http_message = http_test005_on_raw };
+    web_server_create_route(&http_test005_server, &user_route);
+    web_server_create_route(&http_test005_server, &post_route);
+    web_server_create_route(&http_test005_server, &me_route);
+    web_server_create_route(&http_test005_server, &file_route);
+    web_server_create_route(&http_test005_server, &raw_route);
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &http_test005_server);
+
+    int passed = 1;
+    passed &= http_test005_expect("/users/42", "user;42");
+    passed &= http_test005_expect("/users/me", "me;?");
+    passed &= http_test005_expect("/users/mel", "user;mel");
+    passed &= http_test005_expect("/users/42/posts/7", "post;42;7");
+    passed &= http_test005_expect("/users/42?sort=asc", "user;42");
+    passed &= http_test005_expect("/files/a/b/c.txt", "file;a/b/c.txt");
+    passed &= http_test005_expect("/files/", "file;");
+    passed &= http_test005_expect("/raw/a/b/c.txt", "raw;a/b;c.txt");
+
+    /** Paths which match no route, before one which does on the same connection so it gets closed. */
+    char response[2048];
+    const char *requests = "GET /users/ HTTP/1.1\r\n\r\n"
+        "GET /users/42/posts HTTP/1.1\r\n\r\n"
+        "GET /users/42 HTTP/1.1\r\nConnection: close\r\n\r\n";
+
+    int received = http_test005_exchange(requests, response, sizeof(response));
+    char *first = strstr(response, "HTTP/1.1 404 Not Found\r\n");
+    char *second = first != NULL ? strstr(first + 1, "HTTP/1.1 404 Not Found\r\n") : NULL;
+    char *user = strstr(response, "\r\n\r\nuser;42");
+
+    if (received == -1 || second == NULL || user == NULL || user < second)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 005] paths which match no route were not answered with 404:\n%s\n" ANSI_RESET, response);
+        passed = 0;
+    };
+
+    /** Another connection wakes the server up once it is closed, so the server sees it stopped listening. */
+    struct sockaddr_in wake_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(wake_addr.sin_addr));
+
+    struct tcp_client wake = {0};
+    if (tcp_client_init(&wake, (struct sockaddr *)&wake_addr, 0) != 0 || tcp_client_connect(&wake) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 005] client failed to connect to wake the server\n" ANSI_RESET);
+        return 1;
+    };
+
+    usleep(100000);
+    web_server_close(&http_test005_server);
+    tcp_client_close(&wake, false);
+    pthread_join(servt, NULL);
+
+    if (passed) printf(ANSI_GREEN "[HTTP TEST CASE 005] paths were routed to their parameters\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // HTTP_TEST_005
@@ -0,0 +1,179 @@
+#ifndef HTTP_TEST_006
+#define HTTP_TEST_006
+
+/**
+ * TEST CASE 6: edge triggered polling, which only reports a socket again for new bytes, so every request and body has to be read until the socket would block
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8086
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The number of requests pipelined in one write, which is far more than one read of the receive buffer takes. */
+#define HTTP_TEST006_PIPELINED 2000
+/** The size of the body sent in one write. */
+#define HTTP_TEST006_BODY_SIZE 1048576
+
+static struct web_server http_test006_server = {0};
+
+/** The number of requests the route handled. */
+static int http_test006_handled = 0;
+
+static void http_test006_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request);
+static int http_test006_exchange(const char *request, size_t request_length, char *response, size_t capacity);
+static int http_test006_count(const char *response, const char *bytes);
+static int http_test006();
+
+/** Responds with the path of the request, and the size of its body if it was received intact. */
+static void http_test006_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    ++http_test006_handled;
+
+    size_t intact = 1;
+    for (size_t i = 0; i < request->body_size; ++i) intact &= request->body[i] == (char)('a' + i % 26);
+
+    char body[128];
+    int length = snprintf(body, sizeof(body), "%s %zu", http_request_get_path(request), intact ? request->body_size : (size_t)-1);
+
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "text/plain"} }, 1);
+    http_server_send_response(server, client, &response, body, length);
+};
+
+/** Sends bytes in one write on a new connection, and receives until the server closes it. Returns the number of bytes received, or `-1`. */
+static int http_test006_exchange(const char *request, size_t request_length, char *response, size_t capacity)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    struct tcp_client client = {0};
+    if (tcp_client_init(&client, (struct sockaddr *)&addr, 0) != 0 || tcp_client_connect(&client) != 0) return -1;
+
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client.sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    size_t sent = 0;
+    int result = 1;
+    while (sent < request_length && (result = tcp_client_send(&client, request + sent, request_length - sent, 0)) > 0) sent += result;
+
+    size_t received = 0;
+    while (result > 0 && received < capacity - 1 && (result = tcp_client_receive(&client, response + received, capacity - 1 - received, 0)) > 0) received += result;
+
+    response[received] = '\0';
+    tcp_client_close(&client, false);
+
+    return result == 0 ? (int)received : -1;
+};
+
+/** Counts the occurrences of some bytes in a response. */
+static int http_test006_count(const char *response, const char *bytes)
+{
+    int count = 0;
+    for (const char *cursor = response; (cursor = strstr(cursor, bytes)) != NULL; cursor += strlen(bytes)) ++count;
+
+    return count;
+};
+
+static int http_test006()
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&http_test006_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 006] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    http_test006_server.tcp_server->edge_triggered = true;
+    http_test006_server.http_server_config.max_body_len = HTTP_TEST006_BODY_SIZE;
+
+    struct web_server_route route = { .path = "/*", .on_http_message = http_test006_server_on_data };
+    web_server_create_route(&http_test006_server, &route);
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &http_test006_server);
+
+    int passed = 1;
+    size_t capacity = 128 * HTTP_TEST006_PIPELINED;
+    char *requests = malloc(HTTP_TEST006_BODY_SIZE + 1024);
+    char *response = malloc(capacity);
+
+    /** Every request arrives in one wakeup, and only the last asks to close the connection. */
+    size_t length = 0;
+    for (int i = 0; i < HTTP_TEST006_PIPELINED - 1; ++i) length += sprintf(requests + length, "GET /%d HTTP/1.1\r\n\r\n", i);
+    length += sprintf(requests + length, "GET /last HTTP/1.1\r\nConnection: close\r\n\r\n");
+
+    int received = http_test006_exchange(requests, length, response, capacity);
+    if (received == -1 || http_test006_count(response, "HTTP/1.1 200 OK") != HTTP_TEST006_PIPELINED || strstr(response, "\r\n\r\n/last 0") == NULL)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 006] %d of %d pipelined requests were answered\n" ANSI_RESET, http_test006_count(response, "HTTP/1.1 200 OK"), HTTP_TEST006_PIPELINED);
+        passed = 0;
+    };
+
+    /** The body is received over many reads, all of them from the one edge it arrived with. */
+    length = sprintf(requests, "POST /body HTTP/1.1\r\nContent-Length: %d\r\nConnection: close\r\n\r\n", HTTP_TEST006_BODY_SIZE);
+    for (size_t i = 0; i < HTTP_TEST006_BODY_SIZE; ++i) requests[length++] = 'a' + i % 26;
+
+    char expected[64];
+    sprintf(expected, "\r\n\r\n/body %d", HTTP_TEST006_BODY_SIZE);
+
+    received = http_test006_exchange(requests, length, response, capacity);
+    if (received == -1 || strstr(response, expected) == NULL)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 006] body sent in one write was not received intact: %s\n" ANSI_RESET, received == -1 ? "(timed out)" : response);
+        passed = 0;
+    };
+
+    if (http_test006_handled != HTTP_TEST006_PIPELINED + 1)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 006] %d requests were handled instead of %d\n" ANSI_RESET, http_test006_handled, HTTP_TEST006_PIPELINED + 1);
+        passed = 0;
+    };
+
+    free(requests);
+    free(response);
+
+    web_server_close(&http_test006_server);
+    pthread_join(servt, NULL);
+
+    if (passed) printf(ANSI_GREEN "[HTTP TEST CASE 006] edge triggered sockets were read until they would block\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // HTTP_TEST_006
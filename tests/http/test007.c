@@ -0,0 +1,218 @@
+#ifndef HTTP_TEST_007
+#define HTTP_TEST_007
+
+/**
+ * TEST CASE 7: the io_uring backend, and the fallback to polling when the kernel refuses io_uring
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#endif
+
+#ifdef __linux__
+#include <stddef.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8087
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The size of the response which is too large for the socket to take at once, so the rest is sent once it is writable. */
+#define HTTP_TEST007_BIG_SIZE 4194304
+
+static struct web_server http_test007_server = {0};
+
+/** The body of the large response. */
+static char *http_test007_big = NULL;
+
+static void http_test007_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request);
+static void http_test007_server_on_big(struct web_server *server, struct web_client *client, struct http_request *request);
+static int http_test007_exchange(const char *request, char *response, size_t capacity);
+static int http_test007_serve(enum tcp_server_backend *backend);
+static int http_test007_fallback();
+static int http_test007();
+
+/** Responds with the path of the request. */
+static void http_test007_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    const char *path = http_request_get_path(request);
+
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "text/plain"} }, 1);
+    http_server_send_response(server, client, &response, path, strlen(path));
+};
+
+/** Responds with the large body. */
+static void http_test007_server_on_big(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "application/octet-stream"} }, 1);
+    http_server_send_response(server, client, &response, http_test007_big, HTTP_TEST007_BIG_SIZE);
+};
+
+/** Sends requests on a new connection, and receives until the server closes it. Returns the number of bytes received, or `-1`. */
+static int http_test007_exchange(const char *request, char *response, size_t capacity)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    struct tcp_client client = {0};
+    if (tcp_client_init(&client, (struct sockaddr *)&addr, 0) != 0 || tcp_client_connect(&client) != 0) return -1;
+
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client.sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    size_t received = 0;
+    int result = tcp_client_send(&client, request, strlen(request), 0) == strlen(request) ? 1 : -1;
+    while (result > 0 && received < capacity - 1 && (result = tcp_client_receive(&client, response + received, capacity - 1 - received, 0)) > 0) received += result;
+
+    response[received] = '\0';
+    tcp_client_close(&client, false);
+
+    return result == 0 ? (int)received : -1;
+};
+
+/** Starts a server which asks for io_uring, and checks that it serves pipelined requests and a large response. Returns whether or not it did. */
+static int http_test007_serve(enum tcp_server_backend *backend)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init_backend(&http_test007_server, (struct sockaddr *)&addr, BACKLOG, TCP_SERVER_BACKEND_IO_URING) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 007] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 0;
+    };
+
+    *backend = http_test007_server.tcp_server->backend;
+
+    struct web_server_route big_route = { .path = "/big", .on_http_message = http_test007_server_on_big };
+    struct web_server_route route = { .path = "/*", .on_http_message = http_test007_server_on_data };
+    web_server_create_route(&http_test007_server, &big_route);
+    web_server_create_route(&http_test007_server, &route);
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &http_test007_server);
+
+    int passed = 1;
+    size_t capacity = HTTP_TEST007_BIG_SIZE + 1024;
+    char *response = malloc(capacity);
+
+    int received = http_test007_exchange("GET /a HTTP/1.1\r\n\r\nGET /b HTTP/1.1\r\nConnection: close\r\n\r\n", response, capacity);
+    char *a = strstr(response, "\r\n\r\n/a");
+    char *b = strstr(response, "\r\n\r\n/b");
+    if (received == -1 || a == NULL || b == NULL || a > b)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 007] pipelined requests were not answered in order: %s\n" ANSI_RESET, response);
+        passed = 0;
+    };
+
+    received = http_test007_exchange("GET /big HTTP/1.1\r\nConnection: close\r\n\r\n", response, capacity);
+    char *body = strstr(response, "\r\n\r\n");
+    if (received == -1 || body == NULL || received - (body + 4 - response) != HTTP_TEST007_BIG_SIZE || memcmp(body + 4, http_test007_big, HTTP_TEST007_BIG_SIZE) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 007] large response was not received intact (%d bytes)\n" ANSI_RESET, received);
+        passed = 0;
+    };
+
+    free(response);
+
+    web_server_close(&http_test007_server);
+    pthread_join(servt, NULL);
+
+    return passed;
+};
+
+/** Refuses io_uring to a child process, and checks that its server falls back to polling. Returns whether or not it did. */
+static int http_test007_fallback()
+{
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+    pid_t pid = fork();
+    if (pid == -1) return 0;
+
+    if (pid == 0)
+    {
+        struct sock_filter filter[] = {
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_io_uring_setup, 0, 1),
+            BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | ENOSYS),
+            BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+        };
+        struct sock_fprog program = { .len = sizeof(filter) / sizeof(filter[0]), .filter = filter };
+
+        /** Without a filter, the fallback cannot be told apart from a kernel which has io_uring, so the check is skipped. */
+        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0 || prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program) != 0) _exit(2);
+
+        enum tcp_server_backend backend;
+        _exit(http_test007_serve(&backend) && backend == TCP_SERVER_BACKEND_POLL ? 0 : 1);
+    };
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) return 0;
+
+    return WEXITSTATUS(status) != 1;
+#else
+    return 1;
+#endif
+};
+
+static int http_test007()
+{
+    http_test007_big = malloc(HTTP_TEST007_BIG_SIZE);
+    for (size_t i = 0; i < HTTP_TEST007_BIG_SIZE; ++i) http_test007_big[i] = (char)(i * 131 >> 3);
+
+    int passed = 1;
+    enum tcp_server_backend backend = TCP_SERVER_BACKEND_POLL;
+
+    if (!http_test007_serve(&backend)) passed = 0;
+
+    /** The child has to bind the same port, which is free again now that the server closed its socket. */
+    if (!http_test007_fallback())
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 007] server did not fall back to polling without io_uring\n" ANSI_RESET);
+        passed = 0;
+    };
+
+    free(http_test007_big);
+
+    if (passed) printf(ANSI_GREEN "[HTTP TEST CASE 007] server ran on %s, and fell back to polling without io_uring\n" ANSI_RESET, backend == TCP_SERVER_BACKEND_IO_URING ? "io_uring" : "polling");
+    return passed ? 0 : 1;
+};
+
+#endif // HTTP_TEST_007
@@ -0,0 +1,264 @@
+#ifndef HTTP_TEST_008
+#define HTTP_TEST_008
+
+/**
+ * TEST CASE 8: bodies sent with MSG_ZEROCOPY, which are released once the kernel is done with them, including after their connection was closed
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8088
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The size of the bodies, which is far past the threshold and more than a small receive buffer takes. */
+#define HTTP_TEST008_BODY_SIZE 4194304
+/** The size from which bodies are sent without being copied. */
+#define HTTP_TEST008_THRESHOLD 16384
+
+static struct web_server http_test008_server = {0};
+
+/** The body which is sent, and may not be freed until it is released. */
+static char *http_test008_body = NULL;
+
+/** The number of bodies sent, and the number the server released. */
+static volatile int http_test008_sent = 0;
+static volatile int http_test008_released = 0;
+/** Whether or not the body sent before closing its connection was still referenced by the kernel, and how many bodies were released right after. */
+static volatile int http_test008_held = -1;
+static volatile int http_test008_released_at_close = -1;
+/** Whether or not the body under the threshold was released before it was sent. */
+static volatile int http_test008_small_released = 0;
+
+static void http_test008_on_sent(void *data);
+static void http_test008_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request);
+static void http_test008_server_on_small(struct web_server *server, struct web_client *client, struct http_request *request);
+static void http_test008_server_on_hold(struct web_server *server, struct web_client *client, struct http_request *request);
+static int http_test008_connect(struct tcp_client *client, int receive_buffer);
+static int http_test008_receive_until_closed(struct tcp_client *client, char *response, size_t capacity);
+static int http_test008_wait_released(int released);
+static int http_test008();
+
+static void http_test008_on_sent(void *data)
+{
+    ++http_test008_released;
+};
+
+/** Responds with the large body, without copying it. */
+static void http_test008_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    ++http_test008_sent;
+
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "application/octet-stream"} }, 1);
+    http_server_send_response_zerocopy(server, client, &response, http_test008_body, HTTP_TEST008_BODY_SIZE, http_test008_on_sent, NULL);
+};
+
+/** Responds with a body under the threshold, which is copied and so released right away. */
+static void http_test008_server_on_small(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    ++http_test008_sent;
+    int released = http_test008_released;
+
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "application/octet-stream"} }, 1);
+    http_server_send_response_zerocopy(server, client, &response, http_test008_body, 100, http_test008_on_sent, NULL);
+
+    http_test008_small_released = http_test008_released == released + 1;
+};
+
+/** Responds with the large body, and closes the connection before the kernel could send it all. */
+static void http_test008_server_on_hold(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    ++http_test008_sent;
+
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "application/octet-stream"} }, 1);
+    http_server_send_response_zerocopy(server, client, &response, http_test008_body, HTTP_TEST008_BODY_SIZE, http_test008_on_sent, NULL);
+
+    http_test008_held = client->tcp_client->zerocopy_enabled && !client->tcp_client->zerocopy_unavailable;
+    tcp_server_close_client(server->tcp_server, client->tcp_client->sockfd, false);
+    http_test008_released_at_close = http_test008_released;
+};
+
+/** Connects a blocking client, which stops waiting for bytes after a second. Returns `0`, or `-1` if it could not connect. */
+static int http_test008_connect(struct tcp_client *client, int receive_buffer)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    memset(client, 0, sizeof(struct tcp_client));
+    if (tcp_client_init(client, (struct sockaddr *)&addr, 0) != 0) return -1;
+
+    /** The buffer is sized before connecting, as it decides the window the connection starts with. */
+    if (receive_buffer > 0) setsockopt(client->sockfd, SOL_SOCKET, SO_RCVBUF, (const char *)&receive_buffer, sizeof(receive_buffer));
+    if (tcp_client_connect(client) != 0) return -1;
+
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client->sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    return 0;
+};
+
+/** Receives until the server closes the connection. Returns the number of bytes received, or `-1` if the server did not close it in time. */
+static int http_test008_receive_until_closed(struct tcp_client *client, char *response, size_t capacity)
+{
+    size_t received = 0;
+    int result = 0;
+    while (received < capacity - 1 && (result = tcp_client_receive(client, response + received, capacity - 1 - received, 0)) > 0) received += result;
+
+    response[received] = '\0';
+    return result == 0 ? (int)received : -1;
+};
+
+/** Waits up to a second for the server to release a number of bodies. Returns whether or not it did. */
+static int http_test008_wait_released(int released)
+{
+    for (int i = 0; i < 100 && http_test008_released < released; ++i) usleep(10000);
+    return http_test008_released == released;
+};
+
+static int http_test008()
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&http_test008_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 008] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    http_test008_server.tcp_server->zerocopy_threshold = HTTP_TEST008_THRESHOLD;
+
+    struct web_server_route small_route = { .path = "/small", .on_http_message = http_test008_server_on_small };
+    struct web_server_route hold_route = { .path = "/hold", .on_http_message = http_test008_server_on_hold };
+    struct web_server_route route = { .path = "/*", .on_http_message = http_test008_server_on_data };
+    web_server_create_route(&http_test008_server, &small_route);
+    web_server_create_route(&http_test008_server, &hold_route);
+    web_server_create_route(&http_test008_server, &route);
+
+    http_test008_body = malloc(HTTP_TEST008_BODY_SIZE);
+    for (size_t i = 0; i < HTTP_TEST008_BODY_SIZE; ++i) http_test008_body[i] = (char)(i * 7);
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &http_test008_server);
+
+    int passed = 1;
+    size_t capacity = 2 * HTTP_TEST008_BODY_SIZE + 1024;
+    char *response = malloc(capacity);
+    struct tcp_client client;
+
+    /** Two large bodies and a small one, each released once. */
+    const char *requests = "GET /a HTTP/1.1\r\n\r\nGET /small HTTP/1.1\r\n\r\nGET /b HTTP/1.1\r\nConnection: close\r\n\r\n";
+    if (http_test008_connect(&client, 0) != 0 || tcp_client_send(&client, requests, strlen(requests), 0) != strlen(requests))
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 008] client failed to connect or send\n" ANSI_RESET);
+        passed = 0;
+    }
+    else
+    {
+        int received = http_test008_receive_until_closed(&client, response, capacity);
+        char *a = received == -1 ? NULL : strstr(response, "\r\n\r\n");
+        char *small = a == NULL || a + 4 + HTTP_TEST008_BODY_SIZE > response + received ? NULL : strstr(a + 4 + HTTP_TEST008_BODY_SIZE, "\r\n\r\n");
+        char *b = small == NULL || small + 104 > response + received ? NULL : strstr(small + 104, "\r\n\r\n");
+
+        if (b == NULL || memcmp(a + 4, http_test008_body, HTTP_TEST008_BODY_SIZE) != 0 || memcmp(small + 4, http_test008_body, 100) != 0 || response + received - (b + 4) != HTTP_TEST008_BODY_SIZE || memcmp(b + 4, http_test008_body, HTTP_TEST008_BODY_SIZE) != 0)
+        {
+            printf(ANSI_RED "[HTTP TEST CASE 008] bodies were not received intact (%d bytes)\n" ANSI_RESET, received);
+            passed = 0;
+        };
+    };
+
+    tcp_client_close(&client, false);
+
+    if (!http_test008_small_released)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 008] copied body was not released right away\n" ANSI_RESET);
+        passed = 0;
+    };
+
+    if (!http_test008_wait_released(3))
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 008] %d of 3 bodies were released\n" ANSI_RESET, http_test008_released);
+        passed = 0;
+    };
+
+    /** The client reads slowly, so the kernel still references the body when its connection is closed. */
+    if (http_test008_connect(&client, 65536) != 0 || tcp_client_send(&client, "GET /hold HTTP/1.1\r\n\r\n", 22, 0) != 22)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 008] client failed to connect or send\n" ANSI_RESET);
+        passed = 0;
+    }
+    else
+    {
+        usleep(300000);
+
+        /** Without zerocopy (on other systems, or if the kernel refused it), the body was copied and released right away. */
+        if (http_test008_held == 1 && (http_test008_released_at_close != 3 || http_test008_released != 3))
+        {
+            printf(ANSI_RED "[HTTP TEST CASE 008] body was released while the kernel still referenced it\n" ANSI_RESET);
+            passed = 0;
+        };
+
+        http_test008_receive_until_closed(&client, response, capacity);
+    };
+
+    tcp_client_close(&client, false);
+
+    if (!http_test008_wait_released(4))
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 008] body of the closed connection was not released once the kernel was done with it\n" ANSI_RESET);
+        passed = 0;
+    };
+
+    web_server_close(&http_test008_server);
+    pthread_join(servt, NULL);
+
+    if (http_test008_released != http_test008_sent)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 008] %d bodies were sent but %d were released\n" ANSI_RESET, http_test008_sent, http_test008_released);
+        passed = 0;
+    };
+
+    free(response);
+    free(http_test008_body);
+
+    if (passed) printf(ANSI_GREEN "[HTTP TEST CASE 008] bodies sent without copying were released once, after the kernel was done with them\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // HTTP_TEST_008
@@ -0,0 +1,240 @@
+#ifndef HTTP_TEST_009
+#define HTTP_TEST_009
+
+/**
+ * TEST CASE 9: the header, body, and keep-alive timeouts, which close a connection that takes too long, answering a late request with 408
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8089
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The timeouts of the server, in milliseconds. */
+#define HTTP_TEST009_HEADER_TIMEOUT 200
+#define HTTP_TEST009_BODY_TIMEOUT 200
+#define HTTP_TEST009_KEEP_ALIVE_TIMEOUT 300
+/** How much later than its timeout a connection may be closed, as the timer wheel only checks it so often. */
+#define HTTP_TEST009_SLACK 400
+
+static struct web_server http_test009_server = {0};
+
+/** The number of requests which the server reported as timed out. */
+static volatile int http_test009_timeouts = 0;
+
+static void http_test009_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request);
+static void http_test009_server_on_malformed_request(struct web_server *server, struct web_client *client, enum parse_request_error_types error);
+static long http_test009_now();
+static int http_test009_connect(struct tcp_client *client);
+static int http_test009_receive_until_closed(struct tcp_client *client, char *response, size_t capacity);
+static int http_test009_closed_in_time(long start, long timeout);
+static int http_test009();
+
+static void http_test009_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "text/plain"} }, 1);
+    http_server_send_response(server, client, &response, "ok", 2);
+};
+
+static void http_test009_server_on_malformed_request(struct web_server *server, struct web_client *client, enum parse_request_error_types error)
+{
+    if (error == REQUEST_PARSE_ERROR_TIMEOUT) ++http_test009_timeouts;
+};
+
+/** Returns the milliseconds of a monotonic clock. */
+static long http_test009_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+};
+
+/** Connects a blocking client, which stops waiting for bytes after two seconds. Returns `0`, or `-1` if it could not connect. */
+static int http_test009_connect(struct tcp_client *client)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    memset(client, 0, sizeof(struct tcp_client));
+    if (tcp_client_init(client, (struct sockaddr *)&addr, 0) != 0 || tcp_client_connect(client) != 0) return -1;
+
+    struct timeval timeout = { .tv_sec = 2, .tv_usec = 0 };
+    setsockopt(client->sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    return 0;
+};
+
+/** Receives until the server closes the connection. Returns the number of bytes received, or `-1` if the server did not close it in time. */
+static int http_test009_receive_until_closed(struct tcp_client *client, char *response, size_t capacity)
+{
+    size_t received = 0;
+    int result = 0;
+    while (received < capacity - 1 && (result = tcp_client_receive(client, response + received, capacity - 1 - received, 0)) > 0) received += result;
+
+    response[received] = '\0';
+    return result == 0 ? (int)received : -1;
+};
+
+/** Returns whether or not a connection was closed no sooner than its timeout, and not much later. */
+static int http_test009_closed_in_time(long start, long timeout)
+{
+    long elapsed = http_test009_now() - start;
+    return elapsed >= timeout - 50 && elapsed < timeout + HTTP_TEST009_SLACK;
+};
+
+static int http_test009()
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&http_test009_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 009] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    http_test009_server.http_server_config.header_timeout = HTTP_TEST009_HEADER_TIMEOUT;
+    http_test009_server.http_server_config.body_timeout = HTTP_TEST009_BODY_TIMEOUT;
+    http_test009_server.http_server_config.keep_alive_timeout = HTTP_TEST009_KEEP_ALIVE_TIMEOUT;
+    http_test009_server.on_http_malformed_request = http_test009_server_on_malformed_request;
+
+    struct web_server_route route = { .path = "/*", .on_http_message = http_test009_server_on_data };
+    web_server_create_route(&http_test009_server, &route);
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &http_test009_server);
+
+    int passed = 1;
+    char response[4096];
+    struct tcp_client client;
+
+    /** A connection which never sends a request is answered with 408 once the header timeout passes. */
+    long start = http_test009_now();
+    if (http_test009_connect(&client) != 0 || http_test009_receive_until_closed(&client, response, sizeof(response)) == -1 || strstr(response, "408") == NULL || !http_test009_closed_in_time(start, HTTP_TEST009_HEADER_TIMEOUT))
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 009] silent connection was not timed out after its header timeout: %s\n" ANSI_RESET, response);
+        passed = 0;
+    };
+
+    tcp_client_close(&client, false);
+
+    /** Trickling the headers does not extend the header timeout, which counts from the first byte of the request. */
+    const char *request = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    start = http_test009_now();
+    if (http_test009_connect(&client) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 009] client failed to connect\n" ANSI_RESET);
+        passed = 0;
+    }
+    else
+    {
+        for (size_t i = 0; i < strlen(request) && http_test009_now() - start < HTTP_TEST009_HEADER_TIMEOUT + HTTP_TEST009_SLACK; ++i)
+        {
+            if (send(client.sockfd, request + i, 1, MSG_NOSIGNAL) != 1) break;
+            usleep(50000);
+        };
+
+        if (http_test009_receive_until_closed(&client, response, sizeof(response)) == -1 || strstr(response, "408") == NULL || strstr(response, "200") != NULL || !http_test009_closed_in_time(start, HTTP_TEST009_HEADER_TIMEOUT))
+        {
+            printf(ANSI_RED "[HTTP TEST CASE 009] trickled headers were not timed out after the header timeout: %s\n" ANSI_RESET, response);
+            passed = 0;
+        };
+    };
+
+    tcp_client_close(&client, false);
+
+    /** A body which stops arriving is timed out once the body timeout passes. */
+    request = "POST / HTTP/1.1\r\nContent-Length: 10\r\n\r\n12345";
+    start = http_test009_now();
+    if (http_test009_connect(&client) != 0 || tcp_client_send(&client, request, strlen(request), 0) != strlen(request) || http_test009_receive_until_closed(&client, response, sizeof(response)) == -1 || strstr(response, "408") == NULL || !http_test009_closed_in_time(start, HTTP_TEST009_BODY_TIMEOUT))
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 009] partial body was not timed out after the body timeout: %s\n" ANSI_RESET, response);
+        passed = 0;
+    };
+
+    tcp_client_close(&client, false);
+
+    /** Requests spaced under the keep-alive timeout keep the connection open, which is closed without a response once it idles for longer. */
+    request = "GET / HTTP/1.1\r\n\r\n";
+    int answered = 0;
+    if (http_test009_connect(&client) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 009] client failed to connect\n" ANSI_RESET);
+        passed = 0;
+    }
+    else
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (tcp_client_send(&client, request, strlen(request), 0) != strlen(request)) break;
+            usleep(HTTP_TEST009_KEEP_ALIVE_TIMEOUT * 2 / 3 * 1000);
+
+            int result = recv(client.sockfd, response, sizeof(response) - 1, MSG_DONTWAIT);
+            if (result <= 0) break;
+
+            response[result] = '\0';
+            if (strstr(response, "200 OK") != NULL) ++answered;
+        };
+
+        start = http_test009_now() - HTTP_TEST009_KEEP_ALIVE_TIMEOUT * 2 / 3;
+        if (answered != 3 || http_test009_receive_until_closed(&client, response, sizeof(response)) != 0 || !http_test009_closed_in_time(start, HTTP_TEST009_KEEP_ALIVE_TIMEOUT))
+        {
+            printf(ANSI_RED "[HTTP TEST CASE 009] idle connection was not closed after the keep-alive timeout (%d of 3 requests answered)\n" ANSI_RESET, answered);
+            passed = 0;
+        };
+    };
+
+    tcp_client_close(&client, false);
+
+    /** The idle connection is closed without a request to report. */
+    if (http_test009_timeouts != 3)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 009] %d requests were reported as timed out instead of 3\n" ANSI_RESET, http_test009_timeouts);
+        passed = 0;
+    };
+
+    web_server_close(&http_test009_server);
+    pthread_join(servt, NULL);
+
+    if (passed) printf(ANSI_GREEN "[HTTP TEST CASE 009] slow requests were answered with 408, and idle connections were closed after their timeouts\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // HTTP_TEST_009
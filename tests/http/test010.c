@@ -0,0 +1,178 @@
+#ifndef HTTP_TEST_010
+#define HTTP_TEST_010
+
+/**
+ * TEST CASE 10: the slab of connections, which refuses connections past its capacity and hands a freed slot to the next connection zeroed
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8090
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The number of connections the server has slots for. */
+#define HTTP_TEST010_MAX_CONNECTIONS 2
+
+static struct web_server http_test010_server = {0};
+
+/** The client of the last request, and the marker its handler leaves in it. */
+static struct web_client *volatile http_test010_client = NULL;
+static int http_test010_marker = 0;
+
+static void http_test010_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request);
+static int http_test010_connect(struct tcp_client *client);
+static int http_test010_request(struct tcp_client *client, const char *expected);
+static int http_test010();
+
+/** Responds with whether or not the client was zeroed, which it only is before its first request, and marks it. */
+static void http_test010_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    const char *body = client->data == NULL && client->route == NULL && client->deflate == NULL ? "zeroed" : "marked";
+    client->data = &http_test010_marker;
+    http_test010_client = client;
+
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "text/plain"} }, 1);
+    http_server_send_response(server, client, &response, body, strlen(body));
+};
+
+/** Connects a blocking client, which stops waiting for bytes after a second. Returns `0`, or `-1` if it could not connect. */
+static int http_test010_connect(struct tcp_client *client)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    memset(client, 0, sizeof(struct tcp_client));
+    if (tcp_client_init(client, (struct sockaddr *)&addr, 0) != 0 || tcp_client_connect(client) != 0) return -1;
+
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client->sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    return 0;
+};
+
+/** Sends a request on a connection, and returns whether or not its response ends with the expected body. */
+static int http_test010_request(struct tcp_client *client, const char *expected)
+{
+    const char *request = "GET / HTTP/1.1\r\n\r\n";
+    if (tcp_client_send(client, request, strlen(request), 0) != strlen(request)) return 0;
+
+    char response[1024];
+    size_t received = 0;
+    int result = 0;
+
+    /** The response is complete once its body arrived, as the connection is kept alive. */
+    while (received < sizeof(response) - 1 && (result = tcp_client_receive(client, response + received, sizeof(response) - 1 - received, 0)) > 0)
+    {
+        received += result;
+        response[received] = '\0';
+
+        char *body = strstr(response, "\r\n\r\n");
+        if (body != NULL && strlen(body + 4) >= strlen(expected)) return strcmp(body + 4, expected) == 0;
+    };
+
+    return 0;
+};
+
+static int http_test010()
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&http_test010_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 010] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    http_test010_server.max_connections = HTTP_TEST010_MAX_CONNECTIONS;
+
+    struct web_server_route route = { .path = "/*", .on_http_message = http_test010_server_on_data };
+    web_server_create_route(&http_test010_server, &route);
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &http_test010_server);
+
+    int passed = 1;
+    struct tcp_client first, second, refused, reused;
+
+    /** Each connection starts zeroed, and keeps its slot across its requests. */
+    if (http_test010_connect(&first) != 0 || !http_test010_request(&first, "zeroed") || !http_test010_request(&first, "marked"))
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 010] first connection did not start zeroed and keep its slot\n" ANSI_RESET);
+        passed = 0;
+    };
+
+    struct web_client *first_client = http_test010_client;
+
+    if (http_test010_connect(&second) != 0 || !http_test010_request(&second, "zeroed") || http_test010_client == first_client)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 010] second connection did not get a slot of its own\n" ANSI_RESET);
+        passed = 0;
+    };
+
+    /** Every slot is in use, so the connection is closed without being served. */
+    char byte;
+    if (http_test010_connect(&refused) != 0 || tcp_client_receive(&refused, &byte, 1, 0) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 010] connection past the capacity of the slab was not refused\n" ANSI_RESET);
+        passed = 0;
+    };
+
+    tcp_client_close(&refused, false);
+
+    /** The slot of a closed connection is handed to the next one, without what the last one left in it. */
+    tcp_client_close(&first, false);
+    usleep(100000);
+
+    if (http_test010_connect(&reused) != 0 || !http_test010_request(&reused, "zeroed") || http_test010_client != first_client || !http_test010_request(&reused, "marked"))
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 010] slot of a closed connection was not reused zeroed\n" ANSI_RESET);
+        passed = 0;
+    };
+
+    tcp_client_close(&second, false);
+    tcp_client_close(&reused, false);
+
+    web_server_close(&http_test010_server);
+    pthread_join(servt, NULL);
+
+    if (passed) printf(ANSI_GREEN "[HTTP TEST CASE 010] connections past the slab were refused, and freed slots were reused zeroed\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // HTTP_TEST_010
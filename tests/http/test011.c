@@ -0,0 +1,198 @@
+#ifndef HTTP_TEST_011
+#define HTTP_TEST_011
+
+/**
+ * TEST CASE 11: the arena requests are parsed into, which is reset after each request and keeps its pages for the next ones on the connection
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8091
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The number of requests sent of each size, one after another on the same connection. */
+#define HTTP_TEST011_REQUESTS 20
+/** The number of headers of each request besides its length, which is more than the headers of a request start with room for. */
+#define HTTP_TEST011_HEADERS 40
+/** The size of the bodies, the large one being larger than a page of the arena. */
+#define HTTP_TEST011_BODY_SIZE 2000
+#define HTTP_TEST011_LARGE_BODY_SIZE 20000
+
+static struct web_server http_test011_server = {0};
+
+/** The number of requests handled, and whether or not each of them was parsed intact. */
+static int http_test011_handled = 0;
+static int http_test011_intact = 1;
+/** The pages of the arena and where the body was allocated, for each request. */
+static size_t http_test011_pages[2 * HTTP_TEST011_REQUESTS + 1] = {0};
+static char *http_test011_bodies[2 * HTTP_TEST011_REQUESTS + 1] = {0};
+
+static void http_test011_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request);
+static size_t http_test011_count_pages(struct arena *arena);
+static int http_test011_request(struct tcp_client *client, int index, size_t body_size);
+static int http_test011();
+
+/** Records the arena of a request, and checks that its headers and body are the ones it was sent with. */
+static void http_test011_server_on_data(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    int index = http_test011_handled++;
+
+    struct http_header *header = http_request_get_header(request, "X-Index");
+    int intact = header != NULL && atoi(sso_string_get(&header->value)) == index && request->headers.size == HTTP_TEST011_HEADERS + 1;
+    for (size_t i = 0; intact && i < request->body_size; ++i) intact = request->body[i] == (char)('a' + (index + i) % 26);
+
+    if (!intact) http_test011_intact = 0;
+
+    if (index < (int)(sizeof(http_test011_pages) / sizeof(http_test011_pages[0])))
+    {
+        http_test011_pages[index] = http_test011_count_pages(&client->request_arena);
+        http_test011_bodies[index] = request->body;
+    };
+
+    struct http_response response = {0};
+    http_response_build(&response, "HTTP/1.1", 200, (char *[][2]){ {"Content-Type", "text/plain"} }, 1);
+    http_server_send_response(server, client, &response, "ok", 2);
+};
+
+/** Counts the pages of an arena. */
+static size_t http_test011_count_pages(struct arena *arena)
+{
+    size_t count = 0;
+    for (struct arena_page *page = arena->pages; page != NULL; page = page->next) ++count;
+
+    return count;
+};
+
+/** Sends a request with many headers and a body, and returns whether or not it was answered. */
+static int http_test011_request(struct tcp_client *client, int index, size_t body_size)
+{
+    static char request[HTTP_TEST011_LARGE_BODY_SIZE + 4096];
+
+    size_t length = sprintf(request, "POST / HTTP/1.1\r\nX-Index: %d\r\nContent-Length: %zu\r\n", index, body_size);
+    for (int i = 0; i < HTTP_TEST011_HEADERS - 1; ++i) length += sprintf(request + length, "X-Header-%d: value-%d\r\n", i, index);
+    length += sprintf(request + length, "\r\n");
+    for (size_t i = 0; i < body_size; ++i) request[length++] = 'a' + (index + i) % 26;
+
+    if (tcp_client_send(client, request, length, 0) != length) return 0;
+
+    /** The response is complete once its body arrived, as the connection is kept alive. */
+    char response[1024];
+    size_t received = 0;
+    int result = 0;
+    while (received < sizeof(response) - 1 && (result = tcp_client_receive(client, response + received, sizeof(response) - 1 - received, 0)) > 0)
+    {
+        received += result;
+        response[received] = '\0';
+
+        char *body = strstr(response, "\r\n\r\n");
+        if (body != NULL && strlen(body + 4) >= 2) return strcmp(body + 4, "ok") == 0;
+    };
+
+    return 0;
+};
+
+static int http_test011()
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&http_test011_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 011] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    http_test011_server.http_server_config.max_header_count = HTTP_TEST011_HEADERS + 1;
+
+    struct web_server_route route = { .path = "/*", .on_http_message = http_test011_server_on_data };
+    web_server_create_route(&http_test011_server, &route);
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &http_test011_server);
+
+    struct sockaddr_in server_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(server_addr.sin_addr));
+
+    int passed = 1;
+    struct tcp_client client = {0};
+    if (tcp_client_init(&client, (struct sockaddr *)&server_addr, 0) != 0 || tcp_client_connect(&client) != 0)
+    {
+        printf(ANSI_RED "[HTTP TEST CASE 011] client failed to connect\n" ANSI_RESET);
+        passed = 0;
+    }
+    else
+    {
+        struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+        setsockopt(client.sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+        /** Requests of one size, then one larger than a page, then the first size again. */
+        int answered = 0, index = 0;
+        for (int i = 0; i < HTTP_TEST011_REQUESTS; ++i) answered += http_test011_request(&client, index++, HTTP_TEST011_BODY_SIZE);
+        answered += http_test011_request(&client, index++, HTTP_TEST011_LARGE_BODY_SIZE);
+        for (int i = 0; i < HTTP_TEST011_REQUESTS; ++i) answered += http_test011_request(&client, index++, HTTP_TEST011_BODY_SIZE);
+
+        if (answered != index || http_test011_handled != index || !http_test011_intact)
+        {
+            printf(ANSI_RED "[HTTP TEST CASE 011] %d of %d requests were answered intact\n" ANSI_RESET, http_test011_intact ? answered : 0, index);
+            passed = 0;
+        };
+
+        /** Each request is allocated where the last one was, as the arena was reset in between without freeing its pages. */
+        int reused = 1;
+        for (int i = 1; i < HTTP_TEST011_REQUESTS; ++i) reused &= http_test011_pages[i] == http_test011_pages[0] && http_test011_bodies[i] == http_test011_bodies[0];
+
+        /** The large request takes a page of its own, which is kept, so the smaller requests after it need no more pages. */
+        size_t large_pages = http_test011_pages[HTTP_TEST011_REQUESTS];
+        for (int i = HTTP_TEST011_REQUESTS + 1; i < index; ++i) reused &= http_test011_pages[i] == large_pages && http_test011_bodies[i] == http_test011_bodies[0];
+
+        if (!reused || large_pages <= http_test011_pages[0])
+        {
+            printf(ANSI_RED "[HTTP TEST CASE 011] arena did not reuse its pages across requests (%zu pages, %zu after the large request)\n" ANSI_RESET, http_test011_pages[0], large_pages);
+            passed = 0;
+        };
+    };
+
+    tcp_client_close(&client, false);
+
+    web_server_close(&http_test011_server);
+    pthread_join(servt, NULL);
+
+    if (passed) printf(ANSI_GREEN "[HTTP TEST CASE 011] requests were parsed intact into an arena which kept its pages across them\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // HTTP_TEST_011
@@ -56,6 +56,9 @@ static int tcp_test001_client_connect = 0;
 static int tcp_test001_client_data = 0;
 static int tcp_test001_client_disconnect = 0;
 
+/** The client accepted by the server, which has to outlive its connection. */
+static struct tcp_client tcp_test001_server_client = {0};
+
 static void *tcp_test001_server_thread_nonblocking_main(void *arg);
 static void tcp_test001_server_on_connect(struct tcp_server *server);
 static void tcp_test001_server_on_data(struct tcp_server *server, socket_t sockfd);
@@ -79,10 +82,9 @@ static void *tcp_test001_server_thread_nonblocking_main(void *arg)
 
 static void tcp_test001_server_on_connect(struct tcp_server *server)
 {
-    struct tcp_client client = {};
-    tcp_server_accept(server, &client);
+    tcp_server_accept(server, &tcp_test001_server_client);
 
-    printf("[TCP TEST CASE 001] new socket connected. socket id: %d\n", client.sockfd);
+    printf("[TCP TEST CASE 001] new socket connected. socket id: %d\n", tcp_test001_server_client.sockfd);
     tcp_test001_server_connect++;
 };
 
@@ -235,10 +237,7 @@ static int tcp_test001()
         return 1;
     };
 
-    pthread_t client_thread;
-    pthread_create(&client_thread, NULL, tcp_test001_client_thread_nonblocking_main, client);
-
-
+    /** The client connects before its loop starts polling, since an unconnected socket already reports a hangup. */
     int client_connect_result = 0;
     if ((client_connect_result = tcp_client_connect(client)) != 0)
     {
@@ -246,6 +245,9 @@ static int tcp_test001()
         return 1;
     };
 
+    pthread_t client_thread;
+    pthread_create(&client_thread, NULL, tcp_test001_client_thread_nonblocking_main, client);
+
     pthread_join(client_thread, NULL);
     pthread_join(server_thread, NULL);
 
@@ -0,0 +1,208 @@
+#ifndef TCP_TEST_003
+#define TCP_TEST_003
+
+/**
+ * TEST CASE 3: nonblocking server queueing what a slow client does not read yet
+*/
+
+#include "../../include/tcp/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <unistd.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8925
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The size of the payload, which is far more than the socket buffers of both sides hold. */
+#define TCP_TEST003_PAYLOAD_LENGTH (4 * 1024 * 1024)
+
+static struct tcp_client *tcp_test003_server_client = NULL;
+static char *tcp_test003_payload = NULL;
+
+/** At the end of this test, all of these values must equal 1 unless otherwise specified. */
+static int tcp_test003_sent = 0; // every send reported its whole length as sent or queued
+static int tcp_test003_queued = 0; // bytes were left queued after the sends returned
+static int tcp_test003_backpressured = 0; // the client was backpressured past the high watermark
+static int tcp_test003_drained = 0; // `on_drain` was called once, and the client was no longer backpressured by then
+static int tcp_test003_received = 0; // the client received every byte in order
+
+static void *tcp_test003_server_thread_main(void *arg);
+static void tcp_test003_server_on_connect(struct tcp_server *server);
+static void tcp_test003_server_on_data(struct tcp_server *server, socket_t sockfd);
+static void tcp_test003_server_on_drain(struct tcp_server *server, socket_t sockfd);
+static void tcp_test003_server_on_disconnect(struct tcp_server *server, socket_t sockfd, bool is_error);
+static int tcp_test003();
+
+static void *tcp_test003_server_thread_main(void *arg)
+{
+    struct tcp_server *server = (struct tcp_server *)arg;
+    if (tcp_server_main_loop(server) != 0) netc_perror(ANSI_RED "[TCP TEST CASE 003] server main loop aborted");
+
+    return NULL;
+};
+
+static void tcp_test003_server_on_connect(struct tcp_server *server)
+{
+    tcp_test003_server_client = calloc(1, sizeof(struct tcp_client));
+    if (tcp_server_accept(server, tcp_test003_server_client) != 0) return;
+
+    /** A small send buffer makes the socket take far less than one send offers. */
+    setsockopt(tcp_test003_server_client->sockfd, SOL_SOCKET, SO_SNDBUF, &(int){16384}, sizeof(int));
+};
+
+static void tcp_test003_server_on_data(struct tcp_server *server, socket_t sockfd)
+{
+    char request[3] = {0};
+    if (tcp_server_receive(sockfd, request, 2, 0) != 2) return;
+
+    struct tcp_client *client = tcp_test003_server_client;
+
+    /** The payload is sent in two parts, and the end marker has to arrive after both of them. */
+    struct iovec payload[2] = {
+        { .iov_base = tcp_test003_payload, .iov_len = TCP_TEST003_PAYLOAD_LENGTH / 2 },
+        { .iov_base = tcp_test003_payload + TCP_TEST003_PAYLOAD_LENGTH / 2, .iov_len = TCP_TEST003_PAYLOAD_LENGTH / 2 },
+    };
+    struct iovec end = { .iov_base = "end", .iov_len = 3 };
+
+    ssize_t payload_result = tcp_server_send_queued(server, client, payload, 2);
+    ssize_t end_result = tcp_server_send_queued(server, client, &end, 1);
+
+    tcp_test003_sent = payload_result == TCP_TEST003_PAYLOAD_LENGTH && end_result == 3;
+    tcp_test003_queued = socket_buffer_available(&client->send_buffer) > 0;
+    tcp_test003_backpressured = tcp_server_is_backpressured(server, client);
+};
+
+static void tcp_test003_server_on_drain(struct tcp_server *server, socket_t sockfd)
+{
+    tcp_test003_drained += !tcp_server_is_backpressured(server, tcp_test003_server_client) && socket_buffer_available(&tcp_test003_server_client->send_buffer) == 0;
+};
+
+static void tcp_test003_server_on_disconnect(struct tcp_server *server, socket_t sockfd, bool is_error)
+{
+    if (sockfd == server->sockfd) return;
+
+    tcp_server_close_self(server);
+};
+
+static int tcp_test003()
+{
+    tcp_test003_payload = malloc(TCP_TEST003_PAYLOAD_LENGTH);
+    for (size_t i = 0; i < TCP_TEST003_PAYLOAD_LENGTH; ++i) tcp_test003_payload[i] = (char)(i % 251);
+
+    struct tcp_server *server = calloc(1, sizeof(struct tcp_server));
+    server->on_connect = tcp_test003_server_on_connect;
+    server->on_data = tcp_test003_server_on_data;
+    server->on_drain = tcp_test003_server_on_drain;
+    server->on_disconnect = tcp_test003_server_on_disconnect;
+
+    struct sockaddr_in saddr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (tcp_server_init(server, (struct sockaddr *)&saddr, 1) != 0)
+    {
+        netc_perror(ANSI_RED "[TCP TEST CASE 003] server failed to initialize");
+        return 1;
+    };
+
+    server->send_high_watermark = 65536;
+    setsockopt(server->sockfd, SOL_SOCKET, SO_REUSEADDR, &(int){1}, sizeof(int));
+
+    if (tcp_server_bind(server) != 0 || tcp_server_listen(server, BACKLOG) != 0)
+    {
+        netc_perror(ANSI_RED "[TCP TEST CASE 003] server failed to bind or listen");
+        return 1;
+    };
+
+    pthread_t server_thread;
+    pthread_create(&server_thread, NULL, tcp_test003_server_thread_main, server);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    struct tcp_client client = {0};
+    if (tcp_client_init(&client, (struct sockaddr *)&addr, 0) != 0)
+    {
+        netc_perror(ANSI_RED "[TCP TEST CASE 003] client failed to initialize");
+        return 1;
+    };
+
+    setsockopt(client.sockfd, SOL_SOCKET, SO_RCVBUF, &(int){16384}, sizeof(int));
+
+    if (tcp_client_connect(&client) != 0 || tcp_client_send(&client, "go", 2, 0) != 2)
+    {
+        netc_perror(ANSI_RED "[TCP TEST CASE 003] client failed to connect or send");
+        return 1;
+    };
+
+    /** The client does not read for a while, so the server has to queue most of the payload. */
+    usleep(100000);
+
+    char *received = malloc(TCP_TEST003_PAYLOAD_LENGTH + 3);
+    size_t received_length = 0;
+    while (received_length < TCP_TEST003_PAYLOAD_LENGTH + 3)
+    {
+        int result = tcp_client_receive(&client, received + received_length, TCP_TEST003_PAYLOAD_LENGTH + 3 - received_length, 0);
+        if (result <= 0) break;
+
+        received_length += result;
+    };
+
+    tcp_test003_received = received_length == TCP_TEST003_PAYLOAD_LENGTH + 3
+        && memcmp(received, tcp_test003_payload, TCP_TEST003_PAYLOAD_LENGTH) == 0
+        && memcmp(received + TCP_TEST003_PAYLOAD_LENGTH, "end", 3) == 0;
+
+    tcp_client_close(&client, false);
+    pthread_join(server_thread, NULL);
+
+    free(received);
+    free(tcp_test003_payload);
+
+    if (tcp_test003_sent != 1) printf(ANSI_RED "[SERVER_SEND] server failed to send or queue every byte\n" ANSI_RESET);
+    else printf(ANSI_GREEN "[SERVER_SEND] server sent or queued every byte\n" ANSI_RESET);
+
+    if (tcp_test003_queued != 1) printf(ANSI_RED "[SERVER_QUEUE] server did not queue what the socket could not take\n" ANSI_RESET);
+    else printf(ANSI_GREEN "[SERVER_QUEUE] server queued what the socket could not take\n" ANSI_RESET);
+
+    if (tcp_test003_backpressured != 1) printf(ANSI_RED "[SERVER_BACKPRESSURE] client was not backpressured past the high watermark\n" ANSI_RESET);
+    else printf(ANSI_GREEN "[SERVER_BACKPRESSURE] client was backpressured past the high watermark\n" ANSI_RESET);
+
+    if (tcp_test003_drained != 1) printf(ANSI_RED "[SERVER_DRAIN] on_drain was called %d times\n" ANSI_RESET, tcp_test003_drained);
+    else printf(ANSI_GREEN "[SERVER_DRAIN] on_drain was called once the queue drained\n" ANSI_RESET);
+
+    if (tcp_test003_received != 1) printf(ANSI_RED "[CLIENT_DATA] client received %zu bytes, or received them out of order\n\n\n" ANSI_RESET, received_length);
+    else printf(ANSI_GREEN "[CLIENT_DATA] client received every byte in order\n\n\n" ANSI_RESET);
+
+    return (int)(!(tcp_test003_sent == 1 && tcp_test003_queued == 1 && tcp_test003_backpressured == 1 && tcp_test003_drained == 1 && tcp_test003_received == 1));
+};
+
+#endif // TCP_TEST_003
@@ -0,0 +1,187 @@
+#ifndef WS_TEST_002
+#define WS_TEST_002
+
+/**
+ * TEST CASE 2: permessage-deflate round trips between a server and a client, at every window size and with and without context takeover
+*/
+
+#include "../../include/ws/deflate.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The length of a message, which is longer than the largest window so matches are found both inside and outside of it. */
+#define WS_TEST002_MESSAGE_LENGTH (96 * 1024)
+/** The number of messages sent in each direction, so the later ones are compressed with the context of the earlier ones. */
+#define WS_TEST002_MESSAGE_COUNT 3
+
+static int ws_test002_fill(uint8_t *message, size_t length, uint32_t seed);
+static int ws_test002_round_trip(struct ws_deflate *sender, struct ws_deflate *receiver, const uint8_t *message, size_t length, size_t *compressed_length);
+static int ws_test002_negotiate(uint8_t window_bits, bool no_context_takeover, struct ws_deflate **server, struct ws_deflate **client);
+static int ws_test002_window(uint8_t window_bits, bool no_context_takeover, const uint8_t *message);
+static int ws_test002();
+
+/** Fills a message with words picked at random from a small vocabulary, so it compresses but does not repeat itself at any one distance. */
+static int ws_test002_fill(uint8_t *message, size_t length, uint32_t seed)
+{
+    static const char *words[] = { "frame ", "mask ", "opcode ", "payload ", "deflate ", "window ", "context ", "takeover ", "socket ", "topic " };
+
+    size_t size = 0;
+    while (size < length)
+    {
+        seed = seed * 1103515245 + 12345;
+        const char *word = words[(seed >> 16) % (sizeof(words) / sizeof(words[0]))];
+
+        size_t word_length = strlen(word);
+        if (word_length > length - size) word_length = length - size;
+
+        memcpy(message + size, word, word_length);
+        size += word_length;
+    };
+
+    return 0;
+};
+
+/** Compresses a message on one end and inflates it on the other. Returns whether or not the same bytes came out. */
+static int ws_test002_round_trip(struct ws_deflate *sender, struct ws_deflate *receiver, const uint8_t *message, size_t length, size_t *compressed_length)
+{
+    struct vector compressed = {0};
+    struct vector inflated = {0};
+
+    int matches = ws_deflate_compress(sender, message, length, &compressed) == 0
+        && ws_deflate_decompress(receiver, compressed.elements, compressed.size, &inflated, length) == 0
+        && inflated.size == length && memcmp(inflated.elements, message, length) == 0;
+
+    *compressed_length = compressed.size;
+
+    if (compressed.elements != NULL) vector_free(&compressed);
+    if (inflated.elements != NULL) vector_free(&inflated);
+
+    return matches;
+};
+
+/** Negotiates permessage-deflate with both ends asking for a window, the way a handshake does, and creates the state of both ends. Returns `0`, or `-1` if it was refused. */
+static int ws_test002_negotiate(uint8_t window_bits, bool no_context_takeover, struct ws_deflate **server, struct ws_deflate **client)
+{
+    struct ws_deflate_config client_config = { .enabled = true, .options = { .server_no_context_takeover = no_context_takeover, .client_no_context_takeover = no_context_takeover, .server_max_window_bits = window_bits, .client_max_window_bits = window_bits } };
+    struct ws_deflate_config server_config = { .enabled = true };
+
+    char offer[256];
+    char response[256];
+    struct ws_deflate_options server_negotiated = {0};
+    struct ws_deflate_options client_negotiated = {0};
+
+    ws_deflate_format_offer(&client_config, offer, sizeof(offer));
+    if (ws_deflate_accept_offer(offer, &server_config, &server_negotiated) != 0) return -1;
+
+    ws_deflate_format_response(&server_negotiated, response, sizeof(response));
+    if (ws_deflate_accept_response(response, &client_negotiated) != 0) return -1;
+
+    *server = ws_deflate_create(&server_negotiated, &server_config, true, NULL);
+    *client = ws_deflate_create(&client_negotiated, &client_config, false, NULL);
+
+    return *server != NULL && *client != NULL ? 0 : -1;
+};
+
+/** Sends messages both ways with a window. Returns whether or not every message came out as it went in. */
+static int ws_test002_window(uint8_t window_bits, bool no_context_takeover, const uint8_t *message)
+{
+    struct ws_deflate *server = NULL;
+    struct ws_deflate *client = NULL;
+
+    if (ws_test002_negotiate(window_bits, no_context_takeover, &server, &client) != 0)
+    {
+        printf(ANSI_RED "[WS TEST CASE 002] window of %d bits%s was not negotiated\n" ANSI_RESET, window_bits, no_context_takeover ? " without context takeover" : "");
+        ws_deflate_free(server);
+        ws_deflate_free(client);
+        return 0;
+    };
+
+    int passed = 1;
+    size_t compressed_length = 0;
+
+    for (int i = 0; i < WS_TEST002_MESSAGE_COUNT && passed; ++i)
+    {
+        passed &= ws_test002_round_trip(server, client, message + i, WS_TEST002_MESSAGE_LENGTH - i, &compressed_length);
+        passed &= ws_test002_round_trip(client, server, message + i, WS_TEST002_MESSAGE_LENGTH - i, &compressed_length);
+    };
+
+    /** 
+     * Random bytes which fit in the window are sent twice, and only compress to less the second time if the context was taken over.
+     * They only match the copy sent before them, which is what the second one is compressed against.
+    */
+    uint8_t noise[(1 << WS_DEFLATE_MAX_WINDOW_BITS) / 4];
+    size_t noise_length = ((size_t)1 << window_bits) / 4;
+
+    uint32_t seed = window_bits;
+    for (size_t i = 0; i < noise_length; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        noise[i] = seed >> 16;
+    };
+
+    size_t first_length = 0;
+    for (int i = 0; i < 2 && passed; ++i)
+    {
+        passed &= ws_test002_round_trip(server, client, noise, noise_length, &compressed_length);
+        if (i == 0) first_length = compressed_length;
+        else if (no_context_takeover ? compressed_length != first_length : compressed_length >= first_length / 2) passed = 0;
+    };
+
+    /** A message which inflates past the limit is refused. */
+    struct vector compressed = {0};
+    struct vector inflated = {0};
+    if (passed && ws_deflate_compress(server, message, WS_TEST002_MESSAGE_LENGTH, &compressed) == 0)
+        passed &= ws_deflate_decompress(client, compressed.elements, compressed.size, &inflated, WS_TEST002_MESSAGE_LENGTH - 1) == -2 && inflated.elements == NULL;
+
+    if (compressed.elements != NULL) vector_free(&compressed);
+
+    if (!passed) printf(ANSI_RED "[WS TEST CASE 002] messages did not round trip with a window of %d bits%s\n" ANSI_RESET, window_bits, no_context_takeover ? " without context takeover" : "");
+
+    ws_deflate_free(server);
+    ws_deflate_free(client);
+
+    return passed;
+};
+
+static int ws_test002()
+{
+    uint8_t *message = malloc(WS_TEST002_MESSAGE_LENGTH);
+    ws_test002_fill(message, WS_TEST002_MESSAGE_LENGTH, 2);
+
+    int passed = 1;
+
+    /** A server window of 8 bits cannot be compressed with, so an offer asking for it is refused in favour of the next one. */
+    struct ws_deflate_config server_config = { .enabled = true };
+    struct ws_deflate_options negotiated = {0};
+    if (ws_deflate_accept_offer("permessage-deflate; server_max_window_bits=8", &server_config, &negotiated) != -1
+        || ws_deflate_accept_offer("permessage-deflate; server_max_window_bits=8, permessage-deflate; server_max_window_bits=9", &server_config, &negotiated) != 0 || negotiated.server_max_window_bits != 9)
+    {
+        printf(ANSI_RED "[WS TEST CASE 002] offer of a window of 8 bits was not refused in favour of the next one\n" ANSI_RESET);
+        passed = 0;
+    };
+
+    for (uint8_t window_bits = 9; window_bits <= WS_DEFLATE_MAX_WINDOW_BITS; ++window_bits)
+    {
+        passed &= ws_test002_window(window_bits, false, message);
+        passed &= ws_test002_window(window_bits, true, message);
+    };
+
+    free(message);
+
+    if (passed) printf(ANSI_GREEN "[WS TEST CASE 002] messages round tripped through permessage-deflate at every window size\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // WS_TEST_002
@@ -0,0 +1,118 @@
+#ifndef WS_TEST_003
+#define WS_TEST_003
+
+/**
+ * TEST CASE 3: masking payloads with the kernel selected for the CPU, against masking them one byte at a time
+*/
+
+#include "../../include/utils/simd.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The longest payload masked at every length, which covers the vector loop, the word loop and the bytes after them of every kernel. */
+#define WS_TEST003_MAX_LENGTH 300
+/** The length of the payload masked in parts, which is long enough for many vectors. */
+#define WS_TEST003_LONG_LENGTH 65539
+
+static void ws_test003_mask_reference(uint8_t *destination, const uint8_t *source, size_t length, const uint8_t masking_key[4], size_t phase);
+static int ws_test003_compare(const uint8_t *source, size_t length, size_t offset, const uint8_t masking_key[4], size_t phase);
+static int ws_test003();
+
+/** Masks a payload one byte at a time, as RFC 6455 describes it. */
+static void ws_test003_mask_reference(uint8_t *destination, const uint8_t *source, size_t length, const uint8_t masking_key[4], size_t phase)
+{
+    for (size_t i = 0; i < length; ++i) destination[i] = source[i] ^ masking_key[(phase + i) % 4];
+};
+
+/** Masks a payload at an offset from the alignment of the buffers, both into another buffer and in place. Returns whether or not both match the reference. */
+static int ws_test003_compare(const uint8_t *source, size_t length, size_t offset, const uint8_t masking_key[4], size_t phase)
+{
+    static uint8_t expected[WS_TEST003_MAX_LENGTH];
+    static uint8_t masked[WS_TEST003_MAX_LENGTH + 64];
+
+    ws_test003_mask_reference(expected, source, length, masking_key, phase);
+
+    /** The bytes around the payload are filled, so a kernel which writes past either end is caught. */
+    memset(masked, 0xAA, sizeof(masked));
+    simd_mask(masked + offset, source, length, masking_key, phase);
+
+    int matches = memcmp(masked + offset, expected, length) == 0;
+    for (size_t i = 0; i < offset; ++i) matches &= masked[i] == 0xAA;
+    for (size_t i = offset + length; i < sizeof(masked); ++i) matches &= masked[i] == 0xAA;
+
+    memcpy(masked + offset, source, length);
+    simd_mask(masked + offset, masked + offset, length, masking_key, phase);
+    matches &= memcmp(masked + offset, expected, length) == 0;
+
+    return matches;
+};
+
+static int ws_test003()
+{
+    const uint8_t masking_key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+    uint8_t *source = malloc(WS_TEST003_LONG_LENGTH + 32);
+    uint32_t seed = 3;
+    for (size_t i = 0; i < WS_TEST003_LONG_LENGTH + 32; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        source[i] = seed >> 16;
+    };
+
+    int passed = 1;
+
+    /** Every length, at every phase of the key, from and into buffers which are not aligned the same way. */
+    for (size_t length = 0; length <= WS_TEST003_MAX_LENGTH && passed; ++length)
+    {
+        for (size_t phase = 0; phase < 8 && passed; ++phase)
+        {
+            for (size_t offset = 0; offset < 32 && passed; offset += 7)
+            {
+                if (!ws_test003_compare(source + offset % 5, length, offset, masking_key, phase))
+                {
+                    printf(ANSI_RED "[WS TEST CASE 003] %zu bytes at phase %zu and offset %zu were not masked like the reference\n" ANSI_RESET, length, phase, offset);
+                    passed = 0;
+                };
+            };
+        };
+    };
+
+    /** A payload masked in parts of odd lengths, each at the phase the last one ended on, is masked as if it were whole. */
+    uint8_t *expected = malloc(WS_TEST003_LONG_LENGTH);
+    uint8_t *masked = malloc(WS_TEST003_LONG_LENGTH);
+    ws_test003_mask_reference(expected, source, WS_TEST003_LONG_LENGTH, masking_key, 0);
+
+    size_t masked_length = 0;
+    for (size_t part = 1; masked_length < WS_TEST003_LONG_LENGTH; part = part * 3 + 1)
+    {
+        size_t length = part < WS_TEST003_LONG_LENGTH - masked_length ? part : WS_TEST003_LONG_LENGTH - masked_length;
+        simd_mask(masked + masked_length, source + masked_length, length, masking_key, masked_length);
+        masked_length += length;
+    };
+
+    if (memcmp(masked, expected, WS_TEST003_LONG_LENGTH) != 0)
+    {
+        printf(ANSI_RED "[WS TEST CASE 003] payload masked in parts was not masked like the whole of it\n" ANSI_RESET);
+        passed = 0;
+    };
+
+    free(source);
+    free(expected);
+    free(masked);
+
+    if (passed) printf(ANSI_GREEN "[WS TEST CASE 003] payloads were masked like the reference at every length, phase and alignment (SIMD level %d)\n" ANSI_RESET, simd_get_level());
+    return passed ? 0 : 1;
+};
+
+#endif // WS_TEST_003
@@ -0,0 +1,239 @@
+#ifndef WS_TEST_004
+#define WS_TEST_004
+
+/**
+ * TEST CASE 4: topics, which clients subscribe to and unsubscribe from, and which a message is published to once for all of their subscribers
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/ws/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8926
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The number of clients subscribed to the topic. */
+#define WS_TEST004_CLIENTS 3
+
+static struct web_server ws_test004_server = {0};
+
+/** The result of the last command a client sent, or `-1` until the server handled it. */
+static volatile int ws_test004_result = -1;
+
+static void ws_test004_server_on_handshake(struct web_server *server, struct web_client *client, struct http_request *request);
+static void ws_test004_server_on_message(struct web_server *server, struct web_client *client, struct ws_message *message);
+static int ws_test004_connect(struct tcp_client *client);
+static int ws_test004_command(struct tcp_client *client, const char *command);
+static int ws_test004_published(struct tcp_client *client);
+static int ws_test004();
+
+/** Upgrades every connection, and subscribes it to the topic. */
+static void ws_test004_server_on_handshake(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    if (ws_server_upgrade_connection(server, client, request) == 0) ws_server_subscribe(server, client, "chat");
+};
+
+/** Runs the command a client sent, and keeps its result. */
+static void ws_test004_server_on_message(struct web_server *server, struct web_client *client, struct ws_message *message)
+{
+    /** Text messages are terminated. */
+    const char *command = (const char *)message->buffer;
+    int result = -2;
+
+    if (strcmp(command, "pub") == 0)
+    {
+        struct ws_message published;
+        ws_build_message(&published, WS_OPCODE_TEXT, 5, (uint8_t *)"hello");
+        result = ws_server_publish(server, "chat", &published);
+    }
+    else if (strcmp(command, "sub") == 0) result = ws_server_subscribe(server, client, "chat");
+    else if (strcmp(command, "unsub") == 0) result = ws_server_unsubscribe(server, client, "chat");
+    else if (strcmp(command, "find") == 0) result = ws_topics_find(&server->topics, "chat") != NULL;
+
+    ws_test004_result = result;
+};
+
+/** Connects a blocking client and upgrades it, which stops waiting for bytes after a second. Returns `0`, or `-1` if it could not. */
+static int ws_test004_connect(struct tcp_client *client)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    memset(client, 0, sizeof(struct tcp_client));
+    if (tcp_client_init(client, (struct sockaddr *)&addr, 0) != 0 || tcp_client_connect(client) != 0) return -1;
+
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client->sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    const char *request = "GET /chat HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n";
+    if (tcp_client_send(client, request, strlen(request), 0) != strlen(request)) return -1;
+
+    /** The handshake is received a byte at a time, so no frame after it is read with it. */
+    char response[1024];
+    size_t received = 0;
+    while (received < sizeof(response) - 1 && tcp_client_receive(client, response + received, 1, 0) == 1)
+    {
+        response[++received] = '\0';
+        if (strstr(response, "\r\n\r\n") != NULL) return strstr(response, " 101 ") != NULL ? 0 : -1;
+    };
+
+    return -1;
+};
+
+/** Sends a command in a masked frame, and waits up to a second for the server to run it. Returns its result, or `-1` if it did not run. */
+static int ws_test004_command(struct tcp_client *client, const char *command)
+{
+    const uint8_t masking_key[4] = { 0x12, 0x34, 0x56, 0x78 };
+    size_t length = strlen(command);
+
+    uint8_t frame[2 + 4 + 125] = { 0x80 | WS_OPCODE_TEXT, 0x80 | (uint8_t)length };
+    memcpy(frame + 2, masking_key, 4);
+    for (size_t i = 0; i < length; ++i) frame[6 + i] = command[i] ^ masking_key[i % 4];
+
+    ws_test004_result = -1;
+    if (tcp_client_send(client, (char *)frame, 6 + length, 0) != 6 + length) return -1;
+
+    for (int i = 0; i < 100 && ws_test004_result == -1; ++i) usleep(10000);
+    return ws_test004_result;
+};
+
+/** Returns whether or not the published message is the next frame a client receives. */
+static int ws_test004_published(struct tcp_client *client)
+{
+    const uint8_t expected[] = { 0x80 | WS_OPCODE_TEXT, 5, 'h', 'e', 'l', 'l', 'o' };
+    uint8_t frame[sizeof(expected)];
+
+    size_t received = 0;
+    int result = 0;
+    while (received < sizeof(frame) && (result = tcp_client_receive(client, (char *)frame + received, sizeof(frame) - received, 0)) > 0) received += result;
+
+    return received == sizeof(frame) && memcmp(frame, expected, sizeof(frame)) == 0;
+};
+
+static int ws_test004()
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&ws_test004_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[WS TEST CASE 004] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    struct web_server_route route = { .path = "/chat", .on_ws_handshake_request = ws_test004_server_on_handshake, .on_ws_message = ws_test004_server_on_message };
+    web_server_create_route(&ws_test004_server, &route);
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &ws_test004_server);
+
+    int passed = 1;
+    struct tcp_client clients[WS_TEST004_CLIENTS];
+
+    int connected = 0;
+    for (int i = 0; i < WS_TEST004_CLIENTS; ++i) connected += ws_test004_connect(&clients[i]) == 0;
+
+    if (connected != WS_TEST004_CLIENTS)
+    {
+        printf(ANSI_RED "[WS TEST CASE 004] %d of %d clients were upgraded\n" ANSI_RESET, connected, WS_TEST004_CLIENTS);
+        passed = 0;
+
+        for (int i = 0; i < WS_TEST004_CLIENTS; ++i) tcp_client_close(&clients[i], false);
+    }
+    else
+    {
+        /** A message is published to every subscriber, including the one which published it. */
+        int sent = ws_test004_command(&clients[0], "pub");
+        int received = 0;
+        for (int i = 0; i < WS_TEST004_CLIENTS; ++i) received += ws_test004_published(&clients[i]);
+
+        if (sent != WS_TEST004_CLIENTS || received != WS_TEST004_CLIENTS || ws_test004_command(&clients[0], "sub") != 1)
+        {
+            printf(ANSI_RED "[WS TEST CASE 004] message was published to %d subscribers and received by %d of %d\n" ANSI_RESET, sent, received, WS_TEST004_CLIENTS);
+            passed = 0;
+        };
+
+        /** A client which unsubscribed is no longer published to, and cannot unsubscribe twice. */
+        if (ws_test004_command(&clients[1], "unsub") != 0 || ws_test004_command(&clients[1], "unsub") != 1 || ws_test004_command(&clients[0], "pub") != WS_TEST004_CLIENTS - 1
+            || !ws_test004_published(&clients[0]) || !ws_test004_published(&clients[2]))
+        {
+            printf(ANSI_RED "[WS TEST CASE 004] message was not published to the subscribers left after one unsubscribed\n" ANSI_RESET);
+            passed = 0;
+        };
+
+        char byte;
+        if (recv(clients[1].sockfd, &byte, 1, MSG_DONTWAIT) != -1)
+        {
+            printf(ANSI_RED "[WS TEST CASE 004] message was published to a client which unsubscribed\n" ANSI_RESET);
+            passed = 0;
+        };
+
+        /** A client which disconnects is unsubscribed, and the topic is removed once its last subscriber is. */
+        tcp_client_close(&clients[2], false);
+        usleep(100000);
+
+        if (ws_test004_command(&clients[0], "pub") != 1 || !ws_test004_published(&clients[0]))
+        {
+            printf(ANSI_RED "[WS TEST CASE 004] disconnected client was not unsubscribed\n" ANSI_RESET);
+            passed = 0;
+        };
+
+        tcp_client_close(&clients[0], false);
+        usleep(100000);
+
+        if (ws_test004_command(&clients[1], "find") != 0)
+        {
+            printf(ANSI_RED "[WS TEST CASE 004] topic was kept after its last subscriber disconnected\n" ANSI_RESET);
+            passed = 0;
+        };
+
+        tcp_client_close(&clients[1], false);
+    };
+
+    web_server_close(&ws_test004_server);
+    pthread_join(servt, NULL);
+
+    if (passed) printf(ANSI_GREEN "[WS TEST CASE 004] messages were published to the subscribers of a topic, which lost the clients that unsubscribed or disconnected\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // WS_TEST_004
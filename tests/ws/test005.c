@@ -0,0 +1,265 @@
+#ifndef WS_TEST_005
+#define WS_TEST_005
+
+/**
+ * TEST CASE 5: decoding frames at the lengths where their header changes, with the length in 7 bits, in 16 bits, or in 64 bits
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/ws/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8927
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The largest payload the server takes, which is its default. */
+#define WS_TEST005_MAX_PAYLOAD_LENGTH 65536
+
+static struct web_server ws_test005_server = {0};
+
+/** The payload the frames are cut from, masked on the way in and compared on the way back. */
+static uint8_t *ws_test005_payload = NULL;
+
+static void ws_test005_server_on_handshake(struct web_server *server, struct web_client *client, struct http_request *request);
+static void ws_test005_server_on_message(struct web_server *server, struct web_client *client, struct ws_message *message);
+static int ws_test005_connect(struct tcp_client *client);
+static int ws_test005_send_frame(struct tcp_client *client, size_t length, int split_header);
+static int ws_test005_receive(struct tcp_client *client, uint8_t *buffer, size_t length);
+static int ws_test005_receive_frame(struct tcp_client *client, uint8_t *opcode, uint8_t *payload, size_t capacity);
+static int ws_test005_echo(struct tcp_client *client, uint8_t *echoed, size_t length, int split_header);
+static int ws_test005();
+
+static void ws_test005_server_on_handshake(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    ws_server_upgrade_connection(server, client, request);
+};
+
+/** Sends every message back as it was received. */
+static void ws_test005_server_on_message(struct web_server *server, struct web_client *client, struct ws_message *message)
+{
+    ws_send_message(client, message, NULL, 1);
+};
+
+/** Connects a blocking client and upgrades it, which stops waiting for bytes after a second. Returns `0`, or `-1` if it could not. */
+static int ws_test005_connect(struct tcp_client *client)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    memset(client, 0, sizeof(struct tcp_client));
+    if (tcp_client_init(client, (struct sockaddr *)&addr, 0) != 0 || tcp_client_connect(client) != 0) return -1;
+
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client->sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    const char *request = "GET /echo HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n";
+    if (tcp_client_send(client, request, strlen(request), 0) != strlen(request)) return -1;
+
+    /** The handshake is received a byte at a time, so no frame after it is read with it. */
+    char response[1024];
+    size_t received = 0;
+    while (received < sizeof(response) - 1 && tcp_client_receive(client, response + received, 1, 0) == 1)
+    {
+        response[++received] = '\0';
+        if (strstr(response, "\r\n\r\n") != NULL) return strstr(response, " 101 ") != NULL ? 0 : -1;
+    };
+
+    return -1;
+};
+
+/** Sends a masked binary frame of the first `length` bytes of the payload, with its header split over many writes if asked to. Returns `0`, or `-1`. */
+static int ws_test005_send_frame(struct tcp_client *client, size_t length, int split_header)
+{
+    const uint8_t masking_key[4] = { 0xa1, 0x5e, 0x07, 0xc3 };
+
+    uint8_t header[14] = { 0x80 | WS_OPCODE_BINARY };
+    size_t header_length = 2;
+
+    /** The shortest encoding of the length, as RFC 6455 asks for. */
+    if (length <= 125) header[1] = 0x80 | length;
+    else if (length <= 0xFFFF)
+    {
+        header[1] = 0x80 | 126;
+        header[2] = length >> 8;
+        header[3] = length;
+        header_length = 4;
+    }
+    else
+    {
+        header[1] = 0x80 | 127;
+        for (int i = 0; i < 8; ++i) header[2 + i] = (uint64_t)length >> (8 * (7 - i));
+        header_length = 10;
+    };
+
+    memcpy(header + header_length, masking_key, 4);
+    header_length += 4;
+
+    uint8_t *frame = malloc(header_length + length);
+    memcpy(frame, header, header_length);
+    for (size_t i = 0; i < length; ++i) frame[header_length + i] = ws_test005_payload[i] ^ masking_key[i % 4];
+
+    /** A header split over many reads is only decoded once all of it arrived. */
+    size_t sent = 0;
+    int result = 1;
+    for (; split_header && sent < header_length && result > 0; ++sent)
+    {
+        result = tcp_client_send(client, (char *)frame + sent, 1, 0);
+        usleep(5000);
+    };
+
+    while (sent < header_length + length && (result = tcp_client_send(client, (char *)frame + sent, header_length + length - sent, 0)) > 0) sent += result;
+
+    free(frame);
+    return sent == header_length + length ? 0 : -1;
+};
+
+/** Receives exactly `length` bytes. Returns `0`, or `-1` if the connection closed or timed out first. */
+static int ws_test005_receive(struct tcp_client *client, uint8_t *buffer, size_t length)
+{
+    size_t received = 0;
+    int result = 0;
+    while (received < length && (result = tcp_client_receive(client, (char *)buffer + received, length - received, 0)) > 0) received += result;
+
+    return received == length ? 0 : -1;
+};
+
+/** Receives an unmasked frame from the server. Returns the length of its payload, or `-1`. */
+static int ws_test005_receive_frame(struct tcp_client *client, uint8_t *opcode, uint8_t *payload, size_t capacity)
+{
+    uint8_t header[8];
+    if (ws_test005_receive(client, header, 2) != 0 || (header[1] & 0x80) != 0) return -1;
+
+    *opcode = header[0] & 0x0F;
+    uint64_t length = header[1] & 0x7F;
+    if (length >= 126)
+    {
+        size_t length_bytes = length == 126 ? 2 : 8;
+        if (ws_test005_receive(client, header, length_bytes) != 0) return -1;
+
+        length = 0;
+        for (size_t i = 0; i < length_bytes; ++i) length = length << 8 | header[i];
+    };
+
+    if (length > capacity || ws_test005_receive(client, payload, length) != 0) return -1;
+    return (int)length;
+};
+
+/** Sends a frame and returns whether or not it came back with the same payload. */
+static int ws_test005_echo(struct tcp_client *client, uint8_t *echoed, size_t length, int split_header)
+{
+    uint8_t opcode = 0;
+    if (ws_test005_send_frame(client, length, split_header) != 0) return 0;
+
+    return ws_test005_receive_frame(client, &opcode, echoed, WS_TEST005_MAX_PAYLOAD_LENGTH + 1) == (int)length && opcode == WS_OPCODE_BINARY && memcmp(echoed, ws_test005_payload, length) == 0;
+};
+
+static int ws_test005()
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&ws_test005_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[WS TEST CASE 005] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    ws_test005_server.ws_server_config.max_payload_len = WS_TEST005_MAX_PAYLOAD_LENGTH;
+
+    struct web_server_route route = { .path = "/echo", .on_ws_handshake_request = ws_test005_server_on_handshake, .on_ws_message = ws_test005_server_on_message };
+    web_server_create_route(&ws_test005_server, &route);
+
+    ws_test005_payload = malloc(WS_TEST005_MAX_PAYLOAD_LENGTH + 1);
+    for (size_t i = 0; i <= WS_TEST005_MAX_PAYLOAD_LENGTH; ++i) ws_test005_payload[i] = (uint8_t)(i * 31 + (i >> 8));
+
+    uint8_t *echoed = malloc(WS_TEST005_MAX_PAYLOAD_LENGTH + 1);
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &ws_test005_server);
+
+    int passed = 1;
+    struct tcp_client client;
+
+    /** The last length of each encoding and the first of the next one, each sent with its header in one write and split over many. */
+    const size_t lengths[] = { 0, 125, 126, 127, 65535, 65536 };
+    if (ws_test005_connect(&client) != 0)
+    {
+        printf(ANSI_RED "[WS TEST CASE 005] client failed to connect or upgrade\n" ANSI_RESET);
+        passed = 0;
+    }
+    else
+    {
+        for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i)
+        {
+            for (int split_header = 0; split_header <= 1; ++split_header)
+            {
+                if (!ws_test005_echo(&client, echoed, lengths[i], split_header))
+                {
+                    printf(ANSI_RED "[WS TEST CASE 005] frame of %zu bytes%s was not decoded intact\n" ANSI_RESET, lengths[i], split_header ? " with its header split" : "");
+                    passed = 0;
+                };
+            };
+        };
+
+        /** One byte past the largest payload is refused, and the connection is closed instead of the frame being echoed. */
+        uint8_t opcode = 0;
+        int length = ws_test005_send_frame(&client, WS_TEST005_MAX_PAYLOAD_LENGTH + 1, 0) == 0 ? ws_test005_receive_frame(&client, &opcode, echoed, WS_TEST005_MAX_PAYLOAD_LENGTH + 1) : -1;
+        if (length != -1 && opcode != WS_OPCODE_CLOSE)
+        {
+            printf(ANSI_RED "[WS TEST CASE 005] frame of %d bytes past the largest payload was not refused\n" ANSI_RESET, WS_TEST005_MAX_PAYLOAD_LENGTH + 1);
+            passed = 0;
+        };
+    };
+
+    tcp_client_close(&client, false);
+
+    web_server_close(&ws_test005_server);
+    pthread_join(servt, NULL);
+
+    free(ws_test005_payload);
+    free(echoed);
+
+    if (passed) printf(ANSI_GREEN "[WS TEST CASE 005] frames were decoded at the lengths where their header changes\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // WS_TEST_005
@@ -0,0 +1,274 @@
+#ifndef WS_TEST_006
+#define WS_TEST_006
+
+/**
+ * TEST CASE 6: streaming the payload of messages to `on_ws_fragment` as it arrives, across reads and across the frames of a message
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/ws/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8928
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The length of the large message, which is more than the largest payload the server gathers, and the size of the writes it is sent in. */
+#define WS_TEST006_LARGE_LENGTH 200000
+#define WS_TEST006_CHUNK_SIZE 16384
+
+static struct web_server ws_test006_server = {0};
+
+/** The payload the messages are cut from, and what the server streamed of the last message. */
+static uint8_t *ws_test006_payload = NULL;
+static uint8_t *ws_test006_streamed = NULL;
+static size_t ws_test006_streamed_length = 0;
+/** The number of fragments of the last message, and of them the number which were final. */
+static int ws_test006_fragments = 0;
+static int ws_test006_finals = 0;
+/** The number of messages which were streamed to their final fragment. */
+static volatile int ws_test006_messages = 0;
+
+static void ws_test006_server_on_handshake(struct web_server *server, struct web_client *client, struct http_request *request);
+static void ws_test006_server_on_fragment(struct web_server *server, struct web_client *client, const uint8_t *data, size_t length, bool is_final);
+static int ws_test006_connect(struct tcp_client *client);
+static int ws_test006_send_frame(struct tcp_client *client, uint8_t first_byte, const uint8_t *payload, size_t length, size_t chunk_size);
+static int ws_test006_streamed_message(const uint8_t *expected, size_t length, int min_fragments);
+static int ws_test006_pong(struct tcp_client *client);
+static int ws_test006();
+
+static void ws_test006_server_on_handshake(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    ws_server_upgrade_connection(server, client, request);
+};
+
+/** Gathers what was streamed, only to compare it once the message ended. */
+static void ws_test006_server_on_fragment(struct web_server *server, struct web_client *client, const uint8_t *data, size_t length, bool is_final)
+{
+    if (ws_test006_streamed_length + length <= WS_TEST006_LARGE_LENGTH) memcpy(ws_test006_streamed + ws_test006_streamed_length, data, length);
+
+    ws_test006_streamed_length += length;
+    ++ws_test006_fragments;
+
+    if (is_final)
+    {
+        ++ws_test006_finals;
+        ++ws_test006_messages;
+    };
+};
+
+/** Connects a blocking client and upgrades it, which stops waiting for bytes after a second. Returns `0`, or `-1` if it could not. */
+static int ws_test006_connect(struct tcp_client *client)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    memset(client, 0, sizeof(struct tcp_client));
+    if (tcp_client_init(client, (struct sockaddr *)&addr, 0) != 0 || tcp_client_connect(client) != 0) return -1;
+
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client->sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    const char *request = "GET /stream HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n";
+    if (tcp_client_send(client, request, strlen(request), 0) != strlen(request)) return -1;
+
+    /** The handshake is received a byte at a time, so no frame after it is read with it. */
+    char response[1024];
+    size_t received = 0;
+    while (received < sizeof(response) - 1 && tcp_client_receive(client, response + received, 1, 0) == 1)
+    {
+        response[++received] = '\0';
+        if (strstr(response, "\r\n\r\n") != NULL) return strstr(response, " 101 ") != NULL ? 0 : -1;
+    };
+
+    return -1;
+};
+
+/** Sends a masked frame with the given first byte, in writes of `chunk_size` bytes a little apart so the server reads it in parts. Returns `0`, or `-1`. */
+static int ws_test006_send_frame(struct tcp_client *client, uint8_t first_byte, const uint8_t *payload, size_t length, size_t chunk_size)
+{
+    const uint8_t masking_key[4] = { 0x5c, 0x93, 0x2e, 0xd1 };
+
+    uint8_t header[14] = { first_byte };
+    size_t header_length = 2;
+
+    if (length <= 125) header[1] = 0x80 | length;
+    else if (length <= 0xFFFF)
+    {
+        header[1] = 0x80 | 126;
+        header[2] = length >> 8;
+        header[3] = length;
+        header_length = 4;
+    }
+    else
+    {
+        header[1] = 0x80 | 127;
+        for (int i = 0; i < 8; ++i) header[2 + i] = (uint64_t)length >> (8 * (7 - i));
+        header_length = 10;
+    };
+
+    memcpy(header + header_length, masking_key, 4);
+    header_length += 4;
+
+    uint8_t *frame = malloc(header_length + length);
+    memcpy(frame, header, header_length);
+    for (size_t i = 0; i < length; ++i) frame[header_length + i] = payload[i] ^ masking_key[i % 4];
+
+    size_t sent = 0;
+    int result = 0;
+    while (sent < header_length + length)
+    {
+        size_t remaining = header_length + length - sent;
+        if ((result = tcp_client_send(client, (char *)frame + sent, remaining < chunk_size ? remaining : chunk_size, 0)) <= 0) break;
+
+        sent += result;
+        if (sent < header_length + length) usleep(2000);
+    };
+
+    free(frame);
+    return sent == header_length + length ? 0 : -1;
+};
+
+/** Waits up to a second for a message to be streamed to its final fragment, and returns whether or not it was streamed intact in as many fragments as expected. Resets what was streamed. */
+static int ws_test006_streamed_message(const uint8_t *expected, size_t length, int min_fragments)
+{
+    for (int i = 0; i < 100 && ws_test006_messages == 0; ++i) usleep(10000);
+
+    int intact = ws_test006_messages == 1 && ws_test006_finals == 1 && ws_test006_fragments >= min_fragments
+        && ws_test006_streamed_length == length && memcmp(ws_test006_streamed, expected, length) == 0;
+
+    ws_test006_streamed_length = 0;
+    ws_test006_fragments = 0;
+    ws_test006_finals = 0;
+    ws_test006_messages = 0;
+
+    return intact;
+};
+
+/** Returns whether or not the next frame a client receives is the pong to its ping. */
+static int ws_test006_pong(struct tcp_client *client)
+{
+    const uint8_t expected[] = { 0x80 | WS_OPCODE_PONG, 4, 'p', 'i', 'n', 'g' };
+    uint8_t frame[sizeof(expected)];
+
+    size_t received = 0;
+    int result = 0;
+    while (received < sizeof(frame) && (result = tcp_client_receive(client, (char *)frame + received, sizeof(frame) - received, 0)) > 0) received += result;
+
+    return received == sizeof(frame) && memcmp(frame, expected, sizeof(frame)) == 0;
+};
+
+static int ws_test006()
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&ws_test006_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[WS TEST CASE 006] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    struct web_server_route route = { .path = "/stream", .on_ws_handshake_request = ws_test006_server_on_handshake, .on_ws_fragment = ws_test006_server_on_fragment };
+    web_server_create_route(&ws_test006_server, &route);
+
+    ws_test006_payload = malloc(WS_TEST006_LARGE_LENGTH);
+    ws_test006_streamed = malloc(WS_TEST006_LARGE_LENGTH);
+    for (size_t i = 0; i < WS_TEST006_LARGE_LENGTH; ++i) ws_test006_payload[i] = (uint8_t)(i * 7 + (i >> 9));
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &ws_test006_server);
+
+    int passed = 1;
+    struct tcp_client client;
+
+    if (ws_test006_connect(&client) != 0)
+    {
+        printf(ANSI_RED "[WS TEST CASE 006] client failed to connect or upgrade\n" ANSI_RESET);
+        passed = 0;
+    }
+    else
+    {
+        /** A frame larger than the largest payload the server gathers is streamed in the parts it was read in, and only its last part is final. */
+        if (ws_test006_send_frame(&client, 0x80 | WS_OPCODE_BINARY, ws_test006_payload, WS_TEST006_LARGE_LENGTH, WS_TEST006_CHUNK_SIZE) != 0
+            || !ws_test006_streamed_message(ws_test006_payload, WS_TEST006_LARGE_LENGTH, 2))
+        {
+            printf(ANSI_RED "[WS TEST CASE 006] frame of %d bytes was not streamed intact across reads\n" ANSI_RESET, WS_TEST006_LARGE_LENGTH);
+            passed = 0;
+        };
+
+        /** A message of many frames, one of them empty and a ping between them, is streamed as one message which ends with its last frame. */
+        const uint8_t ping[] = { 'p', 'i', 'n', 'g' };
+        int sent = ws_test006_send_frame(&client, WS_OPCODE_BINARY, ws_test006_payload, 1000, WS_TEST006_CHUNK_SIZE) == 0
+            && ws_test006_send_frame(&client, WS_OPCODE_CONTINUE, ws_test006_payload + 1000, 0, WS_TEST006_CHUNK_SIZE) == 0
+            && ws_test006_send_frame(&client, 0x80 | WS_OPCODE_PING, ping, sizeof(ping), WS_TEST006_CHUNK_SIZE) == 0
+            && ws_test006_send_frame(&client, WS_OPCODE_CONTINUE, ws_test006_payload + 1000, 300, WS_TEST006_CHUNK_SIZE) == 0
+            && ws_test006_send_frame(&client, 0x80 | WS_OPCODE_CONTINUE, ws_test006_payload + 1300, 200, WS_TEST006_CHUNK_SIZE) == 0;
+
+        if (!sent || !ws_test006_pong(&client) || !ws_test006_streamed_message(ws_test006_payload, 1500, 3))
+        {
+            printf(ANSI_RED "[WS TEST CASE 006] message of many frames was not streamed intact as one message\n" ANSI_RESET);
+            passed = 0;
+        };
+
+        /** Text is streamed as it was sent, without the terminator it is delivered to `on_ws_message` with. */
+        const char *text = "streamed text";
+        if (ws_test006_send_frame(&client, 0x80 | WS_OPCODE_TEXT, (const uint8_t *)text, strlen(text), WS_TEST006_CHUNK_SIZE) != 0
+            || !ws_test006_streamed_message((const uint8_t *)text, strlen(text), 1))
+        {
+            printf(ANSI_RED "[WS TEST CASE 006] text message was not streamed as it was sent\n" ANSI_RESET);
+            passed = 0;
+        };
+    };
+
+    tcp_client_close(&client, false);
+
+    web_server_close(&ws_test006_server);
+    pthread_join(servt, NULL);
+
+    free(ws_test006_payload);
+    free(ws_test006_streamed);
+
+    if (passed) printf(ANSI_GREEN "[WS TEST CASE 006] messages were streamed to their final fragment across reads and frames\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // WS_TEST_006
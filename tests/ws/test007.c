@@ -0,0 +1,293 @@
+#ifndef WS_TEST_007
+#define WS_TEST_007
+
+/**
+ * TEST CASE 7: sending messages split into frames, in batches of iovecs straight from the message, or masked into the scratch buffer of the connection
+*/
+
+#include "../../include/web/server.h"
+#include "../../include/ws/server.h"
+#include "../../include/tcp/client.h"
+#include "../../include/utils/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#undef IP
+#undef PORT
+#undef BACKLOG
+#undef ANSI_RED
+#undef ANSI_GREEN
+#undef ANSI_RESET
+
+#define IP "127.0.0.1"
+#define PORT 8929
+#define BACKLOG 3
+
+#define ANSI_RED "\x1b[31m"
+#define ANSI_GREEN "\x1b[32m"
+#define ANSI_RESET "\x1b[0m"
+
+/** The length of the longest message, which needs a 64 bit length and more than the scratch buffer starts with. */
+#define WS_TEST007_MAX_LENGTH 70000
+
+/** A message the server sends when asked to: its length, the number of frames it is split into, and whether or not it is masked. */
+struct ws_test007_case
+{
+    size_t length;
+    size_t num_frames;
+    int masked;
+};
+
+static const struct ws_test007_case ws_test007_cases[] = {
+    { WS_TEST007_MAX_LENGTH, 1, 0 },
+    { 1003, 5, 0 },
+    { 1003, WS_SEND_BATCH * 2 + 3, 0 },
+    { 0, 3, 0 },
+    { 10, 0, 0 },
+    { 1003, 5, 1 },
+    { WS_TEST007_MAX_LENGTH, WS_SEND_BATCH + 1, 1 },
+    { 1003, 5, 1 }
+};
+
+static const uint8_t ws_test007_masking_key[4] = { 0x0f, 0xa5, 0x3c, 0x71 };
+
+static struct web_server ws_test007_server = {0};
+
+/** The payload the messages are cut from. */
+static uint8_t *ws_test007_payload = NULL;
+/** What the server returned for the last message it sent, whether or not the message was left as it was, and the scratch buffer after it. */
+static int ws_test007_result = 0;
+static int ws_test007_untouched = 0;
+static void *ws_test007_scratch = NULL;
+static size_t ws_test007_scratch_capacity = 0;
+/** Whether or not the server sent the last message it was asked to. */
+static volatile int ws_test007_handled = 0;
+
+static void ws_test007_server_on_handshake(struct web_server *server, struct web_client *client, struct http_request *request);
+static void ws_test007_server_on_message(struct web_server *server, struct web_client *client, struct ws_message *message);
+static int ws_test007_connect(struct tcp_client *client);
+static int ws_test007_command(struct tcp_client *client, int index);
+static int ws_test007_receive(struct tcp_client *client, uint8_t *buffer, size_t length);
+static int ws_test007_received_message(struct tcp_client *client, const struct ws_test007_case *test_case);
+static int ws_test007();
+
+static void ws_test007_server_on_handshake(struct web_server *server, struct web_client *client, struct http_request *request)
+{
+    ws_server_upgrade_connection(server, client, request);
+};
+
+/** Sends the message the client asked for from a copy of the payload, and records what sending it did. */
+static void ws_test007_server_on_message(struct web_server *server, struct web_client *client, struct ws_message *message)
+{
+    const struct ws_test007_case *test_case = &ws_test007_cases[atoi((const char *)message->buffer)];
+
+    static uint8_t buffer[WS_TEST007_MAX_LENGTH];
+    memcpy(buffer, ws_test007_payload, test_case->length);
+
+    struct ws_message sent;
+    ws_build_message(&sent, WS_OPCODE_BINARY, test_case->length, buffer);
+
+    uint8_t masking_key[4];
+    memcpy(masking_key, ws_test007_masking_key, 4);
+
+    ws_test007_result = ws_send_message(client, &sent, test_case->masked ? masking_key : NULL, test_case->num_frames);
+    ws_test007_untouched = memcmp(buffer, ws_test007_payload, test_case->length) == 0;
+    ws_test007_scratch = client->send_scratch.elements;
+    ws_test007_scratch_capacity = client->send_scratch.capacity;
+    ws_test007_handled = 1;
+};
+
+/** Connects a blocking client and upgrades it, which stops waiting for bytes after a second. Returns `0`, or `-1` if it could not. */
+static int ws_test007_connect(struct tcp_client *client)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT)
+    };
+    inet_pton(AF_INET, IP, &(addr.sin_addr));
+
+    memset(client, 0, sizeof(struct tcp_client));
+    if (tcp_client_init(client, (struct sockaddr *)&addr, 0) != 0 || tcp_client_connect(client) != 0) return -1;
+
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client->sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+
+    const char *request = "GET /send HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n";
+    if (tcp_client_send(client, request, strlen(request), 0) != strlen(request)) return -1;
+
+    /** The handshake is received a byte at a time, so no frame after it is read with it. */
+    char response[1024];
+    size_t received = 0;
+    while (received < sizeof(response) - 1 && tcp_client_receive(client, response + received, 1, 0) == 1)
+    {
+        response[++received] = '\0';
+        if (strstr(response, "\r\n\r\n") != NULL) return strstr(response, " 101 ") != NULL ? 0 : -1;
+    };
+
+    return -1;
+};
+
+/** Asks the server for a message, in a masked text frame with the index of its case. Returns `0`, or `-1`. */
+static int ws_test007_command(struct tcp_client *client, int index)
+{
+    const uint8_t masking_key[4] = { 0x12, 0x34, 0x56, 0x78 };
+
+    char command[16];
+    size_t length = sprintf(command, "%d", index);
+
+    uint8_t frame[2 + 4 + sizeof(command)] = { 0x80 | WS_OPCODE_TEXT, 0x80 | (uint8_t)length };
+    memcpy(frame + 2, masking_key, 4);
+    for (size_t i = 0; i < length; ++i) frame[6 + i] = command[i] ^ masking_key[i % 4];
+
+    ws_test007_handled = 0;
+    return tcp_client_send(client, (char *)frame, 6 + length, 0) == 6 + length ? 0 : -1;
+};
+
+/** Receives exactly `length` bytes. Returns `0`, or `-1` if the connection closed or timed out first. */
+static int ws_test007_receive(struct tcp_client *client, uint8_t *buffer, size_t length)
+{
+    size_t received = 0;
+    int result = 0;
+    while (received < length && (result = tcp_client_receive(client, (char *)buffer + received, length - received, 0)) > 0) received += result;
+
+    return received == length ? 0 : -1;
+};
+
+/** Receives the frames of a message, and returns whether or not they split and mask its payload the way it was asked for. */
+static int ws_test007_received_message(struct tcp_client *client, const struct ws_test007_case *test_case)
+{
+    static uint8_t payload[WS_TEST007_MAX_LENGTH];
+
+    size_t num_frames = test_case->num_frames == 0 ? 1 : test_case->num_frames;
+    size_t split_length = test_case->length / num_frames;
+    size_t received = 0;
+
+    for (size_t i = 0; i < num_frames; ++i)
+    {
+        uint8_t header[8];
+        if (ws_test007_receive(client, header, 2) != 0) return 0;
+
+        /** Only the first frame has the opcode, and only the last one is final. */
+        int fin = (header[0] & 0x80) != 0;
+        int opcode = header[0] & 0x0F;
+        if (fin != (i + 1 == num_frames) || opcode != (i == 0 ? WS_OPCODE_BINARY : WS_OPCODE_CONTINUE)) return 0;
+
+        int masked = (header[1] & 0x80) != 0;
+        uint64_t length = header[1] & 0x7F;
+        if (masked != test_case->masked) return 0;
+
+        if (length >= 126)
+        {
+            size_t length_bytes = length == 126 ? 2 : 8;
+            if (ws_test007_receive(client, header, length_bytes) != 0) return 0;
+
+            length = 0;
+            for (size_t j = 0; j < length_bytes; ++j) length = length << 8 | header[j];
+        };
+
+        /** The last frame takes what is left over of splitting the payload evenly. */
+        uint64_t expected_length = i + 1 == num_frames ? test_case->length - split_length * (num_frames - 1) : split_length;
+        if (length != expected_length) return 0;
+
+        uint8_t masking_key[4] = {0};
+        if (masked && (ws_test007_receive(client, masking_key, 4) != 0 || memcmp(masking_key, ws_test007_masking_key, 4) != 0)) return 0;
+        if (ws_test007_receive(client, payload + received, length) != 0) return 0;
+
+        /** Every frame is masked from the start of the key. */
+        for (uint64_t j = 0; j < length; ++j) payload[received + j] ^= masking_key[j % 4];
+        received += length;
+    };
+
+    for (int i = 0; i < 100 && ws_test007_handled == 0; ++i) usleep(10000);
+    return ws_test007_handled && ws_test007_result == 1 && ws_test007_untouched && received == test_case->length && memcmp(payload, ws_test007_payload, received) == 0;
+};
+
+static int ws_test007()
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons(PORT)
+    };
+
+    if (web_server_init(&ws_test007_server, (struct sockaddr *)&addr, BACKLOG) != 0)
+    {
+        printf(ANSI_RED "[WS TEST CASE 007] server failed to initialize\nerrno: %d\nerrno reason: %d\n%s", errno, netc_errno_reason, ANSI_RESET);
+        return 1;
+    };
+
+    struct web_server_route route = { .path = "/send", .on_ws_handshake_request = ws_test007_server_on_handshake, .on_ws_message = ws_test007_server_on_message };
+    web_server_create_route(&ws_test007_server, &route);
+
+    ws_test007_payload = malloc(WS_TEST007_MAX_LENGTH);
+    for (size_t i = 0; i < WS_TEST007_MAX_LENGTH; ++i) ws_test007_payload[i] = (uint8_t)(i * 13 + (i >> 10));
+
+    pthread_t servt;
+    pthread_create(&servt, NULL, (void *)web_server_start, &ws_test007_server);
+
+    int passed = 1;
+    struct tcp_client client;
+
+    if (ws_test007_connect(&client) != 0)
+    {
+        printf(ANSI_RED "[WS TEST CASE 007] client failed to connect or upgrade\n" ANSI_RESET);
+        passed = 0;
+    }
+    else
+    {
+        /** The scratch buffer of the connection after each message, which only masking needs. */
+        void *scratches[sizeof(ws_test007_cases) / sizeof(ws_test007_cases[0])] = {0};
+        size_t capacities[sizeof(ws_test007_cases) / sizeof(ws_test007_cases[0])] = {0};
+
+        for (size_t i = 0; i < sizeof(ws_test007_cases) / sizeof(ws_test007_cases[0]); ++i)
+        {
+            const struct ws_test007_case *test_case = &ws_test007_cases[i];
+            if (ws_test007_command(&client, i) != 0 || !ws_test007_received_message(&client, test_case))
+            {
+                printf(ANSI_RED "[WS TEST CASE 007] %s message of %zu bytes was not sent intact in %zu frames\n" ANSI_RESET, test_case->masked ? "masked" : "unmasked", test_case->length, test_case->num_frames);
+                passed = 0;
+            };
+
+            scratches[i] = ws_test007_scratch;
+            capacities[i] = ws_test007_scratch_capacity;
+        };
+
+        /** Messages which are not masked are sent without the scratch buffer, which then grows for the larger masked message and is kept for the next one. */
+        size_t last = sizeof(ws_test007_cases) / sizeof(ws_test007_cases[0]) - 1;
+        if (scratches[4] != NULL || scratches[5] == NULL || capacities[last - 1] < WS_TEST007_MAX_LENGTH || scratches[last] != scratches[last - 1] || capacities[last] != capacities[last - 1])
+        {
+            printf(ANSI_RED "[WS TEST CASE 007] scratch buffer was not kept across masked messages (%zu bytes, then %zu)\n" ANSI_RESET, capacities[last - 1], capacities[last]);
+            passed = 0;
+        };
+    };
+
+    tcp_client_close(&client, false);
+
+    web_server_close(&ws_test007_server);
+    pthread_join(servt, NULL);
+
+    free(ws_test007_payload);
+
+    if (passed) printf(ANSI_GREEN "[WS TEST CASE 007] messages were split into frames and masked without touching them, through a scratch buffer which was kept\n" ANSI_RESET);
+    return passed ? 0 : 1;
+};
+
+#endif // WS_TEST_007